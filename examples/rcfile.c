@@ -46,25 +46,30 @@ int main(int argc, char **argv) {
   int fd;
   char pstr[1024];
   sexp_t *sx, *param;
+  sexp_alist_t *params;
   sexp_iowrap_t *iow;
 
   fd = open("testrc",O_RDONLY);
   iow = init_iowrap(fd);
   sx = read_one_sexp(iow);
+
+  /* index the parameters once instead of searching for each one */
+  params = sexp_alist_index(sx);
   
-  param = find_sexp("parameter1",sx);
-  print_sexp(pstr,1024,param->next);
+  param = sexp_alist_get(params,"parameter1");
+  print_sexp(pstr,1024,param->list->next);
   printf("parameter1 = %s\n",pstr);
   
-  param = find_sexp("parameter2",sx);
-  print_sexp(pstr,1024,param->next);
+  param = sexp_alist_get(params,"parameter2");
+  print_sexp(pstr,1024,param->list->next);
   printf("parameter2 = %s\n",pstr);
   
-  param = find_sexp("parameter3",sx);
+  param = sexp_alist_get(params,"parameter3");
   if (param == NULL) {
     printf("parameter3 not defined.\n");
   }
   
+  destroy_sexp_alist(params);
   destroy_sexp(sx);
   destroy_iowrap(iow);
   sexp_cleanup();
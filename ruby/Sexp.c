@@ -135,48 +135,81 @@ static void sexp_rubyfree(void *s) {
   destroy_sexp(sx);
 }
 
-/* given a sexp_t, recursively turn it into a ruby array of strings.
- * This is not sufficient to deal with DQUOTE and SQUOTE atoms.
- * This needs to be fixed eventually.  Likely by storing either:
- *   1. A second array corresponding to the first of sexp_t types
- *   2. Replacing string elements in the array(s) with a record type
- *      containing the string and the type.
+/* sexp_to_array walk state.  arrays is a ruby array used as a stack of
+ * the arrays being filled in, innermost last.
  */
-static VALUE sexp_to_array(sexp_t *sx, int aggressive_typing) {
-  VALUE     a = rb_ary_new(); /* create array */
-  sexp_t   *s = sx;
+typedef struct {
+  VALUE arrays;
+  int   aggressive_typing;
+} to_array_t;
+
+static sexp_walk_t to_array_pre(sexp_t *s, unsigned int depth, void *data) {
+  to_array_t *ta = (to_array_t *)data;
+  VALUE     a = rb_ary_entry(ta->arrays, -1);
+  VALUE     b;
   sval_type svt;
   int       i;
   double    d;
 
-  while (s != NULL) {
-    if (s->ty == SEXP_LIST) {
-      rb_ary_push(a, sexp_to_array(s->list, aggressive_typing));
-    } else {
-      if (aggressive_typing == 1) {
-        svt = infer_sval_type(s);
-        switch (svt) {
-        case SVAL_INTEGER:
-          i = atoi(s->val);
-          rb_ary_push(a, INT2FIX(i));
-          break;
-        case SVAL_REAL:
-          d = strtod(s->val,NULL);
-          rb_ary_push(a, rb_float_new(d));
-          break;
-        case SVAL_NONE:
-          rb_fatal("ERROR: infer_sval_type => SVAL_NONE for array elt.\n");
-          break;
-        default:
-          rb_ary_push(a, rb_str_new2(s->val));
-        }
-      } else { /* no aggressive typing - everything is a string */
+  if (s->ty == SEXP_LIST) {
+    b = rb_ary_new();
+    rb_ary_push(a, b);
+    if (s->list != NULL)
+      rb_ary_push(ta->arrays, b);
+  } else {
+    if (ta->aggressive_typing == 1) {
+      svt = infer_sval_type(s);
+      switch (svt) {
+      case SVAL_INTEGER:
+        i = atoi(s->val);
+        rb_ary_push(a, INT2FIX(i));
+        break;
+      case SVAL_REAL:
+        d = strtod(s->val,NULL);
+        rb_ary_push(a, rb_float_new(d));
+        break;
+      case SVAL_NONE:
+        rb_fatal("ERROR: infer_sval_type => SVAL_NONE for array elt.\n");
+        break;
+      default:
         rb_ary_push(a, rb_str_new2(s->val));
       }
+    } else { /* no aggressive typing - everything is a string */
+      rb_ary_push(a, rb_str_new2(s->val));
     }
-    s = s->next;
   }
-  
+
+  return SEXP_WALK_CONTINUE;
+}
+
+static sexp_walk_t to_array_post(sexp_t *s, unsigned int depth, void *data) {
+  to_array_t *ta = (to_array_t *)data;
+
+  if (s->ty == SEXP_LIST && s->list != NULL)
+    rb_ary_pop(ta->arrays);
+
+  return SEXP_WALK_CONTINUE;
+}
+
+/* given a sexp_t, turn it and the elements following it into a ruby array
+ * of strings.  Nested lists are walked with sexp_walk rather than by
+ * recursion, so deeply nested input does not exhaust the C stack.
+ * This is not sufficient to deal with DQUOTE and SQUOTE atoms.
+ * This needs to be fixed eventually.  Likely by storing either:
+ *   1. A second array corresponding to the first of sexp_t types
+ *   2. Replacing string elements in the array(s) with a record type
+ *      containing the string and the type.
+ */
+static VALUE sexp_to_array(sexp_t *sx, int aggressive_typing) {
+  VALUE      a = rb_ary_new(); /* create array */
+  to_array_t ta;
+
+  ta.arrays = rb_ary_new();
+  ta.aggressive_typing = aggressive_typing;
+  rb_ary_push(ta.arrays, a);
+
+  sexp_walk(sx, to_array_pre, to_array_post, &ta);
+
   return a;
 }
 
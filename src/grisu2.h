@@ -0,0 +1,238 @@
+/**
+   @cond IGNORE
+
+   Grisu2, from Florian Loitsch, "Printing Floating-Point Numbers Quickly
+   and Accurately with Integers" (PLDI 2010), after the C++ version by
+   Milo Yip in dtoa-benchmark, which is under the MIT license:
+
+   Copyright (C) 2014 Milo Yip
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the
+   "Software"), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+   @endcond
+**/
+
+/*
+ * The digits of a double, for sexp_format_double.  This file has no
+ * include guard: sexp.c includes it once.
+ *
+ * grisu2 writes the decimal digits of a positive, finite double with
+ * integer arithmetic only, and sets *K to the power of ten they are
+ * scaled by.  The digits always read back as the same double, and for
+ * all but a small fraction of doubles there are as few of them as can.
+ */
+
+/* f times 2^e */
+typedef struct {
+  unsigned long long f;
+  int e;
+} grisu_fp_t;
+
+#define GRISU_HIDDEN_BIT    0x0010000000000000ULL
+#define GRISU_FRACTION_MASK 0x000FFFFFFFFFFFFFULL
+#define GRISU_EXPONENT_BIAS 1075
+
+/* 10^k for k = -348, -340, ..., 340, each rounded to 64 bits */
+static const unsigned long long grisu_pow_f[] = {
+  0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL,
+  0xcf42894a5dce35eaULL, 0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL,
+  0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL, 0xbe5691ef416bd60cULL,
+  0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+  0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL,
+  0xc21094364dfb5637ULL, 0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL,
+  0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL, 0xb23867fb2a35b28eULL,
+  0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+  0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL,
+  0xb5b5ada8aaff80b8ULL, 0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL,
+  0x964e858c91ba2655ULL, 0xdff9772470297ebdULL, 0xa6dfbd9fb8e5b88fULL,
+  0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+  0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL,
+  0xaa242499697392d3ULL, 0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL,
+  0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL, 0x9c40000000000000ULL,
+  0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+  0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL,
+  0x9f4f2726179a2245ULL, 0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL,
+  0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL, 0x924d692ca61be758ULL,
+  0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+  0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL,
+  0x952ab45cfa97a0b3ULL, 0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL,
+  0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL, 0x88fcf317f22241e2ULL,
+  0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+  0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL,
+  0x8bab8eefb6409c1aULL, 0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL,
+  0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL, 0x80444b5e7aa7cf85ULL,
+  0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+  0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL
+};
+
+static const short grisu_pow_e[] = {
+  -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+  -954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+  -688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+  -422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+  -157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+  109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+  375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+  641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+  907, 933, 960, 986, 1013, 1039, 1066
+};
+
+static const unsigned long long grisu_pow10[] = {
+  1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+  10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL,
+  100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+  100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+  100000000000000000ULL, 1000000000000000000ULL,
+  10000000000000000000ULL
+};
+
+/* the top 64 bits of the product, rounded */
+static grisu_fp_t grisu_multiply(grisu_fp_t x, grisu_fp_t y) {
+  const unsigned long long m32 = 0xFFFFFFFFULL;
+  unsigned long long a = x.f >> 32, b = x.f & m32;
+  unsigned long long c = y.f >> 32, d = y.f & m32;
+  unsigned long long ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+  unsigned long long mid = (bd >> 32) + (ad & m32) + (bc & m32);
+  grisu_fp_t r;
+
+  mid += 1ULL << 31;
+  r.f = ac + (ad >> 32) + (bc >> 32) + (mid >> 32);
+  r.e = x.e + y.e + 64;
+
+  return r;
+}
+
+static grisu_fp_t grisu_normalize(grisu_fp_t x) {
+  while ((x.f & 0x8000000000000000ULL) == 0) {
+    x.f <<= 1;
+    x.e--;
+  }
+
+  return x;
+}
+
+/* move the last digit down while that brings it closer to w, staying
+   inside the interval */
+static void grisu_round(char *buf, int len, unsigned long long delta,
+                        unsigned long long rest, unsigned long long ten_kappa,
+                        unsigned long long wp_w) {
+  while (rest < wp_w && delta - rest >= ten_kappa &&
+         (rest + ten_kappa < wp_w ||
+          wp_w - rest > rest + ten_kappa - wp_w)) {
+    buf[len - 1]--;
+    rest += ten_kappa;
+  }
+}
+
+static int grisu2(double v, char *buf, int *K) {
+  grisu_fp_t w, wp, wm, c, one;
+  unsigned long long bits, delta, p2, rest, wp_w;
+  unsigned int p1, d;
+  double dk;
+  int k, kappa, len = 0;
+
+  memcpy(&bits, &v, sizeof(bits));
+  w.f = bits & GRISU_FRACTION_MASK;
+  w.e = (int) ((bits >> 52) & 0x7FF);
+  if (w.e != 0) {
+    w.f += GRISU_HIDDEN_BIT;
+    w.e -= GRISU_EXPONENT_BIAS;
+  } else {
+    w.e = 1 - GRISU_EXPONENT_BIAS;
+  }
+
+  /* the bounds halfway to the doubles on either side; the lower one is
+     closer at a power of two */
+  wp.f = (w.f << 1) + 1;
+  wp.e = w.e - 1;
+  wp = grisu_normalize(wp);
+  if (w.f == GRISU_HIDDEN_BIT) {
+    wm.f = (w.f << 2) - 1;
+    wm.e = w.e - 2;
+  } else {
+    wm.f = (w.f << 1) - 1;
+    wm.e = w.e - 1;
+  }
+  wm.f <<= wm.e - wp.e;
+  wm.e = wp.e;
+
+  /* scale by the cached power that brings the exponent between -60
+     and -32, so the integer part fits in 32 bits */
+  dk = (-61 - wp.e) * 0.30102999566398114 + 347;
+  k = (int) dk;
+  if (dk - k > 0.0)
+    k++;
+  k = (k >> 3) + 1;
+  *K = -(-348 + (k << 3));
+  c.f = grisu_pow_f[k];
+  c.e = grisu_pow_e[k];
+
+  w = grisu_multiply(grisu_normalize(w), c);
+  wp = grisu_multiply(wp, c);
+  wm = grisu_multiply(wm, c);
+  wm.f++;
+  wp.f--;
+
+  /* the digits of wp, until what is left is within the interval */
+  delta = wp.f - wm.f;
+  one.f = 1ULL << -wp.e;
+  one.e = wp.e;
+  wp_w = wp.f - w.f;
+  p1 = (unsigned int) (wp.f >> -one.e);
+  p2 = wp.f & (one.f - 1);
+
+  kappa = 1;
+  while (kappa < 10 && p1 >= grisu_pow10[kappa])
+    kappa++;
+
+  while (kappa > 0) {
+    d = (unsigned int) (p1 / grisu_pow10[kappa - 1]);
+    p1 = (unsigned int) (p1 % grisu_pow10[kappa - 1]);
+    if (d != 0 || len != 0)
+      buf[len++] = (char) ('0' + d);
+    kappa--;
+    rest = ((unsigned long long) p1 << -one.e) + p2;
+    if (rest <= delta) {
+      *K += kappa;
+      grisu_round(buf, len, delta, rest, grisu_pow10[kappa] << -one.e, wp_w);
+      return len;
+    }
+  }
+
+  for (;;) {
+    p2 *= 10;
+    delta *= 10;
+    d = (unsigned int) (p2 >> -one.e);
+    if (d != 0 || len != 0)
+      buf[len++] = (char) ('0' + d);
+    p2 &= one.f - 1;
+    kappa--;
+    if (p2 < delta) {
+      *K += kappa;
+      grisu_round(buf, len, delta, p2, one.f,
+                  wp_w * (-kappa < 20 ? grisu_pow10[-kappa] : 0));
+      return len;
+    }
+  }
+}
+
+#undef GRISU_HIDDEN_BIT
+#undef GRISU_FRACTION_MASK
+#undef GRISU_EXPONENT_BIAS
@@ -64,7 +64,14 @@ sexp_iowrap_t *init_iowrap(int fd) {
     return NULL;
   }
 
-  iow->cc = NULL;
+  /* made here rather than by the first read, so that its limits and
+     recovery can be set before reading */
+  iow->cc = init_continuation(NULL);
+  if (iow->cc == NULL) {
+    sexp_free(iow, sizeof(sexp_iowrap_t));
+    return NULL;
+  }
+
   iow->fd = fd;
   iow->cnt = 0;
   iow->buf[0] = '\0';
@@ -91,8 +98,9 @@ sexp_t *read_one_sexp(sexp_iowrap_t *iow) {
   if (iow == NULL)
     return NULL;
 
-  /* check if we have more to parse from the continuation. */
-  if (iow->cc != NULL && iow->cc->lastPos != NULL) {
+  /* check if we have more to parse from the continuation.  A work
+     budget can stop it more than once in the same buffer. */
+  while (iow->cc != NULL && iow->cc->lastPos != NULL) {
     iow->cc = cparse_sexp(iow->buf, iow->cnt, iow->cc);
 
     if (iow->cc == NULL) return NULL; /* cparse_sexp set sexp_errno */
@@ -101,7 +109,15 @@ sexp_t *read_one_sexp(sexp_iowrap_t *iow) {
       iow->cc->last_sexp = NULL;
       return sx;
     }
-    iow->cnt = 0;
+    /* only the end of the budget or of the input is gone on from; the
+       parser would stop at an error in the same place again */
+    if (iow->cc->error != SEXP_ERR_OK &&
+        iow->cc->error != SEXP_ERR_INCOMPLETE) {
+      sexp_errno = iow->cc->error;
+      return NULL;
+    }
+    if (iow->cc->lastPos == NULL)
+      iow->cnt = 0;
   }
 
   if (iow->cnt == 0) {
@@ -129,7 +145,8 @@ sexp_t *read_one_sexp(sexp_iowrap_t *iow) {
     }
 
     iow->cc = cparse_sexp(iow->buf,iow->cnt,iow->cc);
-    iow->cnt = 0;
+    if (iow->cc->lastPos == NULL)
+      iow->cnt = 0;
   }
 
   sx = iow->cc->last_sexp;
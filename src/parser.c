@@ -40,6 +40,10 @@
 #include "sexp.h"
 #include "faststack.h"
 
+#ifdef _SEXP_THREADS_
+# include <pthread.h>
+#endif
+
 /*
  * constants related to atom buffer sizes and growth.
  */
@@ -71,6 +75,14 @@ sexp_errcode_t set_parser_buffer_params(size_t ss, size_t gs) {
 typedef struct parse_stack_data
 {
   sexp_t *fst, *lst;
+
+  /* with a projection: the pattern the elements of this list are
+     projected by (NULL keeps them all), or while the head of the list is
+     not known yet, the pattern of the enclosing list in pending, and the
+     element before this list in prev so it can be unlinked again. */
+  const sexp_projection_t *proj;
+  const sexp_projection_t *pending;
+  sexp_t *prev;
 }
   parse_data_t;
 
@@ -93,6 +105,181 @@ faststack_t *pd_cache;
 faststack_t *sexp_t_cache;
 #endif
 
+/*
+ * The source ranges recorded by continuations with track_source set are
+ * kept out of the elements, in a table keyed by element address, so that
+ * elements that are not tracked do not pay for them.  The table is open
+ * addressed with linear probing, at most half full, and removes entries
+ * by moving the ones after them back.  An element with an entry has
+ * SEXP_FLAG_RANGE set, and sexp_t_deallocate drops the entry.
+ */
+typedef struct src_ent {
+  const sexp_t *sx;
+  size_t offset;
+  size_t length;
+} src_ent_t;
+
+static src_ent_t *src_slots = NULL;
+static size_t src_cap = 0;
+static size_t src_count = 0;
+
+#ifdef _SEXP_THREADS_
+static pthread_mutex_t src_lock = PTHREAD_MUTEX_INITIALIZER;
+# define SRC_LOCK()   pthread_mutex_lock(&src_lock)
+# define SRC_UNLOCK() pthread_mutex_unlock(&src_lock)
+#else
+# define SRC_LOCK()
+# define SRC_UNLOCK()
+#endif
+
+/* first slot to look at for sx in a table of cap slots */
+#define SRC_SLOT(sx, cap) \
+  ((((size_t) (sx) >> 4) * (size_t) 2654435761UL) & ((cap) - 1))
+
+/* slot of sx, or of the empty slot where it would go */
+static size_t
+_src_find (const sexp_t *sx)
+{
+  size_t i = SRC_SLOT(sx, src_cap);
+
+  while (src_slots[i].sx != NULL && src_slots[i].sx != sx)
+    i = (i + 1) & (src_cap - 1);
+
+  return i;
+}
+
+/* double the table, or make it; called with the lock held */
+static int
+_src_grow (void)
+{
+  src_ent_t *old = src_slots;
+  size_t oldcap = src_cap, i, j;
+  size_t cap = (src_cap == 0) ? 256 : src_cap * 2;
+
+#ifdef __cplusplus
+  src_slots = (src_ent_t *) sexp_calloc(cap, sizeof(src_ent_t));
+#else
+  src_slots = sexp_calloc(cap, sizeof(src_ent_t));
+#endif
+  if (src_slots == NULL) {
+    src_slots = old;
+    return -1;
+  }
+  src_cap = cap;
+
+  for (i = 0; i < oldcap; i++) {
+    if (old[i].sx != NULL) {
+      j = _src_find(old[i].sx);
+      src_slots[j] = old[i];
+    }
+  }
+
+  if (old != NULL)
+    sexp_free(old, oldcap * sizeof(src_ent_t));
+
+  return 0;
+}
+
+/*
+ * record the source range of sx and set SEXP_FLAG_SOURCE and
+ * SEXP_FLAG_RANGE on it.  Without the memory for it, sx is left as if it
+ * had not been tracked, and is printed instead of copied.
+ */
+static void
+_src_set (sexp_t *sx, size_t offset, size_t length)
+{
+  size_t i;
+
+  SRC_LOCK();
+
+  if ((src_count + 1) * 2 > src_cap && _src_grow() != 0) {
+    SRC_UNLOCK();
+    return;
+  }
+
+  i = _src_find(sx);
+  if (src_slots[i].sx == NULL) {
+    src_slots[i].sx = sx;
+    src_count++;
+  }
+  src_slots[i].offset = offset;
+  src_slots[i].length = length;
+  sx->flags |= SEXP_FLAG_SOURCE | SEXP_FLAG_RANGE;
+
+  SRC_UNLOCK();
+}
+
+/* forget the source range of sx, which is being freed */
+static void
+_src_drop (sexp_t *sx)
+{
+  size_t i, j, k;
+
+  SRC_LOCK();
+
+  if (src_count > 0) {
+    i = _src_find(sx);
+    if (src_slots[i].sx == sx) {
+      /* move back the entries after i that would not be found past the
+         hole it leaves */
+      src_slots[i].sx = NULL;
+      src_count--;
+      for (j = (i + 1) & (src_cap - 1); src_slots[j].sx != NULL;
+           j = (j + 1) & (src_cap - 1)) {
+        k = SRC_SLOT(src_slots[j].sx, src_cap);
+        if ((j > i && (k <= i || k > j)) || (j < i && k <= i && k > j)) {
+          src_slots[i] = src_slots[j];
+          src_slots[j].sx = NULL;
+          i = j;
+        }
+      }
+    }
+  }
+
+  SRC_UNLOCK();
+
+  sx->flags &= ~(SEXP_FLAG_SOURCE | SEXP_FLAG_RANGE);
+}
+
+int
+sexp_source_range (const sexp_t *sx, size_t *offset, size_t *length)
+{
+  size_t i;
+  int found = 0;
+
+  if (sx == NULL || !(sx->flags & SEXP_FLAG_SOURCE))
+    return -1;
+
+  SRC_LOCK();
+
+  if (src_count > 0) {
+    i = _src_find(sx);
+    if (src_slots[i].sx == sx) {
+      if (offset != NULL)
+        *offset = src_slots[i].offset;
+      if (length != NULL)
+        *length = src_slots[i].length;
+      found = 1;
+    }
+  }
+
+  SRC_UNLOCK();
+
+  return found ? 0 : -1;
+}
+
+/* drop every source range, for sexp_cleanup */
+static void
+_src_cleanup (void)
+{
+  SRC_LOCK();
+  if (src_slots != NULL)
+    sexp_free(src_slots, src_cap * sizeof(src_ent_t));
+  src_slots = NULL;
+  src_cap = src_count = 0;
+  SRC_UNLOCK();
+}
+
 /**
  * sexp_t allocation
  */
@@ -150,6 +337,8 @@ sexp_t_allocate(void) {
     }
   }
 
+  sx->flags = 0;
+
   return sx;
 }
 #endif
@@ -160,8 +349,13 @@ sexp_t_allocate(void) {
 #ifdef _NO_MEMORY_MANAGEMENT_
 void
 sexp_t_deallocate(sexp_t *s) {
-  if (s->ty == SEXP_VALUE && s->val != NULL) {
-    sexp_free(s->val,s->val_allocated);
+  if (s->flags & SEXP_FLAG_ARENA) return;
+
+  if (s->flags & SEXP_FLAG_RANGE)
+    _src_drop(s);
+
+  if (s->ty == SEXP_VALUE) {
+    sexp_release_val(s);
   }
 
   sexp_free(s,sizeof(sexp_t));
@@ -170,6 +364,10 @@ sexp_t_deallocate(sexp_t *s) {
 void
 sexp_t_deallocate(sexp_t *s) {
   if (s == NULL) return;
+  if (s->flags & SEXP_FLAG_ARENA) return;
+
+  if (s->flags & SEXP_FLAG_RANGE)
+    _src_drop(s);
 
   if (sexp_t_cache == NULL) {
     sexp_t_cache = make_stack();
@@ -178,8 +376,8 @@ sexp_t_deallocate(sexp_t *s) {
       /**** HOW DO WE GET THE USER TO KNOW SOMETHING HAPPENED? ****/
 
       sexp_errno = SEXP_ERR_MEMORY;
-      if (s->ty == SEXP_VALUE && s->val != NULL) {
-        sexp_free(s->val,s->val_allocated);
+      if (s->ty == SEXP_VALUE) {
+        sexp_release_val(s);
       }
       sexp_free(s,sizeof(sexp_t));
       return;
@@ -188,11 +386,12 @@ sexp_t_deallocate(sexp_t *s) {
 
   s->list = s->next = NULL;
 
-  if (s->ty == SEXP_VALUE && s->val != NULL) {
-    sexp_free(s->val,s->val_allocated);
+  if (s->ty == SEXP_VALUE) {
+    sexp_release_val(s);
   }
 
   s->val = NULL;
+  s->flags = 0;
 
   sexp_t_cache = push(sexp_t_cache, s);
 }
@@ -204,11 +403,16 @@ sexp_t_deallocate(sexp_t *s) {
  */
 #ifdef _NO_MEMORY_MANAGEMENT_
 void sexp_cleanup(void) {
+  sexp_reclaimer_shutdown();
+  _src_cleanup();
 }
 #else
 void sexp_cleanup(void) {
   stack_lvl_t *l;
 
+  sexp_reclaimer_shutdown();
+  _src_cleanup();
+
   if (pd_cache != NULL) {
     l = pd_cache->top;
     while (l != NULL) {
@@ -551,12 +755,30 @@ init_continuation(char *str)
 
   cc->sbuffer = str;
   cc->lastPos = NULL;
+  cc->seg = 0;
   cc->state = 1;
   cc->vcur = cc->val;
   cc->depth = 0;
   cc->qdepth = 0;
   cc->squoted = 0;
   cc->event_handlers = NULL;
+  cc->intern = NULL;
+  cc->hashcons = NULL;
+  cc->event_sink = NULL;
+  cc->projection = NULL;
+  cc->track_source = 0;
+  cc->index_lists = 0;
+  cc->validate_info = NULL;
+  cc->max_depth = 0;
+  cc->max_atom_bytes = cc->max_nodes = cc->max_bytes = 0;
+  cc->nodes = cc->bytes = 0;
+  cc->recover = 0;
+  cc->skipped = 0;
+  cc->resync = 0;
+  cc->resync_start = 0;
+  cc->work_budget = 0;
+  cc->src_base = 0;
+  cc->src_atom = 0;
 
   return cc;
 }
@@ -604,1086 +826,537 @@ iparse_sexp (char *s, size_t len, pcont_t *cc) {
 /*************************************************************************/
 /*************************************************************************/
 
-/* TEMPORARY -- THIS WILL GO AWAY WHEN eparse_sexp GETS ROLLED BACK INTO
- * cparse_sexp */
-pcont_t *eparse_sexp (char *str, size_t len, pcont_t *lc);
-
-/**
- * Continuation based parser - the guts of the package.
+/*
+ * decide whether the list whose elements are on top of the stack, and
+ * whose head was not known so far, is kept by the projection of the list
+ * around it, now that its head is known (NULL when it is not an atom).
+ * A list that is dropped is unlinked from the list around it and
+ * destroyed along with its elements; returns 0 then, 1 if it is kept.
  */
-pcont_t *
-cparse_sexp (char *str, size_t len, pcont_t *lc)
+static int
+_project_head (faststack_t * stack, const sexp_t * head,
+               parser_event_handlers_t * event_handlers)
 {
-  char *t = NULL;
-  char *s = NULL;
-  register size_t       binexpected = 0;
-  register size_t       binread = 0;
-  register parsermode_t mode = PARSER_NORMAL;
-  register size_t       val_allocated = 0;
-  register unsigned int squoted = 0;
-  register size_t       val_used = 0;
-  register unsigned int state = 1;
-  register unsigned int depth = 0;
-  register unsigned int qdepth = 0;
-  register unsigned int elts = 0;
-  register unsigned int esc = 0;
-  pcont_t *cc = NULL;
-  char *val = NULL;
-  char *vcur = NULL;
-  char *bindata = NULL;
-  sexp_t *sx = NULL;
-  faststack_t *stack = NULL;
-  parse_data_t *data = NULL;
-  stack_lvl_t *lvl = NULL;
-  char *bufEnd = NULL;
-  int keepgoing = 1;
-  parser_event_handlers_t *event_handlers = NULL;
-
-  /*** define a macro used for stashing continuation state away ***/
-  /** NOTE1: sbuffer is set manually as appropriate. **/
-  /** NOTE2: this also sets sexp_errno to the same value as the
-      error field in the continuation.  This used to be
-      done in iparse_sexp and parse_sexp, but that meant that
-      direct callers of cparse_sexp would see inconsistent errors.
-      sexp_errno could say one thing, but cc would say the other.
-      This has been fixed. **/
-#define SAVE_CONT_STATE(err,ls) {               \
-    cc->bindata = bindata;                      \
-    cc->binread = binread;                      \
-    cc->binexpected = binexpected;              \
-    cc->val = val;                              \
-    cc->mode = mode;                            \
-    cc->squoted = squoted;                      \
-    cc->val_used = val_used;                    \
-    cc->val_allocated = val_allocated;          \
-    cc->vcur = vcur;                            \
-    cc->lastPos = t;                            \
-    cc->depth = depth;                          \
-    cc->qdepth = qdepth;                        \
-    cc->state = state;                          \
-    cc->stack = stack;                          \
-    cc->esc = esc;                              \
-    cc->last_sexp = (ls);                       \
-    cc->error = (err);                          \
-    cc->event_handlers = event_handlers;        \
-    sexp_errno = (err);                         \
-  }
-  /*** end continuation state saving macro ***/
-
-  /* make sure non-null string */
-  if (str == NULL) {
-    cc = lc;
+  parse_data_t *data = (parse_data_t *) top_data (stack);
+  const sexp_projection_t *next = NULL;
+  stack_lvl_t *lvl;
+  sexp_t *sx, *elts, *prev;
+  int keep;
 
-    if (cc == NULL) {
-      cc = init_continuation(str);
-      if (cc == NULL) return NULL; /* sexp_errno was set in call */
-    }
-    cc->error = SEXP_ERR_NULLSTRING;
-    cc->last_sexp = NULL;
+  if (head != NULL && head->ty == SEXP_VALUE && head->aty != SEXP_BINARY)
+    keep = sexp_projection_step(data->pending, head->val,
+                                head->val_used - 1, &next);
+  else
+    keep = sexp_projection_step(data->pending, NULL, 0, &next);
 
-    return cc;
+  if (keep) {
+    data->proj = next;
+    data->pending = NULL;
+    return 1;
   }
 
-  /* first, if we have a non null continuation passed in, restore state. */
-  if (lc != NULL) {
-    /* if the parser mode is events only, call the parser that doesn't
-       allocate any elements or stack parts */
-    if (lc->mode == PARSER_EVENTS_ONLY)
-      return eparse_sexp(str,len,lc);
-
-    cc = lc;
-    binexpected = cc->binexpected;
-    binread = cc->binread;
-    bindata = cc->bindata;
-    val_used = cc->val_used;
-    val_allocated = cc->val_allocated;
-    squoted = cc->squoted;
-    val = cc->val;
-    vcur = cc->vcur;
-    state = cc->state;
-    depth = cc->depth;
-    qdepth = cc->qdepth;
-    stack = cc->stack;
-    esc = cc->esc;
-    mode = cc->mode;
-    event_handlers = cc->event_handlers;
-    s = str;
-    if (cc->lastPos != NULL)
-      t = cc->lastPos;
-    else {
-      t = s;
-      cc->sbuffer = str;
-    }
+  lvl = pop (stack);
+  elts = data->fst;
+  prev = data->prev;
+  pd_deallocate(data);
+  lvl->data = NULL;
+
+  data = (parse_data_t *) top_data (stack);
+  sx = data->lst;
+  if (prev != NULL) {
+    prev->next = NULL;
+    data->lst = prev;
   } else {
-    /* new continuation... */
-    cc = init_continuation(str);
-    if (cc == NULL) return NULL;
-
-    /* explicitly set mode -- init continuation defaults to PARSER_NORMAL */
-    cc->mode = mode;
-    val = cc->val;
-
-    val_used = cc->val_used;
-    val_allocated = cc->val_allocated;
-
-    vcur = val;
-
-    /* allocate stack */
-    stack = cc->stack;
-
-    /* t is temp pointer into s for current position */
-    s = str;
-    t = s;
+    data->fst = data->lst = NULL;
   }
 
-  bufEnd = cc->sbuffer+len;
-
-  /* guard for loop - see end of loop for info.  Put it out here in the
-     event that we're restoring state from a continuation and need to
-     check before we start up. */
-  if (state != 15 && t[0] == '\0') keepgoing = 0;
-
-  /*==================*/
-  /* main parser loop */
-  /*==================*/
-  while (keepgoing == 1 && t != bufEnd)
-    {
-      /* based on the current state in the FSM, do something */
-      switch (state)
-        {
-        case 1:
-          switch (t[0])
-            {
-              /* space,tab,CR,LF considered white space */
-            case '\n':
-            case ' ':
-            case '\t':
-            case '\r':
-              t++;
-              break;
-              /* semicolon starts a comment that extends until a \n is
-                 encountered. */
-            case ';':
-              t++;
-              state = 11;
-              break;
-              /* enter state 2 for open paren */
-            case '(':
-              state = 2;
-              t++;
-              if (event_handlers != NULL &&
-                  event_handlers->start_sexpr != NULL)
-                event_handlers->start_sexpr();
-              break;
-              /* enter state 3 for close paren */
-            case ')':
-              state = 3;
-              break;
-              /* begin quoted string - enter state 5 */
-            case '\"':
-              state = 5;
-              /* set cur pointer to beginning of val buffer */
-              vcur = val;
-              t++;
-              break;
-              /* single quote - enter state 7 */
-            case '\'':
-              state = 7;
-              t++;
-              break;
-              /* other characters are assumed to be atom parts */
-            default:
-              /* set cur pointer to beginning of val buffer */
-              vcur = val;
-
-              /** NOTE: the following code originally required a transition
-                  to state 4 before processing the first atom character --
-                  this required two iterations for the first character
-                  of each atom.  merging this into here allows us to process
-                  what we already know to be a valid atom character before
-                  entering state 4. **/
-              vcur[0] = t[0];
-              if (t[0] == '\\') esc = 1;
-              else esc = 0;
-              val_used++;
-
-              if (val_used == val_allocated) {
-#ifdef __cplusplus
-                val = (char *)sexp_realloc(val,
-                                           val_allocated+sexp_val_grow_size,
-                                           val_allocated);
-#else
-                val = sexp_realloc(val,
-                                   val_allocated+sexp_val_grow_size,
-                                   val_allocated);
-#endif
-
-                if (val == NULL) {
-                  SAVE_CONT_STATE(SEXP_ERR_MEMORY,NULL);
-                  return cc;
-                }
-
-                vcur = val + val_used;
-                val_allocated += sexp_val_grow_size;
-              } else vcur++;
-
-              /* if the atom starts with # and we're in inline
-                 binary mode, we need to go to state 12 to start
-                 checking for the #b# prefix.  otherwise,
-                 if it's not a # or we're just in normal mode,
-                 proceed to state 4 as usual. */
-              if (t[0] == '#' && mode == PARSER_INLINE_BINARY) {
-                state = 12;
-              } else {
-                state = 4;
-              }
-
-              t++;
-              break;
-            }
-          break;
-        case 2:
-          /* open paren */
-          depth++;
-
-          sx = sexp_t_allocate();
-
-          if (sx == NULL) {
-            SAVE_CONT_STATE(SEXP_ERR_MEMORY,NULL);
-            return cc;
-          }
-
-          elts++;
-          sx->ty = SEXP_LIST;
-          sx->next = NULL;
-          sx->list = NULL;
-
-          if (stack->height < 1)
-            {
-              data = pd_allocate();
-
-              if (data == NULL) {
-                sexp_t_deallocate(sx);
-                SAVE_CONT_STATE(SEXP_ERR_MEMORY,NULL);
-                return cc;
-              }
-
-              data->fst = data->lst = sx;
-              push (stack, data);
-            }
-          else
-            {
-              data = (parse_data_t *) top_data (stack);
-              if (data->lst != NULL)
-                data->lst->next = sx;
-              else
-                data->fst = sx;
-              data->lst = sx;
-            }
-
-          data = pd_allocate();
-          if (data == NULL) {
-            SAVE_CONT_STATE(SEXP_ERR_MEMORY,NULL);
-            return cc;
-          }
-          data->fst = data->lst = NULL;
-          push (stack, data);
-
-          state = 1;
-          break;
-        case 3:
-          /** close paren **/
-
-          /* check for close parens that were never opened. */
-          if (depth == 0) {
-            esc = 0;
-            state = 1;
-            SAVE_CONT_STATE(SEXP_ERR_BADFORM,NULL);
-            return cc;
-          }
-
-          t++;
-          depth--;
-
-          lvl = pop (stack);
-          data = (parse_data_t *) lvl->data;
-          sx = data->fst;
-          pd_deallocate(data);
-          lvl->data = NULL;
-
-          if (stack->top != NULL)
-            {
-              data = (parse_data_t *) top_data (stack);
-              data->lst->list = sx;
-            }
-          else
-            {
-              SAVE_CONT_STATE(SEXP_ERR_BAD_STACK, NULL);
-              return cc;
-            }
-
-          if (event_handlers != NULL &&
-              event_handlers->end_sexpr != NULL)
-            event_handlers->end_sexpr();
-
-          state = 1;
-
-          /** if depth = 0 then we finished a sexpr, and we return **/
-          if (depth == 0) {
-            while (stack->top != NULL)
-              {
-                lvl = pop (stack);
-                data = (parse_data_t *) lvl->data;
-                sx = data->fst;
-                pd_deallocate(data);
-                lvl->data = NULL;
-              }
-
-            esc = 0;
-            state = 1;
-            SAVE_CONT_STATE(SEXP_ERR_OK, sx);
-
-            return cc;
-          }
-          break;
-        case 4: /** parsing atom **/
-          if (esc == 1 && (t[0] == '\"' || t[0] == '(' ||
-                           t[0] == ')' || t[0] == '\'' ||
-                           t[0] == '\\')) {
-            vcur--; /* back up to overwrite the \ */
-            vcur[0] = t[0];
-            vcur++;
-            t++;
-            esc = 0;
-            break;
-          }
-
-          /* look at an ascii table - these ranges are the non-whitespace, non
-             paren and quote characters that are legal in atoms */
-          if (!((t[0] >= '*' && t[0] <= '~') ||
-                ((unsigned char)(t[0]) > 127) ||
-                (t[0] == '!') ||
-                (t[0] >= '#' && t[0] <= '&')))
-            {
-              vcur[0] = '\0';
-              val_used++;
-
-              sx = sexp_t_allocate();
-
-              if (sx == NULL) {
-                SAVE_CONT_STATE(SEXP_ERR_MEMORY, NULL);
-                return cc;
-              }
-
-              elts++;
-              sx->ty = SEXP_VALUE;
-              sx->val = val;
-              sx->val_allocated = val_allocated;
-              sx->val_used = val_used;
-              sx->next = NULL;
-              if (squoted != 0)
-                sx->aty = SEXP_SQUOTE;
-              else
-                sx->aty = SEXP_BASIC;
-
-              if (event_handlers != NULL &&
-                  event_handlers->characters != NULL)
-                event_handlers->characters(sx->val,sx->val_used,sx->aty);
-
-#ifdef __cplusplus
-              val = (char *)sexp_malloc(sizeof(char)*sexp_val_start_size);
-#else
-              val = sexp_malloc(sizeof(char)*sexp_val_start_size);
-#endif
-
-              if (val == NULL) {
-                sexp_t_deallocate(sx);
-                SAVE_CONT_STATE(SEXP_ERR_MEMORY, NULL);
-                return cc;
-              }
-
-              val_allocated = sexp_val_start_size;
-              val_used = 0;
-              vcur = val;
-
-              if (!empty_stack (stack))
-                {
-                  data = (parse_data_t *) top_data (stack);
-                  if (data->fst == NULL)
-                    {
-                      data->fst = data->lst = sx;
-                    }
-                  else
-                    {
-                      data->lst->next = sx;
-                      data->lst = sx;
-                    }
-                }
-              else
-                {
-                  /* looks like this expression was just a basic atom - so
-                     return it. */
-                  squoted = 0;
-                  state = 1;
-                  esc = 0;
-                  SAVE_CONT_STATE(SEXP_ERR_OK, sx);
-                  return cc;
-                }
-
-              switch (t[0]) {
-              case ' ':
-              case '\t':
-              case '\n':
-              case '\r':
-                /** NOTE: we know whitespace following atom, so spin ahead
-                    one and let state 1 do what it needs to for the next
-                    character. **/
-                state = 1;
-                t++;
-                squoted = 0;
-                break;
-              case ')':
-                squoted = 0;
-                state = 3;
-                break;
-              default:
-                squoted = 0;
-                state = 1;
-              }
-            }
-          else
-            {
-              vcur[0] = t[0];
-              if (t[0] == '\\') esc = 1;
-              else esc = 0;
-              val_used++;
-
-              if (val_used == val_allocated) {
-                char *valnew = NULL;
-#ifdef __cplusplus
-                valnew = (char *)sexp_realloc(val,
-                                              val_allocated+sexp_val_grow_size,
-                                              val_allocated);
-#else
-                valnew = sexp_realloc(val,
-                                      val_allocated+sexp_val_grow_size,
-                                      val_allocated);
-#endif
-
-                if (valnew == NULL) {
-                  SAVE_CONT_STATE(SEXP_ERR_MEMORY, NULL);
-                  return cc;
-                }
-
-                val = valnew;
-
-                vcur = val + val_used;
-                val_allocated += sexp_val_grow_size;
-              } else vcur++;
-
-              t++;
-            }
-          break;
-        case 5:
-          if (esc == 1 && (t[0] == '\"' ||
-                           t[0] == '\'' ||
-                           t[0] == '(' ||
-                           t[0] == ')' ||
-                           t[0] == '\\')) {
-            vcur--;
-            vcur[0] = t[0];
-            vcur++;
-            /** NO NEED TO UPDATE VAL COUNTS **/
-            t++;
-            esc = 0;
-          }
-
-          if (t[0] == '\"')
-            {
-              state = 6;
-
-              if (squoted == 1) {
-                vcur[0] = '\"';
-                val_used++;
-
-                if (val_used == val_allocated) {
-                  char *valnew = NULL;
-
-#ifdef __cplusplus
-                  valnew = (char *)sexp_realloc(val,
-                                                val_allocated+
-                                                sexp_val_grow_size,
-                                                val_allocated);
-#else
-                  valnew = sexp_realloc(val,
-                                        val_allocated+sexp_val_grow_size,
-                                        val_allocated);
-#endif
-
-                  if (valnew == NULL) {
-                    SAVE_CONT_STATE(SEXP_ERR_MEMORY, NULL);
-                    return cc;
-                  }
-
-                  val = valnew;
+  sx->list = elts;
+  destroy_sexp(sx);
 
-                  vcur = val + val_used;
-                  val_allocated += sexp_val_grow_size;
-                } else vcur++;
-              }
-
-              vcur[0] = '\0';
-
-              val_used++;
-              sx = sexp_t_allocate();
-
-              if (sx == NULL) {
-                SAVE_CONT_STATE(SEXP_ERR_MEMORY, NULL);
-                return cc;
-              }
+  /* a top level list leaves nothing behind */
+  if (data->fst == NULL && stack->height == 1) {
+    lvl = pop (stack);
+    pd_deallocate(data);
+    lvl->data = NULL;
+  }
 
-              elts++;
-              sx->ty = SEXP_VALUE;
-              sx->val = val;
-              sx->val_used = val_used;
-              sx->val_allocated = val_allocated;
-              sx->next = NULL;
+  if (event_handlers != NULL &&
+      event_handlers->end_sexpr != NULL)
+    event_handlers->end_sexpr();
 
-              if (squoted == 1) {
-                sx->aty = SEXP_SQUOTE;
-                squoted = 0;
-              } else
-                sx->aty = SEXP_DQUOTE;
+  return 0;
+}
 
-              if (event_handlers != NULL &&
-                  event_handlers->characters != NULL)
-                event_handlers->characters(sx->val,sx->val_used,sx->aty);
+/*** define a macro used for stashing continuation state away ***/
+/** NOTE1: sbuffer is set manually as appropriate. **/
+/** NOTE2: this also sets sexp_errno to the same value as the
+    error field in the continuation.  This used to be
+    done in iparse_sexp and parse_sexp, but that meant that
+    direct callers of cparse_sexp would see inconsistent errors.
+    sexp_errno could say one thing, but cc would say the other.
+    This has been fixed. **/
+/** NOTE3: the parser only returns SEXP_ERR_OK for a finished
+    expression, so that is where the counts for the limits of the
+    continuation start over. **/
+#define SAVE_CONT_STATE(err,ls) {               \
+  cc->bindata = bindata;                      \
+  cc->binread = binread;                      \
+  cc->binexpected = binexpected;              \
+  cc->val = val;                              \
+  cc->squoted = squoted;                      \
+  cc->val_used = val_used;                    \
+  cc->val_allocated = val_allocated;          \
+  cc->vcur = vcur;                            \
+  cc->lastPos = t;                            \
+  cc->seg = seg;                              \
+  cc->depth = depth;                          \
+  cc->qdepth = qdepth;                        \
+  cc->state = state;                          \
+  cc->stack = stack;                          \
+  cc->esc = esc;                              \
+  cc->last_sexp = (ls);                       \
+  cc->error = (err);                          \
+  cc->event_handlers = event_handlers;        \
+  cc->src_base = src_base;                    \
+  cc->src_atom = src_atom;                    \
+  cc->nodes = ((err) == SEXP_ERR_OK) ? 0 : nodes; \
+  cc->bytes = ((err) == SEXP_ERR_OK) ? 0 : bytes; \
+  sexp_errno = (err);                         \
+}
+/*** end continuation state saving macro ***/
+
+/*** a limit of the continuation, with zero for none ***/
+#define PARSE_LIMIT(n) ((n) != 0 ? (size_t) (n) : (size_t) -1)
+
+/*** hash-cons a finished top-level expression in sx if the continuation
+     asks for it, failing the parse if that cannot be done ***/
+#define HASHCONS_RESULT() {                             \
+  if (hashcons != NULL) {                             \
+    sexp_t *hx = sexp_hashcons_with(hashcons, sx);    \
+    if (hx == NULL) {                                 \
+      sexp_errcode_t hcerr = sexp_errno;              \
+      destroy_sexp(sx);                               \
+      SAVE_CONT_STATE(hcerr, NULL);                   \
+      return cc;                                      \
+    }                                                 \
+    sx = hx;                                          \
+  }                                                   \
+}
 
-#ifdef __cplusplus
-              val = (char *)sexp_malloc(sizeof(char)*sexp_val_start_size);
-#else
-              val = sexp_malloc(sizeof(char)*sexp_val_start_size);
-#endif
+/*** input offset of a position in the current buffer ***/
+#define SRC_POS(p) (src_base + (size_t) ((p) - cc->sbuffer))
 
-              if (val == NULL) {
-                sexp_t_deallocate(sx);
-                SAVE_CONT_STATE(SEXP_ERR_MEMORY, NULL);
-                return cc;
-              }
-
-              val_allocated = sexp_val_start_size;
-              val_used = 0;
-              vcur = val;
-
-              if (!empty_stack (stack))
-                {
-                  data = (parse_data_t *) top_data (stack);
-                  if (data->fst == NULL)
-                    {
-                      data->fst = data->lst = sx;
-                    }
-                  else
-                    {
-                      data->lst->next = sx;
-                      data->lst = sx;
-                    }
-                }
-              else
-                {
-                  /* looks like this expression was just a basic double
-                     quoted atom - so return it. */
-                  t++; /* spin past the quote */
-
-                  squoted = 0;
-                  esc = 0;
-                  state = 1;
-                  SAVE_CONT_STATE(SEXP_ERR_OK, sx);
-
-                  return cc;
-                }
-            }
-          else
-            {
-              vcur[0] = t[0];
-              val_used++;
-
-              if (val_used == val_allocated) {
-                char *valnew = NULL;
+/*** record the source range of the element sx that started at
+     offset start and ends before p ***/
+#define SET_SOURCE(start, p) {                  \
+  if (track)                                  \
+    _src_set(sx, (start), SRC_POS(p) - (start)); \
+}
 
-#ifdef __cplusplus
-                valnew = (char *)sexp_realloc(val,
-                                              val_allocated+sexp_val_grow_size,
-                                              val_allocated);
-#else
-                valnew = sexp_realloc(val,
-                                      val_allocated+sexp_val_grow_size,
-                                      val_allocated);
-#endif
+/*** with a projection, is the element starting here dropped? ***/
+#define DROP_ELT() (projection != NULL &&                               \
+                  (empty_stack (stack) ||                             \
+                   ((parse_data_t *) top_data (stack))->proj != NULL))
+
+/*** depth at which skipping a dropped element ends ***/
+#define SKIP_DEPTH() ((unsigned int) (stack->height > 0 ?               \
+                                    stack->height - 1 : 0))
+
+/*** a skip that ends before t: if it was to resynchronize after an
+     error, count what it passed over ***/
+#define SKIP_END() {                                            \
+  if (cc->resync) {                                           \
+    cc->skipped += SRC_POS(t) - cc->resync_start;             \
+    cc->resync = 0;                                           \
+  }                                                           \
+}
 
-                if (valnew == NULL) {
-                  SAVE_CONT_STATE(SEXP_ERR_MEMORY, NULL);
-                  return cc;
-                }
-
-                val = valnew;
-
-                vcur = val + val_used;
-                val_allocated += sexp_val_grow_size;
-              } else vcur++;
-
-              if (t[0] == '\\') {
-                esc = 1;
-              } else
-                esc = 0;
-            }
-
-          t++;
-          break;
-        case 6:
-          vcur = val;
-          state = 1;
-          break;
-        case 7:
-          if (t[0] == '\"')
-            {
-              state = 5;
-              vcur = val;
-              t++;
-
-              vcur[0] = '\"';
-              val_used++;
-
-              if (val_used == val_allocated) {
-                char *valnew = NULL;
+/*** look at the segment t is in up to its end, or up to where the work
+     budget runs out ***/
+#define SEG_BUDGET() {                                          \
+  bufEnd = segEnd;                                            \
+  if ((size_t) (bufEnd - t) > left)                           \
+    bufEnd = t + left;                                        \
+  left -= (size_t) (bufEnd - t);                              \
+}
 
-#ifdef __cplusplus
-                valnew = (char *)sexp_realloc(val,
-                                              val_allocated+sexp_val_grow_size,
-                                              val_allocated);
-#else
-                valnew = sexp_realloc(val,
-                                      val_allocated+sexp_val_grow_size,
-                                      val_allocated);
-#endif
-                if (valnew == NULL) {
-                  SAVE_CONT_STATE(SEXP_ERR_MEMORY, NULL);
-                  return cc;
-                }
-
-                val = valnew;
-
-                vcur = val + val_used;
-                val_allocated += sexp_val_grow_size;
-              } else vcur++;
-
-              squoted = 1;
-            }
-          else if (t[0] == '(')
-            {
-              vcur = val;
-              state = 8;
-            }
-          else
-            {
-              vcur = val;
-              state = 4;
-              squoted = 1;
-            }
-          break;
-        case 8:
-          if (esc == 0) {
-            if (t[0] == '(')
-              {
-                qdepth++;
-              }
-            else if (t[0] == ')')
-              {
-                qdepth--;
-                state = 9;
-              }
-            else if (t[0] == '\"')
-              {
-                state = 10;
-              }
-          } else {
-            esc = 0;
-          }
-          vcur[0] = t[0];
-          if (t[0] == '\\') esc = 1;
-          else esc = 0;
-          val_used++;
-
-          if (val_used == val_allocated) {
-            char *valnew = NULL;
+/*** decide on the list around the atom in sx if sx is its head ***/
+#define PROJECT_ATOM() {                                        \
+  if (data->pending != NULL && data->fst == sx &&             \
+      _project_head(stack, sx, event_handlers) == 0)          \
+    state = 16;                                               \
+}
 
-#ifdef __cplusplus
-            valnew = (char *)sexp_realloc(val,
-                                          val_allocated+sexp_val_grow_size,
-                                          val_allocated);
-#else
-            valnew = sexp_realloc(val,
-                                  val_allocated+sexp_val_grow_size,
-                                  val_allocated);
-#endif
-            if (valnew == NULL) {
-              SAVE_CONT_STATE(SEXP_ERR_MEMORY, NULL);
-              return cc;
-            }
-
-            val = valnew;
-
-            vcur = val + val_used;
-            val_allocated += sexp_val_grow_size;
-          } else vcur++;
-
-          t++;
-          /* let it fall through to state 9 if we know we're transitioning
-             into that state */
-          if (state != 9)
-            break;
-        case 9:
-          if (qdepth == 0)
-            {
-              state = 1;
-              vcur[0] = '\0';
-              sx = sexp_t_allocate();
-
-              if (sx == NULL) {
-                SAVE_CONT_STATE(SEXP_ERR_MEMORY, NULL);
-                return cc;
-              }
-
-              elts++;
-              sx->ty = SEXP_VALUE;
-              sx->val = val;
-              sx->val_allocated = val_allocated;
-              sx->val_used = val_used;
-              sx->next = NULL;
-              sx->aty = SEXP_SQUOTE;
-
-              if (event_handlers != NULL &&
-                  event_handlers->characters != NULL)
-                event_handlers->characters(sx->val,sx->val_used,sx->aty);
+/*
+ * classes of input bytes for the state machine, looked up in a table
+ * rather than tested against ranges of characters.  The low bits give
+ * what a byte does between elements (state 1); PC_PART is set for the
+ * bytes that may continue an atom (state 4), which are the
+ * non-whitespace, non paren and quote characters.
+ */
+#define PC_ATOM   0   /* anything else starts an atom */
+#define PC_SPACE  1   /* space, tab, CR, LF */
+#define PC_OPEN   2
+#define PC_CLOSE  3
+#define PC_DQUOTE 4
+#define PC_SQUOTE 5
+#define PC_SEMI   6   /* comment */
+#define PC_START  0x7
+#define PC_PART   0x8
+
+#define A PC_ATOM
+#define S PC_SPACE
+#define O PC_OPEN
+#define C PC_CLOSE
+#define D PC_DQUOTE
+#define Q PC_SQUOTE
+#define M PC_SEMI
+#define P PC_PART
+static const unsigned char parse_class[256] = {
+  A, A, A, A, A, A, A, A, A, S, S, A, A, S, A, A,
+  A, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A,
+  S, P, D, P, P, P, P, Q, O, C, P, P, P, P, P, P,
+  P, P, P, P, P, P, P, P, P, P, P, M|P, P, P, P, P,
+  P, P, P, P, P, P, P, P, P, P, P, P, P, P, P, P,
+  P, P, P, P, P, P, P, P, P, P, P, P, P, P, P, P,
+  P, P, P, P, P, P, P, P, P, P, P, P, P, P, P, P,
+  P, P, P, P, P, P, P, P, P, P, P, P, P, P, P, A,
+  P, P, P, P, P, P, P, P, P, P, P, P, P, P, P, P,
+  P, P, P, P, P, P, P, P, P, P, P, P, P, P, P, P,
+  P, P, P, P, P, P, P, P, P, P, P, P, P, P, P, P,
+  P, P, P, P, P, P, P, P, P, P, P, P, P, P, P, P,
+  P, P, P, P, P, P, P, P, P, P, P, P, P, P, P, P,
+  P, P, P, P, P, P, P, P, P, P, P, P, P, P, P, P,
+  P, P, P, P, P, P, P, P, P, P, P, P, P, P, P, P,
+  P, P, P, P, P, P, P, P, P, P, P, P, P, P, P, P
+};
+#undef A
+#undef S
+#undef O
+#undef C
+#undef D
+#undef Q
+#undef M
+#undef P
+
+#define PARSE_CLASS(c) (parse_class[(unsigned char) (c)])
+
+/*** the specialized parsers, see parser_fsm.h ***/
+#define PARSE_TREE     1
+#define PARSE_EVENTS   2
+#define PARSE_VALIDATE 3
+
+#define PARSE_FN     _parse_tree
+#define PARSE_KIND   PARSE_TREE
+#define PARSE_BINARY 0
+#include "parser_fsm.h"
+#undef PARSE_FN
+#undef PARSE_KIND
+#undef PARSE_BINARY
+
+#define PARSE_FN     _parse_tree_binary
+#define PARSE_KIND   PARSE_TREE
+#define PARSE_BINARY 1
+#include "parser_fsm.h"
+#undef PARSE_FN
+#undef PARSE_KIND
+#undef PARSE_BINARY
+
+#define PARSE_FN     _parse_events
+#define PARSE_KIND   PARSE_EVENTS
+#define PARSE_BINARY 0
+#include "parser_fsm.h"
+#undef PARSE_FN
+#undef PARSE_KIND
+#undef PARSE_BINARY
+
+#define PARSE_FN     _parse_validate
+#define PARSE_KIND   PARSE_VALIDATE
+#define PARSE_BINARY 0
+#include "parser_fsm.h"
+#undef PARSE_FN
+#undef PARSE_KIND
+#undef PARSE_BINARY
+
+#define PARSE_FN     _parse_validate_binary
+#define PARSE_KIND   PARSE_VALIDATE
+#define PARSE_BINARY 1
+#include "parser_fsm.h"
+#undef PARSE_FN
+#undef PARSE_KIND
+#undef PARSE_BINARY
 
-#ifdef __cplusplus
-              val = (char *)sexp_malloc(sizeof(char)*sexp_val_start_size);
-#else
-              val = sexp_malloc(sizeof(char)*sexp_val_start_size);
-#endif
+/*
+ * pick the parser for the mode of the continuation, once per call, so
+ * the loop over the input does not test it.
+ */
+static pcont_t *
+_parse (const struct iovec *iov, int iovcnt, pcont_t *cc)
+{
+  switch (cc->mode) {
+  case PARSER_INLINE_BINARY:
+    return _parse_tree_binary(iov, iovcnt, cc);
+  case PARSER_EVENTS_ONLY:
+    /* the mode is events only, so nothing is allocated; with nobody to
+       tell about the events, all that is left is checking the input */
+    if (cc->event_handlers == NULL && cc->event_sink == NULL)
+      return _parse_validate(iov, iovcnt, cc);
+    return _parse_events(iov, iovcnt, cc);
+  default:
+    return _parse_tree(iov, iovcnt, cc);
+  }
+}
 
-              if (val == NULL) {
-                sexp_t_deallocate(sx);
-                SAVE_CONT_STATE(SEXP_ERR_MEMORY, NULL);
-                return cc;
-              }
-
-              val_allocated = sexp_val_start_size;
-              val_used = 0;
-              vcur = val;
-
-              if (!empty_stack (stack))
-                {
-                  data = (parse_data_t *) top_data (stack);
-                  if (data->fst == NULL)
-                    {
-                      data->fst = data->lst = sx;
-                    }
-                  else
-                    {
-                      data->lst->next = sx;
-                      data->lst = sx;
-                    }
-                }
-              else
-                {
-                  /* looks like the whole expression was a single
-                     quoted value!  So return it. */
-                  squoted = 0;
-                  esc = 0;
-                  state = 1;
-                  SAVE_CONT_STATE(SEXP_ERR_OK, sx);
-                  return cc;
-                }
-            }
-          else
-            state = 8;
-          break;
-        case 10:
-          if (t[0] == '\"' && esc == 0)
-            {
-              state = 8;
-            }
-          vcur[0] = t[0];
-          if (t[0] == '\\') esc = 1;
-          else esc = 0;
-          val_used++;
-
-          if (val_used == val_allocated) {
-            char *valnew = NULL;
+/*
+ * set a continuation that stopped at an error in its input to carry on
+ * after it: a stray close paren is passed over, and otherwise (a limit,
+ * or a binary size that is not all digits) the expression being parsed
+ * is dropped, its open lists are ended for the event handlers and the
+ * event sink, and the parser is put in the state that skips over the
+ * rest of it (states 16 to 22), from where the error was found.  When a limit is found to be passed in the middle of
+ * a character, the parser has not acted on that character yet, except
+ * after a string (state 6) or the size of binary data (state 15).
+ */
+static void
+_resync (pcont_t *cc)
+{
+  stack_lvl_t *lvl;
+  parse_data_t *data;
+  size_t i;
+
+  if (cc->error == SEXP_ERR_BADFORM && cc->state != 14) {
+    cc->lastPos++;
+    cc->skipped++;
+    cc->state = 1;
+    cc->esc = 0;
+    return;
+  }
 
-#ifdef __cplusplus
-            valnew = (char *)sexp_realloc(val,
-                                          val_allocated+sexp_val_grow_size,
-                                          val_allocated);
-#else
-            valnew = sexp_realloc(val,
-                                  val_allocated+sexp_val_grow_size,
-                                  val_allocated);
-#endif
+  /* handlers have seen the start of every list still open, which is
+     ended for them here, so what they build stays balanced */
+  for (i = 0; i < cc->depth; i++) {
+    if (cc->event_handlers != NULL && cc->event_handlers->end_sexpr != NULL)
+      cc->event_handlers->end_sexpr();
+    if (cc->mode == PARSER_EVENTS_ONLY && cc->event_sink != NULL &&
+        cc->event_sink->end_sexpr != NULL)
+      cc->event_sink->end_sexpr(cc->event_sink->data);
+  }
 
-            if (valnew == NULL) {
-              SAVE_CONT_STATE(SEXP_ERR_MEMORY, NULL);
-              return cc;
-            }
-
-            val = valnew;
-
-            vcur = val + val_used;
-            val_allocated += sexp_val_grow_size;
-          } else vcur++;
-
-          t++;
-          break;
-        case 11:
-          if (t[0] == '\n') {
-            state = 1;
-          }
-          t++;
-          break;
-        case 12: /* pre: we saw a # and we're in inline binary mode */
-          if (t[0] == 'b') {
-            vcur[0] = t[0];
-            if (t[0] == '\\') esc = 1;
-            else esc = 0;
-            val_used++;
-
-            if (val_used == val_allocated) {
-              char *valnew = NULL;
+  /* the elements built so far go back to the caches */
+  while (!empty_stack(cc->stack)) {
+    lvl = pop(cc->stack);
+    data = (parse_data_t *) lvl->data;
+    if (data != NULL) {
+      data->lst = NULL;
+      destroy_sexp(data->fst);
+      pd_deallocate(data);
+      lvl->data = NULL;
+    }
+  }
 
-#ifdef __cplusplus
-              valnew = (char *)sexp_realloc(val,
-                                            val_allocated+sexp_val_grow_size,
-                                            val_allocated);
-#else
-              valnew = sexp_realloc(val,
-                                    val_allocated+sexp_val_grow_size,
-                                    val_allocated);
-#endif
+  if (cc->bindata != NULL) {
+    sexp_free(cc->bindata, cc->binexpected);
+    cc->bindata = NULL;
+  }
 
-              if (valnew == NULL) {
-                SAVE_CONT_STATE(SEXP_ERR_MEMORY, NULL);
-                return cc;
-              }
+  cc->resync = 1;
+  cc->resync_start = cc->src_base + (size_t) (cc->lastPos - cc->sbuffer);
+  cc->squoted = 0;
+  cc->nodes = cc->bytes = 0;
+
+  switch (cc->state) {
+  case 1: /* the first character of an atom */
+    cc->esc = 0;
+    cc->state = 19;
+    if (cc->mode == PARSER_INLINE_BINARY && cc->lastPos[0] == '#') {
+      cc->binread = cc->binexpected = 0;
+      cc->lastPos++;
+      cc->state = 21;
+    }
+    break;
+  case 4: /* an atom */
+    cc->state = 19;
+    break;
+  case 5: /* a string */
+    cc->state = 17;
+    break;
+  case 6: /* the close quote of a string */
+    cc->lastPos++;
+    cc->state = 16;
+    break;
+  case 7: /* a single quote */
+    cc->state = 20;
+    break;
+  case 8: /* a quoted list */
+  case 10: /* a string in a quoted list */
+    if (cc->qdepth == 0) {
+      cc->state = 20;
+      break;
+    }
+    /* the parens of a quoted list are followed as depth, and qdepth
+       becomes the depth inside its first one */
+    i = cc->depth + 1;
+    cc->depth += cc->qdepth;
+    cc->qdepth = (unsigned int) i;
+    cc->state = (cc->state == 8) ? 16 : 17;
+    break;
+  case 12: /* #, perhaps of a binary atom */
+  case 13: /* #b */
+    cc->binread = cc->state - 12;
+    cc->binexpected = 0;
+    cc->esc = 0;
+    cc->state = 21;
+    break;
+  case 14: /* the size of binary data, with something else in it */
+    cc->binread = cc->binexpected = 0;
+    cc->esc = 0;
+    cc->state = 19;
+    break;
+  case 15: /* binary data */
+    cc->binread = 0;
+    cc->state = 22;
+    break;
+  default: /* an open paren, or the end of a quoted list */
+    cc->state = 16;
+  }
 
-              val = valnew;
+  cc->val_used = 0;
+  cc->vcur = cc->val;
+}
 
-              vcur = val + val_used;
-              val_allocated += sexp_val_grow_size;
-            } else vcur++;
+/*
+ * errors a continuation can recover from if it is asked to.
+ */
+static int
+_recoverable (sexp_errcode_t err)
+{
+  switch (err) {
+  case SEXP_ERR_BADFORM:
+  case SEXP_ERR_LIMIT_DEPTH:
+  case SEXP_ERR_LIMIT_ATOM:
+  case SEXP_ERR_LIMIT_NODES:
+  case SEXP_ERR_LIMIT_BYTES:
+    return 1;
+  default:
+    return 0;
+  }
+}
 
-            state = 13; /* so far, #b */
-            t++;
-          } else {
-            state = 4; /* not #b, so plain ol' atom */
-          }
+/**
+ * Continuation based parser - the guts of the package.
+ */
+pcont_t *
+cparse_sexp (char *str, size_t len, pcont_t *lc)
+{
+  struct iovec one;
 
-          break;
+  one.iov_base = str;
+  one.iov_len = len;
 
-        case 13: /* pre: we saw a #b and we're in inline binary mode */
-          if (t[0] == '#') {
-            vcur[0] = t[0];
-            if (t[0] == '\\') esc = 1;
-            else esc = 0;
-            val_used++;
+  return cparse_sexpv((str != NULL) ? &one : NULL, 1, lc);
+}
 
-            if (val_used == val_allocated) {
-              char *valnew = NULL;
+/**
+ * The continuation based parser over input in segments.  The parser
+ * goes from one segment to the next inside its loop, so an atom split
+ * between segments is read as it would be from one buffer.
+ */
+pcont_t *
+cparse_sexpv (const struct iovec *iov, int iovcnt, pcont_t *lc)
+{
+  pcont_t *cc = lc;
 
-#ifdef __cplusplus
-              valnew = (char *)sexp_realloc(val,
-                                            val_allocated+sexp_val_grow_size,
-                                            val_allocated);
-#else
-              valnew = sexp_realloc(val,
-                                    val_allocated+sexp_val_grow_size,
-                                    val_allocated);
-#endif
+  /* make sure non-null input */
+  if (iov == NULL || iovcnt <= 0) {
+    if (cc == NULL) {
+      cc = init_continuation(NULL);
+      if (cc == NULL) return NULL; /* sexp_errno was set in call */
+    }
+    cc->error = SEXP_ERR_NULLSTRING;
+    cc->last_sexp = NULL;
 
-              if (valnew == NULL) {
-                SAVE_CONT_STATE(SEXP_ERR_MEMORY, NULL);
-                return cc;
-              }
-
-              val = valnew;
-
-              vcur = val + val_used;
-              val_allocated += sexp_val_grow_size;
-            } else vcur++;
-
-            state = 14; /* so far, #b# - we're definitely in binary
-                           land now. */
-            /* reset vcur to val, overwrite #b# with the size string. */
-            vcur = val;
-            val_used = 0;
-            t++;
-          } else {
-            state = 4; /* not #b#, so plain ol' atom */
-          }
-
-          break;
-
-        case 14:
-          /**
-           * so far we've read #b#.  Now, the steps of the process become:
-           * proceed to read bytes in until we see # again.  This will be
-           * an ASCII representation of the size.  At this point, we want
-           * to read as many bytes as specified by this size string after
-           * the #.
-           */
-          if (t[0] == '#') { /* done with size string */
-            t++;
-            state = 15;
-            vcur[0] = '\0';
-
-            binexpected = (size_t) atoi(val);
-
-            binread = 0;
-            if (binexpected > 0) {
-#ifdef __cplusplus
-              bindata = (char *)sexp_malloc(sizeof(char)*binexpected);
-#else
-              bindata = sexp_malloc(sizeof(char)*binexpected);
-#endif
+    return cc;
+  }
 
-              if (bindata == NULL) {
-                SAVE_CONT_STATE(SEXP_ERR_MEMORY, NULL);
-                return cc;
-              }
+  /* new continuation... init_continuation defaults to PARSER_NORMAL */
+  if (cc == NULL) {
+    cc = init_continuation((char *) iov[0].iov_base);
+    if (cc == NULL) return NULL;
+  }
 
-            } else {
-              bindata = NULL;
-            }
-          } else { /* still reading size string */
-            vcur[0] = t[0];
-            if (t[0] == '\\') esc = 1;
-            else esc = 0;
-            val_used++;
+  _parse(iov, iovcnt, cc);
 
-            if (val_used == val_allocated) {
-              char *valnew = NULL;
+  /* an error the continuation recovers from is passed over, and the
+     parser carries on from the position it was found at */
+  while (cc->recover != 0 && _recoverable(cc->error)) {
+    _resync(cc);
+    _parse(iov, iovcnt, cc);
+  }
 
-#ifdef __cplusplus
-              valnew = (char *)sexp_realloc(val,
-                                            val_allocated+sexp_val_grow_size,
-                                            val_allocated);
-#else
-              valnew = sexp_realloc(val,
-                                    val_allocated+sexp_val_grow_size,
-                                    val_allocated);
-#endif
+  return cc;
+}
 
-              if (valnew == NULL) {
-                SAVE_CONT_STATE(SEXP_ERR_MEMORY, NULL);
-                return cc;
-              }
-
-              val = valnew;
-
-              vcur = val + val_used;
-              val_allocated += sexp_val_grow_size;
-            } else vcur++;
-
-            t++;
-          }
-
-          break;
-
-        case 15: /* reading binary blob */
-          if (binread < binexpected) {
-            bindata[binread] = t[0];
-            binread++;
-            t++;
-          }
-
-          if (binread == binexpected) {
-            /* state = 1 -- create a sexp_t and head back */
-            sx = sexp_t_allocate();
-
-            if (sx == NULL) {
-              SAVE_CONT_STATE(SEXP_ERR_MEMORY, NULL);
-              return cc;
-            }
-
-            elts++;
-            sx->ty = SEXP_VALUE;
-            sx->bindata = bindata;
-            sx->binlength = binread;
-            sx->next = NULL;
-            sx->aty = SEXP_BINARY;
-
-            if (event_handlers != NULL &&
-                event_handlers->binary != NULL)
-              event_handlers->binary(sx->bindata, sx->binlength);
-
-            bindata = NULL;
-            binread = binexpected = 0;
-
-            state = 1;
-
-            val_used = 0;
-            vcur = val;
-
-            if (!empty_stack (stack))
-              {
-                data = (parse_data_t *) top_data (stack);
-                if (data->fst == NULL)
-                  {
-                    data->fst = data->lst = sx;
-                  }
-                else
-                  {
-                    data->lst->next = sx;
-                    data->lst = sx;
-                  }
-              }
-
-          }
-
-          break;
-
-        default:
-          SAVE_CONT_STATE(SEXP_ERR_UNKNOWN_STATE, NULL);
-          return cc;
-        }
+/*
+ * Validation runs the validating parser over the input with a
+ * continuation of its own.  That parser reads nothing from the atom
+ * buffer or the stack of the continuation, so it is given neither.
+ */
+sexp_errcode_t
+sexp_validate (const char *buf, size_t len, sexp_validate_info_t *info)
+{
+  pcont_t cc;
+  struct iovec one;
+  sexp_errcode_t err;
+  int binary = 0;
+
+  if (buf == NULL) {
+    sexp_errno = SEXP_ERR_NULLSTRING;
+    return SEXP_ERR_NULLSTRING;
+  }
 
-      /* the null check used to be part of the guard on the while loop.
-         unfortunately, if we're in state 15, null is considered a
-         perfectly valid byte.  This means the length passed in better
-         be accurate for the parser to not walk off the end of the
-         string! */
-      if (state != 15 && t[0] == '\0') keepgoing = 0;
-    }
+  if (info != NULL) {
+    binary = (info->mode == PARSER_INLINE_BINARY);
+    info->exprs = info->atoms = 0;
+    info->max_depth = 0;
+    info->offset = 0;
+  }
 
-  if (depth == 0 && elts > 0) {
-    while (stack->top != NULL)
-      {
-        lvl = pop (stack);
-        data = (parse_data_t *) lvl->data;
-        sx = data->fst;
-        pd_deallocate(data);
-        lvl->data = NULL;
-      }
+  memset(&cc, 0, sizeof(pcont_t));
+  cc.state = 1;
+  cc.mode = PARSER_EVENTS_ONLY;
+  cc.validate_info = info;
+
+  /* the parser does not write to its input */
+  one.iov_base = (void *) buf;
+  one.iov_len = len;
+  do {
+    if (binary)
+      _parse_validate_binary(&one, 1, &cc);
+    else
+      _parse_validate(&one, 1, &cc);
+  } while (cc.error == SEXP_ERR_OK && cc.lastPos != NULL);
+
+  err = cc.error;
+
+  if (err == SEXP_ERR_INCOMPLETE && cc.src_base < len) {
+    /* the parser stopped at a nul byte: what follows it would never be
+       read, so the input is not what it seems to be */
+    err = SEXP_ERR_BADCONTENT;
+  } else if (err == SEXP_ERR_INCOMPLETE && cc.depth == 0 &&
+             (cc.state == 1 || cc.state == 11)) {
+    /* running out of input between expressions is the normal end */
+    err = SEXP_ERR_OK;
+  }
 
-    esc = 0;
-    state = 1;
-    SAVE_CONT_STATE(SEXP_ERR_OK, sx);
-  } else {
-    SAVE_CONT_STATE(SEXP_ERR_INCOMPLETE, NULL);
-    if (t[0] == '\0' || t == bufEnd)
-      cc->lastPos = NULL;
+  if (info != NULL) {
+    if (err == SEXP_ERR_BADFORM)
+      info->offset = (size_t) (cc.lastPos - buf);
+    else if (err == SEXP_ERR_BADCONTENT)
+      info->offset = cc.src_base;
     else
-      cc->lastPos = t;
+      info->offset = len;
   }
 
-  return cc;
+  sexp_errno = err;
+  return err;
 }
@@ -0,0 +1,1354 @@
+/**
+   @cond IGNORE
+
+   ======================================================
+   SFSEXP: Small, Fast S-Expression Library
+   Written by Matthew Sottile (mjsottile@gmail.com)
+   ======================================================
+
+   Copyright (2003-2006). The Regents of the University of California. This
+   material was produced under U.S. Government contract W-7405-ENG-36 for Los
+   Alamos National Laboratory, which is operated by the University of
+   California for the U.S. Department of Energy. The U.S. Government has rights
+   to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+   THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+   LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+   derivative works, such modified software should be clearly marked, so as not
+   to confuse it with the version available from LANL.
+
+   Additionally, this library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of the
+   License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+   LA-CC-04-094
+
+   @endcond
+**/
+
+/*
+ * The parser state machine (see state_machine.txt).  This file has no
+ * include guard: parser.c includes it once for each specialized parser,
+ * after defining
+ *
+ *   PARSE_FN     - the name of the function to define
+ *   PARSE_KIND   - PARSE_TREE to build sexp_t structures, PARSE_EVENTS to
+ *                  only call the event handlers and event sink of the
+ *                  continuation, PARSE_VALIDATE to only check the input
+ *   PARSE_BINARY - 1 to read #b#<size>#<bytes> atoms as binary data
+ *
+ * The choices are made by the preprocessor, so the loop of each parser
+ * holds only the branches that parser needs.  The function takes the
+ * input as iovcnt segments and a continuation that is ready to use;
+ * cparse_sexpv picks the parser.
+ */
+
+/*** projections are only applied to trees in normal mode ***/
+#define PARSE_PROJECT (PARSE_KIND == PARSE_TREE && !PARSE_BINARY)
+
+/*** callbacks: tree parsers call the event handlers, events parsers
+     call the event sink as well, validating parsers call neither ***/
+#if PARSE_KIND == PARSE_VALIDATE
+#define EMIT_START()
+#define EMIT_END()
+#define EMIT_CHARS(v,n,ty)
+#define EMIT_BINARY(b,n)
+#else
+#if PARSE_KIND == PARSE_EVENTS
+#define EMIT_SINK(fn,args) {                            \
+    if (event_sink != NULL && event_sink->fn != NULL)   \
+      event_sink->fn args;                              \
+  }
+#else
+#define EMIT_SINK(fn,args)
+#endif
+#define EMIT_START() {                                                  \
+    if (event_handlers != NULL && event_handlers->start_sexpr != NULL)  \
+      event_handlers->start_sexpr();                                    \
+    EMIT_SINK(start_sexpr, (event_sink->data));                         \
+  }
+#define EMIT_END() {                                                    \
+    if (event_handlers != NULL && event_handlers->end_sexpr != NULL)    \
+      event_handlers->end_sexpr();                                      \
+    EMIT_SINK(end_sexpr, (event_sink->data));                           \
+  }
+/* the sink is given the text in val without its terminating nul */
+#define EMIT_CHARS(v,n,ty) {                                            \
+    if (event_handlers != NULL && event_handlers->characters != NULL)   \
+      event_handlers->characters((v),(n),(ty));                         \
+    EMIT_SINK(characters, (event_sink->data, val,                       \
+                           (size_t) (vcur - val), (ty)));               \
+  }
+#define EMIT_BINARY(b,n) {                                              \
+    if (event_handlers != NULL && event_handlers->binary != NULL)       \
+      event_handlers->binary((b),(n));                                  \
+    EMIT_SINK(binary, (event_sink->data, (b), (n)));                    \
+  }
+#endif
+
+/*** the limits of the continuation are checked by every parser ***/
+/* stop with err when over is true, a limit of the continuation having
+   been passed */
+#define CHECK_LIMIT(over,err) {                                         \
+    if (over) {                                                         \
+      SAVE_CONT_STATE((err), NULL);                                     \
+      return cc;                                                        \
+    }                                                                   \
+  }
+/* c is a digit that the size of binary data read so far as n can take
+   without overflowing */
+#define BIN_DIGIT(c,n) ((c) >= '0' && (c) <= '9' &&                     \
+                        (n) <= ((size_t) -1 - 9) / 10)
+/* count an element of the expression, before it is made */
+#define COUNT_NODE() {                                                  \
+    nodes++;                                                            \
+    CHECK_LIMIT(nodes > lim_nodes, SEXP_ERR_LIMIT_NODES);               \
+  }
+/* count an atom of n bytes, before it is made */
+#define COUNT_ATOM(n) {                                                 \
+    bytes += (n);                                                       \
+    CHECK_LIMIT((n) > lim_atom, SEXP_ERR_LIMIT_ATOM);                   \
+    CHECK_LIMIT(bytes > lim_bytes, SEXP_ERR_LIMIT_BYTES);               \
+    COUNT_NODE();                                                       \
+  }
+
+/*** the text of the atom being read is kept in val, except by validating
+     parsers: nobody reads it there, so they only count its length, for
+     the limits ***/
+#if PARSE_KIND == PARSE_VALIDATE
+#define VAL_ADD(c) { val_used++; }
+#define VAL_REPLACE(c)
+#define VAL_NUL()
+#define COUNT(field) {                          \
+    if (info != NULL)                           \
+      info->field++;                            \
+  }
+#else
+/* append c, growing val when it fills up; an atom that is too long
+   is caught here, before it has all been read */
+#define VAL_ADD(c) {                                                    \
+    vcur[0] = (c);                                                      \
+    val_used++;                                                         \
+    if (val_used == val_allocated) {                                    \
+      char *valnew;                                                     \
+      CHECK_LIMIT(val_used > lim_atom, SEXP_ERR_LIMIT_ATOM);            \
+      CHECK_LIMIT(bytes + val_used > lim_bytes, SEXP_ERR_LIMIT_BYTES);  \
+      valnew = (char *) sexp_realloc(val,                               \
+                                     val_allocated+                     \
+                                     sexp_val_grow_size,                \
+                                     val_allocated);                    \
+      if (valnew == NULL) {                                             \
+        SAVE_CONT_STATE(SEXP_ERR_MEMORY, NULL);                         \
+        return cc;                                                      \
+      }                                                                 \
+      val = valnew;                                                     \
+      vcur = val + val_used;                                            \
+      val_allocated += sexp_val_grow_size;                              \
+    } else vcur++;                                                      \
+  }
+/* replace the last character, the \ of an escape */
+#define VAL_REPLACE(c) { vcur[-1] = (c); }
+#define VAL_NUL() { vcur[0] = '\0'; }
+#define COUNT(field)
+#endif
+
+static pcont_t *
+PARSE_FN (const struct iovec *iov, int iovcnt, pcont_t *cc)
+{
+  char *t = NULL;
+  register size_t       binexpected = cc->binexpected;
+  register size_t       binread = cc->binread;
+  register size_t       val_allocated = cc->val_allocated;
+  register unsigned int squoted = cc->squoted;
+  register size_t       val_used = cc->val_used;
+  register unsigned int state = cc->state;
+  register unsigned int depth = cc->depth;
+  register unsigned int qdepth = cc->qdepth;
+  register unsigned int elts = 0;
+  register unsigned int esc = cc->esc;
+  char *val = cc->val;
+  char *vcur = cc->vcur;
+  char *bindata = cc->bindata;
+  faststack_t *stack = cc->stack;
+  char *bufEnd = NULL;
+  char *segEnd = NULL;
+  unsigned int seg;
+  size_t left = (cc->work_budget != 0) ? cc->work_budget : (size_t) -1;
+  int keepgoing = 1;
+  parser_event_handlers_t *event_handlers = cc->event_handlers;
+  size_t src_base = cc->src_base;
+  size_t src_atom = cc->src_atom;
+  size_t nodes = cc->nodes;
+  size_t bytes = cc->bytes;
+  size_t lim_depth = PARSE_LIMIT(cc->max_depth);
+  size_t lim_atom = PARSE_LIMIT(cc->max_atom_bytes);
+  size_t lim_nodes = PARSE_LIMIT(cc->max_nodes);
+  size_t lim_bytes = PARSE_LIMIT(cc->max_bytes);
+#if PARSE_KIND == PARSE_EVENTS
+  sexp_event_sink_t *event_sink = cc->event_sink;
+#endif
+#if PARSE_KIND == PARSE_VALIDATE
+  sexp_validate_info_t *info = cc->validate_info;
+#endif
+#if PARSE_KIND == PARSE_TREE
+  sexp_t *sx = NULL;
+  parse_data_t *data = NULL;
+  stack_lvl_t *lvl = NULL;
+  sexp_intern_t *intern = cc->intern;
+  sexp_hashcons_t *hashcons = cc->hashcons;
+  sexp_t *lsx = NULL;
+  sexp_t *prev = NULL;
+  const sexp_projection_t *pending = NULL;
+  unsigned int track = cc->track_source;
+  size_t src_open;
+#endif
+#if PARSE_PROJECT
+  const sexp_projection_t *projection = cc->projection;
+#endif
+
+  if (cc->lastPos != NULL) {
+    t = cc->lastPos;
+    seg = cc->seg;
+  } else {
+    t = (char *) iov[0].iov_base;
+    seg = 0;
+    cc->sbuffer = t;
+  }
+
+  segEnd = cc->sbuffer + iov[seg].iov_len;
+  SEG_BUDGET();
+
+  /* guard for loop - see end of loop for info.  Put it out here in the
+     event that we're restoring state from a continuation and need to
+     check before we start up. */
+  if (t != bufEnd && t[0] == '\0' && state != 15 && state != 22)
+    keepgoing = 0;
+
+  /*==================*/
+  /* main parser loop */
+  /*==================*/
+  while (keepgoing == 1)
+    {
+      /* at the end of a segment, go on to the next one, unless the
+         input or the work budget ends here */
+      if (t == bufEnd) {
+        if (t != segEnd || left == 0 || seg + 1 >= (unsigned int) iovcnt ||
+            (depth == 0 && elts > 0))
+          break;
+        src_base += (size_t) (segEnd - cc->sbuffer);
+        seg++;
+        t = cc->sbuffer = (char *) iov[seg].iov_base;
+        segEnd = t + iov[seg].iov_len;
+        SEG_BUDGET();
+        if (t != bufEnd && t[0] == '\0' && state != 15 && state != 22)
+          keepgoing = 0;
+        continue;
+      }
+
+      /* based on the current state in the FSM, do something */
+      switch (state)
+        {
+        case 1:
+          switch (PARSE_CLASS(t[0]) & PC_START)
+            {
+              /* space,tab,CR,LF considered white space */
+            case PC_SPACE:
+              t++;
+              break;
+              /* semicolon starts a comment that extends until a \n is
+                 encountered. */
+            case PC_SEMI:
+              t++;
+              state = 11;
+              break;
+              /* enter state 2 for open paren */
+            case PC_OPEN:
+              state = 2;
+              t++;
+              EMIT_START();
+              break;
+              /* enter state 3 for close paren */
+            case PC_CLOSE:
+              state = 3;
+              break;
+              /* begin quoted string - enter state 5 */
+            case PC_DQUOTE:
+#if PARSE_PROJECT
+              if (DROP_ELT()) {
+                state = 17;
+                esc = 0;
+                t++;
+                break;
+              }
+#endif
+              state = 5;
+              src_atom = SRC_POS(t);
+              /* set cur pointer to beginning of val buffer */
+              vcur = val;
+              t++;
+              break;
+              /* single quote - enter state 7 */
+            case PC_SQUOTE:
+#if PARSE_PROJECT
+              if (DROP_ELT()) {
+                state = 20;
+                t++;
+                break;
+              }
+#endif
+              state = 7;
+              src_atom = SRC_POS(t);
+              t++;
+              break;
+              /* other characters are assumed to be atom parts */
+            default:
+#if PARSE_PROJECT
+              if (DROP_ELT()) {
+                /* as in state 4, the first character is always taken */
+                esc = (t[0] == '\\');
+                state = 19;
+                t++;
+                break;
+              }
+#endif
+
+              /* set cur pointer to beginning of val buffer */
+              vcur = val;
+              src_atom = SRC_POS(t);
+
+              /** NOTE: the following code originally required a transition
+                  to state 4 before processing the first atom character --
+                  this required two iterations for the first character
+                  of each atom.  merging this into here allows us to process
+                  what we already know to be a valid atom character before
+                  entering state 4. **/
+              if (t[0] == '\\') esc = 1;
+              else esc = 0;
+              VAL_ADD(t[0]);
+
+              /* if the atom starts with # and we're in inline
+                 binary mode, we need to go to state 12 to start
+                 checking for the #b# prefix.  otherwise,
+                 if it's not a # or we're just in normal mode,
+                 proceed to state 4 as usual. */
+#if PARSE_BINARY
+              if (t[0] == '#') {
+                state = 12;
+              } else {
+                state = 4;
+              }
+#else
+              state = 4;
+#endif
+
+              t++;
+              break;
+            }
+          break;
+        case 2:
+          /* open paren */
+          depth++;
+          CHECK_LIMIT(depth > lim_depth, SEXP_ERR_LIMIT_DEPTH);
+          COUNT_NODE();
+
+#if PARSE_KIND != PARSE_TREE
+          elts++;
+#if PARSE_KIND == PARSE_VALIDATE
+          if (info != NULL && depth > info->max_depth)
+            info->max_depth = depth;
+#endif
+#else
+#if PARSE_PROJECT
+          if (projection != NULL && !empty_stack(stack) &&
+              ((parse_data_t *) top_data (stack))->pending != NULL) {
+            /* a list at the head of a list decides on that list */
+            if (_project_head(stack, NULL, event_handlers) == 0) {
+              EMIT_END();
+              state = 16;
+              break;
+            }
+          }
+
+          /* a list that is not the head of a projected list is pending
+             until its own head is known */
+          pending = NULL;
+          if (projection != NULL) {
+            if (stack->height < 1)
+              pending = projection;
+            else if (((parse_data_t *) top_data (stack))->fst != NULL)
+              pending = ((parse_data_t *) top_data (stack))->proj;
+          }
+#endif
+
+          sx = sexp_t_allocate();
+
+          if (sx == NULL) {
+            SAVE_CONT_STATE(SEXP_ERR_MEMORY,NULL);
+            return cc;
+          }
+
+          elts++;
+          sx->ty = SEXP_LIST;
+          sx->next = NULL;
+          sx->list = NULL;
+          prev = NULL;
+
+          /* the open paren was the character before this one */
+          if (track)
+            _src_set(sx, SRC_POS(t) - 1, 0);
+
+          if (stack->height < 1)
+            {
+              data = pd_allocate();
+
+              if (data == NULL) {
+                sexp_t_deallocate(sx);
+                SAVE_CONT_STATE(SEXP_ERR_MEMORY,NULL);
+                return cc;
+              }
+
+              data->fst = data->lst = sx;
+              data->proj = data->pending = NULL;
+              data->prev = NULL;
+              push (stack, data);
+            }
+          else
+            {
+              data = (parse_data_t *) top_data (stack);
+              prev = data->lst;
+              if (data->lst != NULL)
+                data->lst->next = sx;
+              else
+                data->fst = sx;
+              data->lst = sx;
+            }
+
+          data = pd_allocate();
+          if (data == NULL) {
+            SAVE_CONT_STATE(SEXP_ERR_MEMORY,NULL);
+            return cc;
+          }
+          data->fst = data->lst = NULL;
+          data->proj = NULL;
+          data->pending = pending;
+          data->prev = prev;
+          push (stack, data);
+#endif
+
+          state = 1;
+          break;
+        case 3:
+          /** close paren **/
+
+          /* check for close parens that were never opened. */
+          if (depth == 0) {
+            esc = 0;
+            state = 1;
+            SAVE_CONT_STATE(SEXP_ERR_BADFORM,NULL);
+            return cc;
+          }
+
+          t++;
+          depth--;
+
+#if PARSE_KIND == PARSE_TREE
+#if PARSE_PROJECT
+          /* an empty list, or one headed by a list, decides on itself */
+          if (((parse_data_t *) top_data (stack))->pending != NULL &&
+              _project_head(stack, NULL, event_handlers) == 0) {
+            if (empty_stack(stack)) elts = 0;
+            state = 1;
+            break;
+          }
+#endif
+
+          lvl = pop (stack);
+          data = (parse_data_t *) lvl->data;
+          sx = data->fst;
+          pd_deallocate(data);
+          lvl->data = NULL;
+
+          if (stack->top != NULL)
+            {
+              data = (parse_data_t *) top_data (stack);
+              data->lst->list = sx;
+              if (track &&
+                  sexp_source_range(data->lst, &src_open, NULL) == 0)
+                _src_set(data->lst, src_open, SRC_POS(t) - src_open);
+
+              if (cc->index_lists > 0) {
+                size_t n = 0;
+
+                for (lsx = sx; lsx != NULL && n < cc->index_lists;
+                     lsx = lsx->next)
+                  n++;
+                if (n == cc->index_lists && sexp_index(data->lst) != 0) {
+                  SAVE_CONT_STATE(SEXP_ERR_MEMORY, NULL);
+                  return cc;
+                }
+              }
+            }
+          else
+            {
+              SAVE_CONT_STATE(SEXP_ERR_BAD_STACK, NULL);
+              return cc;
+            }
+#endif
+
+          EMIT_END();
+
+          state = 1;
+
+          /** if depth = 0 then we finished a sexpr, and we return **/
+          if (depth == 0) {
+#if PARSE_KIND != PARSE_TREE
+            esc = 0;
+            COUNT(exprs);
+            SAVE_CONT_STATE(SEXP_ERR_OK, NULL);
+            return cc;
+#else
+            while (stack->top != NULL)
+              {
+                lvl = pop (stack);
+                data = (parse_data_t *) lvl->data;
+                sx = data->fst;
+                pd_deallocate(data);
+                lvl->data = NULL;
+              }
+
+            esc = 0;
+            state = 1;
+            HASHCONS_RESULT();
+            SAVE_CONT_STATE(SEXP_ERR_OK, sx);
+
+            return cc;
+#endif
+          }
+          break;
+        case 4: /** parsing atom **/
+          if (esc == 1 && (t[0] == '\"' || t[0] == '(' ||
+                           t[0] == ')' || t[0] == '\'' ||
+                           t[0] == '\\')) {
+            VAL_REPLACE(t[0]); /* overwrite the \ */
+            t++;
+            esc = 0;
+            break;
+          }
+
+          /* the non-whitespace, non paren and quote characters are
+             legal in atoms */
+          if (!(PARSE_CLASS(t[0]) & PC_PART))
+            {
+              VAL_NUL();
+              COUNT_ATOM(val_used);
+              val_used++;
+
+#if PARSE_KIND != PARSE_TREE
+              elts++;
+              COUNT(atoms);
+              EMIT_CHARS(val, val_used,
+                         (squoted != 0) ? SEXP_SQUOTE : SEXP_BASIC);
+              val_used = 0;
+              vcur = val;
+
+              if (depth == 0) {
+                /* looks like this expression was just a basic atom. */
+                squoted = 0;
+                state = 1;
+                esc = 0;
+                COUNT(exprs);
+                SAVE_CONT_STATE(SEXP_ERR_OK, NULL);
+                return cc;
+              }
+#else
+              sx = sexp_t_allocate();
+
+              if (sx == NULL) {
+                SAVE_CONT_STATE(SEXP_ERR_MEMORY, NULL);
+                return cc;
+              }
+
+              elts++;
+              sx->ty = SEXP_VALUE;
+              sx->next = NULL;
+              if (squoted != 0)
+                sx->aty = SEXP_SQUOTE;
+              else
+                sx->aty = SEXP_BASIC;
+              SET_SOURCE(src_atom, t);
+
+              if (intern != NULL && squoted == 0) {
+                /* the atom gets the table's copy of the text. */
+                sx->val = NULL;
+                if (sexp_intern_val(intern, sx, val, val_used - 1) != 0) {
+                  sexp_t_deallocate(sx);
+                  SAVE_CONT_STATE(SEXP_ERR_MEMORY, NULL);
+                  return cc;
+                }
+              } else {
+                sx->val = val;
+                sx->val_allocated = val_allocated;
+                sx->val_used = val_used;
+              }
+
+              EMIT_CHARS(sx->val, sx->val_used, sx->aty);
+
+              if (sx->val != val) {
+                /* interned: the buffer is free for the next atom. */
+                val_used = 0;
+                vcur = val;
+              } else {
+#ifdef __cplusplus
+                val = (char *)sexp_malloc(sizeof(char)*sexp_val_start_size);
+#else
+                val = sexp_malloc(sizeof(char)*sexp_val_start_size);
+#endif
+
+                if (val == NULL) {
+                  sexp_t_deallocate(sx);
+                  SAVE_CONT_STATE(SEXP_ERR_MEMORY, NULL);
+                  return cc;
+                }
+
+                val_allocated = sexp_val_start_size;
+                val_used = 0;
+                vcur = val;
+              }
+
+              if (!empty_stack (stack))
+                {
+                  data = (parse_data_t *) top_data (stack);
+                  if (data->fst == NULL)
+                    {
+                      data->fst = data->lst = sx;
+                    }
+                  else
+                    {
+                      data->lst->next = sx;
+                      data->lst = sx;
+                    }
+                }
+              else
+                {
+                  /* looks like this expression was just a basic atom - so
+                     return it. */
+                  squoted = 0;
+                  state = 1;
+                  esc = 0;
+                  HASHCONS_RESULT();
+                  SAVE_CONT_STATE(SEXP_ERR_OK, sx);
+                  return cc;
+                }
+#endif
+
+              switch (PARSE_CLASS(t[0]) & PC_START) {
+              case PC_SPACE:
+                /** NOTE: we know whitespace following atom, so spin ahead
+                    one and let state 1 do what it needs to for the next
+                    character. **/
+                state = 1;
+                t++;
+                squoted = 0;
+                break;
+              case PC_CLOSE:
+                squoted = 0;
+                state = 3;
+                break;
+              default:
+                squoted = 0;
+                state = 1;
+              }
+
+#if PARSE_PROJECT
+              PROJECT_ATOM();
+#endif
+            }
+          else
+            {
+              VAL_ADD(t[0]);
+              if (t[0] == '\\') esc = 1;
+              else esc = 0;
+
+              t++;
+
+              /* take the rest of a run of plain atom characters without
+                 going around the loop for each; escapes, the end of the
+                 atom and a full buffer are left to the code above */
+              if (esc == 0) {
+#if PARSE_KIND == PARSE_VALIDATE
+                char *run = t;
+
+                while (t != bufEnd &&
+                       (PARSE_CLASS(t[0]) & PC_PART) && t[0] != '\\')
+                  t++;
+                val_used += (size_t) (t - run);
+#else
+                while (t != bufEnd && val_used + 1 < val_allocated &&
+                       (PARSE_CLASS(t[0]) & PC_PART) && t[0] != '\\') {
+                  *vcur++ = *t++;
+                  val_used++;
+                }
+#endif
+              }
+            }
+          break;
+        case 5:
+          if (esc == 1 && (t[0] == '\"' ||
+                           t[0] == '\'' ||
+                           t[0] == '(' ||
+                           t[0] == ')' ||
+                           t[0] == '\\')) {
+            VAL_REPLACE(t[0]);
+            /** NO NEED TO UPDATE VAL COUNTS **/
+            t++;
+            esc = 0;
+            /* as in state 4: the escaped character may have been the
+               last one in the buffer */
+            break;
+          }
+
+          if (t[0] == '\"')
+            {
+              if (squoted == 1) {
+                VAL_ADD('\"');
+              }
+
+              state = 6;
+              VAL_NUL();
+              COUNT_ATOM(val_used);
+
+              val_used++;
+#if PARSE_KIND != PARSE_TREE
+              elts++;
+              COUNT(atoms);
+              EMIT_CHARS(val, val_used,
+                         (squoted == 1) ? SEXP_SQUOTE : SEXP_DQUOTE);
+              squoted = 0;
+              val_used = 0;
+              vcur = val;
+
+              if (depth == 0) {
+                /* looks like this expression was just a basic double
+                   quoted atom. */
+                t++; /* spin past the quote */
+
+                esc = 0;
+                state = 1;
+                COUNT(exprs);
+                SAVE_CONT_STATE(SEXP_ERR_OK, NULL);
+                return cc;
+              }
+#else
+              sx = sexp_t_allocate();
+
+              if (sx == NULL) {
+                SAVE_CONT_STATE(SEXP_ERR_MEMORY, NULL);
+                return cc;
+              }
+
+              elts++;
+              sx->ty = SEXP_VALUE;
+              sx->val = val;
+              sx->val_used = val_used;
+              sx->val_allocated = val_allocated;
+              sx->next = NULL;
+
+              if (squoted == 1) {
+                sx->aty = SEXP_SQUOTE;
+                squoted = 0;
+              } else
+                sx->aty = SEXP_DQUOTE;
+              SET_SOURCE(src_atom, t + 1);
+
+              EMIT_CHARS(sx->val, sx->val_used, sx->aty);
+
+#ifdef __cplusplus
+              val = (char *)sexp_malloc(sizeof(char)*sexp_val_start_size);
+#else
+              val = sexp_malloc(sizeof(char)*sexp_val_start_size);
+#endif
+
+              if (val == NULL) {
+                sexp_t_deallocate(sx);
+                SAVE_CONT_STATE(SEXP_ERR_MEMORY, NULL);
+                return cc;
+              }
+
+              val_allocated = sexp_val_start_size;
+              val_used = 0;
+              vcur = val;
+
+              if (!empty_stack (stack))
+                {
+                  data = (parse_data_t *) top_data (stack);
+                  if (data->fst == NULL)
+                    {
+                      data->fst = data->lst = sx;
+                    }
+                  else
+                    {
+                      data->lst->next = sx;
+                      data->lst = sx;
+                    }
+#if PARSE_PROJECT
+                  PROJECT_ATOM();
+#endif
+                }
+              else
+                {
+                  /* looks like this expression was just a basic double
+                     quoted atom - so return it. */
+                  t++; /* spin past the quote */
+
+                  squoted = 0;
+                  esc = 0;
+                  state = 1;
+                  HASHCONS_RESULT();
+                  SAVE_CONT_STATE(SEXP_ERR_OK, sx);
+
+                  return cc;
+                }
+#endif
+            }
+          else
+            {
+              VAL_ADD(t[0]);
+
+              if (t[0] == '\\') {
+                esc = 1;
+              } else
+                esc = 0;
+            }
+
+          t++;
+          break;
+        case 6:
+          vcur = val;
+          state = 1;
+          break;
+        case 7:
+          if (t[0] == '\"')
+            {
+              vcur = val;
+              VAL_ADD('\"');
+
+              state = 5;
+              t++;
+              squoted = 1;
+            }
+          else if (t[0] == '(')
+            {
+              vcur = val;
+              state = 8;
+            }
+          else
+            {
+              vcur = val;
+              state = 4;
+              squoted = 1;
+            }
+          break;
+        case 8:
+          VAL_ADD(t[0]);
+          if (esc == 0) {
+            if (t[0] == '(')
+              {
+                qdepth++;
+              }
+            else if (t[0] == ')')
+              {
+                qdepth--;
+                state = 9;
+              }
+            else if (t[0] == '\"')
+              {
+                state = 10;
+              }
+          } else {
+            esc = 0;
+          }
+          if (t[0] == '\\') esc = 1;
+          else esc = 0;
+
+          t++;
+          /* let it fall through to state 9 if we know we're transitioning
+             into that state */
+          if (state != 9)
+            break;
+        case 9:
+          if (qdepth == 0)
+            {
+              VAL_NUL();
+              COUNT_ATOM(val_used);
+              state = 1;
+#if PARSE_KIND != PARSE_TREE
+              elts++;
+              COUNT(atoms);
+              EMIT_CHARS(val, val_used, SEXP_SQUOTE);
+              val_used = 0;
+              vcur = val;
+
+              if (depth == 0) {
+                /* looks like the whole expression was a single
+                   quoted value! */
+                squoted = 0;
+                esc = 0;
+                COUNT(exprs);
+                SAVE_CONT_STATE(SEXP_ERR_OK, NULL);
+                return cc;
+              }
+#else
+              sx = sexp_t_allocate();
+
+              if (sx == NULL) {
+                SAVE_CONT_STATE(SEXP_ERR_MEMORY, NULL);
+                return cc;
+              }
+
+              elts++;
+              sx->ty = SEXP_VALUE;
+              sx->val = val;
+              sx->val_allocated = val_allocated;
+              sx->val_used = val_used;
+              sx->next = NULL;
+              sx->aty = SEXP_SQUOTE;
+              SET_SOURCE(src_atom, t);
+
+              EMIT_CHARS(sx->val, sx->val_used, sx->aty);
+
+#ifdef __cplusplus
+              val = (char *)sexp_malloc(sizeof(char)*sexp_val_start_size);
+#else
+              val = sexp_malloc(sizeof(char)*sexp_val_start_size);
+#endif
+
+              if (val == NULL) {
+                sexp_t_deallocate(sx);
+                SAVE_CONT_STATE(SEXP_ERR_MEMORY, NULL);
+                return cc;
+              }
+
+              val_allocated = sexp_val_start_size;
+              val_used = 0;
+              vcur = val;
+
+              if (!empty_stack (stack))
+                {
+                  data = (parse_data_t *) top_data (stack);
+                  if (data->fst == NULL)
+                    {
+                      data->fst = data->lst = sx;
+                    }
+                  else
+                    {
+                      data->lst->next = sx;
+                      data->lst = sx;
+                    }
+#if PARSE_PROJECT
+                  PROJECT_ATOM();
+#endif
+                }
+              else
+                {
+                  /* looks like the whole expression was a single
+                     quoted value!  So return it. */
+                  squoted = 0;
+                  esc = 0;
+                  state = 1;
+                  HASHCONS_RESULT();
+                  SAVE_CONT_STATE(SEXP_ERR_OK, sx);
+                  return cc;
+                }
+#endif
+            }
+          else
+            state = 8;
+          break;
+        case 10:
+          VAL_ADD(t[0]);
+          if (t[0] == '\"' && esc == 0)
+            {
+              state = 8;
+            }
+          if (t[0] == '\\') esc = 1;
+          else esc = 0;
+
+          t++;
+          break;
+        case 11:
+          if (t[0] == '\n') {
+            state = 1;
+          }
+          t++;
+          break;
+#if PARSE_BINARY
+        case 12: /* pre: we saw a # and we're in inline binary mode */
+          if (t[0] == 'b') {
+            if (t[0] == '\\') esc = 1;
+            else esc = 0;
+            VAL_ADD(t[0]);
+
+            state = 13; /* so far, #b */
+            t++;
+          } else {
+            state = 4; /* not #b, so plain ol' atom */
+          }
+
+          break;
+
+        case 13: /* pre: we saw a #b and we're in inline binary mode */
+          if (t[0] == '#') {
+            if (t[0] == '\\') esc = 1;
+            else esc = 0;
+            VAL_ADD(t[0]);
+
+            state = 14; /* so far, #b# - we're definitely in binary
+                           land now. */
+            /* reset vcur to val, overwrite #b# with the size string. */
+            vcur = val;
+            val_used = 0;
+            t++;
+          } else {
+            state = 4; /* not #b#, so plain ol' atom */
+          }
+
+          break;
+
+        case 14:
+          /**
+           * so far we've read #b#.  Now, the steps of the process become:
+           * proceed to read bytes in until we see # again.  This will be
+           * an ASCII representation of the size.  At this point, we want
+           * to read as many bytes as specified by this size string after
+           * the #.
+           */
+          if (t[0] == '#') { /* done with size string */
+            t++;
+            state = 15;
+            binread = 0;
+            esc = 0;
+            COUNT_ATOM(binexpected);
+#if PARSE_KIND != PARSE_VALIDATE
+            if (binexpected > 0) {
+#ifdef __cplusplus
+              bindata = (char *)sexp_malloc(sizeof(char)*binexpected);
+#else
+              bindata = sexp_malloc(sizeof(char)*binexpected);
+#endif
+
+              if (bindata == NULL) {
+                SAVE_CONT_STATE(SEXP_ERR_MEMORY, NULL);
+                return cc;
+              }
+
+            } else {
+              bindata = NULL;
+            }
+#endif
+          } else if (BIN_DIGIT(t[0], binexpected)) {
+            /* the size is read as it comes, by every parser alike */
+            binexpected = binexpected * 10 + (size_t) (t[0] - '0');
+            t++;
+          } else {
+            /* a size is decimal digits only: a sign, or anything else,
+               is an error */
+            SAVE_CONT_STATE(SEXP_ERR_BADFORM, NULL);
+            return cc;
+          }
+
+          break;
+
+        case 15: /* reading binary blob */
+#if PARSE_KIND == PARSE_VALIDATE
+          /* nothing is kept, so pass over all of it that is here */
+          if (binread < binexpected) {
+            size_t n = (size_t) (bufEnd - t);
+
+            if (n > binexpected - binread)
+              n = binexpected - binread;
+            binread += n;
+            t += n;
+          }
+#else
+          if (binread < binexpected) {
+            bindata[binread] = t[0];
+            binread++;
+            t++;
+          }
+#endif
+
+          if (binread == binexpected) {
+#if PARSE_KIND != PARSE_TREE
+            elts++;
+            COUNT(atoms);
+            EMIT_BINARY(bindata, binread);
+
+            if (bindata != NULL)
+              sexp_free(bindata, binread);
+#else
+            /* state = 1 -- create a sexp_t and head back */
+            sx = sexp_t_allocate();
+
+            if (sx == NULL) {
+              SAVE_CONT_STATE(SEXP_ERR_MEMORY, NULL);
+              return cc;
+            }
+
+            elts++;
+            sx->ty = SEXP_VALUE;
+            sx->bindata = bindata;
+            sx->binlength = binread;
+            sx->next = NULL;
+            sx->aty = SEXP_BINARY;
+            SET_SOURCE(src_atom, t);
+
+            EMIT_BINARY(sx->bindata, sx->binlength);
+#endif
+
+            bindata = NULL;
+            binread = binexpected = 0;
+
+            state = 1;
+
+            val_used = 0;
+            vcur = val;
+
+#if PARSE_KIND == PARSE_TREE
+            if (!empty_stack (stack))
+              {
+                data = (parse_data_t *) top_data (stack);
+                if (data->fst == NULL)
+                  {
+                    data->fst = data->lst = sx;
+                  }
+                else
+                  {
+                    data->lst->next = sx;
+                    data->lst = sx;
+                  }
+              }
+#endif
+          }
+
+          break;
+#endif
+
+          /** states 16 to 22 pass over what a projection drops, or what
+              is skipped to resynchronize after an error, only following
+              the nesting, strings, escapes, comments and binary data **/
+        case 16:
+          if (depth == SKIP_DEPTH()) {
+            /* the dropped element has ended */
+            SKIP_END();
+            state = 1;
+            break;
+          }
+
+          switch (PARSE_CLASS(t[0]) & PC_START)
+            {
+            case PC_OPEN:
+              depth++;
+              t++;
+              break;
+            case PC_CLOSE:
+              if (depth == qdepth) qdepth = 0;
+              depth--;
+              t++;
+              if (depth == SKIP_DEPTH()) {
+                if (empty_stack(stack)) elts = 0;
+                SKIP_END();
+                state = 1;
+              }
+              break;
+            case PC_DQUOTE:
+              state = 17;
+              t++;
+              break;
+            case PC_SQUOTE:
+              state = 20;
+              t++;
+              break;
+            case PC_SEMI:
+              /* inside a quoted list, a semicolon is text */
+              if (qdepth == 0) state = 18;
+              t++;
+              break;
+            case PC_SPACE:
+              t++;
+              break;
+            default:
+#if PARSE_BINARY
+              if (t[0] == '#') {
+                binread = binexpected = 0;
+                esc = 0;
+                state = 21;
+                t++;
+                break;
+              }
+#endif
+              esc = (t[0] == '\\');
+              state = 19;
+              t++;
+            }
+          break;
+        case 17: /* dropped string */
+          if (esc == 1)
+            esc = 0;
+          else if (t[0] == '\\')
+            esc = 1;
+          else if (t[0] == '\"')
+            state = 16;
+          t++;
+          break;
+        case 18: /* dropped comment */
+          if (t[0] == '\n')
+            state = 16;
+          t++;
+          break;
+        case 19: /* dropped atom */
+          if (esc == 1 && (t[0] == '\"' || t[0] == '(' ||
+                           t[0] == ')' || t[0] == '\'' ||
+                           t[0] == '\\')) {
+            esc = 0;
+            t++;
+            break;
+          }
+
+          if (PARSE_CLASS(t[0]) & PC_PART) {
+            esc = (t[0] == '\\');
+            t++;
+          } else {
+            esc = 0;
+            state = 16;
+          }
+          break;
+        case 20: /* dropped single quoted element */
+          if (t[0] == '(') {
+            /* a quoted list ends where the list at this depth does */
+            if (qdepth == 0) qdepth = depth + 1;
+            depth++;
+            state = 16;
+            t++;
+          } else if (t[0] == '\"') {
+            state = 17;
+            t++;
+          } else {
+            esc = 0;
+            state = 19;
+          }
+          break;
+#if PARSE_BINARY
+        case 21: /* dropped atom that started with #, which may be binary */
+          if (binread < 2) {
+            /* binread counts the b and # of a #b# prefix */
+            if (t[0] == (binread == 0 ? 'b' : '#')) {
+              binread++;
+              t++;
+            } else {
+              binread = 0;
+              esc = 0;
+              state = 19;
+            }
+          } else if (t[0] == '#') {
+            binread = 0;
+            state = 22;
+            t++;
+          } else if (BIN_DIGIT(t[0], binexpected)) {
+            binexpected = binexpected * 10 + (size_t) (t[0] - '0');
+            t++;
+          } else {
+            /* not a size state 14 would take, so not binary data */
+            binread = binexpected = 0;
+            esc = 0;
+            state = 19;
+          }
+          break;
+        case 22: /* dropped binary data */
+          if (binread < binexpected) {
+            size_t n = (size_t) (bufEnd - t);
+
+            if (n > binexpected - binread)
+              n = binexpected - binread;
+            binread += n;
+            t += n;
+          }
+          if (binread == binexpected) {
+            binread = binexpected = 0;
+            esc = 0;
+            state = 16;
+          }
+          break;
+#endif
+
+        default:
+          SAVE_CONT_STATE(SEXP_ERR_UNKNOWN_STATE, NULL);
+          return cc;
+        }
+
+      /* the null check used to be part of the guard on the while loop.
+         unfortunately, if we're in state 15 or 22, null is considered a
+         perfectly valid byte.  This means the length passed in better
+         be accurate for the parser to not walk off the end of the
+         string!  The input ends at bufEnd, so that is not looked at. */
+      if (t != bufEnd && t[0] == '\0' && state != 15 && state != 22)
+        keepgoing = 0;
+    }
+
+  if (depth == 0 && elts > 0) {
+#if PARSE_KIND != PARSE_TREE
+    esc = 0;
+    state = 1;
+    COUNT(exprs);
+    SAVE_CONT_STATE(SEXP_ERR_OK, NULL);
+#else
+    while (stack->top != NULL)
+      {
+        lvl = pop (stack);
+        data = (parse_data_t *) lvl->data;
+        sx = data->fst;
+        pd_deallocate(data);
+        lvl->data = NULL;
+      }
+
+    esc = 0;
+    state = 1;
+    HASHCONS_RESULT();
+    SAVE_CONT_STATE(SEXP_ERR_OK, sx);
+#endif
+  } else {
+    SAVE_CONT_STATE(SEXP_ERR_INCOMPLETE, NULL);
+    if ((t == segEnd && seg + 1 >= (unsigned int) iovcnt) ||
+        keepgoing == 0) {
+      /* the next buffer continues the input where this one ended */
+      cc->lastPos = NULL;
+      cc->src_base = SRC_POS(t);
+    } else
+      cc->lastPos = t;
+  }
+
+  return cc;
+}
+
+#undef EMIT_START
+#undef EMIT_END
+#undef EMIT_CHARS
+#undef EMIT_BINARY
+#undef EMIT_SINK
+#undef VAL_ADD
+#undef VAL_REPLACE
+#undef VAL_NUL
+#undef COUNT
+#undef CHECK_LIMIT
+#undef COUNT_NODE
+#undef COUNT_ATOM
+#undef BIN_DIGIT
+#undef PARSE_PROJECT
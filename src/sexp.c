@@ -37,8 +37,40 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <limits.h>
+#ifndef WIN32
+# include <sys/uio.h>
+# include <unistd.h>
+#else
+# include <io.h>
+#endif
 #include "sexp.h"
 #include "faststack.h"
+#include "grisu2.h"
+
+/*
+ * the parallel printer only starts threads when pthreads are available and
+ * the allocator is safe to call from several threads.  the memory limiting
+ * counters are not, so in that mode everything is printed serially.
+ */
+#if defined(_SEXP_THREADS_) && !defined(_SEXP_LIMIT_MEMORY_)
+# define SEXP_PARALLEL_PRINT
+# include <pthread.h>
+#endif
+
+/*
+ * background reclamation additionally needs sexp_t_deallocate to be thread
+ * safe, which is only the case when the sexp_t cache is compiled out.
+ * otherwise destroy_sexp_async simply destroys in the caller.
+ */
+#if defined(SEXP_PARALLEL_PRINT) && defined(_NO_MEMORY_MANAGEMENT_)
+# define SEXP_ASYNC_DESTROY
+#endif
+
+#ifndef IOV_MAX
+# define IOV_MAX 16
+#endif
 
 /*
  * global error code that can be set by sexp library calls.  default
@@ -51,32 +83,223 @@ void reset_sexp_errno() {
 }
 
 /**
- * Recursively walk an s-expression and free it.
+ * Walk an s-expression and free it.  The walk is iterative so that neither
+ * long next chains nor deep nesting use any C stack.  Entering a list whose
+ * next field is non-null leaves the rest of the chain to come back to;
+ * rather than allocating a stack for that, the list element itself is
+ * parked (pointer reversal): its list field is pointed at the pending next
+ * element and its next field at the previously parked element.  Parked
+ * elements are freed when they are popped.
  */
 void
 destroy_sexp (sexp_t * s)
 {
+  sexp_t *parked = NULL;
+  sexp_t *cell, *next;
+
+  for (;;) {
+    if (s == NULL) {
+      if (parked == NULL)
+        break;
+
+      cell = parked;
+      parked = cell->next;
+      s = cell->list;
+
+      cell->next = cell->list = NULL;
+      sexp_t_deallocate(cell);
+      continue;
+    }
+
+    /* a persistent element someone else still refers to stays, and so
+       does everything it refers to. */
+    if ((s->flags & SEXP_FLAG_PERSISTENT) &&
+        SEXP_REF_DEC(&s->refcount) > 0) {
+      s = NULL;
+      continue;
+    }
+
+    next = s->next;
+
+    /* arena elements are freed with their arena. */
+    if (s->flags & SEXP_FLAG_ARENA) {
+      s = next;
+      continue;
+    }
+
+    if (s->flags & SEXP_FLAG_INDEXED)
+      sexp_unindex(s);
+
+    if (s->ty == SEXP_LIST && s->list != NULL) {
+      cell = s;
+      s = s->list;
+
+      if (next != NULL) {
+        cell->list = next;
+        cell->next = parked;
+        parked = cell;
+      } else {
+        cell->next = cell->list = NULL;
+        sexp_t_deallocate(cell);
+      }
+      continue;
+    }
+
+    if (s->flags & SEXP_FLAG_LAZY)
+      sexp_lazy_release(s);
+
+    if (s->ty == SEXP_VALUE) {
+      if (s->aty == SEXP_BINARY && s->bindata != NULL) {
+        sexp_free(s->bindata, s->binlength);
+      } else {
+        sexp_release_val(s);
+      }
+    }
+
+    s->val = NULL;
+    s->bindata = NULL;
+    s->next = s->list = NULL;
+
+    sexp_t_deallocate(s);
+
+    s = next;
+  }
+}
+
+#ifdef SEXP_ASYNC_DESTROY
+/*
+ * state of the background reclaimer.  queued expressions are wrapped in
+ * list elements chained through their next fields, so the whole queue is
+ * itself one expression and a batch is freed with a single destroy_sexp.
+ */
+static pthread_mutex_t reclaim_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  reclaim_work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t  reclaim_idle = PTHREAD_COND_INITIALIZER;
+static pthread_t       reclaim_thread;
+static sexp_t         *reclaim_queue = NULL;
+static int             reclaim_running = 0;
+static int             reclaim_busy = 0;
+static int             reclaim_stop = 0;
+
+static void *
+_reclaimer (void *arg)
+{
+  sexp_t *batch;
+
+  (void) arg;
+
+  pthread_mutex_lock(&reclaim_lock);
+
+  for (;;) {
+    if (reclaim_queue == NULL) {
+      pthread_cond_broadcast(&reclaim_idle);
+
+      if (reclaim_stop != 0)
+        break;
+
+      pthread_cond_wait(&reclaim_work, &reclaim_lock);
+      continue;
+    }
+
+    batch = reclaim_queue;
+    reclaim_queue = NULL;
+    reclaim_busy = 1;
+    pthread_mutex_unlock(&reclaim_lock);
+
+    destroy_sexp(batch);
+
+    pthread_mutex_lock(&reclaim_lock);
+    reclaim_busy = 0;
+  }
+
+  pthread_mutex_unlock(&reclaim_lock);
+
+  return NULL;
+}
+#endif /* SEXP_ASYNC_DESTROY */
+
+/**
+ * Hand s to the reclaimer thread, starting it if needed.  Anything that
+ * can't be queued is destroyed right here.
+ */
+void
+destroy_sexp_async (sexp_t * s)
+{
+#ifdef SEXP_ASYNC_DESTROY
+  sexp_t *cell;
+
   if (s == NULL)
     return;
 
-  if (s->ty == SEXP_LIST) {
-    destroy_sexp (s->list);
-  } else if (s->ty == SEXP_VALUE) {
-    if (s->aty == SEXP_BINARY && s->bindata != NULL) {
-      sexp_free(s->bindata, s->binlength);
-    } else if (s->val != NULL) {
-      sexp_free(s->val, s->val_allocated);
+  cell = new_sexp_list(s);
+  if (cell == NULL) {
+    destroy_sexp(s);
+    return;
+  }
+
+  pthread_mutex_lock(&reclaim_lock);
+
+  if (reclaim_running == 0) {
+    reclaim_stop = 0;
+    if (pthread_create(&reclaim_thread, NULL, _reclaimer, NULL) != 0) {
+      pthread_mutex_unlock(&reclaim_lock);
+      destroy_sexp(cell);
+      return;
     }
+    reclaim_running = 1;
   }
 
-  s->val = NULL;
-  s->bindata = NULL;
+  cell->next = reclaim_queue;
+  reclaim_queue = cell;
+
+  pthread_cond_signal(&reclaim_work);
+  pthread_mutex_unlock(&reclaim_lock);
+#else
+  destroy_sexp(s);
+#endif /* SEXP_ASYNC_DESTROY */
+}
+
+/**
+ * Block until everything handed to destroy_sexp_async so far is freed.
+ */
+void
+sexp_reclaimer_drain (void)
+{
+#ifdef SEXP_ASYNC_DESTROY
+  pthread_mutex_lock(&reclaim_lock);
+
+  while (reclaim_running != 0 && (reclaim_queue != NULL || reclaim_busy != 0))
+    pthread_cond_wait(&reclaim_idle, &reclaim_lock);
+
+  pthread_mutex_unlock(&reclaim_lock);
+#endif /* SEXP_ASYNC_DESTROY */
+}
+
+/**
+ * Drain the reclaimer queue and stop the thread.
+ */
+void
+sexp_reclaimer_shutdown (void)
+{
+#ifdef SEXP_ASYNC_DESTROY
+  pthread_mutex_lock(&reclaim_lock);
+
+  if (reclaim_running == 0) {
+    pthread_mutex_unlock(&reclaim_lock);
+    return;
+  }
 
-  destroy_sexp (s->next);
+  reclaim_stop = 1;
+  pthread_cond_signal(&reclaim_work);
+  pthread_mutex_unlock(&reclaim_lock);
 
-  s->next = s->list = NULL;
+  pthread_join(reclaim_thread, NULL);
 
-  sexp_t_deallocate(s);
+  pthread_mutex_lock(&reclaim_lock);
+  reclaim_running = 0;
+  reclaim_stop = 0;
+  pthread_mutex_unlock(&reclaim_lock);
+#endif /* SEXP_ASYNC_DESTROY */
 }
 
 /**
@@ -91,6 +314,7 @@ print_sexp (char *buf, size_t size, const sexp_t * sx)
   int retval;
   size_t sz;
   char *b = buf, *tc;
+  char nbuf[SEXP_NUMBER_MAX];
   size_t left = size;
   int depth = 0;
   faststack_t *stack;
@@ -135,6 +359,12 @@ print_sexp (char *buf, size_t size, const sexp_t * sx)
 
   tmp = *sx;
   tmp.next = tmp.list = NULL;
+  if (tmp.flags & SEXP_FLAG_LAZY) {
+    /* the copy must not be built, nor take the text from sx */
+    tmp.flags &= ~SEXP_FLAG_LAZY;
+    tmp.val = tmp.bindata = NULL;
+    tmp.val_used = 0;
+  }
 
   fakehead = copy_sexp(&tmp);
 
@@ -146,6 +376,11 @@ print_sexp (char *buf, size_t size, const sexp_t * sx)
 
   fakehead->list = sx->list;
   fakehead->next = NULL; /* this is the important part of fakehead */
+  if (sx->flags & SEXP_FLAG_LAZY) {
+    fakehead->flags |= SEXP_FLAG_LAZY;
+    fakehead->val = sx->val;
+    fakehead->val_used = sx->val_used;
+  }
 
   stack = make_stack ();
   if (stack == NULL)
@@ -193,7 +428,27 @@ print_sexp (char *buf, size_t size, const sexp_t * sx)
               add_char_break_full('\'');
             }
 
-          if (tdata->aty != SEXP_BINARY && tdata->val_used > 0) {
+          if (tdata->aty != SEXP_BINARY && tdata->val == NULL &&
+              (tdata->flags & (SEXP_FLAG_INT64 | SEXP_FLAG_DOUBLE))) {
+            /* numbers need no escaping; format straight into b when
+               the text surely fits. */
+            if (left > SEXP_NUMBER_MAX) {
+              sz = (tdata->flags & SEXP_FLAG_INT64) ?
+                sexp_format_int64(b, sexp_int64_value(tdata)) :
+                sexp_format_double(b, sexp_double_value(tdata));
+            } else {
+              sexp_atom_text(tdata, nbuf, &sz);
+              if (sz >= left) {
+                memcpy(b, nbuf, left);
+                b += left;
+                left = 0;
+                out_of_space();
+              }
+              memcpy(b, nbuf, sz);
+            }
+            b += sz;
+            left -= sz;
+          } else if (tdata->aty != SEXP_BINARY && tdata->val_used > 0) {
             tc = tdata->val;
             /* copy value into string */
             while (tc[0] != 0 && left > 0)
@@ -261,6 +516,28 @@ print_sexp (char *buf, size_t size, const sexp_t * sx)
                 add_char_break_full(' ');
               }
           }
+          else if (tdata->ty == SEXP_LIST &&
+                   (tdata->flags & SEXP_FLAG_LAZY))
+            {
+              /* a lazy list prints as the text it was parsed from */
+              if (tdata->val_used >= left)
+                {
+                  memcpy(b, tdata->val, left);
+                  b += left;
+                  left = 0;
+                  out_of_space();
+                }
+              memcpy(b, tdata->val, tdata->val_used);
+              b += tdata->val_used;
+              left -= tdata->val_used;
+
+              top->data = ((sexp_t *) top->data)->next;
+
+              if (top->data != NULL)
+                {
+                  add_char_break_full(' ');
+                }
+            }
           else if (tdata->ty == SEXP_LIST)
             {
               depth++;
@@ -301,61 +578,173 @@ print_sexp (char *buf, size_t size, const sexp_t * sx)
       return retval;
     }
 
+/*
+ * state of sexp_emit_raw: the rest of the output buffer, the source
+ * text, whether a space goes before the next element, and the error
+ * that ended the walk.
+ */
+typedef struct emit_state {
+  char *b;
+  size_t left;
+  const char *src;
+  size_t srclen;
+  const sexp_t *top;    /* the copy of the element emitted that is walked */
+  const sexp_t *orig;   /* and the element */
+  const sexp_t *copied; /* the last element copied out of src */
+  int sep;
+  sexp_errcode_t err;
+} emit_state_t;
+
+/* append n bytes, always leaving room for the nul */
+static int
+_emit (emit_state_t * e, const char *p, size_t n)
+{
+  if (n >= e->left) {
+    e->err = SEXP_ERR_BUFFER_FULL;
+    return -1;
+  }
+
+  memcpy(e->b, p, n);
+  e->b += n;
+  e->left -= n;
+
+  return 0;
+}
+
+static sexp_walk_t
+_emit_pre (sexp_t * sx, unsigned int depth, void *data)
+{
+  emit_state_t *e = (emit_state_t *) data;
+  size_t off, len;
+  int n;
+
+  if (e->sep && _emit(e, " ", 1) != 0)
+    return SEXP_WALK_STOP;
+  e->sep = 1;
+
+  /* the top element is walked as a copy, and its range is the original's */
+  if (sexp_source_range((sx == e->top) ? e->orig : sx, &off, &len) == 0) {
+    if (off > e->srclen || len > e->srclen - off) {
+      e->err = SEXP_ERR_BAD_PARAM;
+      return SEXP_WALK_STOP;
+    }
+    if (_emit(e, e->src + off, len) != 0)
+      return SEXP_WALK_STOP;
+    e->copied = sx;
+    return SEXP_WALK_SKIP;
+  }
+
+  if (sx->ty == SEXP_LIST) {
+    e->sep = 0;
+    return (_emit(e, "(", 1) != 0) ? SEXP_WALK_STOP : SEXP_WALK_CONTINUE;
+  }
+
+  /* a changed atom is printed as usual */
+  n = print_sexp(e->b, e->left, sx);
+  if (n < 0) {
+    e->err = sexp_errno;
+    return SEXP_WALK_STOP;
+  }
+  e->b += n;
+  e->left -= n;
+
+  return SEXP_WALK_CONTINUE;
+}
+
+static sexp_walk_t
+_emit_post (sexp_t * sx, unsigned int depth, void *data)
+{
+  emit_state_t *e = (emit_state_t *) data;
+
+  if (sx->ty == SEXP_LIST && sx != e->copied) {
+    if (_emit(e, ")", 1) != 0)
+      return SEXP_WALK_STOP;
+    e->sep = 1;
+  }
+
+  return SEXP_WALK_CONTINUE;
+}
+
+int
+sexp_emit_raw (char *buf, size_t size, const sexp_t * sx,
+               const char *src, size_t srclen)
+{
+  emit_state_t e;
+  sexp_errcode_t olderr;
+  sexp_t tmp;
+
+  if (sx == NULL)
+    {
+      buf[0] = '\0';
+      return 0;
+    }
+
+  if (size < 1)
+    {
+      return -1;
+    }
+
+  e.b = buf;
+  e.left = size;
+  e.src = src;
+  e.srclen = (src == NULL) ? 0 : srclen;
+  e.sep = 0;
+  e.err = SEXP_ERR_OK;
+
+  /* the walk would go on along the next chain of sx */
+  tmp = *sx;
+  tmp.next = NULL;
+  e.top = &tmp;
+  e.orig = sx;
+  e.copied = NULL;
+
+  olderr = sexp_errno;
+  sexp_errno = SEXP_ERR_OK;
+  if (sexp_walk(&tmp, _emit_pre, _emit_post, &e) == NULL &&
+      e.err == SEXP_ERR_OK && sexp_errno == SEXP_ERR_MEMORY)
+    e.err = SEXP_ERR_MEMORY;
+
+  e.b[0] = '\0';
+
+  if (e.err != SEXP_ERR_OK) {
+    sexp_errno = e.err;
+    return -1;
+  }
+
+  sexp_errno = olderr;
+
+  return (int) (size - e.left);
+}
+
   /**
    * Iterative method to walk sx and turn it back into the string
-   * representation of the s-expression.  Fills the CSTRING that is
-   * passed in.  If *s == NULL (new CSTRING, never used), snew() is called
-   * and passed back.  If *s != NULL, *s is used as the CSTRING to print
-   * into.  In the last case, the recycled CSTRING must have sempty() called
-   * to reset the allocated vs. used counters to make it appear to be empty.
-   * the code will assume that sempty() was called by the user!
+   * representation of the s-expression, appending it to *s.  This is
+   * the body of print_sexp_cstr, split out so that callers printing many
+   * elements (print_sexp_parallel) can reuse one stack.  The stack must
+   * be empty on entry and is left empty on return.  The fake head used to
+   * stop the walk at sx lives on the C stack, so nothing is taken from
+   * or returned to the sexp_t cache and this is safe to call from
+   * several threads at once.  Returns 0 on success, -1 if sx contains an
+   * element of unknown type; sexp_errno is left for the caller to set, as
+   * the workers of print_sexp_parallel must not write it.
    */
-  int
-    print_sexp_cstr (CSTRING **s, const sexp_t *sx, size_t ss)
+  static int
+    _print_sexp_cstr (CSTRING **s, const sexp_t *sx, faststack_t *stack)
   {
-    int retval;
     char *tc;
     int depth = 0;
-    faststack_t *stack;
     stack_lvl_t *top;
     sexp_t *tdata;
-    sexp_t *fakehead;
-    CSTRING *_s = NULL;
+    sexp_t fakehead;
+    CSTRING *_s = *s;
     char sbuf[32];
     unsigned int i;
-    sexp_t tmp;
-
-    if (sx == NULL)
-      {
-        return -1;
-      }
-
-    if (*s == NULL)
-      _s = snew(ss);
-    else
-      _s = *s;
-
-    tmp = *sx;
-    tmp.next = tmp.list = NULL;
+    size_t n;
 
-    fakehead = copy_sexp(&tmp);
+    fakehead = *sx;
+    fakehead.next = NULL; /* this is the important part of fakehead */
 
-    if (fakehead == NULL) {
-      sexp_errno = SEXP_ERR_MEMORY;
-      return -1;
-    }
-
-    fakehead->list = sx->list;
-    fakehead->next = NULL; /* this is the important part of fakehead */
-
-    stack = make_stack ();
-    if (stack == NULL) {
-      sexp_errno = SEXP_ERR_MEMORY;
-      sexp_t_deallocate(fakehead);
-      return -1;
-    }
-
-    push (stack, fakehead);
+    push (stack, &fakehead);
 
     while (stack->top != NULL)
       {
@@ -401,6 +790,10 @@ print_sexp (char *buf, size_t size, const sexp_t * sx)
               for (i=0;i<tdata->binlength;i++)
                 _s = saddch(_s,tdata->bindata[i]);
               _s = saddch(_s,' ');
+            } else if (tdata->val == NULL &&
+                       (tdata->flags & (SEXP_FLAG_INT64 | SEXP_FLAG_DOUBLE))) {
+              sexp_atom_text(tdata, sbuf, NULL);
+              _s = sadd(_s, sbuf);
             } else {
               if (tdata->val_used > 0) {
                 tc = tdata->val;
@@ -428,6 +821,20 @@ print_sexp (char *buf, size_t size, const sexp_t * sx)
 
             top->data = ((sexp_t *) top->data)->next;
 
+            if (top->data != NULL)
+              {
+                _s = saddch(_s,' ');
+              }
+          }
+        else if (tdata->ty == SEXP_LIST &&
+                 (tdata->flags & SEXP_FLAG_LAZY))
+          {
+            /* a lazy list prints as the text it was parsed from */
+            for (n = 0; n < tdata->val_used; n++)
+              _s = saddch(_s,tdata->val[n]);
+
+            top->data = ((sexp_t *) top->data)->next;
+
             if (top->data != NULL)
               {
                 _s = saddch(_s,' ');
@@ -441,9 +848,8 @@ print_sexp (char *buf, size_t size, const sexp_t * sx)
           }
         else
           {
-            sexp_errno = SEXP_ERR_BADCONTENT;
-            destroy_stack (stack);
-            sexp_t_deallocate(fakehead);
+            while (stack->top != NULL)
+              pop (stack);
             return -1;
           }
 
@@ -454,16 +860,478 @@ print_sexp (char *buf, size_t size, const sexp_t * sx)
         depth--;
       }
 
+    *s = _s;
+
+    return 0;
+  }
+
+  /**
+   * Iterative method to walk sx and turn it back into the string
+   * representation of the s-expression.  Fills the CSTRING that is
+   * passed in.  If *s == NULL (new CSTRING, never used), snew() is called
+   * and passed back.  If *s != NULL, *s is used as the CSTRING to print
+   * into.  In the last case, the recycled CSTRING must have sempty() called
+   * to reset the allocated vs. used counters to make it appear to be empty.
+   * the code will assume that sempty() was called by the user!
+   */
+  int
+    print_sexp_cstr (CSTRING **s, const sexp_t *sx, size_t ss)
+  {
+    faststack_t *stack;
+    CSTRING *_s = NULL;
+
+    if (sx == NULL)
+      {
+        return -1;
+      }
+
+    if (*s == NULL)
+      _s = snew(ss);
+    else
+      _s = *s;
+
+    stack = make_stack ();
+    if (stack == NULL) {
+      sexp_errno = SEXP_ERR_MEMORY;
+      if (*s == NULL)
+        sdestroy(_s);
+      return -1;
+    }
+
+    if (_print_sexp_cstr(&_s, sx, stack) != 0) {
+      destroy_stack (stack);
+      if (*s == NULL)
+        sdestroy(_s);
+      sexp_errno = SEXP_ERR_BADCONTENT;
+      return -1;
+    }
+
+    destroy_stack (stack);
+
     *s = _s;
     if (_s == NULL)
-      retval = 0;
+      return 0;
     else
-      retval = (int) _s->curlen;
+      return (int) _s->curlen;
+  }
+
+  /**
+   * One contiguous run of children of the list being printed by
+   * print_sexp_parallel, the buffer it is printed into, and what went
+   * wrong printing it.
+   */
+  typedef struct print_chunk {
+    const sexp_t *first;
+    size_t count;
+    CSTRING *out;
+    sexp_errcode_t err;
+  } print_chunk_t;
+
+  /**
+   * State shared by the workers of print_sexp_parallel.  Chunks are handed
+   * out in order from nextchunk, so a worker that drew cheap chunks simply
+   * comes back for more.
+   */
+  typedef struct print_job {
+    print_chunk_t *chunks;
+    size_t nchunks;
+    size_t nextchunk;
+    size_t ss;
+#ifdef SEXP_PARALLEL_PRINT
+    pthread_mutex_t lock;
+#endif
+  } print_job_t;
+
+  /**
+   * Print the elements of one chunk separated by spaces.  Every chunk but
+   * the last also gets the space that separates it from the next chunk.
+   */
+  static sexp_errcode_t
+    _print_chunk (print_chunk_t *c, int last, size_t ss)
+  {
+    faststack_t *stack;
+    const sexp_t *e;
+    size_t i;
+
+    c->out = snew(ss);
+    if (c->out == NULL)
+      return SEXP_ERR_MEMORY;
+
+    stack = make_stack ();
+    if (stack == NULL)
+      return SEXP_ERR_MEMORY;
+
+    for (i = 0, e = c->first; i < c->count; i++, e = e->next) {
+      if (_print_sexp_cstr(&c->out, e, stack) != 0) {
+        destroy_stack (stack);
+        return SEXP_ERR_BADCONTENT;
+      }
+
+      if (i+1 < c->count || last == 0)
+        c->out = saddch(c->out, ' ');
+
+      if (c->out == NULL) {
+        destroy_stack (stack);
+        return SEXP_ERR_MEMORY;
+      }
+    }
 
     destroy_stack (stack);
-    sexp_t_deallocate(fakehead);
 
-    return retval;
+    return SEXP_ERR_OK;
+  }
+
+  /**
+   * Worker loop: take the next unprinted chunk until none are left.  Each
+   * chunk keeps its own error; sexp_errno is set once the workers are
+   * done.
+   */
+  static void *
+    _print_worker (void *arg)
+  {
+    print_job_t *job = (print_job_t *)arg;
+    size_t i;
+
+    for (;;) {
+#ifdef SEXP_PARALLEL_PRINT
+      pthread_mutex_lock(&job->lock);
+#endif
+      i = job->nextchunk;
+      if (i < job->nchunks)
+        job->nextchunk++;
+#ifdef SEXP_PARALLEL_PRINT
+      pthread_mutex_unlock(&job->lock);
+#endif
+
+      if (i >= job->nchunks)
+        break;
+
+      job->chunks[i].err =
+        _print_chunk(&job->chunks[i], (i+1 == job->nchunks), job->ss);
+    }
+
+    return NULL;
+  }
+
+  /**
+   * Split the children of the list sx into chunks and print them with up
+   * to nthreads workers.  On success *chunksp holds *nchunksp printed
+   * chunks which, wrapped in a pair of parens, are the printed form of sx.
+   */
+  static sexp_errcode_t
+    _print_sexp_chunks (const sexp_t *sx, unsigned int nthreads,
+                        print_chunk_t **chunksp, size_t *nchunksp, size_t ss)
+  {
+    print_job_t job;
+    print_chunk_t *chunks;
+    const sexp_t *e;
+    size_t nchildren = 0, nchunks, per, extra, i, j;
+    sexp_errcode_t err;
+#ifdef SEXP_PARALLEL_PRINT
+    pthread_t *tids;
+    unsigned int nt, started = 0;
+#endif
+
+    for (e = sx->list; e != NULL; e = e->next)
+      nchildren++;
+
+    /* a few chunks per thread so that one expensive subtree doesn't leave
+       the other workers idle. */
+    nchunks = (size_t)nthreads * 4;
+    if (nchunks > nchildren)
+      nchunks = nchildren;
+
+#ifdef __cplusplus
+    chunks = (print_chunk_t *)sexp_calloc(nchunks, sizeof(print_chunk_t));
+#else
+    chunks = sexp_calloc(nchunks, sizeof(print_chunk_t));
+#endif
+    if (chunks == NULL)
+      return SEXP_ERR_MEMORY;
+
+    per = nchildren / nchunks;
+    extra = nchildren % nchunks;
+    e = sx->list;
+    for (i = 0; i < nchunks; i++) {
+      chunks[i].first = e;
+      chunks[i].count = per + (i < extra ? 1 : 0);
+      for (j = 0; j < chunks[i].count; j++)
+        e = e->next;
+    }
+
+    job.chunks = chunks;
+    job.nchunks = nchunks;
+    job.nextchunk = 0;
+    job.ss = ss;
+
+#ifdef SEXP_PARALLEL_PRINT
+    nt = (nthreads > nchunks) ? (unsigned int)nchunks : nthreads;
+    pthread_mutex_init(&job.lock, NULL);
+
+#ifdef __cplusplus
+    tids = (pthread_t *)sexp_malloc(sizeof(pthread_t)*nt);
+#else
+    tids = sexp_malloc(sizeof(pthread_t)*nt);
+#endif
+
+    /* the calling thread is worker zero.  if threads can't be started
+       it just ends up doing more of the chunks itself. */
+    if (tids != NULL) {
+      for (started = 0; started+1 < nt; started++)
+        if (pthread_create(&tids[started], NULL, _print_worker, &job) != 0)
+          break;
+    }
+
+    _print_worker(&job);
+
+    for (i = 0; i < started; i++)
+      pthread_join(tids[i], NULL);
+
+    if (tids != NULL)
+      sexp_free(tids, sizeof(pthread_t)*nt);
+    pthread_mutex_destroy(&job.lock);
+#else
+    _print_worker(&job);
+#endif
+
+    /* the first chunk that failed gives the error */
+    for (i = 0; i < nchunks; i++)
+      if (chunks[i].err != SEXP_ERR_OK)
+        break;
+    if (i < nchunks) {
+      err = chunks[i].err;
+      for (i = 0; i < nchunks; i++)
+        sdestroy(chunks[i].out);
+      sexp_free(chunks, sizeof(print_chunk_t)*nchunks);
+      return err;
+    }
+
+    *chunksp = chunks;
+    *nchunksp = nchunks;
+
+    return SEXP_ERR_OK;
+  }
+
+  /**
+   * Print sx into *s, printing the children of a top level list in
+   * parallel and gathering the pieces with one memcpy each.
+   */
+  sexp_errcode_t
+    print_sexp_parallel (CSTRING **s, const sexp_t *sx, size_t ss,
+                         unsigned int nthreads)
+  {
+    print_chunk_t *chunks;
+    size_t nchunks, total, i;
+    CSTRING *_s;
+    char *newbase;
+    sexp_errcode_t err;
+
+    if (sx == NULL || s == NULL)
+      return SEXP_ERR_BAD_PARAM;
+
+    /* nothing to split: fall back to the serial printer. */
+    if (nthreads < 2 || sx->ty != SEXP_LIST ||
+        sx->list == NULL || sx->list->next == NULL)
+      {
+        if (print_sexp_cstr(s, sx, ss) < 0 || *s == NULL)
+          return (sexp_errno != SEXP_ERR_OK) ? sexp_errno : SEXP_ERR_MEMORY;
+        return SEXP_ERR_OK;
+      }
+
+    err = _print_sexp_chunks(sx, nthreads, &chunks, &nchunks, ss);
+    if (err != SEXP_ERR_OK) {
+      sexp_errno = err;
+      return err;
+    }
+
+    total = 2;
+    for (i = 0; i < nchunks; i++)
+      total += chunks[i].out->curlen;
+
+    if (*s == NULL) {
+      _s = snew((ss > total) ? ss : total+1);
+    } else {
+      _s = *s;
+      if (_s->curlen + total >= _s->len) {
+#ifdef __cplusplus
+        newbase = (char *)sexp_realloc(_s->base, _s->curlen+total+1, _s->len);
+#else
+        newbase = sexp_realloc(_s->base, _s->curlen+total+1, _s->len);
+#endif
+        if (newbase == NULL) {
+          _s = NULL;
+        } else {
+          _s->base = newbase;
+          _s->len = _s->curlen+total+1;
+        }
+      }
+    }
+
+    if (_s == NULL) {
+      for (i = 0; i < nchunks; i++)
+        sdestroy(chunks[i].out);
+      sexp_free(chunks, sizeof(print_chunk_t)*nchunks);
+      sexp_errno = SEXP_ERR_MEMORY;
+      return SEXP_ERR_MEMORY;
+    }
+
+    _s->base[_s->curlen++] = '(';
+    for (i = 0; i < nchunks; i++) {
+      memcpy(_s->base+_s->curlen, chunks[i].out->base, chunks[i].out->curlen);
+      _s->curlen += chunks[i].out->curlen;
+      sdestroy(chunks[i].out);
+    }
+    _s->base[_s->curlen++] = ')';
+    _s->base[_s->curlen] = '\0';
+
+    sexp_free(chunks, sizeof(print_chunk_t)*nchunks);
+
+    *s = _s;
+
+    return SEXP_ERR_OK;
+  }
+
+#ifdef WIN32
+  /**
+   * write() all len bytes of buf to fd, carrying on after short writes.
+   * Returns 0, or -1 if a write fails.
+   */
+  static int
+    _write_all (int fd, const char *buf, size_t len)
+  {
+    int n;
+
+    while (len > 0) {
+      n = write(fd, buf, (unsigned int)len);
+
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        return -1;
+
+      buf += n;
+      len -= (size_t)n;
+    }
+
+    return 0;
+  }
+#endif
+
+  /**
+   * Print sx to fd, printing the children of a top level list in parallel
+   * and handing the pieces to the kernel with writev() so the output is
+   * never gathered into one buffer.
+   */
+  sexp_errcode_t
+    write_sexp_parallel (int fd, const sexp_t *sx, unsigned int nthreads)
+  {
+    print_chunk_t *chunks = NULL;
+    size_t nchunks = 0, i;
+    sexp_errcode_t err;
+    CSTRING *single = NULL;
+#ifndef WIN32
+    struct iovec *iov;
+    size_t niov, cur;
+    ssize_t n;
+#endif
+
+    if (sx == NULL)
+      return SEXP_ERR_BAD_PARAM;
+
+    if (nthreads < 2 || sx->ty != SEXP_LIST ||
+        sx->list == NULL || sx->list->next == NULL)
+      {
+        if (print_sexp_cstr(&single, sx, BUFSIZ) < 0 || single == NULL)
+          return (sexp_errno != SEXP_ERR_OK) ? sexp_errno : SEXP_ERR_MEMORY;
+      }
+    else
+      {
+        err = _print_sexp_chunks(sx, nthreads, &chunks, &nchunks, BUFSIZ);
+        if (err != SEXP_ERR_OK) {
+          sexp_errno = err;
+          return err;
+        }
+      }
+
+    err = SEXP_ERR_OK;
+
+#ifndef WIN32
+    niov = (single != NULL) ? 1 : nchunks+2;
+#ifdef __cplusplus
+    iov = (struct iovec *)sexp_malloc(sizeof(struct iovec)*niov);
+#else
+    iov = sexp_malloc(sizeof(struct iovec)*niov);
+#endif
+
+    if (iov == NULL) {
+      err = SEXP_ERR_MEMORY;
+    } else {
+      if (single != NULL) {
+        iov[0].iov_base = single->base;
+        iov[0].iov_len = single->curlen;
+      } else {
+        iov[0].iov_base = "(";
+        iov[0].iov_len = 1;
+        for (i = 0; i < nchunks; i++) {
+          iov[i+1].iov_base = chunks[i].out->base;
+          iov[i+1].iov_len = chunks[i].out->curlen;
+        }
+        iov[niov-1].iov_base = ")";
+        iov[niov-1].iov_len = 1;
+      }
+
+      cur = 0;
+      while (cur < niov) {
+        n = writev(fd, iov+cur,
+                   (int)((niov-cur > IOV_MAX) ? IOV_MAX : niov-cur));
+
+        if (n < 0) {
+          if (errno == EINTR)
+            continue;
+          err = SEXP_ERR_IO;
+          break;
+        }
+
+        /* skip over whatever the kernel took, including partial vectors */
+        while (cur < niov && (size_t)n >= iov[cur].iov_len) {
+          n -= iov[cur].iov_len;
+          cur++;
+        }
+        if (cur < niov) {
+          iov[cur].iov_base = (char *)iov[cur].iov_base + n;
+          iov[cur].iov_len -= n;
+        }
+      }
+
+      sexp_free(iov, sizeof(struct iovec)*niov);
+    }
+#else
+    if (single != NULL) {
+      if (_write_all(fd, single->base, single->curlen) != 0)
+        err = SEXP_ERR_IO;
+    } else {
+      if (_write_all(fd, "(", 1) != 0)
+        err = SEXP_ERR_IO;
+      for (i = 0; i < nchunks && err == SEXP_ERR_OK; i++)
+        if (_write_all(fd, chunks[i].out->base, chunks[i].out->curlen) != 0)
+          err = SEXP_ERR_IO;
+      if (err == SEXP_ERR_OK && _write_all(fd, ")", 1) != 0)
+        err = SEXP_ERR_IO;
+    }
+#endif
+
+    if (single != NULL)
+      sdestroy(single);
+
+    for (i = 0; i < nchunks; i++)
+      sdestroy(chunks[i].out);
+    if (chunks != NULL)
+      sexp_free(chunks, sizeof(print_chunk_t)*nchunks);
+
+    if (err != SEXP_ERR_OK)
+      sexp_errno = err;
+
+    return err;
   }
 
   /**
@@ -551,3 +1419,216 @@ print_sexp (char *buf, size_t size, const sexp_t * sx)
 
     return sx;
   }
+
+  /**
+   * allocate a basic atom for a number, with no text.
+   */
+  static sexp_t *_new_sexp_number(unsigned int flag) {
+    sexp_t *sx = sexp_t_allocate();
+
+    if (sx == NULL) {
+      sexp_errno = SEXP_ERR_MEMORY;
+      return NULL;
+    }
+
+    sx->ty = SEXP_VALUE;
+    sx->aty = SEXP_BASIC;
+    sx->list = sx->next = NULL;
+    sx->val = NULL;
+    sx->val_used = sx->val_allocated = 0;
+    sx->bindata = NULL;
+    sx->binlength = 0;
+    sx->flags = flag;
+
+    return sx;
+  }
+
+  sexp_t *new_sexp_int64(sexp_int64_t v) {
+    sexp_t *sx = _new_sexp_number(SEXP_FLAG_INT64);
+
+    if (sx != NULL)
+      sexp_set_int64(sx, v);
+
+    return sx;
+  }
+
+  sexp_t *new_sexp_double(double v) {
+    sexp_t *sx = _new_sexp_number(SEXP_FLAG_DOUBLE);
+
+    if (sx != NULL)
+      sexp_set_double(sx, v);
+
+    return sx;
+  }
+
+  /*
+   * the 64 bits of a number are kept in two fields a numeric atom has no
+   * other use for, 32 bits in each so that they fit where size_t is that
+   * small: the low half in binlength and the high half in val_allocated.
+   */
+  static void _set_number_bits(sexp_t *sx, sexp_uint64_t bits) {
+    sx->binlength = (size_t) (bits & 0xffffffffUL);
+    sx->val_allocated = (size_t) (bits >> 32);
+  }
+
+  static sexp_uint64_t _number_bits(const sexp_t *sx) {
+    return ((sexp_uint64_t) sx->val_allocated << 32) |
+      (sexp_uint64_t) sx->binlength;
+  }
+
+  void sexp_set_int64(sexp_t *sx, sexp_int64_t v) {
+    _set_number_bits(sx, (sexp_uint64_t) v);
+    sx->flags = (sx->flags & ~SEXP_FLAG_DOUBLE) | SEXP_FLAG_INT64;
+  }
+
+  void sexp_set_double(sexp_t *sx, double v) {
+    sexp_uint64_t bits;
+
+    memcpy(&bits, &v, sizeof(bits));
+    _set_number_bits(sx, bits);
+    sx->flags = (sx->flags & ~SEXP_FLAG_INT64) | SEXP_FLAG_DOUBLE;
+  }
+
+  sexp_int64_t sexp_int64_value(const sexp_t *sx) {
+    return (sexp_int64_t) _number_bits(sx);
+  }
+
+  double sexp_double_value(const sexp_t *sx) {
+    sexp_uint64_t bits = _number_bits(sx);
+    double v;
+
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+  }
+
+  /* "00" to "99", for writing integers two digits at a time. */
+  static const char digit_pairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233"
+    "34353637383940414243444546474849505152535455565758596061626364656667"
+    "6869707172737475767778798081828384858687888990919293949596979899";
+
+  size_t sexp_format_int64(char *buf, sexp_int64_t v) {
+    char tmp[SEXP_NUMBER_MAX];
+    char *t = tmp + sizeof(tmp);
+    unsigned long long u;
+    size_t n, d;
+
+    /* negate in unsigned arithmetic so the most negative value works. */
+    u = (v < 0) ? 0ULL - (unsigned long long) v : (unsigned long long) v;
+
+    while (u >= 100) {
+      d = (size_t) (u % 100) * 2;
+      u /= 100;
+      *--t = digit_pairs[d + 1];
+      *--t = digit_pairs[d];
+    }
+    if (u >= 10) {
+      d = (size_t) u * 2;
+      *--t = digit_pairs[d + 1];
+      *--t = digit_pairs[d];
+    } else {
+      *--t = (char) ('0' + u);
+    }
+    if (v < 0)
+      *--t = '-';
+
+    n = (size_t) (tmp + sizeof(tmp) - t);
+    memcpy(buf, t, n);
+    buf[n] = '\0';
+
+    return n;
+  }
+
+  size_t sexp_format_double(char *buf, double v) {
+    char digits[24];
+    char *t = buf;
+    int len, K, x, p, i;
+
+    /* whole numbers that print the same as integers, without printf.
+       Zero goes the slow way to keep its sign. */
+    if (v != 0 && v > -1e15 && v < 1e15 && v == (double) (sexp_int64_t) v)
+      return sexp_format_int64(buf, (sexp_int64_t) v);
+
+    /* zero, infinities and NaN are left to printf. */
+    if (v == 0 || v - v != 0)
+      return (size_t) sprintf(buf, "%g", v);
+
+    if (v < 0) {
+      *t++ = '-';
+      v = -v;
+    }
+    len = grisu2(v, digits, &K);
+    while (len > 1 && digits[len - 1] == '0') {
+      len--;
+      K++;
+    }
+
+    /* laid out as %g would with as many significant digits as the value
+       needs, and never fewer than 15; x is the exponent of the first. */
+    x = len + K - 1;
+    p = (len > 15) ? len : 15;
+    if (x >= -4 && x < p) {
+      if (x < 0) {
+        *t++ = '0';
+        *t++ = '.';
+        for (i = -1; i > x; i--)
+          *t++ = '0';
+        memcpy(t, digits, len);
+        t += len;
+      } else if (x + 1 >= len) {
+        memcpy(t, digits, len);
+        t += len;
+        for (i = len; i <= x; i++)
+          *t++ = '0';
+      } else {
+        memcpy(t, digits, x + 1);
+        t += x + 1;
+        *t++ = '.';
+        memcpy(t, digits + x + 1, len - x - 1);
+        t += len - x - 1;
+      }
+    } else {
+      *t++ = digits[0];
+      if (len > 1) {
+        *t++ = '.';
+        memcpy(t, digits + 1, len - 1);
+        t += len - 1;
+      }
+      *t++ = 'e';
+      if (x < 0) {
+        *t++ = '-';
+        x = -x;
+      } else {
+        *t++ = '+';
+      }
+      if (x >= 100)
+        *t++ = (char) ('0' + x / 100);
+      *t++ = (char) ('0' + x / 10 % 10);
+      *t++ = (char) ('0' + x % 10);
+    }
+    *t = '\0';
+
+    return (size_t) (t - buf);
+  }
+
+  const char *sexp_atom_text(const sexp_t *sx, char *buf, size_t *len) {
+    size_t n;
+
+    if (sx == NULL || sx->ty != SEXP_VALUE || sx->aty == SEXP_BINARY)
+      return NULL;
+
+    if (sx->val == NULL &&
+        (sx->flags & (SEXP_FLAG_INT64 | SEXP_FLAG_DOUBLE))) {
+      n = (sx->flags & SEXP_FLAG_INT64) ?
+        sexp_format_int64(buf, sexp_int64_value(sx)) :
+        sexp_format_double(buf, sexp_double_value(sx));
+      if (len != NULL)
+        *len = n;
+      return buf;
+    }
+
+    if (len != NULL)
+      *len = (sx->val != NULL && sx->val_used > 0) ? sx->val_used - 1 : 0;
+
+    return sx->val;
+  }
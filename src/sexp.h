@@ -39,9 +39,20 @@
 
 #include <stddef.h>
 #include <stdio.h> /* for BUFSIZ only */
+#ifndef WIN32
+# include <sys/uio.h>
+#else
+/* the segments cparse_sexpv takes, laid out as POSIX has them */
+struct iovec {
+  void *iov_base;
+  size_t iov_len;
+};
+#endif
 #include "faststack.h"
 #include "cstring.h"
 #include "sexp_memory.h"
+#include "sexp_arena.h"
+#include "sexp_intern.h"
 #include "sexp_errors.h"
 
 /* doxygen documentation groups defined here */
@@ -192,10 +203,108 @@ typedef enum {
   SEXP_BINARY
 } atom_t;
 
+/**
+ * Flag bit set on elements that live in a sexp_arena_t, as placed there by
+ * copy_sexp_into or share_sexp_into.  destroy_sexp leaves such elements
+ * (and anything hanging off them) alone; they are freed with the arena.
+ */
+#define SEXP_FLAG_ARENA       0x1
+
+/**
+ * Flag bit set on atoms whose val buffer is reference counted and may be
+ * shared with other elements.  The buffer must not be modified in place.
+ */
+#define SEXP_FLAG_SHARED_VAL  0x2
+
+/**
+ * Flag bit set on elements of persistent (immutable, reference counted)
+ * expressions; see sexp_freeze.  Such elements may be shared between
+ * several expressions and must not be modified.  destroy_sexp drops a
+ * reference and only frees elements whose count reaches zero.
+ */
+#define SEXP_FLAG_PERSISTENT  0x4
+
+/**
+ * Flag bit set on atoms whose val is the copy held by an intern table (see
+ * sexp_intern.h).  Interned atoms are shared atoms as well, so
+ * SEXP_FLAG_SHARED_VAL is always set with this one.
+ */
+#define SEXP_FLAG_INTERNED    0x8
+
+/**
+ * Flag bit set on lists whose val_allocated holds their structural hash,
+ * as stored by sexp_hash_cache.  Atoms are not flagged: their hash is
+ * worked out again when it is needed.
+ */
+#define SEXP_FLAG_HASHED      0x10
+
+/**
+ * Flag bit set on lists whose elements have not been parsed yet (see
+ * sexp_lazy.h).  Their val and val_used hold their source text, and their
+ * bindata and val_allocated belong to sexp_lazy.c.
+ */
+#define SEXP_FLAG_LAZY        0x20
+
+/**
+ * Flag bit set on elements whose source range (see sexp_source_range)
+ * gives the text they were parsed from, as recorded by a continuation
+ * with track_source set.  Clear it on an element that is changed, and on
+ * every list that contains it, so sexp_emit_raw prints it instead of
+ * copying stale text.
+ */
+#define SEXP_FLAG_SOURCE      0x40
+
+/**
+ * Flag bit set on lists with an index of their elements (see sexp_index).
+ * Their bindata and binlength belong to the index.
+ */
+#define SEXP_FLAG_INDEXED     0x80
+
+/**
+ * Flag bits set on basic atoms made by new_sexp_int64 and new_sexp_double.
+ * Their val is NULL, and the 64 bits of their value are kept in
+ * val_allocated and binlength, to be read with sexp_int64_value or
+ * sexp_double_value: print_sexp and print_sexp_cstr format the number as
+ * they print it, and sexp_atom_text gives the text to everyone else.
+ */
+#define SEXP_FLAG_INT64       0x100
+#define SEXP_FLAG_DOUBLE      0x200
+
+/**
+ * Flag bit set on elements that have an entry in the table of source
+ * ranges, whether or not SEXP_FLAG_SOURCE is still set.  The entry is
+ * dropped when the element is freed; leave this bit alone.
+ */
+#define SEXP_FLAG_RANGE       0x400
+
+/**
+ * Size of a buffer that can hold the text of any numeric atom, with its
+ * terminating nul.
+ */
+#define SEXP_NUMBER_MAX       32
+
 /*============*/
 /* STRUCTURES */
 /*============*/
 
+/**
+ * 64 bit integer type of numeric atoms.
+ */
+#ifdef _MSC_VER
+typedef __int64 sexp_int64_t;
+#else
+typedef long long sexp_int64_t;
+#endif
+
+/**
+ * Unsigned counterpart of sexp_int64_t, for the bits of numeric atoms.
+ */
+#ifdef _MSC_VER
+typedef unsigned __int64 sexp_uint64_t;
+#else
+typedef unsigned long long sexp_uint64_t;
+#endif
+
 /**
  * An s-expression is represented as a linked structure of elements,
  * where each element is either an <I>atom</I> or <I>list</I>.  An
@@ -251,7 +360,9 @@ typedef struct elt {
   size_t   val_allocated;
 
   /**
-   * Number of bytes used in val (<= val_allocated).
+   * Number of bytes used in val (<= val_allocated).  Lists have no val,
+   * and count their generation here instead: every edit made inside a
+   * list through a cursor (see sexp_cursor.h) adds one to it.
    */
   size_t   val_used;
 
@@ -294,6 +405,20 @@ typedef struct elt {
    * The length of the data pointed at by bindata in bytes.
    */
   size_t binlength;
+
+  /**
+   * Bitwise or of the SEXP_FLAG_* values describing who owns the memory of
+   * this element and what else is known about it.  Zero for elements
+   * created by the constructors other than the numeric ones, and by the
+   * parser unless it tracks source ranges.
+   */
+  unsigned int flags;
+
+  /**
+   * Number of references to a persistent element: from list or next
+   * fields of other elements, and from the user.  Unused otherwise.
+   */
+  unsigned int refcount;
 } sexp_t;
 
 /**
@@ -365,6 +490,60 @@ typedef struct parser_event_handlers {
   void (* binary)(const char *data, size_t len);
 } parser_event_handlers_t;
 
+/**
+ * Event callbacks for code that keeps state between events, such as the
+ * streaming path queries of sexp_query.h.  These are called by the
+ * events-only parser (PARSER_EVENTS_ONLY) in addition to any
+ * parser_event_handlers_t, with the data pointer stored here.  Atom text
+ * is passed without a terminating nul in the length.  Any of the function
+ * pointers may be NULL.
+ */
+typedef struct sexp_event_sink {
+  void (* start_sexpr)(void *data);
+  void (* end_sexpr)(void *data);
+  void (* characters)(void *data, const char *val, size_t len, atom_t aty);
+  void (* binary)(void *data, const char *bin, size_t len);
+  void *data;
+} sexp_event_sink_t;
+
+/**
+ * What sexp_validate found in its input.  The counts are also kept up to
+ * date by a continuation in PARSER_EVENTS_ONLY mode that has neither
+ * event handlers nor an event sink, if it points at one of these (see
+ * validate_info in pcont_t); they are never reset by the parser.
+ */
+typedef struct sexp_validate_info {
+  /**
+   * Set by the caller of sexp_validate: PARSER_INLINE_BINARY to check the
+   * framing of \#b\#size\#data atoms as that mode reads them; any other
+   * mode reads the input as PARSER_NORMAL does.
+   */
+  parsermode_t mode;
+
+  /**
+   * Complete top level expressions.
+   */
+  size_t exprs;
+
+  /**
+   * Atoms, binary ones included.
+   */
+  size_t atoms;
+
+  /**
+   * Deepest nesting of lists.
+   */
+  unsigned int max_depth;
+
+  /**
+   * Set by sexp_validate to the offset of the close paren that was never
+   * opened, or of the character in a binary size that is not a digit,
+   * for SEXP_ERR_BADFORM, to the offset of the nul byte for
+   * SEXP_ERR_BADCONTENT, and to the length of the input otherwise.
+   */
+  size_t offset;
+} sexp_validate_info_t;
+
 /**
  * A continuation is used by the parser to save and restore state between
  * invocations to support partial parsing of strings.  For example, if we
@@ -526,6 +705,161 @@ typedef struct pcont {
    * responsibility.
    */
   parser_event_handlers_t *event_handlers;
+
+  /**
+   * Intern table that basic atoms are looked up in, or NULL (the default)
+   * to give every atom a buffer of its own.  The continuation does not
+   * own the table; several continuations may share one.
+   */
+  sexp_intern_t *intern;
+
+  /**
+   * Hash-consing table that every complete expression is hash-consed
+   * against before it is returned (see sexp_hashcons_with), or NULL (the
+   * default) to return ordinary trees.  The continuation does not own the
+   * table; several continuations may share one.  Elements no expression
+   * uses any more are dropped from the table when it fills up, so it can
+   * stay attached to a long-running stream.
+   */
+  struct sexp_hashcons *hashcons;
+
+  /**
+   * Event sink called by the events-only parser, or NULL (the default).
+   * Like event_handlers, it belongs to the user.
+   */
+  sexp_event_sink_t *event_sink;
+
+  /**
+   * Projection that decides which lists are built (see sexp_project.h),
+   * or NULL (the default) to build everything.  The continuation does not
+   * own the projection; several continuations may share one.
+   */
+  struct sexp_projection *projection;
+
+  /**
+   * Nonzero to record where in the input each element was parsed from
+   * (see SEXP_FLAG_SOURCE); zero by default.  Offsets count from the first
+   * byte the continuation was given, across all the buffers it is fed.
+   * With hash-consing, an element shared by equal expressions has the
+   * range of the first one.  The ranges are kept in a table beside the
+   * elements, so an element that is not tracked has no room for one.
+   */
+  unsigned int track_source;
+
+  /**
+   * Lists with at least this many elements are indexed (see sexp_index)
+   * as the parser closes them; zero, the default, indexes none.  Indexes
+   * do not survive hash-consing.
+   */
+  size_t index_lists;
+
+  /**
+   * Input offset of the start of the current buffer, used when tracking
+   * source ranges.
+   */
+  size_t src_base;
+
+  /**
+   * Input offset of the start of the atom being parsed, used when
+   * tracking source ranges.
+   */
+  size_t src_atom;
+
+  /**
+   * Counts kept by the validating parser, or NULL (the default); see
+   * sexp_validate_info_t.  Like event_handlers, it belongs to the user.
+   */
+  sexp_validate_info_t *validate_info;
+
+  /* -----------------------------------------------------------------
+   * Limits on what the parser takes in, for input that cannot be
+   * trusted.  Zero, the default, means no limit.  A parse that goes
+   * past a limit stops with the error code that limit names; the
+   * expression it was in is left on the stack and is freed with the
+   * continuation.
+   * ----------------------------------------------------------------- */
+
+  /**
+   * Deepest nesting of lists (SEXP_ERR_LIMIT_DEPTH).
+   */
+  unsigned int max_depth;
+
+  /**
+   * Longest atom, in bytes of text or binary data (SEXP_ERR_LIMIT_ATOM).
+   * A binary atom is refused on its size, before its data is allocated.
+   */
+  size_t max_atom_bytes;
+
+  /**
+   * Most elements, lists and atoms, in one top level expression
+   * (SEXP_ERR_LIMIT_NODES).
+   */
+  size_t max_nodes;
+
+  /**
+   * Most bytes of text and binary data held by the atoms of one top
+   * level expression (SEXP_ERR_LIMIT_BYTES).
+   */
+  size_t max_bytes;
+
+  /**
+   * Elements of the expression being parsed so far, counted against
+   * max_nodes.
+   */
+  size_t nodes;
+
+  /**
+   * Bytes held by the atoms of the expression being parsed so far,
+   * counted against max_bytes.
+   */
+  size_t bytes;
+
+  /**
+   * Nonzero to recover from errors in the input instead of stopping at
+   * them; zero by default.  After a close paren that was never opened
+   * (SEXP_ERR_BADFORM), the parser passes over the paren.  After an
+   * expression goes past a limit, or has a binary size that is not all
+   * digits (SEXP_ERR_BADFORM as well), it drops the expression, freeing what
+   * was built of it, skips the rest of it and parses what follows.
+   * Event handlers and the event sink have seen the start of a dropped
+   * expression; they are given an end_sexpr for each list of it that is
+   * still open before the parser goes on, so what they see stays
+   * balanced.
+   */
+  unsigned int recover;
+
+  /**
+   * Bytes of input passed over to recover from errors, counted from
+   * where each error was found.  The parser adds to this and never
+   * resets it.
+   */
+  size_t skipped;
+
+  /**
+   * Nonzero while the parser skips to recover from an error.
+   */
+  unsigned int resync;
+
+  /**
+   * Input offset where the skip to recover from an error started.
+   */
+  size_t resync_start;
+
+  /**
+   * Most bytes of input one call to the parser looks at, zero (the
+   * default) for no limit.  A call that reaches it with input left
+   * stops with SEXP_ERR_INCOMPLETE and lastPos set to where it got to,
+   * so that a caller taking turns between inputs can call again with
+   * the same buffer when its turn comes around.  The expression being
+   * parsed is kept in the continuation meanwhile.
+   */
+  size_t work_budget;
+
+  /**
+   * The segment of the input that sbuffer and lastPos are in, when it
+   * was given to cparse_sexpv as several.
+   */
+  unsigned int seg;
 } pcont_t;
 
 /**
@@ -648,6 +982,30 @@ extern "C" {
    */
   int print_sexp(char *loc, size_t size, const sexp_t *e);
 
+  /**
+   * print a sexp_t struct like print_sexp, but copy the text of each
+   * element that still has its source range (SEXP_FLAG_SOURCE) out of
+   * \a src, the \a srclen bytes of input the element was parsed from,
+   * instead of printing it.  A parsed expression of which a few elements
+   * were changed is mostly copied with memcpy, comments and layout
+   * included.  Returns -1 with sexp_errno set to SEXP_ERR_BAD_PARAM if a
+   * source range lies outside src, and as print_sexp otherwise.
+   */
+  int sexp_emit_raw(char *loc, size_t size, const sexp_t *e,
+                    const char *src, size_t srclen);
+
+  /**
+   * The source range of \a sx: the offset of the first byte of its text
+   * from the start of everything its continuation has parsed in
+   * \a *offset, and the length of the text, from the open paren to the
+   * close paren of a list and including the quotes of an atom, in
+   * \a *length.  Either pointer may be NULL.  Returns 0, or -1 if
+   * SEXP_FLAG_SOURCE is not set on sx or its range is not known (it
+   * could not be recorded for want of memory, or sexp_cleanup has been
+   * called since).
+   */
+  int sexp_source_range(const sexp_t *sx, size_t *offset, size_t *length);
+
   /**
    * print a sexp_t structure to a buffer, growing it as necessary instead
    * of relying on fixed size buffers like print_sexp.  Important argument
@@ -659,6 +1017,35 @@ extern "C" {
    */
   int print_sexp_cstr(CSTRING **s, const sexp_t *e, size_t ss);
 
+  /**
+   * print a sexp_t structure to a CSTRING like print_sexp_cstr, but split
+   * the children of a top level list into chunks and print them with up
+   * to <tt>nthreads</tt> threads.  Each thread prints into its own buffer
+   * using the same printer as print_sexp_cstr, and the buffers are joined
+   * with a single memcpy each.  The output is byte for byte identical to
+   * that of print_sexp_cstr.  Atoms, lists with fewer than two children,
+   * a thread count below two, and libraries built without thread support
+   * (see --disable-threads) all fall back to the serial printer.  Since
+   * expressions this large may exceed what an int can count, the length
+   * is left in <tt>(*s)->curlen</tt> and the return value is an error
+   * code.  The parallel path never touches the sexp_t cache, so it is
+   * safe with either memory management setting.
+   */
+  sexp_errcode_t print_sexp_parallel(CSTRING **s, const sexp_t *e, size_t ss,
+                                     unsigned int nthreads);
+
+  /**
+   * \ingroup IO
+   * print a sexp_t structure to a file descriptor, printing the children
+   * of a top level list with up to <tt>nthreads</tt> threads as in
+   * print_sexp_parallel.  The per-thread buffers are handed to writev()
+   * directly instead of being gathered into one buffer first, which keeps
+   * peak memory at roughly one copy of the printed expression.  Returns
+   * SEXP_ERR_IO if the write fails.
+   */
+  sexp_errcode_t write_sexp_parallel(int fd, const sexp_t *e,
+                                     unsigned int nthreads);
+
   /**
    * Allocate a new sexp_t element representing a list.
    */
@@ -686,6 +1073,64 @@ extern "C" {
    */
   sexp_t *new_sexp_atom(const char *buf, size_t bs, atom_t aty);
 
+  /**
+   * Allocate a basic atom holding the integer \a v.  The number is kept
+   * as it is, and only turned into text when the atom is printed or its
+   * text is asked for with sexp_atom_text, so its val is NULL.
+   */
+  sexp_t *new_sexp_int64(sexp_int64_t v);
+
+  /**
+   * Allocate a basic atom holding \a v, kept as new_sexp_int64 keeps
+   * integers.  It is printed with as few digits as read back as the same
+   * double.
+   */
+  sexp_t *new_sexp_double(double v);
+
+  /**
+   * The integer held by \a sx, an atom with SEXP_FLAG_INT64 set.
+   */
+  sexp_int64_t sexp_int64_value(const sexp_t *sx);
+
+  /**
+   * The double held by \a sx, an atom with SEXP_FLAG_DOUBLE set.
+   */
+  double sexp_double_value(const sexp_t *sx);
+
+  /**
+   * Make \a sx, a basic atom with a NULL val, hold the integer \a v,
+   * setting SEXP_FLAG_INT64 and clearing SEXP_FLAG_DOUBLE.
+   */
+  void sexp_set_int64(sexp_t *sx, sexp_int64_t v);
+
+  /**
+   * Make \a sx, a basic atom with a NULL val, hold \a v, setting
+   * SEXP_FLAG_DOUBLE and clearing SEXP_FLAG_INT64.
+   */
+  void sexp_set_double(sexp_t *sx, double v);
+
+  /**
+   * The text of the atom \a sx, and its length in \a *len if len is not
+   * NULL.  That is val, except for numeric atoms that have none, whose
+   * text is written to \a buf, which must hold SEXP_NUMBER_MAX bytes.
+   * Returns NULL for lists and binary atoms.
+   */
+  const char *sexp_atom_text(const sexp_t *sx, char *buf, size_t *len);
+
+  /**
+   * Write \a v in decimal to \a buf, which must hold SEXP_NUMBER_MAX
+   * bytes, with a terminating nul.  Returns the length of the text.
+   */
+  size_t sexp_format_int64(char *buf, sexp_int64_t v);
+
+  /**
+   * Write \a v to \a buf like sexp_format_int64, laid out as printf's %g
+   * would, with digits that read back as the same double.  There are as
+   * few of them as can be for all but a few values in ten thousand, which
+   * get one more.
+   */
+  size_t sexp_format_double(char *buf, double v);
+
   /**
    * create an initial continuation for parsing the given string
    */
@@ -702,6 +1147,8 @@ extern "C" {
    * create an IO wrapper structure around a file descriptor.  A NULL return
    * value indicates some problem occurred allocating the wrapper, so the
    * user should check the value of sexp_errno for further information.
+   * The wrapper's continuation, cc, is ready to have its limits and
+   * recovery set before the first read.
    */
   sexp_iowrap_t *init_iowrap(int fd);
 
@@ -747,8 +1194,41 @@ extern "C" {
   pcont_t *cparse_sexp(char *s, size_t len, pcont_t *pc);
 
   /**
-   * given a sexp_t structure, free the memory it uses (and recursively free
-   * the memory used by all sexp_t structures that it references).  Note
+   * \ingroup parser
+   * cparse_sexp over input in iovcnt segments, such as a chain of
+   * network buffers, without copying them into one.  An atom or an
+   * expression may be split between segments anywhere.  When the
+   * continuation has lastPos set, call again with the same segments to
+   * carry on; when lastPos is NULL, they have all been parsed and the
+   * next call takes new input.  The segments are only read.
+   */
+  pcont_t *cparse_sexpv(const struct iovec *iov, int iovcnt, pcont_t *pc);
+
+  /**
+   * \ingroup parser
+   * Check that the first len bytes of buf hold well formed expressions,
+   * as the parser would read them, without building or allocating
+   * anything: parens are balanced, strings and quoted lists end, and
+   * in PARSER_INLINE_BINARY mode (set in info->mode) binary atoms hold
+   * the bytes they promise.  The parser stops at a nul byte outside
+   * binary data, so one is refused: nothing after it would be read.
+   * Returns SEXP_ERR_OK, SEXP_ERR_BADFORM for a close paren that was
+   * never opened or a binary size that is not all decimal digits (a sign
+   * is refused, as the parser refuses it), SEXP_ERR_BADCONTENT for a nul byte outside binary
+   * data, or SEXP_ERR_INCOMPLETE if the input ends inside an
+   * expression.  The counts in info, which may
+   * be NULL, are filled in for what was checked.  Like the parser, this
+   * treats an atom at the very end of the input as unfinished, since
+   * more of it may follow.
+   */
+  sexp_errcode_t sexp_validate(const char *buf, size_t len,
+                               sexp_validate_info_t *info);
+
+  /**
+   * given a sexp_t structure, free the memory it uses (and free the memory
+   * used by all sexp_t structures that it references).  This does not
+   * recurse, so arbitrarily long or deep expressions can be destroyed on
+   * threads with small stacks.  Note
    * that this will call the deallocation routine for sexp_t elements.
    * This means that memory isn't freed, but stored away in a cache of
    * pre-allocated elements.  This is an optimization to speed up the
@@ -756,9 +1236,37 @@ extern "C" {
    * inlined binary mode, this will free the data pointed to by the bindata
    * field.  So, if you care about the data after the lifetime of the
    * s-expression, make sure to make a copy before cleaning up the sexpr.
+   * Elements that live in an arena are left to the arena.  For persistent
+   * expressions (see sexp_freeze) this drops one reference to s, and
+   * only elements that are no longer referenced are freed.
    */
   void destroy_sexp(sexp_t *s);
 
+  /**
+   * destroy a sexp_t structure on a background thread.  The expression is
+   * queued for a reclaimer thread, started on first use, and the call
+   * returns immediately, so latency sensitive threads don't pay for
+   * freeing large expressions.  The caller must not touch s afterwards.
+   * Background reclamation needs a thread safe allocator, so it is only
+   * available when the library is built with thread support and without
+   * thread-unsafe memory management or memory limiting; otherwise this
+   * simply calls destroy_sexp.
+   */
+  void destroy_sexp_async(sexp_t *s);
+
+  /**
+   * block until every expression passed to destroy_sexp_async so far has
+   * been freed.  Returns immediately if there is no reclaimer thread.
+   */
+  void sexp_reclaimer_drain(void);
+
+  /**
+   * drain the reclaimer queue and stop the reclaimer thread.  This is
+   * called by sexp_cleanup.  A later destroy_sexp_async starts a new
+   * reclaimer thread.
+   */
+  void sexp_reclaimer_shutdown(void);
+
   /**
    * reset the value of sexp_errno to SEXP_ERR_OK.
    */
@@ -780,5 +1288,11 @@ extern "C" {
 #endif
 
 #include "sexp_ops.h"
+#include "sexp_persist.h"
+#include "sexp_project.h"
+#include "sexp_lazy.h"
+#include "sexp_alist.h"
+#include "sexp_cursor.h"
+#include "sexp_builder.h"
 
 #endif /* __SEXP_H__ */
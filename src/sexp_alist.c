@@ -0,0 +1,232 @@
+/**
+   @cond IGNORE
+
+   ======================================================
+   SFSEXP: Small, Fast S-Expression Library
+   Written by Matthew Sottile (mjsottile@gmail.com)
+   ======================================================
+
+   Copyright (2003-2006). The Regents of the University of California. This
+   material was produced under U.S. Government contract W-7405-ENG-36 for Los
+   Alamos National Laboratory, which is operated by the University of
+   California for the U.S. Department of Energy. The U.S. Government has rights
+   to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+   THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+   LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+   derivative works, such modified software should be clearly marked, so as not
+   to confuse it with the version available from LANL.
+
+   Additionally, this library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of the
+   License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+   LA-CC-04-094
+
+   @endcond
+**/
+#include <stdlib.h>
+#include <string.h>
+#include "sexp.h"
+#include "sexp_intern.h"
+
+/*
+ * open addressing with linear probing, like the intern tables.  Keys
+ * point at the val of the head atom of their entry.
+ */
+typedef struct alist_ent {
+  const char *key;
+  size_t len;
+  size_t hash;
+  sexp_t *entry;
+} alist_ent_t;
+
+struct sexp_alist {
+  sexp_t *list;
+  alist_ent_t *slots;
+  size_t cap;    /* power of two */
+  size_t gen;    /* generation of the list the table was built at */
+  unsigned int stale;
+};
+
+/**
+ * The key of the element sx, or NULL if it is not an entry.
+ */
+static sexp_t *
+_key (sexp_t * sx)
+{
+  sexp_t *hd;
+
+  if (sx->ty != SEXP_LIST)
+    return NULL;
+
+  hd = sexp_lazy_list(sx);
+  if (hd == NULL || hd->ty != SEXP_VALUE || hd->aty == SEXP_BINARY ||
+      hd->val == NULL)
+    return NULL;
+
+  return hd;
+}
+
+/**
+ * (Re)build the table of idx from its list.
+ */
+static int
+_build (sexp_alist_t * idx)
+{
+  alist_ent_t *slots;
+  sexp_t *t, *k;
+  size_t n = 0, cap = 16;
+  size_t h, i, len;
+  sexp_errcode_t olderr = sexp_errno;
+
+  sexp_errno = SEXP_ERR_OK;
+  t = sexp_lazy_list(idx->list);
+  if (sexp_errno != SEXP_ERR_OK)
+    return -1;
+
+  for (; t != NULL; t = t->next)
+    n++;
+
+  /* keep the load factor under 3/4. */
+  while (cap/4*3 < n)
+    cap *= 2;
+
+#ifdef __cplusplus
+  slots = (alist_ent_t *)sexp_calloc(cap, sizeof(alist_ent_t));
+#else
+  slots = sexp_calloc(cap, sizeof(alist_ent_t));
+#endif
+  if (slots == NULL) {
+    sexp_errno = SEXP_ERR_MEMORY;
+    return -1;
+  }
+
+  for (t = idx->list->list; t != NULL; t = t->next) {
+    k = _key(t);
+    if (k == NULL) {
+      if (sexp_errno != SEXP_ERR_OK) {
+        sexp_free(slots, cap * sizeof(alist_ent_t));
+        return -1;
+      }
+      continue;
+    }
+
+    len = k->val_used - 1;
+    if (k->flags & SEXP_FLAG_INTERNED)
+      h = sexp_interned_hash(k);
+    else
+      h = sexp_hash_bytes(k->val, len);
+
+    /* the first entry with a key wins. */
+    for (i = h & (cap - 1); slots[i].key != NULL; i = (i + 1) & (cap - 1))
+      if (slots[i].hash == h && slots[i].len == len &&
+          memcmp(slots[i].key, k->val, len) == 0)
+        break;
+    if (slots[i].key != NULL)
+      continue;
+
+    slots[i].key = k->val;
+    slots[i].len = len;
+    slots[i].hash = h;
+    slots[i].entry = t;
+  }
+
+  if (idx->slots != NULL)
+    sexp_free(idx->slots, idx->cap * sizeof(alist_ent_t));
+  idx->slots = slots;
+  idx->cap = cap;
+  idx->gen = idx->list->val_used;
+  idx->stale = 0;
+
+  sexp_errno = olderr;
+
+  return 0;
+}
+
+sexp_alist_t *
+sexp_alist_index (sexp_t * sx)
+{
+  sexp_alist_t *idx;
+
+  if (sx == NULL || sx->ty != SEXP_LIST) {
+    sexp_errno = SEXP_ERR_BAD_PARAM;
+    return NULL;
+  }
+
+#ifdef __cplusplus
+  idx = (sexp_alist_t *)sexp_malloc(sizeof(sexp_alist_t));
+#else
+  idx = sexp_malloc(sizeof(sexp_alist_t));
+#endif
+  if (idx == NULL) {
+    sexp_errno = SEXP_ERR_MEMORY;
+    return NULL;
+  }
+
+  idx->list = sx;
+  idx->slots = NULL;
+  idx->cap = 0;
+  idx->stale = 1;
+
+  if (_build(idx) != 0) {
+    sexp_free(idx, sizeof(sexp_alist_t));
+    return NULL;
+  }
+
+  return idx;
+}
+
+sexp_t *
+sexp_alist_get (sexp_alist_t * idx, const char *key)
+{
+  size_t h, i, len;
+  alist_ent_t *e;
+
+  if (idx == NULL || key == NULL) {
+    sexp_errno = SEXP_ERR_BAD_PARAM;
+    return NULL;
+  }
+
+  /* edits through a cursor move the generation of the list on */
+  if ((idx->stale || idx->gen != idx->list->val_used) && _build(idx) != 0)
+    return NULL;
+
+  len = strlen(key);
+  h = sexp_hash_bytes(key, len);
+
+  for (i = h & (idx->cap - 1); idx->slots[i].key != NULL;
+       i = (i + 1) & (idx->cap - 1)) {
+    e = &idx->slots[i];
+    if (e->hash == h && e->len == len && memcmp(e->key, key, len) == 0)
+      return e->entry;
+  }
+
+  return NULL;
+}
+
+void
+sexp_alist_invalidate (sexp_alist_t * idx)
+{
+  if (idx != NULL)
+    idx->stale = 1;
+}
+
+void
+destroy_sexp_alist (sexp_alist_t * idx)
+{
+  if (idx == NULL) return;
+
+  if (idx->slots != NULL)
+    sexp_free(idx->slots, idx->cap * sizeof(alist_ent_t));
+  sexp_free(idx, sizeof(sexp_alist_t));
+}
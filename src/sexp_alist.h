@@ -0,0 +1,113 @@
+/**
+   @cond IGNORE
+
+   ======================================================
+   SFSEXP: Small, Fast S-Expression Library
+   Written by Matthew Sottile (mjsottile@gmail.com)
+   ======================================================
+
+   Copyright (2003-2006). The Regents of the University of California. This
+   material was produced under U.S. Government contract W-7405-ENG-36 for Los
+   Alamos National Laboratory, which is operated by the University of
+   California for the U.S. Department of Energy. The U.S. Government has rights
+   to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+   THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+   LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+   derivative works, such modified software should be clearly marked, so as not
+   to confuse it with the version available from LANL.
+
+   Additionally, this library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of the
+   License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+   LA-CC-04-094
+
+   @endcond
+**/
+#ifndef __SEXP_ALIST_H__
+#define __SEXP_ALIST_H__
+
+/**
+ * \file sexp_alist.h
+ *
+ * \brief Association list indexes: look up ((key val) (key val) ...) by
+ * key in constant time.
+ *
+ * sexp_alist_index hashes the head atom of every list element of an
+ * association list, so sexp_alist_get finds the entry for a key without
+ * the string comparisons find_sexp makes over the whole expression.  The
+ * index refers to the list and to the text of its keys without copying
+ * them, and remembers the generation of the list (its val_used) it was
+ * built at.  Edits made through a cursor (see sexp_cursor.h) move the
+ * generation on, and the next lookup builds the index again.  After
+ * adding, removing or renaming entries any other way, by hand or by
+ * sexp_intern_val on a key, which gives it new text, call
+ * sexp_alist_invalidate for the same effect.  Changing the values inside
+ * an entry needs nothing.  Destroy the index before the list it indexes,
+ * and before hash-consing it (see sexp_hashcons), which frees elements
+ * of the list.  An index that is up to date may be read
+ * by several threads at once; one that has been invalidated is rebuilt by
+ * the first lookup, which modifies it.
+ */
+
+#include "sexp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /**
+   * An association list index.  The contents are private to sexp_alist.c.
+   */
+  typedef struct sexp_alist sexp_alist_t;
+
+  /**
+   * Index the association list \a sx.  Every element of sx that is a list
+   * headed by a text atom is an entry with that atom as its key; other
+   * elements, and lists headed by numeric atoms without text (see
+   * new_sexp_int64), are ignored.  If several entries have the same key, the
+   * first one is found.  A lazy list, and lazy entries, are built first.
+   *
+   * \param sx The association list.
+   * \return   The index, or NULL with sexp_errno set: SEXP_ERR_BAD_PARAM
+   *           if sx is not a list, SEXP_ERR_MEMORY if the index could not
+   *           be allocated.
+   */
+  sexp_alist_t *sexp_alist_index(sexp_t *sx);
+
+  /**
+   * The entry of the list indexed by \a idx whose key is \a key, or NULL
+   * if there is none.  Returns the whole entry, so the value of
+   * (key val) is its second element.  If the index has been invalidated,
+   * or the generation of its list has moved on, it is built again first;
+   * should that fail, NULL is returned with sexp_errno set.
+   */
+  sexp_t *sexp_alist_get(sexp_alist_t *idx, const char *key);
+
+  /**
+   * Tell \a idx that entries of its list have been added, removed or
+   * renamed other than through a cursor.  The index is built again by the
+   * next lookup.
+   */
+  void sexp_alist_invalidate(sexp_alist_t *idx);
+
+  /**
+   * Destroy the index \a idx.  The list it indexes is not touched.
+   */
+  void destroy_sexp_alist(sexp_alist_t *idx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SEXP_ALIST_H__ */
@@ -0,0 +1,241 @@
+/**
+   @cond IGNORE
+
+   ======================================================
+   SFSEXP: Small, Fast S-Expression Library
+   Written by Matthew Sottile (mjsottile@gmail.com)
+   ======================================================
+
+   Copyright (2003-2006). The Regents of the University of California. This
+   material was produced under U.S. Government contract W-7405-ENG-36 for Los
+   Alamos National Laboratory, which is operated by the University of
+   California for the U.S. Department of Energy. The U.S. Government has rights
+   to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+   THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+   LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+   derivative works, such modified software should be clearly marked, so as not
+   to confuse it with the version available from LANL.
+
+   Additionally, this library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of the
+   License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+   LA-CC-04-094
+
+   @endcond
+**/
+#include <stdlib.h>
+#include <string.h>
+#include "sexp.h"
+#include "sexp_arena.h"
+
+/*
+ * alignment of arena allocations: enough for elements and the arena's own
+ * bookkeeping structures on the platforms we care about.
+ */
+#define ARENA_ALIGN (2*sizeof(void *))
+#define ARENA_ROUND(n) (((n) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+
+/* data of a block starts right after the (padded) header. */
+#define BLK_HDR ARENA_ROUND(sizeof(sexp_arena_blk_t))
+#define BLK_DATA(b) ((char *)(b) + BLK_HDR)
+
+#define ARENA_DEFAULT_BLOCKSIZE (64*1024)
+
+/*
+ * the reference count of a shared val buffer sits in the last aligned
+ * size_t slot of the buffer, past val_used.
+ */
+#define REFS_OFFSET(alloc) \
+  (((alloc) - sizeof(size_t)) & ~(sizeof(size_t) - 1))
+#define VAL_REFS(sx) \
+  ((size_t *)((sx)->val + REFS_OFFSET((sx)->val_allocated)))
+
+static sexp_arena_blk_t *
+_new_blk (size_t size)
+{
+  sexp_arena_blk_t *b;
+
+#ifdef __cplusplus
+  b = (sexp_arena_blk_t *)sexp_malloc(BLK_HDR + size);
+#else
+  b = sexp_malloc(BLK_HDR + size);
+#endif
+  if (b == NULL) {
+    sexp_errno = SEXP_ERR_MEMORY;
+    return NULL;
+  }
+
+  b->next = NULL;
+  b->size = size;
+  b->used = 0;
+
+  return b;
+}
+
+sexp_arena_t *
+new_sexp_arena (size_t blocksize)
+{
+  sexp_arena_t *a;
+
+  if (blocksize == 0)
+    blocksize = ARENA_DEFAULT_BLOCKSIZE;
+
+#ifdef __cplusplus
+  a = (sexp_arena_t *)sexp_malloc(sizeof(sexp_arena_t));
+#else
+  a = sexp_malloc(sizeof(sexp_arena_t));
+#endif
+  if (a == NULL) {
+    sexp_errno = SEXP_ERR_MEMORY;
+    return NULL;
+  }
+
+  a->blocksize = ARENA_ROUND(blocksize);
+  a->used = 0;
+  a->runs = NULL;
+  a->blocks = _new_blk(a->blocksize);
+  if (a->blocks == NULL) {
+    sexp_free(a, sizeof(sexp_arena_t));
+    return NULL;
+  }
+
+  return a;
+}
+
+void
+destroy_sexp_arena (sexp_arena_t * a)
+{
+  sexp_arena_run_t *r;
+  sexp_arena_blk_t *b, *next;
+  size_t i;
+
+  if (a == NULL) return;
+
+  for (r = a->runs; r != NULL; r = r->next)
+    for (i = 0; i < r->count; i++)
+      if (r->elts[i].flags & SEXP_FLAG_SHARED_VAL)
+        sexp_release_val(&r->elts[i]);
+
+  for (b = a->blocks; b != NULL; b = next) {
+    next = b->next;
+    sexp_free(b, BLK_HDR + b->size);
+  }
+
+  sexp_free(a, sizeof(sexp_arena_t));
+}
+
+void *
+sexp_arena_alloc (sexp_arena_t * a, size_t size)
+{
+  sexp_arena_blk_t *b;
+  void *p;
+
+  if (a == NULL) {
+    sexp_errno = SEXP_ERR_BAD_PARAM;
+    return NULL;
+  }
+
+  size = ARENA_ROUND(size);
+  b = a->blocks;
+
+  if (b->size - b->used < size) {
+    if (size > a->blocksize / 2) {
+      /* big request: give it a block of its own behind the current one,
+         which keeps filling up. */
+      b = _new_blk(size);
+      if (b == NULL) return NULL;
+      b->next = a->blocks->next;
+      a->blocks->next = b;
+    } else {
+      b = _new_blk(a->blocksize);
+      if (b == NULL) return NULL;
+      b->next = a->blocks;
+      a->blocks = b;
+    }
+  }
+
+  p = BLK_DATA(b) + b->used;
+  b->used += size;
+  a->used += size;
+
+  return p;
+}
+
+char *
+sexp_make_shared_val (sexp_t * sx)
+{
+  size_t need;
+  char *v;
+
+  if (sx == NULL || sx->ty != SEXP_VALUE || sx->aty == SEXP_BINARY ||
+      sx->val == NULL || ((sx->flags & SEXP_FLAG_ARENA) &&
+                          !(sx->flags & SEXP_FLAG_SHARED_VAL))) {
+    sexp_errno = SEXP_ERR_BADCONTENT;
+    return NULL;
+  }
+
+  if (sx->flags & SEXP_FLAG_SHARED_VAL)
+    return sx->val;
+
+  /* make room for the count past the used part of the buffer. */
+  if (sx->val_allocated < sizeof(size_t) ||
+      REFS_OFFSET(sx->val_allocated) < sx->val_used) {
+    need = ((sx->val_used + sizeof(size_t) - 1) & ~(sizeof(size_t) - 1))
+      + sizeof(size_t);
+#ifdef __cplusplus
+    v = (char *)sexp_realloc(sx->val, need, sx->val_allocated);
+#else
+    v = sexp_realloc(sx->val, need, sx->val_allocated);
+#endif
+    if (v == NULL) {
+      sexp_errno = SEXP_ERR_MEMORY;
+      return NULL;
+    }
+    sx->val = v;
+    sx->val_allocated = need;
+  }
+
+  *VAL_REFS(sx) = 1;
+  sx->flags |= SEXP_FLAG_SHARED_VAL;
+
+  return sx->val;
+}
+
+char *
+sexp_share_val (sexp_t * sx)
+{
+  if (sexp_make_shared_val(sx) == NULL)
+    return NULL;
+
+  SEXP_REF_INC(VAL_REFS(sx));
+
+  return sx->val;
+}
+
+void
+sexp_release_val (sexp_t * sx)
+{
+  if (sx->val != NULL) {
+    if (sx->flags & SEXP_FLAG_SHARED_VAL) {
+      if (SEXP_REF_DEC(VAL_REFS(sx)) == 0)
+        sexp_free(sx->val, sx->val_allocated);
+    } else if (!(sx->flags & SEXP_FLAG_ARENA)) {
+      /* unshared text of arena elements is part of the arena. */
+      sexp_free(sx->val, sx->val_allocated);
+    }
+  }
+
+  sx->val = NULL;
+  sx->flags &= ~(SEXP_FLAG_SHARED_VAL | SEXP_FLAG_INTERNED);
+}
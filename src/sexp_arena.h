@@ -0,0 +1,239 @@
+/**
+   @cond IGNORE
+
+   ======================================================
+   SFSEXP: Small, Fast S-Expression Library
+   Written by Matthew Sottile (mjsottile@gmail.com)
+   ======================================================
+
+   Copyright (2003-2006). The Regents of the University of California. This
+   material was produced under U.S. Government contract W-7405-ENG-36 for Los
+   Alamos National Laboratory, which is operated by the University of
+   California for the U.S. Department of Energy. The U.S. Government has rights
+   to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+   THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+   LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+   derivative works, such modified software should be clearly marked, so as not
+   to confuse it with the version available from LANL.
+
+   Additionally, this library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of the
+   License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+   LA-CC-04-094
+
+   @endcond
+**/
+#ifndef __SEXP_ARENA_H__
+#define __SEXP_ARENA_H__
+
+/**
+ * \file sexp_arena.h
+ *
+ * \brief Arenas for bulk allocation of s-expression elements, and
+ *        reference counted atom buffers that can be shared between copies.
+ *
+ * An arena hands out memory from large blocks and frees it all at once.
+ * copy_sexp_into and share_sexp_into place copies of expressions in an
+ * arena; elements placed there carry SEXP_FLAG_ARENA and live until the
+ * arena is destroyed.
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /*========*/
+  /* MACROS */
+  /*========*/
+
+  /**
+   * \ingroup memory
+   * Increment the reference count at \a p and return the new value.  The
+   * counts of shared atom buffers and persistent elements may be touched
+   * by several threads at once, so this is atomic on compilers that
+   * provide the __atomic builtins (GCC and clang).
+   */
+#ifdef __GNUC__
+#define SEXP_REF_INC(p) __atomic_add_fetch((p), 1, __ATOMIC_RELAXED)
+#else
+#define SEXP_REF_INC(p) (++*(p))
+#endif
+
+  /**
+   * \ingroup memory
+   * Decrement the reference count at \a p and return the new value.
+   * Atomic under the same conditions as SEXP_REF_INC.
+   */
+#ifdef __GNUC__
+#define SEXP_REF_DEC(p) __atomic_sub_fetch((p), 1, __ATOMIC_ACQ_REL)
+#else
+#define SEXP_REF_DEC(p) (--*(p))
+#endif
+
+  /**
+   * \ingroup memory
+   * Read the reference count at \a p.  Atomic under the same conditions
+   * as SEXP_REF_INC.
+   */
+#ifdef __GNUC__
+#define SEXP_REF_GET(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#else
+#define SEXP_REF_GET(p) (*(p))
+#endif
+
+  /*=======*/
+  /* TYPES */
+  /*=======*/
+
+  /* sexp_t, defined in sexp.h */
+  struct elt;
+
+  /**
+   * \ingroup memory
+   * Header of one block of arena memory.  The data follows the header.
+   */
+  typedef struct sexp_arena_blk {
+    /**
+     * Next (older) block.
+     */
+    struct sexp_arena_blk *next;
+
+    /**
+     * Bytes of data in the block.
+     */
+    size_t size;
+
+    /**
+     * Bytes of data handed out so far.
+     */
+    size_t used;
+  } sexp_arena_blk_t;
+
+  /**
+   * \ingroup memory
+   * A run of elements in an arena some of which hold references to shared
+   * atom buffers.  The arena drops those references when it is destroyed.
+   */
+  typedef struct sexp_arena_run {
+    /**
+     * Next run.
+     */
+    struct sexp_arena_run *next;
+
+    /**
+     * First element of the run.
+     */
+    struct elt *elts;
+
+    /**
+     * Number of elements of the run that have been filled in.
+     */
+    size_t count;
+  } sexp_arena_run_t;
+
+  /**
+   * \ingroup memory
+   * An arena.  Allocations are carved sequentially out of the current
+   * block; requests larger than half the block size get a block of their
+   * own.
+   */
+  typedef struct sexp_arena {
+    /**
+     * Blocks owned by the arena, the one being filled first.
+     */
+    sexp_arena_blk_t *blocks;
+
+    /**
+     * Size of the data area of a regular block.
+     */
+    size_t blocksize;
+
+    /**
+     * Total bytes handed out by the arena.
+     */
+    size_t used;
+
+    /**
+     * Runs of elements holding shared atom buffers.
+     */
+    sexp_arena_run_t *runs;
+  } sexp_arena_t;
+
+  /*===========*/
+  /* FUNCTIONS */
+  /*===========*/
+
+  /**
+   * \ingroup memory
+   * Create an empty arena whose regular blocks hold \a blocksize bytes.
+   * A blocksize of zero selects the default of 64KB.  Returns NULL and
+   * sets sexp_errno if the arena could not be allocated.
+   */
+  sexp_arena_t *new_sexp_arena(size_t blocksize);
+
+  /**
+   * \ingroup memory
+   * Free an arena, every element placed in it, and the arena's references
+   * to shared atom buffers.  Elements placed in the arena must not be used
+   * afterwards.
+   */
+  void destroy_sexp_arena(sexp_arena_t *arena);
+
+  /**
+   * \ingroup memory
+   * Allocate \a size bytes from \a arena, aligned for any of the library's
+   * structures.  The memory is not initialized.  Returns NULL and sets
+   * sexp_errno on failure.
+   */
+  void *sexp_arena_alloc(sexp_arena_t *arena, size_t size);
+
+  /**
+   * \ingroup memory
+   * Convert the val buffer of the text atom \a sx to a shared buffer held
+   * only by sx, if it is not shared already, and return it.  The
+   * reference count is stored in the unused tail of the buffer, which is
+   * grown if there is no room, and sx is flagged with SEXP_FLAG_SHARED_VAL.
+   * Returns NULL and sets sexp_errno if sx has no buffer of its own or it
+   * could not be grown.
+   */
+  char *sexp_make_shared_val(struct elt *sx);
+
+  /**
+   * \ingroup memory
+   * Take a new reference to the val buffer of the text atom \a sx and
+   * return the buffer, converting it with sexp_make_shared_val first if
+   * needed.  Only the conversion is unsafe to race with other threads;
+   * taking references to a buffer that is already shared is not.  The new
+   * holder must set SEXP_FLAG_SHARED_VAL and copy val_used and
+   * val_allocated from sx.  Returns NULL and sets sexp_errno on the same
+   * conditions as sexp_make_shared_val.
+   */
+  char *sexp_share_val(struct elt *sx);
+
+  /**
+   * \ingroup memory
+   * Drop the val buffer of \a sx: shared buffers lose a reference and are
+   * freed with the last one, others are freed directly.  val is set to
+   * NULL and SEXP_FLAG_SHARED_VAL and SEXP_FLAG_INTERNED are cleared.
+   * bindata is not touched.
+   */
+  void sexp_release_val(struct elt *sx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SEXP_ARENA_H__ */
@@ -0,0 +1,529 @@
+/**
+   @cond IGNORE
+
+   ======================================================
+   SFSEXP: Small, Fast S-Expression Library
+   Written by Matthew Sottile (mjsottile@gmail.com)
+   ======================================================
+
+   Copyright (2003-2006). The Regents of the University of California. This
+   material was produced under U.S. Government contract W-7405-ENG-36 for Los
+   Alamos National Laboratory, which is operated by the University of
+   California for the U.S. Department of Energy. The U.S. Government has rights
+   to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+   THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+   LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+   derivative works, such modified software should be clearly marked, so as not
+   to confuse it with the version available from LANL.
+
+   Additionally, this library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of the
+   License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+   LA-CC-04-094
+
+   @endcond
+**/
+#include <stdlib.h>
+#include <string.h>
+#include "sexp.h"
+
+#define BUILDER_LEVELS 16
+#define BUILDER_OUT    4096
+
+/*
+ * an open list and its last element.  Level 0 is the top level, whose
+ * list is NULL; its elements are the chain starting at first.
+ */
+typedef struct build_level {
+  sexp_t *list;
+  sexp_t *tail;
+} build_level_t;
+
+struct sexp_builder {
+  sexp_arena_t *arena;
+  sexp_t *first;
+  build_level_t *levels;
+  size_t depth;
+  size_t levcap;
+
+  /* writers only */
+  sexp_write_t write;
+  void *data;
+  char *out;
+  size_t outused;
+  unsigned int space;    /* an element came before, so separate the next */
+
+  sexp_errcode_t error;
+};
+
+static sexp_builder_t *
+_new_builder (void)
+{
+  sexp_builder_t *b;
+
+#ifdef __cplusplus
+  b = (sexp_builder_t *)sexp_malloc(sizeof(sexp_builder_t));
+#else
+  b = sexp_malloc(sizeof(sexp_builder_t));
+#endif
+  if (b == NULL) {
+    sexp_errno = SEXP_ERR_MEMORY;
+    return NULL;
+  }
+
+  b->arena = NULL;
+  b->first = NULL;
+  b->levels = NULL;
+  b->depth = 0;
+  b->levcap = 0;
+  b->write = NULL;
+  b->data = NULL;
+  b->out = NULL;
+  b->outused = 0;
+  b->space = 0;
+  b->error = SEXP_ERR_OK;
+
+  return b;
+}
+
+sexp_builder_t *
+new_sexp_builder (sexp_arena_t * arena)
+{
+  sexp_builder_t *b = _new_builder();
+
+  if (b == NULL)
+    return NULL;
+
+#ifdef __cplusplus
+  b->levels = (build_level_t *)sexp_malloc(BUILDER_LEVELS *
+                                           sizeof(build_level_t));
+#else
+  b->levels = sexp_malloc(BUILDER_LEVELS * sizeof(build_level_t));
+#endif
+  if (b->levels == NULL) {
+    sexp_errno = SEXP_ERR_MEMORY;
+    sexp_free(b, sizeof(sexp_builder_t));
+    return NULL;
+  }
+
+  b->levcap = BUILDER_LEVELS;
+  b->levels[0].list = b->levels[0].tail = NULL;
+  b->arena = arena;
+
+  return b;
+}
+
+sexp_builder_t *
+new_sexp_builder_writer (sexp_write_t write, void *data)
+{
+  sexp_builder_t *b;
+
+  if (write == NULL) {
+    sexp_errno = SEXP_ERR_BAD_PARAM;
+    return NULL;
+  }
+
+  b = _new_builder();
+  if (b == NULL)
+    return NULL;
+
+#ifdef __cplusplus
+  b->out = (char *)sexp_malloc(BUILDER_OUT);
+#else
+  b->out = sexp_malloc(BUILDER_OUT);
+#endif
+  if (b->out == NULL) {
+    sexp_errno = SEXP_ERR_MEMORY;
+    sexp_free(b, sizeof(sexp_builder_t));
+    return NULL;
+  }
+
+  b->write = write;
+  b->data = data;
+
+  return b;
+}
+
+void
+destroy_sexp_builder (sexp_builder_t * b)
+{
+  if (b == NULL) return;
+
+  /* arena elements are skipped by destroy_sexp. */
+  if (b->first != NULL)
+    destroy_sexp(b->first);
+  if (b->levels != NULL)
+    sexp_free(b->levels, b->levcap * sizeof(build_level_t));
+  if (b->out != NULL)
+    sexp_free(b->out, BUILDER_OUT);
+  sexp_free(b, sizeof(sexp_builder_t));
+}
+
+/**
+ * Record the first failure of b.  Always returns -1.
+ */
+static int
+_fail (sexp_builder_t * b, sexp_errcode_t err)
+{
+  b->error = err;
+  sexp_errno = err;
+  return -1;
+}
+
+#define CHECK_BUILDER(b)                         \
+  if ((b) == NULL) {                             \
+    sexp_errno = SEXP_ERR_BAD_PARAM;             \
+    return -1;                                   \
+  }                                              \
+  if ((b)->error != SEXP_ERR_OK) {               \
+    sexp_errno = (b)->error;                     \
+    return -1;                                   \
+  }
+
+/*
+ * writers
+ */
+
+int
+sexp_build_flush (sexp_builder_t * b)
+{
+  CHECK_BUILDER(b);
+
+  if (b->write == NULL || b->outused == 0)
+    return 0;
+
+  if (b->write(b->data, b->out, b->outused) != 0)
+    return _fail(b, SEXP_ERR_IO);
+  b->outused = 0;
+
+  return 0;
+}
+
+static int
+_put (sexp_builder_t * b, const char *s, size_t len)
+{
+  size_t n;
+
+  while (len > 0) {
+    if (b->outused == BUILDER_OUT && sexp_build_flush(b) != 0)
+      return -1;
+    n = BUILDER_OUT - b->outused;
+    if (n > len)
+      n = len;
+    memcpy(b->out + b->outused, s, n);
+    b->outused += n;
+    s += n;
+    len -= n;
+  }
+
+  return 0;
+}
+
+static int
+_putc (sexp_builder_t * b, char c)
+{
+  if (b->outused == BUILDER_OUT && sexp_build_flush(b) != 0)
+    return -1;
+  b->out[b->outused++] = c;
+  return 0;
+}
+
+/**
+ * Separate the element about to be written from the one before it: a
+ * space inside a list, a newline between expressions.
+ */
+static int
+_separate (sexp_builder_t * b)
+{
+  if (!b->space)
+    return 0;
+  return _putc(b, (b->depth > 0) ? ' ' : '\n');
+}
+
+/**
+ * Write an atom the way print_sexp does.
+ */
+static int
+_write_atom (sexp_builder_t * b, const char *buf, size_t len, atom_t aty)
+{
+  size_t i, run;
+
+  if (_separate(b) != 0)
+    return -1;
+
+  if (aty == SEXP_SQUOTE && _putc(b, '\'') != 0)
+    return -1;
+
+  if (aty != SEXP_DQUOTE) {
+    if (_put(b, buf, len) != 0)
+      return -1;
+  } else {
+    if (_putc(b, '\"') != 0)
+      return -1;
+    /* copy runs that need no escaping in one go. */
+    for (i = 0; i < len; i += run) {
+      for (run = 0; i + run < len; run++)
+        if (buf[i + run] == '\"' || buf[i + run] == '\\')
+          break;
+      if (_put(b, buf + i, run) != 0)
+        return -1;
+      if (i + run < len) {
+        if (_putc(b, '\\') != 0 || _putc(b, buf[i + run]) != 0)
+          return -1;
+        run++;
+      }
+    }
+    if (_putc(b, '\"') != 0)
+      return -1;
+  }
+
+  b->space = 1;
+
+  return 0;
+}
+
+/*
+ * trees
+ */
+
+/**
+ * Link sx in as the last element of the innermost open list.
+ */
+static void
+_link (sexp_builder_t * b, sexp_t * sx)
+{
+  build_level_t *l = &b->levels[b->depth];
+
+  if (l->tail != NULL)
+    l->tail->next = sx;
+  else if (l->list != NULL)
+    l->list->list = sx;
+  else
+    b->first = sx;
+  l->tail = sx;
+}
+
+/**
+ * A new element with no contents, from the arena with room for extra
+ * bytes of text after it, or an ordinary one.
+ */
+static sexp_t *
+_elt (sexp_builder_t * b, elt_t ty, size_t extra)
+{
+  sexp_t *sx;
+
+  if (b->arena != NULL) {
+#ifdef __cplusplus
+    sx = (sexp_t *)sexp_arena_alloc(b->arena, sizeof(sexp_t) + extra);
+#else
+    sx = sexp_arena_alloc(b->arena, sizeof(sexp_t) + extra);
+#endif
+    if (sx == NULL)
+      return NULL;
+    sx->flags = SEXP_FLAG_ARENA;
+    sx->val = (extra > 0) ? (char *)(sx + 1) : NULL;
+  } else {
+    sx = sexp_t_allocate();
+    if (sx == NULL) {
+      sexp_errno = SEXP_ERR_MEMORY;
+      return NULL;
+    }
+    sx->val = NULL;
+    if (extra > 0) {
+#ifdef __cplusplus
+      sx->val = (char *)sexp_malloc(extra);
+#else
+      sx->val = sexp_malloc(extra);
+#endif
+      if (sx->val == NULL) {
+        sexp_errno = SEXP_ERR_MEMORY;
+        sexp_t_deallocate(sx);
+        return NULL;
+      }
+    }
+  }
+
+  sx->ty = ty;
+  sx->aty = SEXP_BASIC;
+  sx->val_used = sx->val_allocated = extra;
+  sx->list = sx->next = NULL;
+  sx->bindata = NULL;
+  sx->binlength = 0;
+
+  return sx;
+}
+
+int
+sexp_build_begin (sexp_builder_t * b)
+{
+  build_level_t *levels;
+  sexp_t *sx;
+
+  CHECK_BUILDER(b);
+
+  if (b->write != NULL) {
+    if (_separate(b) != 0 || _putc(b, '(') != 0)
+      return -1;
+    b->depth++;
+    b->space = 0;
+    return 0;
+  }
+
+  if (b->depth + 1 == b->levcap) {
+#ifdef __cplusplus
+    levels = (build_level_t *)
+#else
+    levels =
+#endif
+      sexp_realloc(b->levels, 2 * b->levcap * sizeof(build_level_t),
+                   b->levcap * sizeof(build_level_t));
+    if (levels == NULL)
+      return _fail(b, SEXP_ERR_MEMORY);
+    b->levels = levels;
+    b->levcap *= 2;
+  }
+
+  sx = _elt(b, SEXP_LIST, 0);
+  if (sx == NULL)
+    return _fail(b, sexp_errno);
+
+  _link(b, sx);
+  b->depth++;
+  b->levels[b->depth].list = sx;
+  b->levels[b->depth].tail = NULL;
+
+  return 0;
+}
+
+int
+sexp_build_end (sexp_builder_t * b)
+{
+  CHECK_BUILDER(b);
+
+  if (b->depth == 0)
+    return _fail(b, SEXP_ERR_BADFORM);
+
+  b->depth--;
+
+  if (b->write != NULL) {
+    if (_putc(b, ')') != 0)
+      return -1;
+    b->space = 1;
+  }
+
+  return 0;
+}
+
+int
+sexp_build_atom (sexp_builder_t * b, const char *buf, size_t len,
+                 atom_t aty)
+{
+  sexp_t *sx;
+
+  CHECK_BUILDER(b);
+
+  if (buf == NULL && len > 0)
+    return _fail(b, SEXP_ERR_BAD_PARAM);
+  if (aty == SEXP_BINARY)
+    return _fail(b, SEXP_ERR_BAD_CONSTRUCTOR);
+
+  if (b->write != NULL)
+    return _write_atom(b, buf, len, aty);
+
+  sx = _elt(b, SEXP_VALUE, len + 1);
+  if (sx == NULL)
+    return _fail(b, sexp_errno);
+
+  sx->aty = aty;
+  if (len > 0)
+    memcpy(sx->val, buf, len);
+  sx->val[len] = '\0';
+  _link(b, sx);
+
+  return 0;
+}
+
+/**
+ * Add a numeric atom: as text for a writer, with flag set on a new
+ * element with no text for a tree builder.
+ */
+static int
+_build_number (sexp_builder_t * b, unsigned int flag, sexp_int64_t i,
+               double d)
+{
+  char buf[SEXP_NUMBER_MAX];
+  size_t n;
+  sexp_t *sx;
+
+  CHECK_BUILDER(b);
+
+  if (b->write != NULL) {
+    n = (flag == SEXP_FLAG_INT64) ?
+      sexp_format_int64(buf, i) : sexp_format_double(buf, d);
+    if (_separate(b) != 0 || _put(b, buf, n) != 0)
+      return -1;
+    b->space = 1;
+    return 0;
+  }
+
+  sx = _elt(b, SEXP_VALUE, 0);
+  if (sx == NULL)
+    return _fail(b, sexp_errno);
+
+  if (flag == SEXP_FLAG_INT64)
+    sexp_set_int64(sx, i);
+  else
+    sexp_set_double(sx, d);
+  _link(b, sx);
+
+  return 0;
+}
+
+int
+sexp_build_int (sexp_builder_t * b, sexp_int64_t v)
+{
+  return _build_number(b, SEXP_FLAG_INT64, v, 0);
+}
+
+int
+sexp_build_double (sexp_builder_t * b, double v)
+{
+  return _build_number(b, SEXP_FLAG_DOUBLE, 0, v);
+}
+
+sexp_t *
+sexp_build_finish (sexp_builder_t * b)
+{
+  sexp_t *sx;
+
+  if (b == NULL || b->write != NULL) {
+    sexp_errno = SEXP_ERR_BAD_PARAM;
+    return NULL;
+  }
+  if (b->error != SEXP_ERR_OK) {
+    sexp_errno = b->error;
+    return NULL;
+  }
+  if (b->depth > 0) {
+    sexp_errno = SEXP_ERR_INCOMPLETE;
+    return NULL;
+  }
+
+  sx = b->first;
+  b->first = NULL;
+  b->levels[0].tail = NULL;
+  sexp_errno = SEXP_ERR_OK;
+
+  return sx;
+}
@@ -0,0 +1,155 @@
+/**
+   @cond IGNORE
+
+   ======================================================
+   SFSEXP: Small, Fast S-Expression Library
+   Written by Matthew Sottile (mjsottile@gmail.com)
+   ======================================================
+
+   Copyright (2003-2006). The Regents of the University of California. This
+   material was produced under U.S. Government contract W-7405-ENG-36 for Los
+   Alamos National Laboratory, which is operated by the University of
+   California for the U.S. Department of Energy. The U.S. Government has rights
+   to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+   THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+   LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+   derivative works, such modified software should be clearly marked, so as not
+   to confuse it with the version available from LANL.
+
+   Additionally, this library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of the
+   License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+   LA-CC-04-094
+
+   @endcond
+**/
+#ifndef __SEXP_BUILDER_H__
+#define __SEXP_BUILDER_H__
+
+/**
+ * \file sexp_builder.h
+ *
+ * \brief Builders: construct expressions one element at a time, as a
+ * tree or straight to text.
+ *
+ * A builder is told the elements of an expression in the order they are
+ * printed: sexp_build_begin opens a list, sexp_build_end closes it, and
+ * the atom calls add an atom to the list that is open.  It keeps the last
+ * element of every open list, so each call links its element in without
+ * walking anything.
+ *
+ * A tree builder (new_sexp_builder) makes ordinary elements, or, given
+ * an arena, carves each atom and its text out of the arena with a single
+ * allocation; sexp_build_finish hands over what was built.  A writer
+ * (new_sexp_builder_writer) makes no elements at all: it prints the
+ * expressions as print_sexp would, one per line, into a buffer that is
+ * passed to a write function whenever it fills up and on
+ * sexp_build_flush.
+ *
+ * The first call that fails leaves its error in the builder, and every
+ * later call fails with it without doing anything, so a run of calls can
+ * be checked once at the end.
+ */
+
+#include "sexp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /**
+   * A builder.  The contents are private to sexp_builder.c.
+   */
+  typedef struct sexp_builder sexp_builder_t;
+
+  /**
+   * Function a writer hands its text to: \a len bytes at \a buf, with
+   * the data given to new_sexp_builder_writer.  Returns 0 on success,
+   * anything else to make the builder fail with SEXP_ERR_IO.
+   */
+  typedef int (*sexp_write_t)(void *data, const char *buf, size_t len);
+
+  /**
+   * Make a builder of trees.  Elements come from \a arena if it is not
+   * NULL (and then live as long as the arena), and are ordinary elements
+   * otherwise.  Returns NULL with sexp_errno set on failure.
+   */
+  sexp_builder_t *new_sexp_builder(sexp_arena_t *arena);
+
+  /**
+   * Make a builder that writes text through \a write instead of building
+   * elements.  Returns NULL with sexp_errno set on failure.
+   */
+  sexp_builder_t *new_sexp_builder_writer(sexp_write_t write, void *data);
+
+  /**
+   * Destroy the builder \a b, along with anything it built that was not
+   * handed over by sexp_build_finish.  Text a writer has not flushed is
+   * lost.
+   */
+  void destroy_sexp_builder(sexp_builder_t *b);
+
+  /**
+   * Open a list.  Like the other build calls, returns 0, or -1 with
+   * sexp_errno set (to the builder's error if it has failed before).
+   */
+  int sexp_build_begin(sexp_builder_t *b);
+
+  /**
+   * Close the innermost open list.  Fails with SEXP_ERR_BADFORM if no
+   * list is open.
+   */
+  int sexp_build_end(sexp_builder_t *b);
+
+  /**
+   * Add an atom of type \a aty holding the \a len bytes at \a buf.
+   * Binary atoms are not supported (SEXP_ERR_BAD_CONSTRUCTOR).
+   */
+  int sexp_build_atom(sexp_builder_t *b, const char *buf, size_t len,
+                      atom_t aty);
+
+  /**
+   * Add a basic atom holding \a v.  A tree builder makes a numeric atom
+   * (see new_sexp_int64), whose text is only made when it is printed.
+   */
+  int sexp_build_int(sexp_builder_t *b, sexp_int64_t v);
+
+  /**
+   * Add a basic atom holding \a v, as sexp_build_int does.  It is printed
+   * with as few digits as read back as the same double.
+   */
+  int sexp_build_double(sexp_builder_t *b, double v);
+
+  /**
+   * Hand over the expressions a tree builder has built since it was made
+   * or last finished, linked through next, and start afresh.  Returns
+   * NULL with sexp_errno set if a list is still open
+   * (SEXP_ERR_INCOMPLETE), the builder has failed, or it is a writer
+   * (SEXP_ERR_BAD_PARAM); in the first two cases the expressions stay in
+   * the builder.  Returns NULL with sexp_errno set to SEXP_ERR_OK if
+   * nothing was built.
+   */
+  sexp_t *sexp_build_finish(sexp_builder_t *b);
+
+  /**
+   * Pass the text a writer holds to its write function.  Does nothing for
+   * a tree builder.
+   */
+  int sexp_build_flush(sexp_builder_t *b);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SEXP_BUILDER_H__ */
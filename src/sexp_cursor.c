@@ -0,0 +1,350 @@
+/**
+   @cond IGNORE
+
+   ======================================================
+   SFSEXP: Small, Fast S-Expression Library
+   Written by Matthew Sottile (mjsottile@gmail.com)
+   ======================================================
+
+   Copyright (2003-2006). The Regents of the University of California. This
+   material was produced under U.S. Government contract W-7405-ENG-36 for Los
+   Alamos National Laboratory, which is operated by the University of
+   California for the U.S. Department of Energy. The U.S. Government has rights
+   to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+   THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+   LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+   derivative works, such modified software should be clearly marked, so as not
+   to confuse it with the version available from LANL.
+
+   Additionally, this library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of the
+   License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+   LA-CC-04-094
+
+   @endcond
+**/
+#include <stdlib.h>
+#include <string.h>
+#include "sexp.h"
+
+#define CURSOR_INITIAL 16
+
+/*
+ * a level of the path: the list the cursor went down into (NULL for the
+ * top level), and where the elements passed in it start in lefts.
+ */
+typedef struct cursor_level {
+  sexp_t *list;
+  size_t base;
+} cursor_level_t;
+
+/*
+ * lefts holds, for every level, the elements left of the cursor in the
+ * order they were passed, so the last one is the element before the
+ * focus.
+ */
+struct sexp_cursor {
+  sexp_t *root;
+  sexp_t *focus;
+  cursor_level_t *levels;
+  size_t depth;
+  size_t levcap;
+  sexp_t **lefts;
+  size_t nlefts;
+  size_t leftcap;
+};
+
+sexp_cursor_t *
+new_sexp_cursor (sexp_t * sx)
+{
+  sexp_cursor_t *c;
+
+#ifdef __cplusplus
+  c = (sexp_cursor_t *)sexp_malloc(sizeof(sexp_cursor_t));
+#else
+  c = sexp_malloc(sizeof(sexp_cursor_t));
+#endif
+  if (c == NULL) {
+    sexp_errno = SEXP_ERR_MEMORY;
+    return NULL;
+  }
+
+#ifdef __cplusplus
+  c->levels = (cursor_level_t *)sexp_malloc(CURSOR_INITIAL *
+                                            sizeof(cursor_level_t));
+  c->lefts = (sexp_t **)sexp_malloc(CURSOR_INITIAL * sizeof(sexp_t *));
+#else
+  c->levels = sexp_malloc(CURSOR_INITIAL * sizeof(cursor_level_t));
+  c->lefts = sexp_malloc(CURSOR_INITIAL * sizeof(sexp_t *));
+#endif
+  c->levcap = c->leftcap = CURSOR_INITIAL;
+  if (c->levels == NULL || c->lefts == NULL) {
+    sexp_errno = SEXP_ERR_MEMORY;
+    destroy_sexp_cursor(c);
+    return NULL;
+  }
+
+  c->root = c->focus = sx;
+  c->depth = 0;
+  c->levels[0].list = NULL;
+  c->levels[0].base = 0;
+  c->nlefts = 0;
+
+  return c;
+}
+
+void
+destroy_sexp_cursor (sexp_cursor_t * c)
+{
+  if (c == NULL) return;
+
+  if (c->levels != NULL)
+    sexp_free(c->levels, c->levcap * sizeof(cursor_level_t));
+  if (c->lefts != NULL)
+    sexp_free(c->lefts, c->leftcap * sizeof(sexp_t *));
+  sexp_free(c, sizeof(sexp_cursor_t));
+}
+
+sexp_t *
+sexp_cursor_focus (const sexp_cursor_t * c)
+{
+  return c->focus;
+}
+
+sexp_t *
+sexp_cursor_root (const sexp_cursor_t * c)
+{
+  return c->root;
+}
+
+size_t
+sexp_cursor_depth (const sexp_cursor_t * c)
+{
+  return c->depth;
+}
+
+int
+sexp_cursor_down (sexp_cursor_t * c)
+{
+  cursor_level_t *levels;
+  sexp_t *first;
+  sexp_errcode_t olderr = sexp_errno;
+
+  if (c->focus == NULL || c->focus->ty != SEXP_LIST)
+    return 0;
+
+  sexp_errno = SEXP_ERR_OK;
+  first = sexp_lazy_list(c->focus);
+  if (sexp_errno != SEXP_ERR_OK)
+    return -1;
+  sexp_errno = olderr;
+
+  if (c->depth + 1 == c->levcap) {
+#ifdef __cplusplus
+    levels = (cursor_level_t *)
+#else
+    levels =
+#endif
+      sexp_realloc(c->levels, 2 * c->levcap * sizeof(cursor_level_t),
+                   c->levcap * sizeof(cursor_level_t));
+    if (levels == NULL) {
+      sexp_errno = SEXP_ERR_MEMORY;
+      return -1;
+    }
+    c->levels = levels;
+    c->levcap *= 2;
+  }
+
+  c->depth++;
+  c->levels[c->depth].list = c->focus;
+  c->levels[c->depth].base = c->nlefts;
+  c->focus = first;
+
+  return 1;
+}
+
+int
+sexp_cursor_up (sexp_cursor_t * c)
+{
+  if (c->depth == 0)
+    return 0;
+
+  c->focus = c->levels[c->depth].list;
+  c->nlefts = c->levels[c->depth].base;
+  c->depth--;
+
+  return 1;
+}
+
+int
+sexp_cursor_left (sexp_cursor_t * c)
+{
+  if (c->nlefts == c->levels[c->depth].base)
+    return 0;
+
+  c->focus = c->lefts[--c->nlefts];
+
+  return 1;
+}
+
+int
+sexp_cursor_right (sexp_cursor_t * c)
+{
+  sexp_t **lefts;
+
+  if (c->focus == NULL)
+    return 0;
+
+  if (c->nlefts == c->leftcap) {
+#ifdef __cplusplus
+    lefts = (sexp_t **)
+#else
+    lefts =
+#endif
+      sexp_realloc(c->lefts, 2 * c->leftcap * sizeof(sexp_t *),
+                   c->leftcap * sizeof(sexp_t *));
+    if (lefts == NULL) {
+      sexp_errno = SEXP_ERR_MEMORY;
+      return -1;
+    }
+    c->lefts = lefts;
+    c->leftcap *= 2;
+  }
+
+  c->lefts[c->nlefts++] = c->focus;
+  c->focus = c->focus->next;
+
+  return 1;
+}
+
+/**
+ * The pointer to the focus that an edit changes, after telling the lists
+ * on the path that they are being changed (their cached hashes and source
+ * ranges go, and their generations move on); NULL if the element holding
+ * it is persistent.
+ */
+static sexp_t **
+_link (sexp_cursor_t * c)
+{
+  sexp_t *owner;
+  sexp_t **link;
+  size_t i;
+
+  if (c->nlefts > c->levels[c->depth].base) {
+    owner = c->lefts[c->nlefts - 1];
+    link = &owner->next;
+  } else if (c->depth > 0) {
+    owner = c->levels[c->depth].list;
+    link = &owner->list;
+  } else {
+    return &c->root;
+  }
+
+  if (owner->flags & SEXP_FLAG_PERSISTENT) {
+    sexp_errno = SEXP_ERR_BAD_PARAM;
+    return NULL;
+  }
+
+  if (c->depth > 0)
+    sexp_unindex(c->levels[c->depth].list);
+  for (i = 1; i <= c->depth; i++) {
+    c->levels[i].list->flags &= ~(SEXP_FLAG_HASHED | SEXP_FLAG_SOURCE);
+    c->levels[i].list->val_used++;
+  }
+
+  return link;
+}
+
+int
+sexp_cursor_insert (sexp_cursor_t * c, sexp_t * sx)
+{
+  if (sx == NULL) {
+    sexp_errno = SEXP_ERR_BAD_PARAM;
+    return -1;
+  }
+
+  sx->next = NULL;
+
+  return sexp_cursor_splice(c, sx);
+}
+
+int
+sexp_cursor_splice (sexp_cursor_t * c, sexp_t * sx)
+{
+  sexp_t **link;
+  sexp_t *last;
+
+  if (sx == NULL) {
+    sexp_errno = SEXP_ERR_BAD_PARAM;
+    return -1;
+  }
+
+  link = _link(c);
+  if (link == NULL)
+    return -1;
+
+  for (last = sx; last->next != NULL; last = last->next)
+    ;
+
+  last->next = c->focus;
+  *link = sx;
+  c->focus = sx;
+
+  return 0;
+}
+
+sexp_t *
+sexp_cursor_remove (sexp_cursor_t * c)
+{
+  sexp_t **link;
+  sexp_t *old = c->focus;
+
+  if (old == NULL) {
+    sexp_errno = SEXP_ERR_BAD_PARAM;
+    return NULL;
+  }
+
+  link = _link(c);
+  if (link == NULL)
+    return NULL;
+
+  *link = old->next;
+  c->focus = old->next;
+  old->next = NULL;
+
+  return old;
+}
+
+sexp_t *
+sexp_cursor_replace (sexp_cursor_t * c, sexp_t * sx)
+{
+  sexp_t **link;
+  sexp_t *old = c->focus;
+
+  if (old == NULL || sx == NULL) {
+    sexp_errno = SEXP_ERR_BAD_PARAM;
+    return NULL;
+  }
+
+  link = _link(c);
+  if (link == NULL)
+    return NULL;
+
+  sx->next = old->next;
+  *link = sx;
+  c->focus = sx;
+  old->next = NULL;
+
+  return old;
+}
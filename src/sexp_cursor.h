@@ -0,0 +1,166 @@
+/**
+   @cond IGNORE
+
+   ======================================================
+   SFSEXP: Small, Fast S-Expression Library
+   Written by Matthew Sottile (mjsottile@gmail.com)
+   ======================================================
+
+   Copyright (2003-2006). The Regents of the University of California. This
+   material was produced under U.S. Government contract W-7405-ENG-36 for Los
+   Alamos National Laboratory, which is operated by the University of
+   California for the U.S. Department of Energy. The U.S. Government has rights
+   to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+   THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+   LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+   derivative works, such modified software should be clearly marked, so as not
+   to confuse it with the version available from LANL.
+
+   Additionally, this library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of the
+   License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+   LA-CC-04-094
+
+   @endcond
+**/
+#ifndef __SEXP_CURSOR_H__
+#define __SEXP_CURSOR_H__
+
+/**
+ * \file sexp_cursor.h
+ *
+ * \brief Cursors: move around an expression and edit it in place.
+ *
+ * Elements have no parent pointers, and a list only knows its first
+ * element, so finding the element before another, or the list that holds
+ * it, means a walk from the top.  A cursor remembers the lists it went
+ * down into and the elements it passed on the way, so moving up, down,
+ * left and right, and inserting, removing or replacing the element at
+ * the cursor, all take constant time.  Appending to a list is moving
+ * right to its end once and then inserting there, one element after the
+ * other.
+ *
+ * The cursor is at an element of a list, its focus, or just after the
+ * last element (where the focus is NULL).  At the top level the "list"
+ * is the next chain of the expression the cursor was made for; since an
+ * edit there may change which element comes first, sexp_cursor_root
+ * gives the current first one.  The cursor does not own the expression,
+ * and the expression must only be changed through the cursor while it is
+ * in use.  Edits clear the cached hashes and source ranges of the lists
+ * they change (see sexp_hash_cache and sexp_emit_raw), drop their indexes
+ * (see sexp_index), and add one to their generation (the val_used of a
+ * list), which association list indexes (see sexp_alist_index) check
+ * before a lookup.  Removing a list that has such an index is not seen
+ * by it: destroy the index first.  Persistent expressions cannot be
+ * edited.
+ */
+
+#include "sexp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /**
+   * A cursor.  The contents are private to sexp_cursor.c.
+   */
+  typedef struct sexp_cursor sexp_cursor_t;
+
+  /**
+   * Make a cursor at \a sx, at the top level of the chain of elements
+   * that starts with it.  sx may be NULL to build an expression from
+   * nothing.  Returns NULL with sexp_errno set to SEXP_ERR_MEMORY on
+   * failure.
+   */
+  sexp_cursor_t *new_sexp_cursor(sexp_t *sx);
+
+  /**
+   * Destroy the cursor \a c.  The expression is not touched.
+   */
+  void destroy_sexp_cursor(sexp_cursor_t *c);
+
+  /**
+   * The element at the cursor, or NULL at the end of a list.
+   */
+  sexp_t *sexp_cursor_focus(const sexp_cursor_t *c);
+
+  /**
+   * The first element of the top level.
+   */
+  sexp_t *sexp_cursor_root(const sexp_cursor_t *c);
+
+  /**
+   * How many lists the cursor is inside; 0 at the top level.
+   */
+  size_t sexp_cursor_depth(const sexp_cursor_t *c);
+
+  /**
+   * Move to the first element of the list at the cursor (to its end if it
+   * is empty).  A lazy list is built first.  The moves return 1 if the
+   * cursor moved, 0 if it could not (here: the focus is not a list), and
+   * -1 with sexp_errno set if they ran out of memory.
+   */
+  int sexp_cursor_down(sexp_cursor_t *c);
+
+  /**
+   * Move to the list the cursor is in.  0 at the top level.
+   */
+  int sexp_cursor_up(sexp_cursor_t *c);
+
+  /**
+   * Move to the element before the focus.  0 at the first element.
+   */
+  int sexp_cursor_left(sexp_cursor_t *c);
+
+  /**
+   * Move to the element after the focus, or to the end of the list from
+   * its last element.  0 at the end.
+   */
+  int sexp_cursor_right(sexp_cursor_t *c);
+
+  /**
+   * Insert \a sx before the focus; sx becomes the focus.  sx->next is
+   * overwritten.  Returns 0, or -1 with sexp_errno set to
+   * SEXP_ERR_BAD_PARAM if sx is NULL or the list is persistent.
+   */
+  int sexp_cursor_insert(sexp_cursor_t *c, sexp_t *sx);
+
+  /**
+   * Insert the chain of elements starting at \a sx (linked through next)
+   * before the focus; sx becomes the focus.  Takes time in the length of
+   * the chain.  Same return values as sexp_cursor_insert.
+   */
+  int sexp_cursor_splice(sexp_cursor_t *c, sexp_t *sx);
+
+  /**
+   * Take the focus out of its list and return it, with its next cleared;
+   * the element after it becomes the focus.  The caller owns the element.
+   * Returns NULL with sexp_errno set to SEXP_ERR_BAD_PARAM at the end of
+   * a list or if the list is persistent.
+   */
+  sexp_t *sexp_cursor_remove(sexp_cursor_t *c);
+
+  /**
+   * Put \a sx in place of the focus, which is returned as by
+   * sexp_cursor_remove; sx becomes the focus.  Returns NULL with
+   * sexp_errno set to SEXP_ERR_BAD_PARAM if sx is NULL, at the end of a
+   * list, or if the list is persistent.
+   */
+  sexp_t *sexp_cursor_replace(sexp_cursor_t *c, sexp_t *sx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SEXP_CURSOR_H__ */
@@ -67,7 +67,8 @@ typedef enum {
 
   /**
    * badly formed expression.  Missing, misplaced, or mismatched parenthesis
-   * will result in this error.
+   * will result in this error, as will an inlined binary block whose size
+   * is not all decimal digits (a negative length, for one).
    */
   SEXP_ERR_BADFORM,
 
@@ -75,8 +76,6 @@ typedef enum {
    * a sexp_t that is inconsistent will result in this error code.  An example
    * is a SEXP_BASIC sexp_t with a null val field but a non-zero val_used
    * value.  Similar cases exist for SEXP_DQUOTE, SQUOTE, and BINARY types.
-   * This value is also used in the parser to flag a case where an inlined
-   * binary block is given a negative length.
    */
   SEXP_ERR_BADCONTENT,
 
@@ -141,7 +140,31 @@ typedef enum {
    * constructor intended for text atoms will cause this to
    * be set.
    */
-  SEXP_ERR_BAD_CONSTRUCTOR
+  SEXP_ERR_BAD_CONSTRUCTOR,
+
+  /**
+   * the parser was given a list nested deeper than the max_depth limit
+   * of its continuation allows.
+   */
+  SEXP_ERR_LIMIT_DEPTH,
+
+  /**
+   * the parser was given an atom longer than the max_atom_bytes limit of
+   * its continuation allows.
+   */
+  SEXP_ERR_LIMIT_ATOM,
+
+  /**
+   * the parser was given an expression with more elements than the
+   * max_nodes limit of its continuation allows.
+   */
+  SEXP_ERR_LIMIT_NODES,
+
+  /**
+   * the parser was given an expression whose atoms hold more bytes than
+   * the max_bytes limit of its continuation allows.
+   */
+  SEXP_ERR_LIMIT_BYTES
 
 } sexp_errcode_t;
 
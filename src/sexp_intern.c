@@ -0,0 +1,377 @@
+/**
+   @cond IGNORE
+
+   ======================================================
+   SFSEXP: Small, Fast S-Expression Library
+   Written by Matthew Sottile (mjsottile@gmail.com)
+   ======================================================
+
+   Copyright (2003-2006). The Regents of the University of California. This
+   material was produced under U.S. Government contract W-7405-ENG-36 for Los
+   Alamos National Laboratory, which is operated by the University of
+   California for the U.S. Department of Energy. The U.S. Government has rights
+   to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+   THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+   LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+   derivative works, such modified software should be clearly marked, so as not
+   to confuse it with the version available from LANL.
+
+   Additionally, this library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of the
+   License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+   LA-CC-04-094
+
+   @endcond
+**/
+#include <stdlib.h>
+#include <string.h>
+#include "sexp.h"
+#include "sexp_intern.h"
+
+#ifdef _SEXP_THREADS_
+# include <pthread.h>
+# define LOCK(t)   pthread_mutex_lock(&(t)->lock)
+# define UNLOCK(t) pthread_mutex_unlock(&(t)->lock)
+#else
+# define LOCK(t)
+# define UNLOCK(t)
+#endif
+
+#define INTERN_DEFAULT_SIZE 256
+
+/* FNV-1a; on 32 bit platforms the constants are simply truncated. */
+#define FNV_OFFSET ((size_t)14695981039346656037ULL)
+#define FNV_PRIME  ((size_t)1099511628211ULL)
+
+/*
+ * an interned string is a shared val buffer (see sexp_arena.c) laid out
+ * as the text and its nul, padded to a multiple of sizeof(size_t), then
+ * the hash, then the reference count in the last slot.
+ */
+#define PAD(n) (((n) + sizeof(size_t) - 1) & ~(sizeof(size_t) - 1))
+#define ENT_ALLOC(len) (PAD((len) + 1) + 2*sizeof(size_t))
+#define ENT_HASH(v, alloc) ((size_t *)((v) + (alloc) - 2*sizeof(size_t)))
+#define ENT_REFS(v, alloc) ((size_t *)((v) + (alloc) - sizeof(size_t)))
+
+typedef struct intern_ent {
+  char *val;
+  size_t len;
+  size_t alloc;
+  size_t hash;
+  int pinned;    /* returned by sexp_intern, never swept */
+} intern_ent_t;
+
+struct sexp_intern {
+  intern_ent_t *slots;
+  size_t cap;    /* power of two */
+  size_t count;
+#ifdef _SEXP_THREADS_
+  pthread_mutex_t lock;
+#endif
+};
+
+size_t
+sexp_hash_bytes (const char *buf, size_t len)
+{
+  size_t h = FNV_OFFSET;
+  size_t i;
+
+  for (i = 0; i < len; i++) {
+    h ^= (unsigned char)buf[i];
+    h *= FNV_PRIME;
+  }
+
+  return h;
+}
+
+sexp_intern_t *
+new_sexp_intern (size_t size)
+{
+  sexp_intern_t *t;
+  size_t cap = 16;
+
+  if (size == 0)
+    size = INTERN_DEFAULT_SIZE;
+
+  /* keep the load factor under 3/4. */
+  while (cap/4*3 < size)
+    cap *= 2;
+
+#ifdef __cplusplus
+  t = (sexp_intern_t *)sexp_malloc(sizeof(sexp_intern_t));
+#else
+  t = sexp_malloc(sizeof(sexp_intern_t));
+#endif
+  if (t == NULL) {
+    sexp_errno = SEXP_ERR_MEMORY;
+    return NULL;
+  }
+
+#ifdef __cplusplus
+  t->slots = (intern_ent_t *)sexp_calloc(cap, sizeof(intern_ent_t));
+#else
+  t->slots = sexp_calloc(cap, sizeof(intern_ent_t));
+#endif
+  if (t->slots == NULL) {
+    sexp_errno = SEXP_ERR_MEMORY;
+    sexp_free(t, sizeof(sexp_intern_t));
+    return NULL;
+  }
+
+  t->cap = cap;
+  t->count = 0;
+
+#ifdef _SEXP_THREADS_
+  pthread_mutex_init(&t->lock, NULL);
+#endif
+
+  return t;
+}
+
+void
+destroy_sexp_intern (sexp_intern_t * t)
+{
+  size_t i;
+  intern_ent_t *e;
+
+  if (t == NULL) return;
+
+  /* drop the table's reference to each string. */
+  for (i = 0; i < t->cap; i++) {
+    e = &t->slots[i];
+    if (e->val != NULL && SEXP_REF_DEC(ENT_REFS(e->val, e->alloc)) == 0)
+      sexp_free(e->val, e->alloc);
+  }
+
+#ifdef _SEXP_THREADS_
+  pthread_mutex_destroy(&t->lock);
+#endif
+
+  sexp_free(t->slots, t->cap * sizeof(intern_ent_t));
+  sexp_free(t, sizeof(sexp_intern_t));
+}
+
+size_t
+sexp_intern_count (sexp_intern_t * t)
+{
+  size_t n;
+
+  LOCK(t);
+  n = t->count;
+  UNLOCK(t);
+
+  return n;
+}
+
+/**
+ * Make room for another string.  Strings that only the table refers to
+ * are dropped first, and the number of slots is doubled only if the
+ * table is still at least half full after that.  Called with the lock
+ * held.
+ *
+ * A reference count of one cannot go back up behind our back: the only
+ * other ways to take a reference are _lookup, which needs the lock, and
+ * sexp_share_val, which needs an atom that already holds one.
+ */
+static int
+_grow (sexp_intern_t * t)
+{
+  intern_ent_t *slots;
+  intern_ent_t *e;
+  size_t cap = t->cap;
+  size_t live = 0;
+  size_t i, j;
+
+  for (i = 0; i < t->cap; i++) {
+    e = &t->slots[i];
+    if (e->val != NULL &&
+        (e->pinned || SEXP_REF_GET(ENT_REFS(e->val, e->alloc)) > 1))
+      live++;
+  }
+
+  if ((live + 1) > cap/2)
+    cap *= 2;
+
+#ifdef __cplusplus
+  slots = (intern_ent_t *)sexp_calloc(cap, sizeof(intern_ent_t));
+#else
+  slots = sexp_calloc(cap, sizeof(intern_ent_t));
+#endif
+  if (slots == NULL) {
+    sexp_errno = SEXP_ERR_MEMORY;
+    return -1;
+  }
+
+  for (i = 0; i < t->cap; i++) {
+    e = &t->slots[i];
+    if (e->val == NULL)
+      continue;
+    if (!e->pinned && SEXP_REF_GET(ENT_REFS(e->val, e->alloc)) == 1) {
+      sexp_free(e->val, e->alloc);
+      continue;
+    }
+    j = e->hash & (cap - 1);
+    while (slots[j].val != NULL)
+      j = (j + 1) & (cap - 1);
+    slots[j] = *e;
+  }
+
+  sexp_free(t->slots, t->cap * sizeof(intern_ent_t));
+  t->slots = slots;
+  t->cap = cap;
+  t->count = live;
+
+  return 0;
+}
+
+/**
+ * Find the entry for buf, adding it if needed, and take a reference to
+ * its string for the caller.  Called with the lock held.
+ */
+static intern_ent_t *
+_lookup (sexp_intern_t * t, const char *buf, size_t len)
+{
+  size_t h = sexp_hash_bytes(buf, len);
+  size_t i = h & (t->cap - 1);
+  intern_ent_t *e;
+  char *v;
+
+  for (e = &t->slots[i]; e->val != NULL; e = &t->slots[i]) {
+    if (e->hash == h && e->len == len && memcmp(e->val, buf, len) == 0) {
+      SEXP_REF_INC(ENT_REFS(e->val, e->alloc));
+      return e;
+    }
+    i = (i + 1) & (t->cap - 1);
+  }
+
+  if ((t->count + 1) > t->cap/4*3) {
+    if (_grow(t) != 0)
+      return NULL;
+    i = h & (t->cap - 1);
+    while (t->slots[i].val != NULL)
+      i = (i + 1) & (t->cap - 1);
+    e = &t->slots[i];
+  }
+
+#ifdef __cplusplus
+  v = (char *)sexp_malloc(ENT_ALLOC(len));
+#else
+  v = sexp_malloc(ENT_ALLOC(len));
+#endif
+  if (v == NULL) {
+    sexp_errno = SEXP_ERR_MEMORY;
+    return NULL;
+  }
+
+  memcpy(v, buf, len);
+  v[len] = '\0';
+  *ENT_HASH(v, ENT_ALLOC(len)) = h;
+  /* one reference for the table and one for the caller. */
+  *ENT_REFS(v, ENT_ALLOC(len)) = 2;
+
+  e->val = v;
+  e->len = len;
+  e->alloc = ENT_ALLOC(len);
+  e->hash = h;
+  e->pinned = 0;
+  t->count++;
+
+  return e;
+}
+
+const char *
+sexp_intern (sexp_intern_t * t, const char *buf, size_t len)
+{
+  intern_ent_t *e;
+  const char *v = NULL;
+
+  if (t == NULL || buf == NULL) {
+    sexp_errno = SEXP_ERR_BAD_PARAM;
+    return NULL;
+  }
+
+  LOCK(t);
+  e = _lookup(t, buf, len);
+  if (e != NULL) {
+    v = e->val;
+    /* the table's own reference keeps the string alive; pinning it
+       stops _grow from dropping it once no atom uses it. */
+    e->pinned = 1;
+    SEXP_REF_DEC(ENT_REFS(e->val, e->alloc));
+  }
+  UNLOCK(t);
+
+  return v;
+}
+
+int
+sexp_intern_val (sexp_intern_t * t, sexp_t * sx, const char *buf, size_t len)
+{
+  intern_ent_t *e;
+  char *v = NULL;
+  size_t alloc = 0;
+
+  if (t == NULL || sx == NULL || buf == NULL || sx->ty != SEXP_VALUE ||
+      sx->aty == SEXP_BINARY || (sx->flags & SEXP_FLAG_ARENA)) {
+    sexp_errno = SEXP_ERR_BAD_PARAM;
+    return -1;
+  }
+
+  LOCK(t);
+  e = _lookup(t, buf, len);
+  if (e != NULL) {
+    v = e->val;
+    alloc = e->alloc;
+  }
+  UNLOCK(t);
+
+  if (e == NULL)
+    return -1;
+
+  /* buf may be sx's own text, so it is only dropped now. */
+  sexp_release_val(sx);
+
+  sx->val = v;
+  sx->val_used = len + 1;
+  sx->val_allocated = alloc;
+  sx->flags |= SEXP_FLAG_INTERNED | SEXP_FLAG_SHARED_VAL;
+
+  return 0;
+}
+
+sexp_t *
+new_sexp_interned_atom (sexp_intern_t * t, const char *buf, size_t bs)
+{
+  sexp_t *sx = sexp_t_allocate();
+
+  if (sx == NULL) {
+    sexp_errno = SEXP_ERR_MEMORY;
+    return NULL;
+  }
+
+  sx->ty = SEXP_VALUE;
+  sx->aty = SEXP_BASIC;
+  sx->list = sx->next = NULL;
+  sx->val = NULL;
+  sx->val_used = sx->val_allocated = 0;
+  sx->bindata = NULL;
+  sx->binlength = 0;
+
+  if (sexp_intern_val(t, sx, buf, bs) != 0) {
+    sexp_t_deallocate(sx);
+    return NULL;
+  }
+
+  return sx;
+}
@@ -0,0 +1,137 @@
+/**
+   @cond IGNORE
+
+   ======================================================
+   SFSEXP: Small, Fast S-Expression Library
+   Written by Matthew Sottile (mjsottile@gmail.com)
+   ======================================================
+
+   Copyright (2003-2006). The Regents of the University of California. This
+   material was produced under U.S. Government contract W-7405-ENG-36 for Los
+   Alamos National Laboratory, which is operated by the University of
+   California for the U.S. Department of Energy. The U.S. Government has rights
+   to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+   THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+   LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+   derivative works, such modified software should be clearly marked, so as not
+   to confuse it with the version available from LANL.
+
+   Additionally, this library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of the
+   License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+   LA-CC-04-094
+
+   @endcond
+**/
+#ifndef __SEXP_INTERN_H__
+#define __SEXP_INTERN_H__
+
+/**
+ * \file sexp_intern.h
+ *
+ * \brief Intern tables: one shared, immutable copy of each distinct atom.
+ *
+ * A continuation with an intern table attached (the intern field of
+ * pcont_t) gives every basic atom it parses the table's copy of the atom
+ * text instead of a buffer of its own.  Equal interned atoms then have
+ * equal val pointers, and the table stores a hash of each string next to
+ * it, so comparing an interned atom against a string that differs costs
+ * one integer comparison.  Interned strings are shared atom buffers (see
+ * sexp_share_val) and stay valid as long as any atom refers to them, even
+ * after the table is destroyed.  The table does not keep strings alive on
+ * its own behalf: when it fills up, strings no atom refers to any more
+ * are dropped before it grows, so a table fed by a long-running stream
+ * of distinct atoms stays proportional to the strings in use rather than
+ * to every string it has ever seen.  A table may be used by several
+ * continuations at once; when the library is built with thread support,
+ * lookups are serialized by a lock in the table.
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /* sexp_t, defined in sexp.h */
+  struct elt;
+
+  /**
+   * An intern table.  The contents are private to sexp_intern.c.
+   */
+  typedef struct sexp_intern sexp_intern_t;
+
+  /**
+   * The hash of the text of an atom flagged SEXP_FLAG_INTERNED, as stored by
+   * its intern table.  The hash is sexp_hash_bytes of the text without the
+   * terminating nul.  Not meaningful for other atoms.
+   */
+#define sexp_interned_hash(sx) \
+  (*(const size_t *)((sx)->val + (sx)->val_allocated - 2*sizeof(size_t)))
+
+  /**
+   * Hash \a len bytes at \a buf.  This is the hash used by intern tables.
+   */
+  size_t sexp_hash_bytes(const char *buf, size_t len);
+
+  /**
+   * Create an empty intern table with room for about \a size strings
+   * before it has to grow.  A size of zero selects a default.  Returns NULL
+   * and sets sexp_errno on failure.
+   */
+  sexp_intern_t *new_sexp_intern(size_t size);
+
+  /**
+   * Destroy an intern table.  Strings still used by atoms stay valid until
+   * the last such atom is destroyed.
+   */
+  void destroy_sexp_intern(sexp_intern_t *t);
+
+  /**
+   * Number of distinct strings in the table.  This includes strings no
+   * atom uses any more that have not been dropped yet.
+   */
+  size_t sexp_intern_count(sexp_intern_t *t);
+
+  /**
+   * Return the table's copy of the \a len bytes at \a buf, adding it if it
+   * is not in the table yet.  The copy is nul terminated and must not be
+   * modified.  The string is pinned: unlike strings only atoms use, it is
+   * kept until the table is destroyed and remains valid until then.  Pass
+   * it to find_sexp to search by pointer.  Returns NULL and sets sexp_errno
+   * on failure.
+   */
+  const char *sexp_intern(sexp_intern_t *t, const char *buf, size_t len);
+
+  /**
+   * Point the atom \a sx at the table's copy of the \a len bytes at \a buf
+   * and flag it SEXP_FLAG_INTERNED and SEXP_FLAG_SHARED_VAL.  Any val
+   * buffer sx had before is dropped.  Returns 0, or -1 with sexp_errno set
+   * (sx is unchanged in that case).
+   */
+  int sexp_intern_val(sexp_intern_t *t, struct elt *sx,
+                      const char *buf, size_t len);
+
+  /**
+   * Create a basic atom holding the table's copy of the \a bs bytes at
+   * \a buf.  Returns NULL and sets sexp_errno on failure.
+   */
+  struct elt *new_sexp_interned_atom(sexp_intern_t *t,
+                                     const char *buf, size_t bs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SEXP_INTERN_H__ */
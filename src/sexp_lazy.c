@@ -0,0 +1,442 @@
+/**
+   @cond IGNORE
+
+   ======================================================
+   SFSEXP: Small, Fast S-Expression Library
+   Written by Matthew Sottile (mjsottile@gmail.com)
+   ======================================================
+
+   Copyright (2003-2006). The Regents of the University of California. This
+   material was produced under U.S. Government contract W-7405-ENG-36 for Los
+   Alamos National Laboratory, which is operated by the University of
+   California for the U.S. Department of Energy. The U.S. Government has rights
+   to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+   THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+   LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+   derivative works, such modified software should be clearly marked, so as not
+   to confuse it with the version available from LANL.
+
+   Additionally, this library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of the
+   License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+   LA-CC-04-094
+
+   @endcond
+**/
+#include <stdlib.h>
+#include <string.h>
+#include "sexp.h"
+
+#define NO_ENT ((size_t) -1)
+
+/*
+ * the structural index has an entry for each list of the text, in the
+ * order the lists open.  The lists inside entry i start at entry i+1,
+ * and the one after i at entry next.
+ */
+typedef struct lazy_ent {
+  size_t open;    /* offset of the open paren */
+  size_t close;   /* offset of the matching close paren */
+  size_t next;    /* entry of the next list that is not inside this one */
+} lazy_ent_t;
+
+/*
+ * the text and index of an expression, shared by its lazy lists.  A lazy
+ * list keeps its document in bindata and its entry in val_allocated.
+ */
+typedef struct lazy_doc {
+  char *text;
+  size_t len;
+  lazy_ent_t *ents;
+  size_t nents;
+  size_t capents;
+  unsigned int refs;
+} lazy_doc_t;
+
+static void
+_release (lazy_doc_t * d)
+{
+  if (SEXP_REF_DEC(&d->refs) > 0) return;
+
+  if (d->ents != NULL)
+    sexp_free(d->ents, d->capents * sizeof(lazy_ent_t));
+  sexp_free(d->text, d->len + 1);
+  sexp_free(d, sizeof(lazy_doc_t));
+}
+
+/*
+ * the skip functions return the position after the element at p that
+ * the parser would read as one atom, or end if the text ends first.
+ */
+static const char *
+_skip_string (const char *p, const char *end)
+{
+  int esc = 0;
+
+  for (; p < end && *p != '\0'; p++) {
+    if (esc)
+      esc = 0;
+    else if (*p == '\\')
+      esc = 1;
+    else if (*p == '\"')
+      return p + 1;
+  }
+
+  return p;
+}
+
+static const char *
+_skip_atom (const char *p, const char *end, int esc)
+{
+  for (; p < end; p++) {
+    if (esc && (*p == '\"' || *p == '(' || *p == ')' ||
+                *p == '\'' || *p == '\\')) {
+      esc = 0;
+      continue;
+    }
+    if (!((*p >= '*' && *p <= '~') || ((unsigned char) *p > 127) ||
+          *p == '!' || (*p >= '#' && *p <= '&')))
+      break;
+    esc = (*p == '\\');
+  }
+
+  return p;
+}
+
+/* p is at the open paren of a single quoted list */
+static const char *
+_skip_quoted (const char *p, const char *end)
+{
+  size_t depth = 0;
+  int esc = 0;
+
+  for (; p < end && *p != '\0'; p++) {
+    if (!esc) {
+      if (*p == '(') {
+        depth++;
+      } else if (*p == ')') {
+        if (--depth == 0) return p + 1;
+      } else if (*p == '\"') {
+        p = _skip_string(p + 1, end) - 1;
+        continue;
+      }
+    }
+    esc = (*p == '\\');
+  }
+
+  return p;
+}
+
+static int
+_add_ent (lazy_doc_t * d, size_t open, size_t parent)
+{
+  lazy_ent_t *e;
+  size_t cap;
+
+  if (d->nents == d->capents) {
+    cap = (d->capents == 0) ? 64 : 2 * d->capents;
+#ifdef __cplusplus
+    e = (lazy_ent_t *)sexp_realloc(d->ents, cap * sizeof(lazy_ent_t),
+                                   d->capents * sizeof(lazy_ent_t));
+#else
+    e = sexp_realloc(d->ents, cap * sizeof(lazy_ent_t),
+                     d->capents * sizeof(lazy_ent_t));
+#endif
+    if (e == NULL) {
+      sexp_errno = SEXP_ERR_MEMORY;
+      return -1;
+    }
+    d->ents = e;
+    d->capents = cap;
+  }
+
+  e = &d->ents[d->nents++];
+  e->open = open;
+  e->close = 0;
+  e->next = parent;   /* until the list closes */
+
+  return 0;
+}
+
+/*
+ * index the lists of the expression whose open paren is at start.
+ * Returns 0, or -1 with sexp_errno set.
+ */
+static int
+_index (lazy_doc_t * d, const char *start)
+{
+  const char *p = start, *end = d->text + d->len;
+  size_t cur = NO_ENT, e;
+
+  while (p < end && *p != '\0') {
+    switch (*p) {
+    case ' ':
+    case '\t':
+    case '\n':
+    case '\r':
+      p++;
+      break;
+    case ';':
+      while (p < end && *p != '\n' && *p != '\0') p++;
+      break;
+    case '(':
+      if (_add_ent(d, (size_t) (p - d->text), cur) != 0) return -1;
+      cur = d->nents - 1;
+      p++;
+      break;
+    case ')':
+      e = cur;
+      cur = d->ents[e].next;
+      d->ents[e].close = (size_t) (p - d->text);
+      d->ents[e].next = d->nents;
+      if (cur == NO_ENT) return 0;
+      p++;
+      break;
+    case '\"':
+      p = _skip_string(p + 1, end);
+      break;
+    case '\'':
+      p++;
+      if (p < end && *p == '(')
+        p = _skip_quoted(p, end);
+      else if (p < end && *p == '\"')
+        p = _skip_string(p + 1, end);
+      else
+        p = _skip_atom(p, end, 0);
+      break;
+    default:
+      /* the first character always belongs to the atom */
+      p = _skip_atom(p + 1, end, *p == '\\');
+    }
+  }
+
+  sexp_errno = SEXP_ERR_INCOMPLETE;
+  return -1;
+}
+
+static sexp_t *
+_lazy_node (lazy_doc_t * d, size_t e)
+{
+  sexp_t *sx = sexp_t_allocate();
+
+  if (sx == NULL) return NULL;
+
+  sx->ty = SEXP_LIST;
+  sx->list = sx->next = NULL;
+  sx->flags = SEXP_FLAG_LAZY;
+  sx->val = d->text + d->ents[e].open;
+  sx->val_used = d->ents[e].close - d->ents[e].open + 1;
+  sx->val_allocated = e;
+  sx->bindata = (char *) d;
+  SEXP_REF_INC(&d->refs);
+
+  return sx;
+}
+
+sexp_t *
+parse_sexp_lazy (const char *s, size_t len)
+{
+  lazy_doc_t *d;
+  const char *p, *end = s + len;
+  sexp_t *sx;
+
+  if (s == NULL || len == 0) {
+    sexp_errno = SEXP_ERR_BAD_PARAM;
+    return NULL;
+  }
+
+  /* find the start of the expression */
+  for (p = s; p < end && *p != '\0'; p++) {
+    if (*p == ';') {
+      while (p < end && *p != '\n' && *p != '\0') p++;
+      if (p == end || *p == '\0') break;
+    } else if (*p != ' ' && *p != '\t' && *p != '\n' && *p != '\r') {
+      break;
+    }
+  }
+
+  if (p == end || *p == '\0') {
+    sexp_errno = SEXP_ERR_INCOMPLETE;
+    return NULL;
+  }
+  if (*p == ')') {
+    sexp_errno = SEXP_ERR_BADFORM;
+    return NULL;
+  }
+  if (*p != '(')
+    return parse_sexp((char *) s, len);
+
+#ifdef __cplusplus
+  d = (lazy_doc_t *)sexp_calloc(1, sizeof(lazy_doc_t));
+#else
+  d = sexp_calloc(1, sizeof(lazy_doc_t));
+#endif
+  if (d == NULL) {
+    sexp_errno = SEXP_ERR_MEMORY;
+    return NULL;
+  }
+
+#ifdef __cplusplus
+  d->text = (char *)sexp_malloc(len + 1);
+#else
+  d->text = sexp_malloc(len + 1);
+#endif
+  if (d->text == NULL) {
+    sexp_free(d, sizeof(lazy_doc_t));
+    sexp_errno = SEXP_ERR_MEMORY;
+    return NULL;
+  }
+  memcpy(d->text, s, len);
+  d->text[len] = '\0';
+  d->len = len;
+  d->refs = 1;
+
+  sx = NULL;
+  if (_index(d, d->text + (p - s)) == 0)
+    sx = _lazy_node(d, 0);
+
+  _release(d);
+
+  if (sx != NULL)
+    sexp_errno = SEXP_ERR_OK;
+
+  return sx;
+}
+
+/*
+ * build the elements of the lazy list sx.  Atoms are read by the parser;
+ * the lists among them become lazy lists found through the index.
+ */
+static int
+_force (sexp_t * sx)
+{
+  lazy_doc_t *d = (lazy_doc_t *) sx->bindata;
+  size_t e = sx->val_allocated;
+  size_t pos = d->ents[e].open + 1, close = d->ents[e].close;
+  size_t kid = e + 1;
+  sexp_t *fst = NULL, *lst = NULL, *el;
+  pcont_t *cc = NULL;
+  char c;
+
+  while (pos < close) {
+    c = d->text[pos];
+
+    if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+      pos++;
+      continue;
+    }
+
+    if (c == ';') {
+      while (pos < close && d->text[pos] != '\n') pos++;
+      continue;
+    }
+
+    if (c == '(') {
+      el = _lazy_node(d, kid);
+      if (el == NULL) break;
+      pos = d->ents[kid].close + 1;
+      kid = d->ents[kid].next;
+    } else {
+      if (cc == NULL) {
+        cc = init_continuation(NULL);
+        if (cc == NULL) break;
+      }
+
+      /* the close paren of sx ends an atom that runs up to it */
+      cc->lastPos = NULL;
+      cparse_sexp(d->text + pos, close + 1 - pos, cc);
+      el = cc->last_sexp;
+      cc->last_sexp = NULL;
+      if (el == NULL) {
+        if (sexp_errno == SEXP_ERR_OK) sexp_errno = SEXP_ERR_BADFORM;
+        break;
+      }
+      pos = (size_t) (cc->lastPos - d->text);
+    }
+
+    if (fst == NULL)
+      fst = el;
+    else
+      lst->next = el;
+    lst = el;
+  }
+
+  if (cc != NULL) destroy_continuation(cc);
+
+  if (pos < close) {
+    destroy_sexp(fst);
+    return -1;
+  }
+
+  sx->list = fst;
+  sx->flags &= ~SEXP_FLAG_LAZY;
+  sx->val = NULL;
+  sx->val_used = sx->val_allocated = 0;
+  sx->bindata = NULL;
+  _release(d);
+
+  return 0;
+}
+
+sexp_t *
+sexp_lazy_list (sexp_t * sx)
+{
+  if (sx == NULL || sx->ty != SEXP_LIST) {
+    sexp_errno = SEXP_ERR_BAD_PARAM;
+    return NULL;
+  }
+
+  if ((sx->flags & SEXP_FLAG_LAZY) && _force(sx) != 0)
+    return NULL;
+
+  sexp_errno = SEXP_ERR_OK;
+  return sx->list;
+}
+
+static sexp_walk_t
+_force_visit (sexp_t * sx, unsigned int depth, void *data)
+{
+  if ((sx->flags & SEXP_FLAG_LAZY) && _force(sx) != 0) {
+    *(int *) data = -1;
+    return SEXP_WALK_STOP;
+  }
+
+  return SEXP_WALK_CONTINUE;
+}
+
+int
+sexp_materialize (sexp_t * sx)
+{
+  sexp_errcode_t olderr = sexp_errno;
+  int rc = 0;
+
+  sexp_errno = SEXP_ERR_OK;
+  if (sexp_walk(sx, _force_visit, NULL, &rc) == NULL &&
+      sexp_errno != SEXP_ERR_OK)
+    rc = -1;
+
+  if (rc == 0)
+    sexp_errno = olderr;
+
+  return rc;
+}
+
+void
+sexp_lazy_release (sexp_t * sx)
+{
+  _release((lazy_doc_t *) sx->bindata);
+  sx->flags &= ~SEXP_FLAG_LAZY;
+  sx->bindata = NULL;
+  sx->val = NULL;
+}
@@ -0,0 +1,106 @@
+/**
+   @cond IGNORE
+
+   ======================================================
+   SFSEXP: Small, Fast S-Expression Library
+   Written by Matthew Sottile (mjsottile@gmail.com)
+   ======================================================
+
+   Copyright (2003-2006). The Regents of the University of California. This
+   material was produced under U.S. Government contract W-7405-ENG-36 for Los
+   Alamos National Laboratory, which is operated by the University of
+   California for the U.S. Department of Energy. The U.S. Government has rights
+   to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+   THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+   LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+   derivative works, such modified software should be clearly marked, so as not
+   to confuse it with the version available from LANL.
+
+   Additionally, this library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of the
+   License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+   LA-CC-04-094
+
+   @endcond
+**/
+#ifndef __SEXP_LAZY_H__
+#define __SEXP_LAZY_H__
+
+/**
+ * \file sexp_lazy.h
+ *
+ * \brief Lazy parsing: build the elements of a list when they are needed.
+ *
+ * parse_sexp_lazy checks an expression and indexes where each of its
+ * lists starts and ends, but does not build anything besides the
+ * outermost list.  A lazy list (SEXP_FLAG_LAZY set) has no elements yet:
+ * its val and val_used give its source text, and the first call of
+ * sexp_lazy_list on it parses that one level, leaving the lists inside it
+ * lazy in turn.  Looking at the head of a large message therefore costs
+ * one scan of the text and the atoms of its outermost list.
+ *
+ * A lazy list is never taken for an empty one.  The printers print its
+ * source text, so it can be passed on without being built.  sexp_walk,
+ * and so the functions built on it (copy_sexp, sexp_hash, find_sexp,
+ * the matchers and queries), build it before looking at it, as do
+ * sexp_length, sexp_equal, bfs_find_sexp, sexp_index, the cursors and
+ * the alists; these fail with sexp_errno set if it cannot be built.
+ * Code that reads sx->list itself must call sexp_lazy_list or
+ * sexp_materialize first.  Building the elements of a list modifies
+ * it, so a lazy expression must not be read by several threads at once
+ * until it has been materialized.
+ */
+
+#include "sexp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /**
+   * Parse the first expression in the \a len bytes at \a s lazily.  The
+   * text is copied, so \a s may be reused as soon as this returns.  An
+   * expression that is not a list is parsed as by parse_sexp.  Returns
+   * NULL and sets sexp_errno on failure: SEXP_ERR_INCOMPLETE if the text
+   * ends before the expression does, SEXP_ERR_BADFORM if it starts with a
+   * close paren.
+   */
+  sexp_t *parse_sexp_lazy(const char *s, size_t len);
+
+  /**
+   * The first element of the list \a sx, building the elements of sx
+   * first if it is lazy.  Returns NULL for an empty list, and NULL with
+   * sexp_errno set if the elements could not be built, in which case sx
+   * stays lazy.
+   */
+  sexp_t *sexp_lazy_list(sexp_t *sx);
+
+  /**
+   * Build every lazy list in \a sx and the elements on its next chain,
+   * so the expression can be used like any other.  Returns 0, or -1 with
+   * sexp_errno set.
+   */
+  int sexp_materialize(sexp_t *sx);
+
+  /**
+   * Used by destroy_sexp: let go of the source text of the lazy list
+   * \a sx.
+   */
+  void sexp_lazy_release(sexp_t *sx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SEXP_LAZY_H__ */
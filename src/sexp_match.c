@@ -0,0 +1,458 @@
+/**
+   @cond IGNORE
+
+   ======================================================
+   SFSEXP: Small, Fast S-Expression Library
+   Written by Matthew Sottile (mjsottile@gmail.com)
+   ======================================================
+
+   Copyright (2003-2006). The Regents of the University of California. This
+   material was produced under U.S. Government contract W-7405-ENG-36 for Los
+   Alamos National Laboratory, which is operated by the University of
+   California for the U.S. Department of Energy. The U.S. Government has rights
+   to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+   THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+   LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+   derivative works, such modified software should be clearly marked, so as not
+   to confuse it with the version available from LANL.
+
+   Additionally, this library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of the
+   License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+   LA-CC-04-094
+
+   @endcond
+**/
+#include <stdlib.h>
+#include <string.h>
+#include "sexp.h"
+
+/*
+ * The automaton has a dead state 0, where a trie walk ends when no name
+ * continues with the next byte, and the root state 1.  delta holds the
+ * transitions, nclasses of them for each state.  Each state's matches are
+ * a list of names threaded through outs by index plus one, so that 0
+ * ends a list; for substring matching a state's list continues with the
+ * list of its failure state, so it has every name ending there.
+ */
+
+#define DEAD 0
+#define ROOT 1
+
+#define PATH_SIZE 32
+
+typedef struct match_out {
+  unsigned int name;
+  unsigned int next;
+} match_out_t;
+
+struct sexp_matcher {
+  sexp_match_mode_t mode;
+  size_t n;
+  unsigned char cls[256];
+  unsigned int nclasses;
+  unsigned int nstates;
+  unsigned int maxstates;
+  unsigned int *delta;
+  unsigned int *out;
+  match_out_t *outs;
+};
+
+/**
+ * Fill in the missing transitions of a trie so that it finds names
+ * anywhere in the text (Aho-Corasick), states in breadth-first order.
+ */
+static int
+_add_failures (sexp_matcher_t * m)
+{
+  unsigned int *fail, *queue;
+  unsigned int head = 0, tail = 0;
+  unsigned int s, t, f, c, o;
+  size_t sz = m->maxstates * sizeof(unsigned int);
+
+#ifdef __cplusplus
+  fail = (unsigned int *)sexp_malloc(sz);
+  queue = (unsigned int *)sexp_malloc(sz);
+#else
+  fail = sexp_malloc(sz);
+  queue = sexp_malloc(sz);
+#endif
+  if (fail == NULL || queue == NULL) {
+    if (fail != NULL) sexp_free(fail, sz);
+    if (queue != NULL) sexp_free(queue, sz);
+    sexp_errno = SEXP_ERR_MEMORY;
+    return -1;
+  }
+
+  fail[ROOT] = ROOT;
+  queue[tail++] = ROOT;
+
+  while (head < tail) {
+    s = queue[head++];
+    for (c = 0; c < m->nclasses; c++) {
+      t = m->delta[s * m->nclasses + c];
+      f = (s == ROOT) ? ROOT : m->delta[fail[s] * m->nclasses + c];
+      if (t == DEAD) {
+        m->delta[s * m->nclasses + c] = f;
+        continue;
+      }
+
+      fail[t] = f;
+      queue[tail++] = t;
+
+      /* names ending at t include those ending at its failure state. */
+      if (m->out[t] == 0) {
+        m->out[t] = m->out[f];
+      } else {
+        for (o = m->out[t]; m->outs[o-1].next != 0; o = m->outs[o-1].next)
+          ;
+        m->outs[o-1].next = m->out[f];
+      }
+    }
+  }
+
+  sexp_free(fail, sz);
+  sexp_free(queue, sz);
+
+  return 0;
+}
+
+sexp_matcher_t *
+new_sexp_matcher (const char **names, size_t n, sexp_match_mode_t mode)
+{
+  sexp_matcher_t *m;
+  size_t total = 0;
+  size_t i, j, len;
+  unsigned int s, *d;
+  unsigned char b;
+
+  if (names == NULL && n > 0) {
+    sexp_errno = SEXP_ERR_BAD_PARAM;
+    return NULL;
+  }
+
+#ifdef __cplusplus
+  m = (sexp_matcher_t *)sexp_calloc(1, sizeof(sexp_matcher_t));
+#else
+  m = sexp_calloc(1, sizeof(sexp_matcher_t));
+#endif
+  if (m == NULL) {
+    sexp_errno = SEXP_ERR_MEMORY;
+    return NULL;
+  }
+
+  m->mode = mode;
+  m->n = n;
+
+  /* byte classes: class 0 for bytes in no name.  Names have no nul
+     bytes, so there are at most 256 classes. */
+  m->nclasses = 1;
+  for (i = 0; i < n; i++) {
+    if (names[i] == NULL) {
+      destroy_sexp_matcher(m);
+      sexp_errno = SEXP_ERR_BAD_PARAM;
+      return NULL;
+    }
+    for (j = 0; names[i][j] != '\0'; j++) {
+      b = (unsigned char) names[i][j];
+      if (m->cls[b] == 0)
+        m->cls[b] = (unsigned char) m->nclasses++;
+    }
+    total += j;
+  }
+
+  /* the dead state, the root, and at most one state per name byte. */
+  m->maxstates = (unsigned int) (total + 2);
+
+#ifdef __cplusplus
+  m->delta = (unsigned int *)sexp_calloc((size_t) m->maxstates * m->nclasses,
+                                         sizeof(unsigned int));
+  m->out = (unsigned int *)sexp_calloc(m->maxstates, sizeof(unsigned int));
+  m->outs = (match_out_t *)sexp_calloc(n + 1, sizeof(match_out_t));
+#else
+  m->delta = sexp_calloc((size_t) m->maxstates * m->nclasses,
+                         sizeof(unsigned int));
+  m->out = sexp_calloc(m->maxstates, sizeof(unsigned int));
+  m->outs = sexp_calloc(n + 1, sizeof(match_out_t));
+#endif
+  if (m->delta == NULL || m->out == NULL || m->outs == NULL) {
+    destroy_sexp_matcher(m);
+    sexp_errno = SEXP_ERR_MEMORY;
+    return NULL;
+  }
+
+  /* the trie, of the names reversed when matching suffixes. */
+  m->nstates = 2;
+  for (i = 0; i < n; i++) {
+    len = strlen(names[i]);
+    s = ROOT;
+    for (j = 0; j < len; j++) {
+      b = (unsigned char) names[i][(mode == SEXP_MATCH_SUFFIX) ?
+                                   len - 1 - j : j];
+      d = &m->delta[s * m->nclasses + m->cls[b]];
+      if (*d == DEAD)
+        *d = m->nstates++;
+      s = *d;
+    }
+    m->outs[i].name = (unsigned int) i;
+    m->outs[i].next = m->out[s];
+    m->out[s] = (unsigned int) i + 1;
+  }
+
+  if (mode == SEXP_MATCH_SUBSTRING && _add_failures(m) != 0) {
+    destroy_sexp_matcher(m);
+    return NULL;
+  }
+
+  return m;
+}
+
+void
+destroy_sexp_matcher (sexp_matcher_t * m)
+{
+  if (m == NULL) return;
+
+  if (m->delta != NULL)
+    sexp_free(m->delta,
+              (size_t) m->maxstates * m->nclasses * sizeof(unsigned int));
+  if (m->out != NULL)
+    sexp_free(m->out, m->maxstates * sizeof(unsigned int));
+  if (m->outs != NULL)
+    sexp_free(m->outs, (m->n + 1) * sizeof(match_out_t));
+
+  sexp_free(m, sizeof(sexp_matcher_t));
+}
+
+/**
+ * match walk state.  path holds the lists enclosing the current element;
+ * it starts out in local and moves to the heap if the expression is
+ * nested deeper than that.  seen[i] is the number of the last atom that
+ * was reported for name i, so each name is reported once per atom.
+ */
+typedef struct match_state {
+  const sexp_matcher_t *m;
+  sexp_match_visitor_t visit;
+  void *data;
+  sexp_t **path;
+  size_t depth;
+  size_t cap;
+  sexp_t *local[PATH_SIZE];
+  size_t *seen;
+  size_t atoms;
+  int count;
+  int stopped;
+} match_state_t;
+
+/**
+ * Report the names on the list starting at outs index o for atom sx.
+ * Returns nonzero if the visitor asked to stop.
+ */
+static int
+_report (match_state_t * ms, sexp_t * sx, unsigned int o)
+{
+  unsigned int name;
+
+  for (; o != 0; o = ms->m->outs[o-1].next) {
+    name = ms->m->outs[o-1].name;
+    if (ms->seen[name] == ms->atoms)
+      continue;
+    ms->seen[name] = ms->atoms;
+    ms->count++;
+    if (ms->visit(sx, name, ms->path, (unsigned int) ms->depth,
+                  ms->data) == SEXP_WALK_STOP)
+      return 1;
+  }
+
+  return 0;
+}
+
+static int
+_scan (match_state_t * ms, sexp_t * sx)
+{
+  const sexp_matcher_t *m = ms->m;
+  char nbuf[SEXP_NUMBER_MAX];
+  const unsigned char *t;
+  unsigned int s = ROOT;
+  size_t i, len;
+
+  t = (const unsigned char *) sexp_atom_text(sx, nbuf, &len);
+
+  switch (m->mode) {
+  case SEXP_MATCH_EXACT:
+    for (i = 0; i < len && s != DEAD; i++)
+      s = m->delta[s * m->nclasses + m->cls[t[i]]];
+    return (s != DEAD) ? _report(ms, sx, m->out[s]) : 0;
+
+  case SEXP_MATCH_PREFIX:
+    if (_report(ms, sx, m->out[s]))
+      return 1;
+    for (i = 0; i < len; i++) {
+      s = m->delta[s * m->nclasses + m->cls[t[i]]];
+      if (s == DEAD)
+        break;
+      if (m->out[s] != 0 && _report(ms, sx, m->out[s]))
+        return 1;
+    }
+    return 0;
+
+  case SEXP_MATCH_SUFFIX:
+    if (_report(ms, sx, m->out[s]))
+      return 1;
+    for (i = len; i > 0; i--) {
+      s = m->delta[s * m->nclasses + m->cls[t[i-1]]];
+      if (s == DEAD)
+        break;
+      if (m->out[s] != 0 && _report(ms, sx, m->out[s]))
+        return 1;
+    }
+    return 0;
+
+  default:
+    if (_report(ms, sx, m->out[s]))
+      return 1;
+    for (i = 0; i < len; i++) {
+      s = m->delta[s * m->nclasses + m->cls[t[i]]];
+      if (m->out[s] != 0 && _report(ms, sx, m->out[s]))
+        return 1;
+    }
+    return 0;
+  }
+}
+
+static sexp_walk_t
+_match_pre (sexp_t * sx, unsigned int depth, void *data)
+{
+  match_state_t *ms = (match_state_t *) data;
+  sexp_t **path;
+
+  if (sx->ty == SEXP_VALUE) {
+    if (sx->aty == SEXP_BINARY)
+      return SEXP_WALK_CONTINUE;
+    ms->atoms++;
+    if (_scan(ms, sx)) {
+      ms->stopped = 1;
+      return SEXP_WALK_STOP;
+    }
+    return SEXP_WALK_CONTINUE;
+  }
+
+  if (ms->depth == ms->cap) {
+    if (ms->path == ms->local) {
+#ifdef __cplusplus
+      path = (sexp_t **)sexp_malloc(2 * ms->cap * sizeof(sexp_t *));
+#else
+      path = sexp_malloc(2 * ms->cap * sizeof(sexp_t *));
+#endif
+      if (path != NULL)
+        memcpy(path, ms->local, ms->depth * sizeof(sexp_t *));
+    } else {
+#ifdef __cplusplus
+      path = (sexp_t **)sexp_realloc(ms->path, 2 * ms->cap * sizeof(sexp_t *),
+                                     ms->cap * sizeof(sexp_t *));
+#else
+      path = sexp_realloc(ms->path, 2 * ms->cap * sizeof(sexp_t *),
+                          ms->cap * sizeof(sexp_t *));
+#endif
+    }
+    if (path == NULL) {
+      sexp_errno = SEXP_ERR_MEMORY;
+      return SEXP_WALK_STOP;
+    }
+    ms->path = path;
+    ms->cap *= 2;
+  }
+
+  ms->path[ms->depth++] = sx;
+
+  return SEXP_WALK_CONTINUE;
+}
+
+static sexp_walk_t
+_match_post (sexp_t * sx, unsigned int depth, void *data)
+{
+  if (sx->ty == SEXP_LIST)
+    ((match_state_t *) data)->depth--;
+
+  return SEXP_WALK_CONTINUE;
+}
+
+int
+sexp_match_multi (const sexp_matcher_t * m, sexp_t * sx,
+                  sexp_match_visitor_t visit, void *data)
+{
+  match_state_t ms;
+  sexp_errcode_t olderr;
+  sexp_t *stop;
+
+  if (m == NULL || visit == NULL) {
+    sexp_errno = SEXP_ERR_BAD_PARAM;
+    return -1;
+  }
+
+  if (sx == NULL || m->n == 0)
+    return 0;
+
+#ifdef __cplusplus
+  ms.seen = (size_t *)sexp_calloc(m->n, sizeof(size_t));
+#else
+  ms.seen = sexp_calloc(m->n, sizeof(size_t));
+#endif
+  if (ms.seen == NULL) {
+    sexp_errno = SEXP_ERR_MEMORY;
+    return -1;
+  }
+
+  ms.m = m;
+  ms.visit = visit;
+  ms.data = data;
+  ms.path = ms.local;
+  ms.depth = 0;
+  ms.cap = PATH_SIZE;
+  ms.atoms = 0;
+  ms.count = 0;
+  ms.stopped = 0;
+
+  olderr = sexp_errno;
+  sexp_errno = SEXP_ERR_OK;
+
+  stop = sexp_walk(sx, _match_pre, _match_post, &ms);
+
+  if (ms.path != ms.local)
+    sexp_free(ms.path, ms.cap * sizeof(sexp_t *));
+  sexp_free(ms.seen, m->n * sizeof(size_t));
+
+  if ((stop != NULL && !ms.stopped) || sexp_errno != SEXP_ERR_OK)
+    return -1;
+
+  sexp_errno = olderr;
+
+  return ms.count;
+}
+
+int
+find_sexp_multi (const char **names, size_t n, sexp_t * sx,
+                 sexp_match_visitor_t visit, void *data)
+{
+  sexp_matcher_t *m;
+  int count;
+
+  m = new_sexp_matcher(names, n, SEXP_MATCH_EXACT);
+  if (m == NULL)
+    return -1;
+
+  count = sexp_match_multi(m, sx, visit, data);
+  destroy_sexp_matcher(m);
+
+  return count;
+}
@@ -0,0 +1,145 @@
+/**
+   @cond IGNORE
+
+   ======================================================
+   SFSEXP: Small, Fast S-Expression Library
+   Written by Matthew Sottile (mjsottile@gmail.com)
+   ======================================================
+
+   Copyright (2003-2006). The Regents of the University of California. This
+   material was produced under U.S. Government contract W-7405-ENG-36 for Los
+   Alamos National Laboratory, which is operated by the University of
+   California for the U.S. Department of Energy. The U.S. Government has rights
+   to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+   THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+   LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+   derivative works, such modified software should be clearly marked, so as not
+   to confuse it with the version available from LANL.
+
+   Additionally, this library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of the
+   License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+   LA-CC-04-094
+
+   @endcond
+**/
+#ifndef __SEXP_MATCH_H__
+#define __SEXP_MATCH_H__
+
+/**
+ * \file sexp_match.h
+ *
+ * \brief Searching for many atom values in one pass.
+ *
+ * A matcher is built once from a set of names and then run over any
+ * number of expressions.  The names are compiled into a single automaton
+ * over byte classes (the bytes that occur in some name each get a class,
+ * all other bytes share one), so each atom is scanned once no matter how
+ * many names there are: a trie for whole-atom, prefix and suffix matches,
+ * and an Aho-Corasick automaton for substring matches.  A built matcher
+ * is only read while matching, so one matcher may be used by several
+ * threads at once.
+ */
+
+#include <stddef.h>
+#include "sexp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /**
+   * How a matcher compares names with atom values.
+   */
+  typedef enum {
+    /**
+     * The atom value is the name.
+     */
+    SEXP_MATCH_EXACT,
+
+    /**
+     * The atom value starts with the name.
+     */
+    SEXP_MATCH_PREFIX,
+
+    /**
+     * The atom value ends with the name.
+     */
+    SEXP_MATCH_SUFFIX,
+
+    /**
+     * The name occurs anywhere in the atom value.
+     */
+    SEXP_MATCH_SUBSTRING
+  } sexp_match_mode_t;
+
+  /**
+   * A compiled set of names.  The contents are private to sexp_match.c.
+   */
+  typedef struct sexp_matcher sexp_matcher_t;
+
+  /**
+   * Called for each atom matching a name.  \a sx is the atom, \a name the
+   * index of the name it matched in the array the matcher was built from,
+   * and \a path the lists containing the atom, outermost first; \a depth
+   * is the number of them.  The path array is only valid during the call.
+   * An atom matching several names is reported once for each of them.
+   * Return SEXP_WALK_STOP to end the search, anything else to go on.
+   */
+  typedef sexp_walk_t (*sexp_match_visitor_t)(sexp_t *sx, size_t name,
+                                              sexp_t **path,
+                                              unsigned int depth,
+                                              void *data);
+
+  /**
+   * Build a matcher for the \a n nul-terminated strings in \a names.  The
+   * strings are copied into the automaton and need not outlive it.
+   * Returns NULL and sets sexp_errno on failure.
+   */
+  sexp_matcher_t *new_sexp_matcher(const char **names, size_t n,
+                                   sexp_match_mode_t mode);
+
+  /**
+   * Destroy a matcher.
+   */
+  void destroy_sexp_matcher(sexp_matcher_t *m);
+
+  /**
+   * Report every text atom of \a sx and the elements on its next chain
+   * that matches one of the names of \a m, in depth-first order, to
+   * \a visit.  Binary atoms are not searched.
+   *
+   * \return The number of matches reported, or -1 with sexp_errno set if
+   *         memory for the search could not be allocated.
+   */
+  int sexp_match_multi(const sexp_matcher_t *m, sexp_t *sx,
+                       sexp_match_visitor_t visit, void *data);
+
+  /**
+   * Search \a sx for atoms equal to any of the \a n strings in \a names,
+   * like find_sexp does for one string, but in a single pass.  This
+   * builds and destroys a matcher on every call; build one with
+   * new_sexp_matcher to search many expressions for the same names, or
+   * to match prefixes, suffixes or substrings.
+   *
+   * \return As for sexp_match_multi.
+   */
+  int find_sexp_multi(const char **names, size_t n, sexp_t *sx,
+                      sexp_match_visitor_t visit, void *data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SEXP_MATCH_H__ */
@@ -39,6 +39,162 @@
 #include <string.h>
 #include "sexp_ops.h"
 
+/**
+ * Build sx if it is a lazy list, so that its elements can be looked at.
+ * They are what the list always held, so this does not change its
+ * value.  Returns 0, or -1 with sexp_errno set.
+ */
+static int
+_build (const sexp_t * sx)
+{
+  if ((sx->flags & SEXP_FLAG_LAZY) &&
+      sexp_lazy_list((sexp_t *) sx) == NULL && sexp_errno != SEXP_ERR_OK)
+    return -1;
+
+  return 0;
+}
+
+/**
+ * Depth-first walk with an explicit stack.  Each stack level holds the list
+ * element whose contents are being walked, so the post-order visitor can be
+ * called on it and the walk can continue with its next element.
+ */
+sexp_t *
+sexp_walk (sexp_t * sx, sexp_visitor_t pre, sexp_visitor_t post, void *data)
+{
+  faststack_t *stack = NULL;
+  stack_lvl_t *lvl;
+  sexp_t *cur = sx;
+  sexp_t *next;
+  sexp_walk_t w;
+
+  while (cur != NULL || (stack != NULL && !empty_stack(stack)))
+    {
+      if (cur == NULL)
+        {
+          /* end of a list's contents: finish the list element itself. */
+          lvl = pop (stack);
+          cur = (sexp_t *) lvl->data;
+          next = cur->next;
+
+          if (post != NULL && post (cur, stack->height, data) == SEXP_WALK_STOP)
+            break;
+
+          cur = next;
+          continue;
+        }
+
+      /* cur->next was prefetched while the element before cur was
+         visited, so reading it is cheap: prefetch what comes after it,
+         two steps ahead of the walk */
+      next = cur->next;
+      if (next != NULL)
+        {
+          sexp_prefetch (next->next);
+          sexp_prefetch (next->list);
+        }
+
+      /* a lazy list is built before the visitors see it, so that it is
+         never walked as an empty list */
+      if (_build (cur) != 0)
+        {
+          destroy_stack (stack);
+          return NULL;
+        }
+
+      w = SEXP_WALK_CONTINUE;
+      if (pre != NULL)
+        w = pre (cur, (stack == NULL) ? 0 : stack->height, data);
+
+      if (w == SEXP_WALK_STOP)
+        break;
+
+      if (cur->ty == SEXP_LIST && cur->list != NULL && w != SEXP_WALK_SKIP)
+        {
+          sexp_prefetch (cur->list);
+
+          if (stack == NULL)
+            {
+              stack = make_stack ();
+              if (stack == NULL)
+                {
+                  sexp_errno = SEXP_ERR_MEMORY;
+                  return NULL;
+                }
+            }
+
+          if (push (stack, cur) == NULL)
+            {
+              destroy_stack (stack);
+              sexp_errno = SEXP_ERR_MEMORY;
+              return NULL;
+            }
+
+          cur = cur->list;
+          continue;
+        }
+
+      next = cur->next;
+
+      if (post != NULL &&
+          post (cur, (stack == NULL) ? 0 : stack->height, data) == SEXP_WALK_STOP)
+        break;
+
+      cur = next;
+    }
+
+  destroy_stack (stack);
+
+  return cur;
+}
+
+/**
+ * The name being searched for by find_sexp and bfs_find_sexp, with its
+ * hash for quick rejection of interned atoms.
+ */
+typedef struct find_key {
+  const char *name;
+  size_t hash;
+} find_key_t;
+
+/**
+ * Does the atom sx have the value in key?  Interned atoms equal to the
+ * name are usually the name itself (when it came from sexp_intern), and
+ * ones that differ from it usually have a different hash.
+ */
+static int
+_atom_matches (const sexp_t * sx, const find_key_t * key)
+{
+  char nbuf[SEXP_NUMBER_MAX];
+
+  if (sx->ty != SEXP_VALUE)
+    return 0;
+
+  if (sx->val == NULL)
+    return (sx->flags & (SEXP_FLAG_INT64 | SEXP_FLAG_DOUBLE)) &&
+      strcmp (sexp_atom_text(sx, nbuf, NULL), key->name) == 0;
+
+  if (sx->val == key->name)
+    return 1;
+
+  if ((sx->flags & SEXP_FLAG_INTERNED) && sexp_interned_hash(sx) != key->hash)
+    return 0;
+
+  return strcmp (sx->val, key->name) == 0;
+}
+
+/**
+ * find_sexp visitor: stop at the first atom whose value matches.
+ */
+static sexp_walk_t
+_find_visit (sexp_t * sx, unsigned int depth, void *data)
+{
+  if (_atom_matches (sx, (const find_key_t *) data))
+    return SEXP_WALK_STOP;
+
+  return SEXP_WALK_CONTINUE;
+}
+
 /**
  * Given an s-expression, find the atom inside of it with the
  * value matching name, and return a reference to it.  If the atom
@@ -47,47 +203,28 @@
 sexp_t *
 find_sexp (const char *name, sexp_t * start)
 {
-  sexp_t *temp;
+  find_key_t key;
 
   if (start == NULL)
     return NULL;
 
-  if (start->ty == SEXP_LIST)
-    {
-      temp = find_sexp (name, start->list);
-      if (temp == NULL)
-        return find_sexp (name, start->next);
-      else
-        return temp;
-    }
-  else
-    {
-      if (start->val != NULL && strcmp (start->val, name) == 0)
-        return start;
-      else
-        return find_sexp (name, start->next);
-    }
+  key.name = name;
+  key.hash = sexp_hash_bytes (name, strlen (name));
 
-  return NULL;			/* shouldn't get here */
+  return sexp_walk (start, _find_visit, NULL, &key);
 }
 
 /**
  * Breadth first search - look at ->next before ->list when seeing list
  * elements of an expression.
  */
-sexp_t *bfs_find_sexp(const char *str, sexp_t *sx) {
+static sexp_t *_bfs_find_sexp(const find_key_t *key, sexp_t *sx) {
   sexp_t *t = sx;
   sexp_t *rt;
 
-  if (sx == NULL) return NULL;
-
   while (t != NULL) {
-    if (t->ty == SEXP_VALUE) {
-      if (t->val != NULL) {
-        if (strcmp(t->val,str) == 0) {
-          return t;
-        }
-      }
+    if (_atom_matches(t, key)) {
+      return t;
     }
 
     t = t->next;
@@ -96,7 +233,9 @@ sexp_t *bfs_find_sexp(const char *str, sexp_t *sx) {
   t = sx;
   while (t != NULL) {
     if (t->ty == SEXP_LIST) {
-      rt = bfs_find_sexp(str,t->list);
+      if (_build(t) != 0)
+        return NULL;
+      rt = _bfs_find_sexp(key,t->list);
       if (rt != NULL) return rt;
     }
 
@@ -106,17 +245,43 @@ sexp_t *bfs_find_sexp(const char *str, sexp_t *sx) {
   return NULL;
 }
 
+sexp_t *bfs_find_sexp(const char *str, sexp_t *sx) {
+  find_key_t key;
+
+  if (sx == NULL) return NULL;
+
+  key.name = str;
+  key.hash = sexp_hash_bytes(str, strlen(str));
+
+  return _bfs_find_sexp(&key, sx);
+}
+
 /**
  * Give the length of a s-expression list.
  */
 int sexp_list_length(const sexp_t *sx) {
-  int len = 0;
+  /* a lazy list that cannot be built has no length */
+  if (sx != NULL && _build(sx) != 0)
+    return -1;
+
+  return (int) sexp_length(sx);
+}
+
+size_t
+sexp_length (const sexp_t * sx)
+{
+  size_t len = 0;
   const sexp_t *t;
 
   if (sx == NULL) return 0;
 
   if (sx->ty == SEXP_VALUE) return 1;
 
+  if (sx->flags & SEXP_FLAG_INDEXED) return sx->binlength;
+
+  if (_build(sx) != 0)
+    return 0;
+
   t = sx->list;
 
   while (t != NULL) {
@@ -126,14 +291,97 @@ int sexp_list_length(const sexp_t *sx) {
   return len;
 }
 
+/*
+ * an indexed list keeps its array of element pointers in bindata, and
+ * the number of elements in binlength.
+ */
+int
+sexp_index (sexp_t * sx)
+{
+  sexp_t **elts = NULL;
+  sexp_t *t;
+  size_t n = 0;
+
+  if (sx == NULL || sx->ty != SEXP_LIST) {
+    sexp_errno = SEXP_ERR_BAD_PARAM;
+    return -1;
+  }
+
+  if ((sx->flags & SEXP_FLAG_LAZY) &&
+      sexp_lazy_list(sx) == NULL && sexp_errno != SEXP_ERR_OK)
+    return -1;
+
+  sexp_unindex(sx);
+
+  for (t = sx->list; t != NULL; t = t->next)
+    n++;
+
+  if (n > 0) {
+#ifdef __cplusplus
+    elts = (sexp_t **)sexp_malloc(n * sizeof(sexp_t *));
+#else
+    elts = sexp_malloc(n * sizeof(sexp_t *));
+#endif
+    if (elts == NULL) {
+      sexp_errno = SEXP_ERR_MEMORY;
+      return -1;
+    }
+
+    for (t = sx->list, n = 0; t != NULL; t = t->next)
+      elts[n++] = t;
+  }
+
+  sx->bindata = (char *) elts;
+  sx->binlength = n;
+  sx->flags |= SEXP_FLAG_INDEXED;
+
+  return 0;
+}
+
+void
+sexp_unindex (sexp_t * sx)
+{
+  if (sx == NULL || !(sx->flags & SEXP_FLAG_INDEXED)) return;
+
+  if (sx->bindata != NULL)
+    sexp_free(sx->bindata, sx->binlength * sizeof(sexp_t *));
+  sx->bindata = NULL;
+  sx->binlength = 0;
+  sx->flags &= ~SEXP_FLAG_INDEXED;
+}
+
+sexp_t *
+sexp_nth (const sexp_t * sx, size_t n)
+{
+  sexp_t *t;
+
+  if (sx == NULL || sx->ty != SEXP_LIST) return NULL;
+
+  if (sx->flags & SEXP_FLAG_INDEXED)
+    return (n < sx->binlength) ? ((sexp_t **) sx->bindata)[n] : NULL;
+
+  if (_build(sx) != 0)
+    return NULL;
+
+  for (t = sx->list; t != NULL && n > 0; n--)
+    t = t->next;
+
+  return t;
+}
+
+/* numeric atoms have no val: their value is in val_allocated and
+   binlength */
+#define NUMERIC(s) (((s)->flags & (SEXP_FLAG_INT64 | SEXP_FLAG_DOUBLE)) != 0)
+
 /**
- * Copy an s-expression.
+ * Copy one element, without its list or next.  Returns NULL and sets
+ * sexp_errno on failure.
  */
-sexp_t *copy_sexp(const sexp_t *s) {
+static sexp_t *
+_copy_elt (const sexp_t * s)
+{
   sexp_t *s_new;
 
-  if (s == NULL) return NULL;
-
   s_new = sexp_t_allocate();
   if (s_new == NULL) {
     sexp_errno = SEXP_ERR_MEMORY;
@@ -185,7 +433,8 @@ sexp_t *copy_sexp(const sexp_t *s) {
 
       /* non-binary */
     } else {
-      if (s->val == NULL && (s->val_used > 0 || s->val_allocated > 0)) {
+      if (s->val == NULL && !NUMERIC(s) &&
+          (s->val_used > 0 || s->val_allocated > 0)) {
         sexp_errno = SEXP_ERR_BADCONTENT;
         sexp_t_deallocate(s_new);
         return NULL;
@@ -193,6 +442,9 @@ sexp_t *copy_sexp(const sexp_t *s) {
 
       s_new->val_used = s->val_used;
       s_new->val_allocated = s->val_allocated;
+      s_new->flags = s->flags & (SEXP_FLAG_INT64 | SEXP_FLAG_DOUBLE);
+      if (s->val == NULL)
+        s_new->binlength = s->binlength; /* the rest of a number */
 
       if (s->val == NULL) {
         s_new->val = NULL;
@@ -213,11 +465,625 @@ sexp_t *copy_sexp(const sexp_t *s) {
         memcpy(s_new->val, s->val, sizeof(char)*s->val_used);
       }
     }
+  }
+
+  return s_new;
+}
+
+/*
+ * arena copies can share the text of atoms whose buffer is either already
+ * shared or owned by the element itself (that is, not part of an arena).
+ */
+#define SHAREABLE(s) \
+  ((s)->aty != SEXP_BINARY && (s)->val != NULL && \
+   (!((s)->flags & SEXP_FLAG_ARENA) || ((s)->flags & SEXP_FLAG_SHARED_VAL)))
+
+/**
+ * copy walk state.  tails is a stack of the link fields (a list field of a
+ * copied list, or a next field of a copied element) that the next copied
+ * element at each depth gets hooked onto.  tail is the one for the top
+ * level chain.  For copies into an arena, elements are taken in order from
+ * run and atom data from bytes; otherwise each element is allocated.
+ */
+typedef struct copy_state {
+  faststack_t *tails;
+  sexp_t **tail;
+  sexp_t *root;
+  sexp_arena_run_t *run;
+  char *bytes;
+  int share;
+} copy_state_t;
+
+/**
+ * size of an arena copy: number of elements, bytes of atom data to copy,
+ * and number of atoms whose buffer will be shared instead.
+ */
+typedef struct copy_size {
+  size_t elts;
+  size_t bytes;
+  size_t shared;
+  int share;
+} copy_size_t;
+
+static sexp_walk_t
+_size_pre (sexp_t * s, unsigned int depth, void *data)
+{
+  copy_size_t *sz = (copy_size_t *) data;
+
+  sz->elts++;
+
+  if (s->ty != SEXP_VALUE)
+    return SEXP_WALK_CONTINUE;
+
+  if (s->aty == SEXP_BINARY) {
+    if (s->bindata == NULL && s->binlength > 0) {
+      sexp_errno = SEXP_ERR_BADCONTENT;
+      return SEXP_WALK_STOP;
+    }
+    if (s->bindata != NULL)
+      sz->bytes += s->binlength;
   } else {
-    s_new->list = copy_sexp(s->list);
+    if (s->val == NULL && !NUMERIC(s) &&
+        (s->val_used > 0 || s->val_allocated > 0)) {
+      sexp_errno = SEXP_ERR_BADCONTENT;
+      return SEXP_WALK_STOP;
+    }
+    if (sz->share && SHAREABLE(s))
+      sz->shared++;
+    else if (s->val != NULL)
+      sz->bytes += s->val_used;
   }
 
-  s_new->next = copy_sexp(s->next);
+  return SEXP_WALK_CONTINUE;
+}
 
-  return s_new;
+/**
+ * Fill in the next element of an arena copy.
+ */
+static sexp_t *
+_place_elt (copy_state_t * cs, sexp_t * s)
+{
+  sexp_t *e = &cs->run->elts[cs->run->count];
+  char *v;
+
+  e->ty = s->ty;
+  e->aty = (s->ty == SEXP_VALUE) ? s->aty : SEXP_BASIC;
+  e->list = e->next = NULL;
+  e->val = NULL;
+  e->val_used = e->val_allocated = 0;
+  e->bindata = NULL;
+  e->binlength = 0;
+  e->flags = SEXP_FLAG_ARENA;
+
+  if (s->ty == SEXP_VALUE) {
+    if (s->aty == SEXP_BINARY) {
+      if (s->bindata != NULL) {
+        memcpy(cs->bytes, s->bindata, s->binlength);
+        e->bindata = cs->bytes;
+        e->binlength = s->binlength;
+        cs->bytes += s->binlength;
+      }
+    } else if (cs->share && SHAREABLE(s)) {
+      v = sexp_share_val(s);
+      if (v == NULL)
+        return NULL;
+      e->val = v;
+      e->val_used = s->val_used;
+      e->val_allocated = s->val_allocated;
+      e->flags |= SEXP_FLAG_SHARED_VAL | (s->flags & SEXP_FLAG_INTERNED);
+    } else if (s->val != NULL) {
+      memcpy(cs->bytes, s->val, s->val_used);
+      e->val = cs->bytes;
+      e->val_used = e->val_allocated = s->val_used;
+      cs->bytes += s->val_used;
+    } else {
+      e->flags |= s->flags & (SEXP_FLAG_INT64 | SEXP_FLAG_DOUBLE);
+      e->val_allocated = s->val_allocated;
+      e->binlength = s->binlength;
+    }
+  }
+
+  cs->run->count++;
+
+  return e;
+}
+
+static sexp_walk_t
+_copy_pre (sexp_t * s, unsigned int depth, void *data)
+{
+  copy_state_t *cs = (copy_state_t *) data;
+  sexp_t ***tail;
+  sexp_t *s_new;
+
+  if (cs->run != NULL)
+    s_new = _place_elt (cs, s);
+  else
+    s_new = _copy_elt (s);
+
+  if (s_new == NULL)
+    return SEXP_WALK_STOP;
+
+  tail = (depth == 0) ? &cs->tail : (sexp_t ***) &top_data (cs->tails);
+  **tail = s_new;
+  *tail = &s_new->next;
+
+  if (s->ty == SEXP_LIST && s->list != NULL) {
+    if (push (cs->tails, &s_new->list) == NULL) {
+      sexp_errno = SEXP_ERR_MEMORY;
+      return SEXP_WALK_STOP;
+    }
+  }
+
+  return SEXP_WALK_CONTINUE;
+}
+
+static sexp_walk_t
+_copy_post (sexp_t * s, unsigned int depth, void *data)
+{
+  copy_state_t *cs = (copy_state_t *) data;
+
+  if (s->ty == SEXP_LIST && s->list != NULL)
+    pop (cs->tails);
+
+  return SEXP_WALK_CONTINUE;
+}
+
+/**
+ * Run a copy walk over s, leaving the copy in cs->root.  Returns 0 on
+ * success, -1 with sexp_errno set on failure, in which case cs->root holds
+ * whatever was copied before the failure.
+ */
+static int
+_copy_walk (copy_state_t * cs, const sexp_t * s)
+{
+  sexp_errcode_t olderr;
+  int err = 0;
+
+  cs->tails = make_stack();
+  if (cs->tails == NULL) {
+    sexp_errno = SEXP_ERR_MEMORY;
+    return -1;
+  }
+
+  cs->root = NULL;
+  cs->tail = &cs->root;
+
+  /* sexp_walk reports a failure to allocate its own stack only through
+     sexp_errno, so clear it first and put back the old value on success. */
+  olderr = sexp_errno;
+  sexp_errno = SEXP_ERR_OK;
+
+  /* the walk only changes s to share atom buffers; the cast is for the
+     visitor signature. */
+  if (sexp_walk((sexp_t *)s, _copy_pre, _copy_post, cs) != NULL ||
+      sexp_errno != SEXP_ERR_OK)
+    err = -1;
+  else
+    sexp_errno = olderr;
+
+  destroy_stack(cs->tails);
+
+  return err;
+}
+
+/**
+ * Copy an s-expression.
+ */
+sexp_t *copy_sexp(const sexp_t *s) {
+  copy_state_t cs;
+
+  if (s == NULL) return NULL;
+
+  cs.run = NULL;
+  cs.bytes = NULL;
+  cs.share = 0;
+
+  if (_copy_walk(&cs, s) != 0) {
+    destroy_sexp(cs.root);
+    return NULL;
+  }
+
+  return cs.root;
+}
+
+/**
+ * Copy into an arena: size the copy with one walk, take all of its memory
+ * in one arena allocation (the run record if atoms are shared, then the
+ * elements in depth-first order, then the atom data), and fill it in with
+ * a second walk.
+ */
+static sexp_t *
+_copy_into (sexp_arena_t * arena, sexp_t * s, int share)
+{
+  copy_state_t cs;
+  copy_size_t sz;
+  sexp_arena_run_t localrun;
+  char *mem;
+  size_t runsize;
+  sexp_errcode_t olderr;
+
+  if (arena == NULL) {
+    sexp_errno = SEXP_ERR_BAD_PARAM;
+    return NULL;
+  }
+
+  if (s == NULL) return NULL;
+
+  sz.elts = sz.bytes = sz.shared = 0;
+  sz.share = share;
+
+  olderr = sexp_errno;
+  sexp_errno = SEXP_ERR_OK;
+  if (sexp_walk(s, _size_pre, NULL, &sz) != NULL ||
+      sexp_errno != SEXP_ERR_OK)
+    return NULL;
+  sexp_errno = olderr;
+
+  runsize = (sz.shared > 0) ? sizeof(sexp_arena_run_t) : 0;
+
+#ifdef __cplusplus
+  mem = (char *)sexp_arena_alloc(arena, runsize + sz.elts*sizeof(sexp_t) +
+                                 sz.bytes);
+#else
+  mem = sexp_arena_alloc(arena, runsize + sz.elts*sizeof(sexp_t) + sz.bytes);
+#endif
+  if (mem == NULL)
+    return NULL;
+
+  /* runs holding shared buffers are registered before anything is placed,
+     so the arena drops the references taken even if the copy fails. */
+  if (runsize > 0) {
+    cs.run = (sexp_arena_run_t *)mem;
+    cs.run->next = arena->runs;
+    arena->runs = cs.run;
+  } else {
+    cs.run = &localrun;
+  }
+
+  cs.run->elts = (sexp_t *)(mem + runsize);
+  cs.run->count = 0;
+  cs.bytes = mem + runsize + sz.elts*sizeof(sexp_t);
+  cs.share = share;
+
+  if (_copy_walk(&cs, s) != 0)
+    return NULL;
+
+  return cs.root;
+}
+
+sexp_t *copy_sexp_into(sexp_arena_t *arena, const sexp_t *s) {
+  /* without sharing the source is only read. */
+  return _copy_into(arena, (sexp_t *)s, 0);
+}
+
+sexp_t *share_sexp_into(sexp_arena_t *arena, sexp_t *s) {
+  return _copy_into(arena, s, 1);
+}
+
+/*
+ * structural hashing.  A list's hash folds the hashes of its elements in
+ * order into a seed; an atom's hash is that of its bytes mixed with its
+ * type.
+ */
+
+#define HASH_MIX(h, v) \
+  ((h) ^ ((v) + (size_t) 0x9e3779b97f4a7c15ULL + ((h) << 6) + ((h) >> 2)))
+
+#define HASH_LIST_SEED ((size_t) 0x6c697374UL)
+
+#define HASH_STACK_SIZE 32
+
+/* a list has no text, so its cached hash is kept in val_allocated; atoms
+   are hashed again each time, from the table for interned ones */
+#define CACHED_HASH(s) ((s)->val_allocated)
+
+static size_t
+_atom_hash (const sexp_t * s)
+{
+  char nbuf[SEXP_NUMBER_MAX];
+  const char *t;
+  size_t h, len;
+
+  if (s->aty == SEXP_BINARY)
+    h = sexp_hash_bytes(s->bindata, (s->bindata != NULL) ? s->binlength : 0);
+  else if (s->flags & SEXP_FLAG_INTERNED)
+    h = sexp_interned_hash(s);
+  else {
+    t = sexp_atom_text(s, nbuf, &len);
+    h = sexp_hash_bytes(t, len);
+  }
+
+  return HASH_MIX(h, (size_t) s->aty + 1);
+}
+
+/**
+ * hash walk state.  acc holds the partial hash of each list being walked,
+ * innermost last; it starts out in local and moves to the heap if the
+ * expression is nested deeper than that.
+ */
+typedef struct hash_state {
+  size_t *acc;
+  size_t n;
+  size_t cap;
+  size_t local[HASH_STACK_SIZE];
+  size_t h;
+  int cache;
+} hash_state_t;
+
+static sexp_walk_t
+_hash_pre (sexp_t * s, unsigned int depth, void *data)
+{
+  hash_state_t *hs = (hash_state_t *) data;
+  size_t *acc;
+
+  if (s->flags & SEXP_FLAG_HASHED)
+    return SEXP_WALK_SKIP;
+
+  if (s->ty != SEXP_LIST)
+    return SEXP_WALK_CONTINUE;
+
+  if (hs->n == hs->cap) {
+    if (hs->acc == hs->local) {
+#ifdef __cplusplus
+      acc = (size_t *)sexp_malloc(2 * hs->cap * sizeof(size_t));
+#else
+      acc = sexp_malloc(2 * hs->cap * sizeof(size_t));
+#endif
+      if (acc != NULL)
+        memcpy(acc, hs->local, hs->n * sizeof(size_t));
+    } else {
+#ifdef __cplusplus
+      acc = (size_t *)sexp_realloc(hs->acc, 2 * hs->cap * sizeof(size_t),
+                                   hs->cap * sizeof(size_t));
+#else
+      acc = sexp_realloc(hs->acc, 2 * hs->cap * sizeof(size_t),
+                         hs->cap * sizeof(size_t));
+#endif
+    }
+    if (acc == NULL) {
+      sexp_errno = SEXP_ERR_MEMORY;
+      return SEXP_WALK_STOP;
+    }
+    hs->acc = acc;
+    hs->cap *= 2;
+  }
+
+  hs->acc[hs->n++] = HASH_LIST_SEED;
+
+  return SEXP_WALK_CONTINUE;
+}
+
+static sexp_walk_t
+_hash_post (sexp_t * s, unsigned int depth, void *data)
+{
+  hash_state_t *hs = (hash_state_t *) data;
+  size_t h;
+
+  if (s->flags & SEXP_FLAG_HASHED) {
+    h = CACHED_HASH(s);
+  } else if (s->ty == SEXP_LIST) {
+    h = hs->acc[--hs->n];
+    if (hs->cache) {
+      CACHED_HASH(s) = h;
+      s->flags |= SEXP_FLAG_HASHED;
+    }
+  } else {
+    h = _atom_hash(s);
+  }
+
+  /* the walk started at sx: stop before going on to sx->next. */
+  if (depth == 0) {
+    hs->h = h;
+    return SEXP_WALK_STOP;
+  }
+
+  hs->acc[hs->n-1] = HASH_MIX(hs->acc[hs->n-1], h);
+
+  return SEXP_WALK_CONTINUE;
+}
+
+static size_t
+_hash (sexp_t * sx, int cache)
+{
+  hash_state_t hs;
+  sexp_errcode_t olderr;
+  sexp_t *stop;
+
+  if (sx == NULL)
+    return 0;
+
+  if (sx->flags & SEXP_FLAG_HASHED)
+    return CACHED_HASH(sx);
+
+  if (sx->ty != SEXP_LIST)
+    return _atom_hash(sx);
+
+  hs.acc = hs.local;
+  hs.n = 0;
+  hs.cap = HASH_STACK_SIZE;
+  hs.h = 0;
+  hs.cache = cache;
+
+  olderr = sexp_errno;
+  sexp_errno = SEXP_ERR_OK;
+
+  stop = sexp_walk(sx, _hash_pre, _hash_post, &hs);
+
+  if (hs.acc != hs.local)
+    sexp_free(hs.acc, hs.cap * sizeof(size_t));
+
+  if (stop != sx || sexp_errno != SEXP_ERR_OK)
+    return 0;
+
+  sexp_errno = olderr;
+
+  return hs.h;
+}
+
+size_t
+sexp_hash (const sexp_t * sx)
+{
+  /* without caching the walk does not modify sx. */
+  return _hash((sexp_t *) sx, 0);
+}
+
+size_t
+sexp_hash_cache (sexp_t * sx)
+{
+  return _hash(sx, 1);
+}
+
+static sexp_walk_t
+_uncache_pre (sexp_t * s, unsigned int depth, void *data)
+{
+  if (depth == 0 && s != (sexp_t *) data)
+    return SEXP_WALK_STOP;
+
+  s->flags &= ~SEXP_FLAG_HASHED;
+
+  return SEXP_WALK_CONTINUE;
+}
+
+void
+sexp_hash_uncache (sexp_t * sx)
+{
+  if (sx != NULL)
+    sexp_walk(sx, _uncache_pre, NULL, sx);
+}
+
+/**
+ * Can a and b be told apart without looking at their contents?  For
+ * lists, that is only if both have cached hashes and they differ.
+ */
+static int
+_differ (const sexp_t * a, const sexp_t * b)
+{
+  char abuf[SEXP_NUMBER_MAX], bbuf[SEXP_NUMBER_MAX];
+  const char *ta, *tb;
+  size_t la, lb;
+
+  if (a->ty != b->ty)
+    return 1;
+
+  if ((a->flags & b->flags & SEXP_FLAG_HASHED) &&
+      CACHED_HASH(a) != CACHED_HASH(b))
+    return 1;
+
+  if (a->ty == SEXP_LIST)
+    return 0;
+
+  if (a->aty != b->aty)
+    return 1;
+
+  if (a->aty == SEXP_BINARY) {
+    la = (a->bindata != NULL) ? a->binlength : 0;
+    lb = (b->bindata != NULL) ? b->binlength : 0;
+    return la != lb || (la > 0 && memcmp(a->bindata, b->bindata, la) != 0);
+  }
+
+  if (a->val == b->val && a->val != NULL)
+    return 0;
+
+  if (a->val == NULL && b->val == NULL &&
+      (a->flags & b->flags & SEXP_FLAG_INT64))
+    return sexp_int64_value(a) != sexp_int64_value(b);
+
+  ta = sexp_atom_text(a, abuf, &la);
+  tb = sexp_atom_text(b, bbuf, &lb);
+
+  if (la != lb)
+    return 1;
+
+  /* different texts of interned atoms rarely have the same hash. */
+  if ((a->flags & b->flags & SEXP_FLAG_INTERNED) &&
+      sexp_interned_hash(a) != sexp_interned_hash(b))
+    return 1;
+
+  return la > 0 && memcmp(ta, tb, la) != 0;
+}
+
+/**
+ * Compare the contents of a and b in step, keeping the pairs of lists
+ * being compared on a stack (b above a).
+ */
+int
+sexp_equal (const sexp_t * a, const sexp_t * b)
+{
+  faststack_t *stack = NULL;
+  stack_lvl_t *lvl;
+  const sexp_t *x, *y;
+  int eq = 0;
+
+  if (a == b)
+    return 1;
+
+  if (a == NULL || b == NULL || _differ(a, b))
+    return 0;
+
+  if (a->ty != SEXP_LIST)
+    return 1;
+
+  if (_build(a) != 0 || _build(b) != 0)
+    return -1;
+
+  x = a->list;
+  y = b->list;
+
+  for (;;) {
+    if (x == NULL || y == NULL) {
+      if (x != y)
+        break;
+
+      /* end of both lists: go back to the lists containing them. */
+      if (stack == NULL || empty_stack(stack)) {
+        eq = 1;
+        break;
+      }
+      lvl = pop(stack);
+      y = (const sexp_t *) lvl->data;
+      lvl = pop(stack);
+      x = (const sexp_t *) lvl->data;
+    } else if (x != y) {
+      if (_differ(x, y))
+        break;
+
+      if (x->ty == SEXP_LIST) {
+        if (_build(x) != 0 || _build(y) != 0) {
+          if (stack != NULL)
+            destroy_stack(stack);
+          return -1;
+        }
+
+        sexp_prefetch(x->list);
+        sexp_prefetch(y->list);
+
+        if (stack == NULL) {
+          stack = make_stack();
+          if (stack == NULL) {
+            sexp_errno = SEXP_ERR_MEMORY;
+            return -1;
+          }
+        }
+
+        if (push(stack, (void *) x) == NULL ||
+            push(stack, (void *) y) == NULL) {
+          destroy_stack(stack);
+          sexp_errno = SEXP_ERR_MEMORY;
+          return -1;
+        }
+
+        x = x->list;
+        y = y->list;
+        continue;
+      }
+    }
+
+    x = x->next;
+    y = y->next;
+  }
+
+  if (stack != NULL)
+    destroy_stack(stack);
+
+  return eq;
 }
@@ -76,10 +76,91 @@ extern "C" {
    */
 #define reset_pcont(c) ((c)->lastPos = NULL)
 
+  /**
+   * Prefetch hint for the element \a p.  Walks over large expressions are
+   * dominated by cache misses on the next and list pointers, so traversal
+   * routines issue this for the elements they are about to visit.  It is
+   * a no-op on compilers without __builtin_prefetch.
+   */
+#ifdef __GNUC__
+#define sexp_prefetch(p) __builtin_prefetch((p))
+#else
+#define sexp_prefetch(p) ((void)(p))
+#endif
+
+  /*=======*/
+  /* TYPES */
+  /*=======*/
+
+  /**
+   * Return value of a visitor called by sexp_walk, telling the walk how to
+   * proceed.
+   */
+  typedef enum {
+    /**
+     * Keep walking.
+     */
+    SEXP_WALK_CONTINUE,
+
+    /**
+     * Returned from a pre-order visitor on a list: do not descend into the
+     * list.  The post-order visitor is still called for it.  Treated as
+     * SEXP_WALK_CONTINUE anywhere else.
+     */
+    SEXP_WALK_SKIP,
+
+    /**
+     * End the walk right away.  sexp_walk returns the element the visitor
+     * was called with.
+     */
+    SEXP_WALK_STOP
+  } sexp_walk_t;
+
+  /**
+   * Visitor called by sexp_walk.  \a sx is the element being visited,
+   * \a depth the number of lists it is nested in relative to where the
+   * walk started, and \a data the pointer passed to sexp_walk.
+   */
+  typedef sexp_walk_t (*sexp_visitor_t)(sexp_t *sx, unsigned int depth,
+                                        void *data);
+
+  /*===========*/
+  /* FUNCTIONS */
+  /*===========*/
+
+  /**
+   * Iterative depth-first walk over an s-expression.  The walk visits
+   * \a sx, the contents of sx if it is a list, and then every element of
+   * the next chain of sx in the same way; this is the same set of elements
+   * that destroy_sexp frees.  \a pre is called on each element before its
+   * contents and \a post after them (for atoms, right after \a pre).
+   * Either visitor may be NULL.  The walk reads the next and list pointers
+   * of an element before calling \a post on it, so a post-order visitor
+   * may free the element it is given.  The walk uses a heap allocated
+   * stack, so nesting depth is not limited by the C stack, and it
+   * prefetches the next and list pointers of each element as it is
+   * visited.
+   *
+   * \param sx    Root element of the walk.
+   * \param pre   Visitor called before the contents of each element.
+   * \param post  Visitor called after the contents of each element.
+   * \param data  Passed through to the visitors.
+   * \return      The element on which a visitor returned SEXP_WALK_STOP,
+   *              or NULL if the walk ran to completion.  If the walk
+   *              could not allocate its stack, NULL is returned and
+   *              sexp_errno is set to SEXP_ERR_MEMORY.
+   */
+  sexp_t *sexp_walk(sexp_t *sx, sexp_visitor_t pre, sexp_visitor_t post,
+                    void *data);
+
   /**
    * Find an atom in a sexpression data structure and return a pointer to
    * it.  Return NULL if the string doesn't occur anywhere as an atom.
-   * This is a depth-first search algorithm.
+   * This is a depth-first search algorithm.  Atoms interned with the same
+   * table as \a name (see sexp_intern) are compared by pointer; other
+   * interned atoms are rejected by their stored hash without looking at
+   * their text.  To look for several names in one pass, see
+   * find_sexp_multi (sexp_match.h).
    *
    * \param name   Value to search for.
    * \param start  Root element of the s-expression to search from.
@@ -94,7 +175,8 @@ extern "C" {
    * the earliest occurrence in the string representation of the expression
    * itself.  Breadth first search will find the first occurrence of a string
    * in relation to the structure of the expression itself (IE: the instance
-   * with the lowest depth will be found).
+   * with the lowest depth will be found).  Atoms are compared as in
+   * find_sexp.
    *
    * \param name  Value to search for.
    * \param start Root element of the s-expression to search from.
@@ -111,14 +193,50 @@ extern "C" {
    *
    * \param sx S-expression input.
    * \return   Number of sexp_t elements at the same level as sx, 0 for
-   *           NULL, 1 for an atom.
+   *           NULL, 1 for an atom, -1 with sexp_errno set for a lazy list
+   *           that could not be built.
    */
   int sexp_list_length(const sexp_t *sx);
 
+  /**
+   * Give a list an index: an array of pointers to its elements, so that
+   * sexp_nth and sexp_length take constant time on it.  An index that is
+   * there already is rebuilt, so call this again after changing the
+   * elements of an indexed list (or drop the index with sexp_unindex);
+   * an index that is out of date gives wrong answers.  destroy_sexp frees
+   * the index with the list.  A lazy list is built first.
+   *
+   * \param sx List to index.
+   * \return   0, or -1 with sexp_errno set: SEXP_ERR_BAD_PARAM if sx is
+   *           not a list, SEXP_ERR_MEMORY if the index could not be
+   *           allocated.
+   */
+  int sexp_index(sexp_t *sx);
+
+  /**
+   * Drop the index of \a sx, if it has one.
+   */
+  void sexp_unindex(sexp_t *sx);
+
+  /**
+   * Element \a n of the list \a sx, counting the head as 0, or NULL if
+   * the list is shorter or sx is not a list.  Constant time if sx is
+   * indexed, linear in n otherwise.
+   */
+  sexp_t *sexp_nth(const sexp_t *sx, size_t n);
+
+  /**
+   * Like sexp_list_length, but constant time if \a sx is indexed, and 0
+   * with sexp_errno set for a lazy list that could not be built.
+   */
+  size_t sexp_length(const sexp_t *sx);
+
   /**
    * Copy an s-expression.  This is a deep copy - so the resulting s-expression
    * shares no pointers with the original.  The new one can be changed without
-   * damaging the contents of the original.
+   * damaging the contents of the original.  Elements that the original
+   * shares between several places (see sexp_hashcons) are copied once for
+   * each place, so the copy is always an ordinary tree.
    *
    * \param sx S-expression to copy.
    * \return   A pointer to a copy of sx.  This is a deep copy, so no memory
@@ -126,8 +244,84 @@ extern "C" {
    */
   sexp_t *copy_sexp(const sexp_t *sx);
 
+  /**
+   * Copy an s-expression into an arena.  The copy is sized up front and
+   * placed in a single arena allocation, elements in depth-first order
+   * followed by the atom data, instead of allocating each element and atom
+   * separately.  The copied elements are flagged SEXP_FLAG_ARENA: they are
+   * freed by destroy_sexp_arena, and destroy_sexp ignores them.  As with
+   * copy_sexp, the elements following sx on its next chain are copied too.
+   *
+   * \param arena Arena to copy into.
+   * \param sx    S-expression to copy.
+   * \return      The copy of sx, or NULL with sexp_errno set on failure.
+   */
+  sexp_t *copy_sexp_into(sexp_arena_t *arena, const sexp_t *sx);
+
+  /**
+   * Like copy_sexp_into, except that text atoms are not copied: the copy
+   * takes a reference to the atom's val buffer (see sexp_share_val), so
+   * only the elements themselves are duplicated.  Buffers of sx that are
+   * not shared yet are converted in place, which is why sx is not const;
+   * its contents do not change.  Converting a buffer is not thread safe,
+   * but once sx has been shared, further shares of it or of its copies may
+   * be made from several threads.  Binary atoms and atoms whose text is
+   * itself part of an arena are copied.
+   *
+   * \param arena Arena to copy into.
+   * \param sx    S-expression to copy.
+   * \return      The copy of sx, or NULL with sexp_errno set on failure.
+   */
+  sexp_t *share_sexp_into(sexp_arena_t *arena, sexp_t *sx);
+
+  /**
+   * Structural hash of an s-expression: the types of its elements, the
+   * atom types and bytes, and how the elements are nested.  Elements that
+   * sexp_equal considers equal have the same hash.  Unlike copy_sexp, only
+   * sx itself is hashed, not the elements following it.  Hashes cached by
+   * sexp_hash_cache are used instead of walking the elements they cover.
+   *
+   * \param sx S-expression to hash.
+   * \return   The hash, or 0 with sexp_errno set if the walk ran out of
+   *           memory.
+   */
+  size_t sexp_hash(const sexp_t *sx);
+
+  /**
+   * Like sexp_hash, but also stores the hash of sx and of every list
+   * inside it in the lists themselves (flagging them SEXP_FLAG_HASHED),
+   * so later calls of sexp_hash and sexp_equal on them are cheap.  This
+   * suits expressions that are no longer modified, such as persistent
+   * ones.  An element that is changed in place afterwards must have its
+   * cached hash, and those of the lists containing it, cleared with
+   * sexp_hash_uncache.  Caching writes to the elements, so it must not
+   * run concurrently with other uses of them.
+   */
+  size_t sexp_hash_cache(sexp_t *sx);
+
+  /**
+   * Clear the hashes cached in sx and the elements inside it.
+   */
+  void sexp_hash_uncache(sexp_t *sx);
+
+  /**
+   * Structural equality: are \a a and \a b lists with equal contents, or
+   * atoms of the same type with the same bytes?  As with sexp_hash, the
+   * elements following a and b are not compared.  Elements shared by both
+   * are not looked into, and elements whose hashes are both cached are
+   * known to differ as soon as the hashes do.
+   *
+   * \return 1 if equal, 0 if not, -1 with sexp_errno set if the traversal
+   *         ran out of memory.
+   */
+  int sexp_equal(const sexp_t *a, const sexp_t *b);
+
 #ifdef __cplusplus
 }
 #endif
 
+/* multi-name search and queries build on the walk types above. */
+#include "sexp_match.h"
+#include "sexp_query.h"
+
 #endif /* __SEXP_OPS_H__ */
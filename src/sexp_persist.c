@@ -0,0 +1,726 @@
+/**
+   @cond IGNORE
+
+   ======================================================
+   SFSEXP: Small, Fast S-Expression Library
+   Written by Matthew Sottile (mjsottile@gmail.com)
+   ======================================================
+
+   Copyright (2003-2006). The Regents of the University of California. This
+   material was produced under U.S. Government contract W-7405-ENG-36 for Los
+   Alamos National Laboratory, which is operated by the University of
+   California for the U.S. Department of Energy. The U.S. Government has rights
+   to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+   THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+   LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+   derivative works, such modified software should be clearly marked, so as not
+   to confuse it with the version available from LANL.
+
+   Additionally, this library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of the
+   License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+   LA-CC-04-094
+
+   @endcond
+**/
+#include <stdlib.h>
+#include <string.h>
+#include "sexp.h"
+
+#ifdef _SEXP_THREADS_
+# include <pthread.h>
+# define LOCK(t)   pthread_mutex_lock(&(t)->lock)
+# define UNLOCK(t) pthread_mutex_unlock(&(t)->lock)
+#else
+# define LOCK(t)
+# define UNLOCK(t)
+#endif
+
+#define PERSISTENT(s) ((s) != NULL && ((s)->flags & SEXP_FLAG_PERSISTENT))
+
+/**
+ * sexp_freeze visitor.
+ */
+static sexp_walk_t
+_freeze_pre (sexp_t * sx, unsigned int depth, void *data)
+{
+  if (sx->flags & SEXP_FLAG_PERSISTENT)
+    return SEXP_WALK_SKIP;
+
+  if (sx->flags & SEXP_FLAG_ARENA) {
+    sexp_errno = SEXP_ERR_BAD_PARAM;
+    return SEXP_WALK_STOP;
+  }
+
+  if (sx->ty == SEXP_VALUE && sx->aty != SEXP_BINARY && sx->val != NULL &&
+      sexp_make_shared_val(sx) == NULL)
+    return SEXP_WALK_STOP;
+
+  sx->flags |= SEXP_FLAG_PERSISTENT;
+  sx->refcount = 1;
+
+  return SEXP_WALK_CONTINUE;
+}
+
+sexp_t *
+sexp_freeze (sexp_t * sx)
+{
+  sexp_errcode_t olderr;
+
+  if (sx == NULL) return NULL;
+
+  olderr = sexp_errno;
+  sexp_errno = SEXP_ERR_OK;
+
+  if (sexp_walk(sx, _freeze_pre, NULL, NULL) != NULL ||
+      sexp_errno != SEXP_ERR_OK)
+    return NULL;
+
+  sexp_errno = olderr;
+
+  return sx;
+}
+
+sexp_t *
+sexp_retain (sexp_t * sx)
+{
+  if (PERSISTENT(sx))
+    SEXP_REF_INC(&sx->refcount);
+
+  return sx;
+}
+
+void
+sexp_release (sexp_t * sx)
+{
+  destroy_sexp(sx);
+}
+
+/**
+ * Make a persistent element with the contents of src, taking over the
+ * references list (used only if src is a list) and next.  On failure
+ * those references are dropped.
+ */
+static sexp_t *
+_pcell (sexp_t * src, sexp_t * list, sexp_t * next)
+{
+  sexp_t *c;
+
+  c = sexp_t_allocate();
+  if (c == NULL) {
+    sexp_errno = SEXP_ERR_MEMORY;
+    destroy_sexp(list);
+    destroy_sexp(next);
+    return NULL;
+  }
+
+  c->ty = src->ty;
+  c->aty = (src->ty == SEXP_VALUE) ? src->aty : SEXP_BASIC;
+  c->list = NULL;
+  c->next = next;
+  c->val = NULL;
+  c->val_used = c->val_allocated = 0;
+  c->bindata = NULL;
+  c->binlength = 0;
+  c->flags = SEXP_FLAG_PERSISTENT;
+  c->refcount = 1;
+
+  if (src->ty == SEXP_LIST) {
+    c->list = list;
+    return c;
+  }
+
+  if (src->aty == SEXP_BINARY) {
+    /* binary data has no room for a count, so it is copied. */
+    if (src->bindata != NULL) {
+#ifdef __cplusplus
+      c->bindata = (char *)sexp_malloc(src->binlength);
+#else
+      c->bindata = sexp_malloc(src->binlength);
+#endif
+      if (c->bindata == NULL) {
+        sexp_errno = SEXP_ERR_MEMORY;
+        destroy_sexp(c);
+        return NULL;
+      }
+      memcpy(c->bindata, src->bindata, src->binlength);
+      c->binlength = src->binlength;
+    }
+  } else if (src->val != NULL) {
+    c->val = sexp_share_val(src);
+    if (c->val == NULL) {
+      destroy_sexp(c);
+      return NULL;
+    }
+    c->val_used = src->val_used;
+    c->val_allocated = src->val_allocated;
+    c->flags |= SEXP_FLAG_SHARED_VAL | (src->flags & SEXP_FLAG_INTERNED);
+  } else {
+    c->flags |= src->flags & (SEXP_FLAG_INT64 | SEXP_FLAG_DOUBLE);
+    c->val_allocated = src->val_allocated;
+    c->binlength = src->binlength;
+  }
+
+  return c;
+}
+
+/**
+ * New version of the list a: the children in front of target are copied
+ * (sharing their contents), followed by repl, which takes the place of
+ * target and everything after it.  target NULL means after the last
+ * child.  Takes over the reference to repl.
+ */
+static sexp_t *
+_rebuild (sexp_t * a, sexp_t * target, sexp_t * repl)
+{
+  sexp_t *head = NULL;
+  sexp_t **tail = &head;
+  sexp_t *c, *cell;
+
+  for (c = a->list; c != target; c = c->next) {
+    cell = _pcell(c, sexp_retain(c->list), NULL);
+    if (cell == NULL) {
+      destroy_sexp(head);
+      destroy_sexp(repl);
+      return NULL;
+    }
+    *tail = cell;
+    tail = &cell->next;
+  }
+
+  *tail = repl;
+
+  return _pcell(a, head, sexp_retain(a->next));
+}
+
+sexp_t *
+sexp_set_nth (sexp_t * list, unsigned int n, sexp_t * v)
+{
+  sexp_t *c, *repl;
+  unsigned int i;
+
+  if (!PERSISTENT(list) || list->ty != SEXP_LIST || !PERSISTENT(v)) {
+    sexp_errno = SEXP_ERR_BAD_PARAM;
+    return NULL;
+  }
+
+  for (c = list->list, i = 0; c != NULL && i < n; i++)
+    c = c->next;
+
+  if (c == NULL) {
+    sexp_errno = SEXP_ERR_BAD_PARAM;
+    return NULL;
+  }
+
+  repl = _pcell(v, sexp_retain(v->list), sexp_retain(c->next));
+  if (repl == NULL)
+    return NULL;
+
+  return _rebuild(list, c, repl);
+}
+
+sexp_t *
+sexp_append (sexp_t * list, sexp_t * v)
+{
+  sexp_t *repl;
+
+  if (!PERSISTENT(list) || list->ty != SEXP_LIST || !PERSISTENT(v)) {
+    sexp_errno = SEXP_ERR_BAD_PARAM;
+    return NULL;
+  }
+
+  repl = _pcell(v, sexp_retain(v->list), NULL);
+  if (repl == NULL)
+    return NULL;
+
+  return _rebuild(list, NULL, repl);
+}
+
+/**
+ * sexp_replace path search state: the lists entered on the way from the
+ * root to the element being looked for.
+ */
+typedef struct path_state {
+  faststack_t *path;
+  sexp_t *root;
+  sexp_t *old;
+} path_state_t;
+
+static sexp_walk_t
+_path_pre (sexp_t * sx, unsigned int depth, void *data)
+{
+  path_state_t *ps = (path_state_t *) data;
+
+  /* stop at old, or when the walk leaves root for its next chain. */
+  if (sx == ps->old || (depth == 0 && sx != ps->root))
+    return SEXP_WALK_STOP;
+
+  if (sx->ty == SEXP_LIST && sx->list != NULL &&
+      push(ps->path, sx) == NULL) {
+    sexp_errno = SEXP_ERR_MEMORY;
+    return SEXP_WALK_STOP;
+  }
+
+  return SEXP_WALK_CONTINUE;
+}
+
+static sexp_walk_t
+_path_post (sexp_t * sx, unsigned int depth, void *data)
+{
+  path_state_t *ps = (path_state_t *) data;
+
+  if (sx->ty == SEXP_LIST && sx->list != NULL)
+    pop(ps->path);
+
+  return SEXP_WALK_CONTINUE;
+}
+
+sexp_t *
+sexp_replace (sexp_t * root, sexp_t * old, sexp_t * v)
+{
+  path_state_t ps;
+  stack_lvl_t *lvl;
+  sexp_t *repl, *target, *a;
+  sexp_errcode_t olderr;
+
+  if (!PERSISTENT(root) || !PERSISTENT(old) || !PERSISTENT(v)) {
+    sexp_errno = SEXP_ERR_BAD_PARAM;
+    return NULL;
+  }
+
+  ps.path = make_stack();
+  if (ps.path == NULL) {
+    sexp_errno = SEXP_ERR_MEMORY;
+    return NULL;
+  }
+  ps.root = root;
+  ps.old = old;
+
+  olderr = sexp_errno;
+  sexp_errno = SEXP_ERR_OK;
+
+  if (sexp_walk(root, _path_pre, _path_post, &ps) != old) {
+    if (sexp_errno == SEXP_ERR_OK)
+      sexp_errno = SEXP_ERR_BAD_PARAM;
+    destroy_stack(ps.path);
+    return NULL;
+  }
+
+  sexp_errno = olderr;
+
+  /* rebuild from the parent of old up to the root. */
+  repl = _pcell(v, sexp_retain(v->list), sexp_retain(old->next));
+  target = old;
+
+  while (repl != NULL && !empty_stack(ps.path)) {
+    lvl = pop(ps.path);
+    a = (sexp_t *) lvl->data;
+    repl = _rebuild(a, target, repl);
+    target = a;
+  }
+
+  destroy_stack(ps.path);
+
+  return repl;
+}
+
+/*
+ * hash-consing.  Elements are compared shallowly: type, atom contents, and
+ * the list and next pointers, which already point to canonical elements
+ * because an element is only looked up after everything it refers to.
+ */
+
+#define HASHCONS_DEFAULT_SIZE 1024
+
+typedef struct hc_ent {
+  sexp_t *sx;
+  size_t hash;
+} hc_ent_t;
+
+struct sexp_hashcons {
+  hc_ent_t *slots;
+  size_t cap;    /* power of two */
+  size_t count;
+#ifdef _SEXP_THREADS_
+  pthread_mutex_t lock;
+#endif
+};
+
+#define PTR_HASH(p) ((size_t)(p) >> 4)
+
+static size_t
+_hc_hash (const sexp_t * sx)
+{
+  size_t h;
+
+  /* aty means nothing for lists, and may be left over from an earlier
+     use of the element.  Hashing an atom does not walk anything. */
+  if (sx->ty == SEXP_LIST)
+    h = PTR_HASH(sx->list) * 31 + 17;
+  else
+    h = sexp_hash(sx);
+
+  h = h * 31 + PTR_HASH(sx->next);
+
+  return h;
+}
+
+static int
+_hc_equal (const sexp_t * a, const sexp_t * b)
+{
+  if (a->ty != b->ty || a->next != b->next)
+    return 0;
+
+  if (a->ty == SEXP_LIST)
+    return a->list == b->list;
+
+  /* comparing atoms does not walk anything. */
+  return sexp_equal(a, b) == 1;
+}
+
+sexp_hashcons_t *
+new_sexp_hashcons (size_t size)
+{
+  sexp_hashcons_t *t;
+  size_t cap = 16;
+
+  if (size == 0)
+    size = HASHCONS_DEFAULT_SIZE;
+
+  while (cap/4*3 < size)
+    cap *= 2;
+
+#ifdef __cplusplus
+  t = (sexp_hashcons_t *)sexp_malloc(sizeof(sexp_hashcons_t));
+#else
+  t = sexp_malloc(sizeof(sexp_hashcons_t));
+#endif
+  if (t == NULL) {
+    sexp_errno = SEXP_ERR_MEMORY;
+    return NULL;
+  }
+
+#ifdef __cplusplus
+  t->slots = (hc_ent_t *)sexp_calloc(cap, sizeof(hc_ent_t));
+#else
+  t->slots = sexp_calloc(cap, sizeof(hc_ent_t));
+#endif
+  if (t->slots == NULL) {
+    sexp_errno = SEXP_ERR_MEMORY;
+    sexp_free(t, sizeof(sexp_hashcons_t));
+    return NULL;
+  }
+
+  t->cap = cap;
+  t->count = 0;
+
+#ifdef _SEXP_THREADS_
+  pthread_mutex_init(&t->lock, NULL);
+#endif
+
+  return t;
+}
+
+void
+destroy_sexp_hashcons (sexp_hashcons_t * t)
+{
+  size_t i;
+
+  if (t == NULL) return;
+
+  for (i = 0; i < t->cap; i++)
+    if (t->slots[i].sx != NULL)
+      destroy_sexp(t->slots[i].sx);
+
+#ifdef _SEXP_THREADS_
+  pthread_mutex_destroy(&t->lock);
+#endif
+
+  sexp_free(t->slots, t->cap * sizeof(hc_ent_t));
+  sexp_free(t, sizeof(sexp_hashcons_t));
+}
+
+size_t
+sexp_hashcons_count (sexp_hashcons_t * t)
+{
+  size_t n;
+
+  LOCK(t);
+  n = t->count;
+  UNLOCK(t);
+
+  return n;
+}
+
+/**
+ * Make room for another element.  Canonical elements that only the table
+ * refers to are dropped first; dropping one releases what it refers to,
+ * which may leave more such elements, so this repeats until nothing is
+ * dropped.  The number of slots is doubled only if the table is still at
+ * least half full after that.  Called with the lock held.
+ *
+ * A reference count of one cannot go back up behind our back: the only
+ * other ways to take a reference are _hc_cons, which needs the lock, and
+ * sexp_retain, which needs a reference already.
+ *
+ * Dropping elements leaves holes in the probe sequences, so a new array
+ * of the same size is allocated before anything is dropped; if doubling
+ * then fails the table is still rebuilt, at its old size.
+ */
+static int
+_hc_grow (sexp_hashcons_t * t)
+{
+  hc_ent_t *slots, *big;
+  size_t cap = t->cap;
+  size_t dropped;
+  size_t i, j;
+  int err = 0;
+
+#ifdef __cplusplus
+  slots = (hc_ent_t *)sexp_calloc(cap, sizeof(hc_ent_t));
+#else
+  slots = sexp_calloc(cap, sizeof(hc_ent_t));
+#endif
+  if (slots == NULL) {
+    sexp_errno = SEXP_ERR_MEMORY;
+    return -1;
+  }
+
+  do {
+    dropped = 0;
+    for (i = 0; i < t->cap; i++) {
+      if (t->slots[i].sx != NULL &&
+          SEXP_REF_GET(&t->slots[i].sx->refcount) == 1) {
+        destroy_sexp(t->slots[i].sx);
+        t->slots[i].sx = NULL;
+        dropped++;
+      }
+    }
+    t->count -= dropped;
+  } while (dropped > 0);
+
+  if ((t->count + 1) > cap/2) {
+#ifdef __cplusplus
+    big = (hc_ent_t *)sexp_calloc(cap * 2, sizeof(hc_ent_t));
+#else
+    big = sexp_calloc(cap * 2, sizeof(hc_ent_t));
+#endif
+    if (big == NULL) {
+      sexp_errno = SEXP_ERR_MEMORY;
+      err = -1;
+    } else {
+      sexp_free(slots, cap * sizeof(hc_ent_t));
+      slots = big;
+      cap *= 2;
+    }
+  }
+
+  for (i = 0; i < t->cap; i++) {
+    if (t->slots[i].sx == NULL)
+      continue;
+    j = t->slots[i].hash & (cap - 1);
+    while (slots[j].sx != NULL)
+      j = (j + 1) & (cap - 1);
+    slots[j] = t->slots[i];
+  }
+
+  sexp_free(t->slots, t->cap * sizeof(hc_ent_t));
+  t->slots = slots;
+  t->cap = cap;
+
+  return err;
+}
+
+/**
+ * Return the canonical element for sx, whose list and next are canonical
+ * already, holding the reference the caller had to sx.  Called with the
+ * lock held.  Returns NULL on failure, leaving sx valid.
+ */
+static sexp_t *
+_hc_cons (sexp_hashcons_t * t, sexp_t * sx)
+{
+  size_t h = _hc_hash(sx);
+  size_t i = h & (t->cap - 1);
+  hc_ent_t *e;
+
+  for (e = &t->slots[i]; e->sx != NULL; e = &t->slots[i]) {
+    if (e->sx == sx)
+      return sx;
+    if (e->hash == h && _hc_equal(e->sx, sx)) {
+      sexp_retain(e->sx);
+      destroy_sexp(sx);
+      return e->sx;
+    }
+    i = (i + 1) & (t->cap - 1);
+  }
+
+  if (!(sx->flags & SEXP_FLAG_PERSISTENT)) {
+    if (sx->ty == SEXP_VALUE && sx->aty != SEXP_BINARY && sx->val != NULL &&
+        sexp_make_shared_val(sx) == NULL)
+      return NULL;
+    sx->flags |= SEXP_FLAG_PERSISTENT;
+    sx->refcount = 1;
+  }
+
+  if ((t->count + 1) > t->cap/4*3) {
+    if (_hc_grow(t) != 0)
+      return NULL;
+    i = h & (t->cap - 1);
+    while (t->slots[i].sx != NULL)
+      i = (i + 1) & (t->cap - 1);
+    e = &t->slots[i];
+  }
+
+  /* the table's own reference. */
+  e->sx = sexp_retain(sx);
+  e->hash = h;
+  t->count++;
+
+  return sx;
+}
+
+/**
+ * sexp_hashcons_with collects the link fields pointing at each element
+ * (the caller's root pointer, or the list or next field of another
+ * element) in depth-first order.  An element's list contents and the
+ * elements after it on its next chain all come later in that order, so
+ * going through the links backwards hash-conses everything an element
+ * refers to before the element itself.
+ */
+typedef struct hc_links {
+  sexp_t ***links;
+  size_t n;
+  size_t cap;
+} hc_links_t;
+
+static int
+_hc_push (hc_links_t * l, sexp_t ** link)
+{
+  sexp_t ***nl;
+
+  if (l->n == l->cap) {
+#ifdef __cplusplus
+    nl = (sexp_t ***)sexp_realloc(l->links, 2 * l->cap * sizeof(sexp_t **),
+                                  l->cap * sizeof(sexp_t **));
+#else
+    nl = sexp_realloc(l->links, 2 * l->cap * sizeof(sexp_t **),
+                      l->cap * sizeof(sexp_t **));
+#endif
+    if (nl == NULL) {
+      sexp_errno = SEXP_ERR_MEMORY;
+      return -1;
+    }
+    l->links = nl;
+    l->cap *= 2;
+  }
+
+  l->links[l->n++] = link;
+
+  return 0;
+}
+
+static sexp_walk_t
+_hc_links_pre (sexp_t * sx, unsigned int depth, void *data)
+{
+  /* elements that are persistent already are taken as they are. */
+  if (sx->flags & SEXP_FLAG_PERSISTENT)
+    return SEXP_WALK_SKIP;
+
+  /* the elements of the list are about to be replaced. */
+  sexp_unindex(sx);
+
+  if (sx->ty == SEXP_LIST && sx->list != NULL &&
+      _hc_push((hc_links_t *) data, &sx->list) != 0)
+    return SEXP_WALK_STOP;
+
+  return SEXP_WALK_CONTINUE;
+}
+
+static sexp_walk_t
+_hc_links_post (sexp_t * sx, unsigned int depth, void *data)
+{
+  if (sx->next != NULL && !(sx->flags & SEXP_FLAG_PERSISTENT) &&
+      _hc_push((hc_links_t *) data, &sx->next) != 0)
+    return SEXP_WALK_STOP;
+
+  return SEXP_WALK_CONTINUE;
+}
+
+sexp_t *
+sexp_hashcons_with (sexp_hashcons_t * t, sexp_t * sx)
+{
+  hc_links_t l;
+  sexp_t *root = sx;
+  sexp_t *c;
+  sexp_errcode_t olderr;
+  size_t k;
+
+  if (t == NULL || sx == NULL) {
+    sexp_errno = SEXP_ERR_BAD_PARAM;
+    return NULL;
+  }
+
+  l.cap = 64;
+  l.n = 0;
+#ifdef __cplusplus
+  l.links = (sexp_t ***)sexp_malloc(l.cap * sizeof(sexp_t **));
+#else
+  l.links = sexp_malloc(l.cap * sizeof(sexp_t **));
+#endif
+  if (l.links == NULL) {
+    sexp_errno = SEXP_ERR_MEMORY;
+    return NULL;
+  }
+  l.links[l.n++] = &root;
+
+  olderr = sexp_errno;
+  sexp_errno = SEXP_ERR_OK;
+
+  if (sexp_walk(sx, _hc_links_pre, _hc_links_post, &l) != NULL ||
+      sexp_errno != SEXP_ERR_OK) {
+    sexp_free(l.links, l.cap * sizeof(sexp_t **));
+    return NULL;
+  }
+
+  sexp_errno = olderr;
+
+  LOCK(t);
+  for (k = l.n; k > 0; k--) {
+    c = _hc_cons(t, *l.links[k-1]);
+    if (c == NULL)
+      break;
+    *l.links[k-1] = c;
+  }
+  UNLOCK(t);
+
+  sexp_free(l.links, l.cap * sizeof(sexp_t **));
+
+  return (k == 0) ? root : NULL;
+}
+
+sexp_t *
+sexp_hashcons (sexp_t * sx)
+{
+  sexp_hashcons_t *t;
+  sexp_t *hx;
+
+  t = new_sexp_hashcons(0);
+  if (t == NULL)
+    return NULL;
+
+  hx = sexp_hashcons_with(t, sx);
+  destroy_sexp_hashcons(t);
+
+  return hx;
+}
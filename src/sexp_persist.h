@@ -0,0 +1,200 @@
+/**
+   @cond IGNORE
+
+   ======================================================
+   SFSEXP: Small, Fast S-Expression Library
+   Written by Matthew Sottile (mjsottile@gmail.com)
+   ======================================================
+
+   Copyright (2003-2006). The Regents of the University of California. This
+   material was produced under U.S. Government contract W-7405-ENG-36 for Los
+   Alamos National Laboratory, which is operated by the University of
+   California for the U.S. Department of Energy. The U.S. Government has rights
+   to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+   THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+   LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+   derivative works, such modified software should be clearly marked, so as not
+   to confuse it with the version available from LANL.
+
+   Additionally, this library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of the
+   License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+   LA-CC-04-094
+
+   @endcond
+**/
+#ifndef __SEXP_PERSIST_H__
+#define __SEXP_PERSIST_H__
+
+/**
+ * \file sexp_persist.h
+ *
+ * \brief Persistent (immutable) s-expressions with structural sharing.
+ *
+ * A persistent expression is never modified once frozen.  Updates return
+ * a new version of the expression that shares every element it did not
+ * have to change with the old one, copying only the path from the root
+ * to the change (and, since siblings are linked through their next
+ * fields, the siblings in front of the changed element on each level of
+ * that path).  Elements are reference counted, so versions can be dropped
+ * in any order with destroy_sexp (or sexp_release).  Reference counts are
+ * updated atomically where the compiler supports it, so versions may be
+ * made and dropped from several threads.
+ *
+ * Hash-consing turns an expression into a persistent DAG in which equal
+ * sub-expressions are stored once.  A continuation can hash-cons every
+ * expression it parses against a shared table (the hashcons field of
+ * pcont_t).
+ */
+
+#include <stddef.h>
+#include "sexp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /**
+   * Make the ordinary expression \a sx, and the elements on its next
+   * chain, persistent in place.  Every element gets a reference count of
+   * one (the caller's reference to sx, or the list or next field
+   * pointing at it), and every text atom's buffer becomes a shared buffer
+   * so later versions can use it without copying.  Elements that are
+   * already persistent are left as they are.
+   *
+   * \param sx Expression to freeze.  It must not live in an arena.
+   * \return   sx, or NULL with sexp_errno set on failure.
+   */
+  sexp_t *sexp_freeze(sexp_t *sx);
+
+  /**
+   * Take another reference to the persistent element \a sx.
+   *
+   * \return sx.
+   */
+  sexp_t *sexp_retain(sexp_t *sx);
+
+  /**
+   * Drop a reference to the persistent element \a sx, freeing whatever is
+   * no longer referenced.  The same as destroy_sexp.
+   */
+  void sexp_release(sexp_t *sx);
+
+  /**
+   * Return a new version of the persistent list \a list with its \a n'th
+   * element (counting from zero) replaced by the contents of \a v.  The
+   * elements after the n'th one, and the contents of every element of
+   * list, are shared with the old version.
+   *
+   * \param list Persistent list to update.
+   * \param n    Position of the element to replace.
+   * \param v    Persistent replacement.  The new version refers to the
+   *             contents of v; the caller keeps its reference to v.
+   * \return     New version holding one reference for the caller, or NULL
+   *             with sexp_errno set.  SEXP_ERR_BAD_PARAM is reported if
+   *             an argument is not persistent or list is too short.
+   */
+  sexp_t *sexp_set_nth(sexp_t *list, unsigned int n, sexp_t *v);
+
+  /**
+   * Return a new version of the persistent expression \a root in which the
+   * element \a old, found anywhere inside root by pointer, is replaced by
+   * the contents of \a v.  If old is reachable along several paths the
+   * first one in depth-first order is used.  Everything outside the path
+   * from root to old is shared with the old version.
+   *
+   * \param root Persistent expression to update.
+   * \param old  Element of root to replace, or root itself.
+   * \param v    Persistent replacement; as for sexp_set_nth.
+   * \return     New version holding one reference for the caller, or NULL
+   *             with sexp_errno set.  SEXP_ERR_BAD_PARAM is reported if
+   *             an argument is not persistent or old is not in root.
+   */
+  sexp_t *sexp_replace(sexp_t *root, sexp_t *old, sexp_t *v);
+
+  /**
+   * Return a new version of the persistent list \a list with the contents
+   * of \a v added at the end.  The elements of list have to be copied,
+   * since the last one's next field changes, but their contents are
+   * shared.
+   *
+   * \param list Persistent list to update.
+   * \param v    Persistent element to append; as for sexp_set_nth.
+   * \return     New version holding one reference for the caller, or NULL
+   *             with sexp_errno set.
+   */
+  sexp_t *sexp_append(sexp_t *list, sexp_t *v);
+
+  /**
+   * A hash-consing table: the canonical copy of every distinct element
+   * seen so far.  The contents are private to sexp_persist.c.
+   */
+  typedef struct sexp_hashcons sexp_hashcons_t;
+
+  /**
+   * Create an empty hash-consing table with room for about \a size
+   * elements before it has to grow (zero selects a default).  Returns NULL
+   * and sets sexp_errno on failure.
+   */
+  sexp_hashcons_t *new_sexp_hashcons(size_t size);
+
+  /**
+   * Destroy a hash-consing table, dropping its references to the canonical
+   * elements.  Expressions built with it stay valid.
+   */
+  void destroy_sexp_hashcons(sexp_hashcons_t *t);
+
+  /**
+   * Number of canonical elements in the table.  This includes elements
+   * no expression uses any more that have not been dropped yet.
+   */
+  size_t sexp_hashcons_count(sexp_hashcons_t *t);
+
+  /**
+   * Hash-cons \a sx (and its next chain) against the table \a t: every
+   * element is replaced by the table's canonical element with the same
+   * type, atom contents, list and next, so structurally identical
+   * sub-expressions (and identical tails of lists) are stored once and
+   * the result is a DAG.  Elements of sx that have no equal in the table
+   * become canonical themselves; the others are freed.  The result is a
+   * persistent expression (see sexp_freeze): drop it with destroy_sexp,
+   * which only frees elements nothing else refers to, and do not modify
+   * it in place.  Printing and walking it expand the shared elements;
+   * copy_sexp returns an ordinary tree with everything expanded.
+   * Expressions hash-consed with the same table share elements with each
+   * other.  The table only keeps elements for as long as some expression
+   * uses them: when it fills up, the ones whose only reference is the
+   * table's own are dropped before it grows.  A table may be shared by
+   * several threads.
+   *
+   * \param t  Table to hash-cons against.
+   * \param sx Expression to hash-cons.  The caller's reference to it is
+   *           taken over by the result.
+   * \return   The hash-consed expression, or NULL with sexp_errno set on
+   *           failure, in which case sx has only partly been hash-consed,
+   *           is still valid, and still belongs to the caller.
+   */
+  sexp_t *sexp_hashcons_with(sexp_hashcons_t *t, sexp_t *sx);
+
+  /**
+   * Hash-cons \a sx against a table of its own, so that it shares elements
+   * only with itself.  Same ownership rules as sexp_hashcons_with.
+   */
+  sexp_t *sexp_hashcons(sexp_t *sx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SEXP_PERSIST_H__ */
@@ -0,0 +1,238 @@
+/**
+   @cond IGNORE
+
+   ======================================================
+   SFSEXP: Small, Fast S-Expression Library
+   Written by Matthew Sottile (mjsottile@gmail.com)
+   ======================================================
+
+   Copyright (2003-2006). The Regents of the University of California. This
+   material was produced under U.S. Government contract W-7405-ENG-36 for Los
+   Alamos National Laboratory, which is operated by the University of
+   California for the U.S. Department of Energy. The U.S. Government has rights
+   to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+   THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+   LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+   derivative works, such modified software should be clearly marked, so as not
+   to confuse it with the version available from LANL.
+
+   Additionally, this library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of the
+   License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+   LA-CC-04-094
+
+   @endcond
+**/
+#include <stdlib.h>
+#include <string.h>
+#include "sexp.h"
+
+/* patterns nested deeper than this are refused */
+#define PROJECT_MAX_DEPTH 64
+
+/*
+ * a projection is a tree of list patterns.  The root has no head and
+ * the top level patterns as its kids; patterns with the same head are
+ * merged, so at most one literal kid and one * kid match any list.
+ */
+struct sexp_projection {
+  char *head;      /* NULL for * */
+  size_t len;
+  int all;         /* keep whole lists */
+  struct sexp_projection *kids;
+  struct sexp_projection *next;
+};
+
+static void
+_free (sexp_projection_t * p)
+{
+  sexp_projection_t *n;
+
+  while (p != NULL) {
+    n = p->next;
+    _free(p->kids);
+    if (p->head != NULL)
+      sexp_free(p->head, p->len + 1);
+    sexp_free(p, sizeof(sexp_projection_t));
+    p = n;
+  }
+}
+
+/*
+ * merge the pattern pat into the kids of p.  Returns 0, or -1 with
+ * sexp_errno set.
+ */
+static int
+_add (sexp_projection_t * p, const sexp_t * pat, unsigned int depth)
+{
+  sexp_projection_t *k, *last = NULL;
+  const sexp_t *h, *sub;
+  const char *text = NULL;
+  size_t len = 0;
+
+  if (depth >= PROJECT_MAX_DEPTH || pat->ty != SEXP_LIST) {
+    sexp_errno = SEXP_ERR_BAD_PARAM;
+    return -1;
+  }
+
+  h = pat->list;
+  if (h == NULL || h->ty != SEXP_VALUE || h->aty == SEXP_BINARY) {
+    sexp_errno = SEXP_ERR_BAD_PARAM;
+    return -1;
+  }
+
+  if (h->aty != SEXP_BASIC || strcmp(h->val, "*") != 0) {
+    text = h->val;
+    len = h->val_used - 1;
+  }
+
+  for (k = p->kids; k != NULL; k = k->next) {
+    if (text == NULL ? k->head == NULL :
+        (k->head != NULL && k->len == len &&
+         memcmp(k->head, text, len) == 0))
+      break;
+    last = k;
+  }
+
+  if (k == NULL) {
+#ifdef __cplusplus
+    k = (sexp_projection_t *)sexp_calloc(1, sizeof(sexp_projection_t));
+#else
+    k = sexp_calloc(1, sizeof(sexp_projection_t));
+#endif
+    if (k == NULL) {
+      sexp_errno = SEXP_ERR_MEMORY;
+      return -1;
+    }
+
+    if (text != NULL) {
+#ifdef __cplusplus
+      k->head = (char *)sexp_malloc(len + 1);
+#else
+      k->head = sexp_malloc(len + 1);
+#endif
+      if (k->head == NULL) {
+        sexp_free(k, sizeof(sexp_projection_t));
+        sexp_errno = SEXP_ERR_MEMORY;
+        return -1;
+      }
+      memcpy(k->head, text, len);
+      k->head[len] = '\0';
+      k->len = len;
+    }
+
+    if (last == NULL)
+      p->kids = k;
+    else
+      last->next = k;
+  }
+
+  /* keeping the whole list subsumes any narrower pattern */
+  if (h->next == NULL) {
+    k->all = 1;
+    _free(k->kids);
+    k->kids = NULL;
+    return 0;
+  }
+
+  if (k->all) return 0;
+
+  for (sub = h->next; sub != NULL; sub = sub->next)
+    if (_add(k, sub, depth + 1) != 0) return -1;
+
+  return 0;
+}
+
+sexp_projection_t *
+new_sexp_projection (const char *spec)
+{
+  sexp_projection_t *p;
+  pcont_t *cc;
+  sexp_t *sx;
+  int bad = 0;
+
+  if (spec == NULL) {
+    sexp_errno = SEXP_ERR_BAD_PARAM;
+    return NULL;
+  }
+
+#ifdef __cplusplus
+  p = (sexp_projection_t *)sexp_calloc(1, sizeof(sexp_projection_t));
+#else
+  p = sexp_calloc(1, sizeof(sexp_projection_t));
+#endif
+  if (p == NULL) {
+    sexp_errno = SEXP_ERR_MEMORY;
+    return NULL;
+  }
+
+  cc = init_continuation((char *) spec);
+  if (cc == NULL) {
+    sexp_free(p, sizeof(sexp_projection_t));
+    return NULL;
+  }
+
+  while (!bad &&
+         (sx = iparse_sexp((char *) spec, strlen(spec), cc)) != NULL) {
+    if (_add(p, sx, 0) != 0) bad = 1;
+    destroy_sexp(sx);
+  }
+
+  /* anything but the end of the patterns is an error */
+  if (!bad && (cc->error != SEXP_ERR_INCOMPLETE || cc->depth != 0 ||
+               cc->val_used != 0 || p->kids == NULL)) {
+    sexp_errno = SEXP_ERR_BAD_PARAM;
+    bad = 1;
+  }
+
+  destroy_continuation(cc);
+
+  if (bad) {
+    if (sexp_errno != SEXP_ERR_MEMORY)
+      sexp_errno = SEXP_ERR_BAD_PARAM;
+    destroy_sexp_projection(p);
+    return NULL;
+  }
+
+  sexp_errno = SEXP_ERR_OK;
+  return p;
+}
+
+void
+destroy_sexp_projection (sexp_projection_t * p)
+{
+  _free(p);
+}
+
+int
+sexp_projection_step (const sexp_projection_t * p,
+                      const char *head, size_t len,
+                      const sexp_projection_t **next)
+{
+  const sexp_projection_t *k, *any = NULL;
+
+  for (k = p->kids; k != NULL; k = k->next) {
+    if (k->head == NULL)
+      any = k;
+    else if (head != NULL && k->len == len &&
+             memcmp(k->head, head, len) == 0)
+      break;
+  }
+
+  if (k == NULL) k = any;
+  if (k == NULL) return 0;
+
+  *next = k->all ? NULL : k;
+  return 1;
+}
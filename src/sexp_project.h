@@ -0,0 +1,112 @@
+/**
+   @cond IGNORE
+
+   ======================================================
+   SFSEXP: Small, Fast S-Expression Library
+   Written by Matthew Sottile (mjsottile@gmail.com)
+   ======================================================
+
+   Copyright (2003-2006). The Regents of the University of California. This
+   material was produced under U.S. Government contract W-7405-ENG-36 for Los
+   Alamos National Laboratory, which is operated by the University of
+   California for the U.S. Department of Energy. The U.S. Government has rights
+   to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+   THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+   LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+   derivative works, such modified software should be clearly marked, so as not
+   to confuse it with the version available from LANL.
+
+   Additionally, this library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of the
+   License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+   LA-CC-04-094
+
+   @endcond
+**/
+#ifndef __SEXP_PROJECT_H__
+#define __SEXP_PROJECT_H__
+
+/**
+ * \file sexp_project.h
+ *
+ * \brief Projections: parse only the parts of expressions that are needed.
+ *
+ * A continuation with a projection attached (the projection field of
+ * pcont_t) builds only the lists the projection asks for.  Everything else
+ * is passed over by a scanner that only follows nesting, strings, escapes
+ * and comments, without allocating any elements.  A projection is a
+ * sequence of list patterns, each of the form <tt>(h p1 ... pn)</tt>
+ * where h is an atom and the pi are list patterns:
+ *
+ * - a list is kept if its first element is an atom with the text h
+ *   (quotes are ignored), or if h is an unquoted <tt>*</tt>;
+ * - a pattern without any pi keeps the whole list;
+ * - otherwise, of the elements after the head of the list only the lists
+ *   kept by one of the pi are kept, and the other elements are dropped.
+ *
+ * The top level expressions are matched against the patterns of the
+ * projection, and those that are not kept are not returned at all: the
+ * parser goes on with the next expression.  When several patterns of the
+ * same list pattern match one list, the one with a literal head is used.
+ * For example, <tt>(config (server (port)) (log))</tt> reduces
+ * <tt>(config (server web (port 80) (host a)) (user b) (log x))</tt> to
+ * <tt>(config (server (port 80)) (log x))</tt>.
+ *
+ * Event handlers attached to the continuation are called for what is
+ * built; of a list that is dropped they see at most its start, its head
+ * and its end.  Projections only apply to the normal parser mode; in inline binary
+ * mode, where only parsing can tell where a binary atom ends, they are
+ * ignored.  A projection is never changed after it has been created, so
+ * it may be shared by any number of continuations.
+ */
+
+#include "sexp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /**
+   * A compiled projection.  The contents are private to sexp_project.c.
+   */
+  typedef struct sexp_projection sexp_projection_t;
+
+  /**
+   * Compile the projection in the string \a spec, one or more list
+   * patterns.  Returns NULL and sets sexp_errno on failure:
+   * SEXP_ERR_BAD_PARAM if the string is not a valid projection.
+   */
+  sexp_projection_t *new_sexp_projection(const char *spec);
+
+  /**
+   * Destroy a projection.  No continuation may use it any more.
+   */
+  void destroy_sexp_projection(sexp_projection_t *p);
+
+  /**
+   * Used by the parser: decide whether a list inside a list projected by
+   * \a p is kept, given the \a len bytes of its head atom \a head (NULL if
+   * the list does not start with an atom).  Returns 0 if it is dropped, 1
+   * if it is kept, with \a next set to the projection of its elements, or
+   * to NULL if the whole list is kept.
+   */
+  int sexp_projection_step(const sexp_projection_t *p,
+                           const char *head, size_t len,
+                           const sexp_projection_t **next);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SEXP_PROJECT_H__ */
@@ -0,0 +1,1084 @@
+/**
+   @cond IGNORE
+
+   ======================================================
+   SFSEXP: Small, Fast S-Expression Library
+   Written by Matthew Sottile (mjsottile@gmail.com)
+   ======================================================
+
+   Copyright (2003-2006). The Regents of the University of California. This
+   material was produced under U.S. Government contract W-7405-ENG-36 for Los
+   Alamos National Laboratory, which is operated by the University of
+   California for the U.S. Department of Energy. The U.S. Government has rights
+   to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+   THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+   LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+   derivative works, such modified software should be clearly marked, so as not
+   to confuse it with the version available from LANL.
+
+   Additionally, this library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of the
+   License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+   LA-CC-04-094
+
+   @endcond
+**/
+#include <stdlib.h>
+#include <string.h>
+#include "sexp.h"
+
+/*
+ * A compiled query is an array of pattern nodes; list patterns keep the
+ * indices of their element patterns in kids, and literals their text in
+ * text.  Matching follows the input one element at a time, as a walk
+ * over a tree or as parser events: every element being matched against a
+ * pattern gets an instance of the pattern, kept with the element on a
+ * stack of open elements.  When an element starts, the instances of the
+ * list it is in decide which patterns it is tried against; when it ends,
+ * its instances know whether they matched and tell the instance they
+ * were created for.  Selected elements are collected by the instances
+ * and only handed to the user once the whole top level pattern matched.
+ */
+
+/* queries deeper than this are rejected when compiled. */
+#define QUERY_MAX_DEPTH 64
+
+#define QUERY_GROW 16
+
+typedef enum {
+  Q_ANY,
+  Q_LIT,
+  Q_LIST,
+  Q_CAPTURE,
+  Q_DESC,
+  Q_POS
+} qkind_t;
+
+typedef struct qnode {
+  qkind_t kind;
+  unsigned int sub;     /* Q_CAPTURE, Q_DESC, Q_POS: inner pattern */
+  unsigned int pos;     /* Q_POS */
+  unsigned int first;   /* Q_LIST: element patterns in kids */
+  unsigned int nkids;
+  size_t off;           /* Q_LIT: text in text */
+  size_t len;
+  int selects;          /* the pattern contains a Q_CAPTURE */
+} qnode_t;
+
+struct sexp_query {
+  qnode_t *nodes;
+  unsigned int nnodes;
+  unsigned int capnodes;
+  unsigned int *kids;
+  unsigned int nkids;
+  unsigned int capkids;
+  char *text;
+  size_t textlen;
+  size_t captext;
+  unsigned int root;
+  unsigned int maxkids;
+};
+
+/*========================*/
+/* compiling              */
+/*========================*/
+
+/**
+ * Make room for \a need more items of \a size bytes in the array \a *p
+ * with \a n used of \a *cap.
+ */
+static int
+_reserve (void **p, size_t n, size_t *cap, size_t need, size_t size)
+{
+  size_t ncap = *cap;
+  void *np;
+
+  if (n + need <= *cap)
+    return 0;
+
+  while (ncap < n + need)
+    ncap += (ncap < QUERY_GROW) ? QUERY_GROW : ncap;
+
+  np = sexp_realloc(*p, ncap * size, *cap * size);
+  if (np == NULL) {
+    sexp_errno = SEXP_ERR_MEMORY;
+    return -1;
+  }
+
+  *p = np;
+  *cap = ncap;
+
+  return 0;
+}
+
+static int
+_node (sexp_query_t * q, qkind_t kind)
+{
+  size_t cap = q->capnodes;
+  qnode_t *n;
+
+  if (_reserve((void **) &q->nodes, q->nnodes, &cap, 1, sizeof(qnode_t)))
+    return -1;
+  q->capnodes = (unsigned int) cap;
+
+  n = &q->nodes[q->nnodes];
+  memset(n, 0, sizeof(qnode_t));
+  n->kind = kind;
+
+  return (int) q->nnodes++;
+}
+
+static int
+_is (const sexp_t * sx, const char *word)
+{
+  return sx != NULL && sx->ty == SEXP_VALUE && sx->aty == SEXP_BASIC &&
+    sx->val != NULL && strcmp(sx->val, word) == 0;
+}
+
+static int
+_bad_query (void)
+{
+  sexp_errno = SEXP_ERR_BAD_PARAM;
+  return -1;
+}
+
+/**
+ * Compile the pattern sx, returning its node index or -1.  \a in_list is
+ * set for the element patterns of a list pattern other than the head,
+ * where positional patterns are allowed.
+ */
+static int
+_compile (sexp_query_t * q, const sexp_t * sx, unsigned int depth,
+          int in_list)
+{
+  const sexp_t *h, *e;
+  char nbuf[SEXP_NUMBER_MAX];
+  const char *t;
+  size_t cap, len;
+  unsigned int i, n;
+  int self, sub;
+  char *end;
+  long pos;
+
+  if (sx == NULL || depth > QUERY_MAX_DEPTH)
+    return _bad_query();
+
+  if (sx->ty == SEXP_VALUE) {
+    if (sx->aty == SEXP_BINARY)
+      return _bad_query();
+
+    if (_is(sx, "*"))
+      return _node(q, Q_ANY);
+
+    if (_is(sx, "?")) {
+      self = _node(q, Q_CAPTURE);
+      sub = (self < 0) ? -1 : _node(q, Q_ANY);
+      if (sub < 0)
+        return -1;
+      q->nodes[self].sub = (unsigned int) sub;
+      q->nodes[self].selects = 1;
+      return self;
+    }
+
+    self = _node(q, Q_LIT);
+    if (self < 0)
+      return -1;
+    t = sexp_atom_text(sx, nbuf, &len);
+    n = (unsigned int) len;
+    if (_reserve((void **) &q->text, q->textlen, &q->captext, n + 1, 1))
+      return -1;
+    if (n > 0)
+      memcpy(q->text + q->textlen, t, n);
+    q->nodes[self].off = q->textlen;
+    q->nodes[self].len = n;
+    q->textlen += n;
+    return self;
+  }
+
+  h = sx->list;
+
+  if (_is(h, "?") || _is(h, "//")) {
+    if (h->next == NULL || h->next->next != NULL)
+      return _bad_query();
+    self = _node(q, _is(h, "?") ? Q_CAPTURE : Q_DESC);
+    sub = (self < 0) ? -1 : _compile(q, h->next, depth + 1, 0);
+    if (sub < 0)
+      return -1;
+    q->nodes[self].sub = (unsigned int) sub;
+    q->nodes[self].selects =
+      (q->nodes[self].kind == Q_CAPTURE) || q->nodes[sub].selects;
+    return self;
+  }
+
+  if (_is(h, "@")) {
+    e = h->next;
+    if (!in_list || e == NULL || e->ty != SEXP_VALUE ||
+        e->aty == SEXP_BINARY || e->next == NULL || e->next->next != NULL)
+      return _bad_query();
+    t = sexp_atom_text(e, nbuf, NULL);
+    if (t == NULL)
+      return _bad_query();
+    pos = strtol(t, &end, 10);
+    if (*end != '\0' || pos < 1)
+      return _bad_query();
+    self = _node(q, Q_POS);
+    sub = (self < 0) ? -1 : _compile(q, e->next, depth + 1, 0);
+    if (sub < 0)
+      return -1;
+    q->nodes[self].sub = (unsigned int) sub;
+    q->nodes[self].pos = (unsigned int) pos;
+    q->nodes[self].selects = q->nodes[sub].selects;
+    return self;
+  }
+
+  self = _node(q, Q_LIST);
+  if (self < 0)
+    return -1;
+
+  for (n = 0, e = h; e != NULL; e = e->next)
+    n++;
+
+  /* the element patterns' indices go in a block reserved up front. */
+  cap = q->capkids;
+  if (_reserve((void **) &q->kids, q->nkids, &cap, n, sizeof(unsigned int)))
+    return -1;
+  q->capkids = (unsigned int) cap;
+  q->nodes[self].first = q->nkids;
+  q->nodes[self].nkids = n;
+  q->nkids += n;
+  if (n > q->maxkids)
+    q->maxkids = n;
+
+  for (i = 0, e = h; e != NULL; i++, e = e->next) {
+    sub = _compile(q, e, depth + 1, i > 0);
+    if (sub < 0)
+      return -1;
+    q->kids[q->nodes[self].first + i] = (unsigned int) sub;
+    if (q->nodes[sub].selects)
+      q->nodes[self].selects = 1;
+  }
+
+  return self;
+}
+
+sexp_query_t *
+new_sexp_query (const char *query)
+{
+  sexp_query_t *q;
+  sexp_t *sx;
+  int root, sel;
+
+  if (query == NULL) {
+    sexp_errno = SEXP_ERR_BAD_PARAM;
+    return NULL;
+  }
+
+  sx = parse_sexp((char *) query, strlen(query));
+  if (sx == NULL) {
+    sexp_errno = SEXP_ERR_BAD_PARAM;
+    return NULL;
+  }
+
+#ifdef __cplusplus
+  q = (sexp_query_t *)sexp_calloc(1, sizeof(sexp_query_t));
+#else
+  q = sexp_calloc(1, sizeof(sexp_query_t));
+#endif
+  if (q == NULL) {
+    destroy_sexp(sx);
+    sexp_errno = SEXP_ERR_MEMORY;
+    return NULL;
+  }
+
+  root = _compile(q, sx, 0, 0);
+  destroy_sexp(sx);
+
+  /* a query selecting nothing selects what it matches. */
+  if (root >= 0 && !q->nodes[root].selects) {
+    sel = _node(q, Q_CAPTURE);
+    if (sel >= 0) {
+      q->nodes[sel].sub = (unsigned int) root;
+      q->nodes[sel].selects = 1;
+    }
+    root = sel;
+  }
+
+  if (root < 0) {
+    destroy_sexp_query(q);
+    return NULL;
+  }
+
+  q->root = (unsigned int) root;
+
+  return q;
+}
+
+void
+destroy_sexp_query (sexp_query_t * q)
+{
+  if (q == NULL) return;
+
+  if (q->nodes != NULL)
+    sexp_free(q->nodes, q->capnodes * sizeof(qnode_t));
+  if (q->kids != NULL)
+    sexp_free(q->kids, q->capkids * sizeof(unsigned int));
+  if (q->text != NULL)
+    sexp_free(q->text, q->captext);
+
+  sexp_free(q, sizeof(sexp_query_t));
+}
+
+/*========================*/
+/* matching               */
+/*========================*/
+
+/**
+ * A selected element.  In streams, sx is a copy built from the events and
+ * owned by the list; otherwise it points into the expression matched.
+ */
+typedef struct qsel {
+  sexp_t *sx;
+  struct qsel *next;
+} qsel_t;
+
+/**
+ * Copy of a selected list being built from stream events: the open lists
+ * of the copy, each with its last element so far.
+ */
+typedef struct qopen {
+  sexp_t *list;
+  sexp_t *last;
+} qopen_t;
+
+typedef struct qbuild {
+  struct qbuild *next;
+  sexp_t *root;
+  qopen_t *open;
+  size_t depth;
+  size_t cap;
+} qbuild_t;
+
+/**
+ * An element being matched against a pattern.  For Q_LIST, ok is cleared
+ * once the list can no longer match, count is the number of its elements
+ * seen so far and sat[i] is set once element pattern i has been matched;
+ * for Q_CAPTURE and Q_DESC, ok is set once the inner pattern matched.
+ */
+typedef struct qinst {
+  struct qinst *next;
+  struct qinst *parent;
+  unsigned int node;
+  unsigned int slot;
+  unsigned int count;
+  int ok;
+  sexp_t *sx;
+  qbuild_t *build;
+  qsel_t *sel;
+  qsel_t *last;
+  unsigned char sat[1];
+} qinst_t;
+
+typedef struct qrun {
+  const sexp_query_t *q;
+  sexp_query_visitor_t visit;
+  void *data;
+  qinst_t **frames;     /* instances of each open element */
+  size_t depth;
+  size_t cap;
+  size_t instsize;
+  qinst_t *free;        /* instances for reuse */
+  qbuild_t *builds;     /* copies being built */
+  int stream;
+  int count;
+  int stopped;
+  int failed;
+} qrun_t;
+
+static int
+_fail (qrun_t * r)
+{
+  r->failed = 1;
+  sexp_errno = SEXP_ERR_MEMORY;
+  return -1;
+}
+
+static void
+_free_sels (qrun_t * r, qsel_t * s)
+{
+  qsel_t *n;
+
+  for (; s != NULL; s = n) {
+    n = s->next;
+    if (r->stream)
+      destroy_sexp(s->sx);
+    sexp_free(s, sizeof(qsel_t));
+  }
+}
+
+static void
+_free_build (qrun_t * r, qbuild_t * b)
+{
+  qbuild_t **p;
+
+  for (p = &r->builds; *p != NULL; p = &(*p)->next) {
+    if (*p == b) {
+      *p = b->next;
+      break;
+    }
+  }
+
+  if (b->open != NULL)
+    sexp_free(b->open, b->cap * sizeof(qopen_t));
+  sexp_free(b, sizeof(qbuild_t));
+}
+
+static void
+_put_inst (qrun_t * r, qinst_t * in)
+{
+  if (in->build != NULL) {
+    if (in->build->root != NULL)
+      destroy_sexp(in->build->root);
+    _free_build(r, in->build);
+  }
+  _free_sels(r, in->sel);
+
+  in->next = r->free;
+  r->free = in;
+}
+
+static qinst_t *
+_get_inst (qrun_t * r, unsigned int node, qinst_t * parent,
+           unsigned int slot)
+{
+  qinst_t *in = r->free;
+
+  if (in != NULL) {
+    r->free = in->next;
+  } else {
+#ifdef __cplusplus
+    in = (qinst_t *)sexp_malloc(r->instsize);
+#else
+    in = sexp_malloc(r->instsize);
+#endif
+    if (in == NULL) {
+      _fail(r);
+      return NULL;
+    }
+  }
+
+  memset(in, 0, r->instsize);
+  in->node = node;
+  in->parent = parent;
+  in->slot = slot;
+
+  /* instances on an element are ended newest first, so an inner pattern
+     on the same element ends before the one it was created for. */
+  in->next = r->frames[r->depth-1];
+  r->frames[r->depth-1] = in;
+
+  return in;
+}
+
+/**
+ * Hand the selections of a matching top level pattern to the user.
+ */
+static void
+_deliver (qrun_t * r, qsel_t * s)
+{
+  qsel_t *n;
+
+  for (; s != NULL; s = n) {
+    n = s->next;
+    if (!r->stopped) {
+      r->count++;
+      if (r->visit(s->sx, r->data) == SEXP_WALK_STOP)
+        r->stopped = 1;
+    }
+    if (r->stream)
+      destroy_sexp(s->sx);
+    sexp_free(s, sizeof(qsel_t));
+  }
+}
+
+/**
+ * Tell the instance \a p whether the pattern tried for its slot \a slot
+ * matched, handing it the selections made.
+ */
+static void
+_report (qrun_t * r, qinst_t * p, unsigned int slot, int ok,
+         qsel_t * sel, qsel_t * last)
+{
+  if (p == NULL) {
+    if (ok)
+      _deliver(r, sel);
+    else
+      _free_sels(r, sel);
+    return;
+  }
+
+  if (!ok) {
+    _free_sels(r, sel);
+    /* a list whose head does not match can not match. */
+    if (r->q->nodes[p->node].kind == Q_LIST && slot == 0) {
+      p->ok = 0;
+      _free_sels(r, p->sel);
+      p->sel = p->last = NULL;
+    }
+    return;
+  }
+
+  if (r->q->nodes[p->node].kind == Q_LIST) {
+    if (!p->ok) {
+      _free_sels(r, sel);
+      return;
+    }
+    p->sat[slot] = 1;
+  } else {
+    p->ok = 1;
+  }
+
+  if (sel != NULL) {
+    if (p->last != NULL)
+      p->last->next = sel;
+    else
+      p->sel = sel;
+    p->last = last;
+  }
+}
+
+static qsel_t *
+_sel (qrun_t * r, sexp_t * sx)
+{
+  qsel_t *s;
+
+#ifdef __cplusplus
+  s = (qsel_t *)sexp_malloc(sizeof(qsel_t));
+#else
+  s = sexp_malloc(sizeof(qsel_t));
+#endif
+  if (s == NULL) {
+    _fail(r);
+    return NULL;
+  }
+
+  s->sx = sx;
+  s->next = NULL;
+
+  return s;
+}
+
+/**
+ * A copy of the atom with the given contents.
+ */
+static sexp_t *
+_atom_copy (const char *val, size_t len, atom_t aty)
+{
+  char *bin;
+  sexp_t *sx;
+
+  if (aty != SEXP_BINARY)
+    return new_sexp_atom(val, len, aty);
+
+#ifdef __cplusplus
+  bin = (char *)sexp_malloc(len);
+#else
+  bin = sexp_malloc(len);
+#endif
+  if (bin == NULL && len > 0)
+    return NULL;
+  if (len > 0)
+    memcpy(bin, val, len);
+
+  sx = new_sexp_binary_atom(bin, len);
+  if (sx == NULL && bin != NULL)
+    sexp_free(bin, len);
+
+  return sx;
+}
+
+/**
+ * Add an element to the copy \a b.  A list is opened.
+ */
+static int
+_build_add (qbuild_t * b, sexp_t * sx)
+{
+  qopen_t *o;
+
+  if (b->depth > 0) {
+    o = &b->open[b->depth-1];
+    if (o->last != NULL)
+      o->last->next = sx;
+    else
+      o->list->list = sx;
+    o->last = sx;
+  } else {
+    b->root = sx;
+  }
+
+  if (sx->ty != SEXP_LIST)
+    return 0;
+
+  if (_reserve((void **) &b->open, b->depth, &b->cap, 1, sizeof(qopen_t)))
+    return -1;
+
+  b->open[b->depth].list = sx;
+  b->open[b->depth].last = NULL;
+  b->depth++;
+
+  return 0;
+}
+
+/**
+ * Try the element that just started (the top of the frame stack) against
+ * pattern \a node on behalf of instance \a parent.
+ */
+static int
+_try (qrun_t * r, unsigned int node, qinst_t * parent, unsigned int slot,
+      sexp_t * sx, int is_list, const char *val, size_t len, atom_t aty)
+{
+  const qnode_t *n = &r->q->nodes[node];
+  qinst_t *in;
+  qbuild_t *b;
+  sexp_t *copy;
+
+  switch (n->kind) {
+  case Q_ANY:
+    _report(r, parent, slot, 1, NULL, NULL);
+    return 0;
+
+  case Q_LIT:
+    _report(r, parent, slot,
+            !is_list && aty != SEXP_BINARY && len == n->len &&
+            (len == 0 || memcmp(val, r->q->text + n->off, len) == 0),
+            NULL, NULL);
+    return 0;
+
+  case Q_LIST:
+    if (!is_list) {
+      _report(r, parent, slot, 0, NULL, NULL);
+      return 0;
+    }
+    in = _get_inst(r, node, parent, slot);
+    if (in == NULL)
+      return -1;
+    in->ok = 1;
+    return 0;
+
+  case Q_CAPTURE:
+    in = _get_inst(r, node, parent, slot);
+    if (in == NULL)
+      return -1;
+    if (!r->stream) {
+      in->sx = sx;
+    } else {
+#ifdef __cplusplus
+      b = (qbuild_t *)sexp_calloc(1, sizeof(qbuild_t));
+#else
+      b = sexp_calloc(1, sizeof(qbuild_t));
+#endif
+      if (b == NULL)
+        return _fail(r);
+      in->build = b;
+      copy = is_list ? new_sexp_list(NULL) : _atom_copy(val, len, aty);
+      if (copy == NULL || _build_add(b, copy) != 0)
+        return _fail(r);
+      /* a list copy gets the elements up to the end of the list. */
+      if (is_list) {
+        b->next = r->builds;
+        r->builds = b;
+      }
+    }
+    return _try(r, n->sub, in, 0, sx, is_list, val, len, aty);
+
+  case Q_DESC:
+    in = _get_inst(r, node, parent, slot);
+    if (in == NULL)
+      return -1;
+    return _try(r, n->sub, in, 0, sx, is_list, val, len, aty);
+
+  default:
+    /* positional patterns are resolved by the list pattern. */
+    _report(r, parent, slot, 0, NULL, NULL);
+    return 0;
+  }
+}
+
+static int _end (qrun_t * r, int is_list);
+
+/**
+ * An element starts: a list, or an atom (which ends right away).
+ */
+static int
+_start (qrun_t * r, sexp_t * sx, int is_list, const char *val, size_t len,
+        atom_t aty)
+{
+  const sexp_query_t *q = r->q;
+  const qnode_t *n, *kn;
+  qinst_t *in;
+  qbuild_t *b;
+  sexp_t *copy;
+  unsigned int i, k, kid;
+
+  if (r->failed || r->stopped)
+    return 0;
+
+  /* the copies being built get the element. */
+  for (b = r->builds; b != NULL; b = b->next) {
+    copy = is_list ? new_sexp_list(NULL) : _atom_copy(val, len, aty);
+    if (copy == NULL)
+      return _fail(r);
+    if (_build_add(b, copy) != 0)
+      return _fail(r);
+  }
+
+  if (_reserve((void **) &r->frames, r->depth, &r->cap, 1, sizeof(qinst_t *)))
+    return _fail(r);
+  r->frames[r->depth++] = NULL;
+
+  if (r->depth == 1) {
+    if (_try(r, q->root, NULL, 0, sx, is_list, val, len, aty) != 0)
+      return -1;
+  } else {
+    for (in = r->frames[r->depth-2]; in != NULL; in = in->next) {
+      n = &q->nodes[in->node];
+
+      if (n->kind == Q_DESC) {
+        if (_try(r, in->node, in, 0, sx, is_list, val, len, aty) != 0)
+          return -1;
+        continue;
+      }
+
+      if (n->kind != Q_LIST || !in->ok)
+        continue;
+
+      k = in->count++;
+
+      if (n->nkids == 0) {
+        in->ok = 0;
+        continue;
+      }
+
+      if (k == 0) {
+        if (_try(r, q->kids[n->first], in, 0, sx, is_list, val, len,
+                 aty) != 0)
+          return -1;
+        continue;
+      }
+
+      for (i = 1; i < n->nkids && in->ok; i++) {
+        kid = q->kids[n->first + i];
+        kn = &q->nodes[kid];
+
+        /* once matched, a pattern only needs trying for its selections. */
+        if (in->sat[i] && !kn->selects)
+          continue;
+
+        if (kn->kind == Q_POS) {
+          if (kn->pos != k)
+            continue;
+          kid = kn->sub;
+        }
+
+        if (_try(r, kid, in, i, sx, is_list, val, len, aty) != 0)
+          return -1;
+      }
+    }
+  }
+
+  return is_list ? 0 : _end(r, 0);
+}
+
+/**
+ * The element on top of the frame stack ends.
+ */
+static int
+_end (qrun_t * r, int is_list)
+{
+  const qnode_t *n;
+  qinst_t *in, *next;
+  qbuild_t **b;
+  qsel_t *s;
+  unsigned int i;
+  int ok;
+
+  if (r->failed || r->stopped || r->depth == 0)
+    return 0;
+
+  /* close the list in the copies; copies of it are complete. */
+  if (is_list) {
+    for (b = &r->builds; *b != NULL; ) {
+      if (--(*b)->depth == 0)
+        *b = (*b)->next;
+      else
+        b = &(*b)->next;
+    }
+  }
+
+  for (in = r->frames[r->depth-1]; in != NULL; in = next) {
+    next = in->next;
+    n = &r->q->nodes[in->node];
+
+    switch (n->kind) {
+    case Q_LIST:
+      ok = in->ok && in->count > 0;
+      if (n->nkids == 0)
+        ok = in->ok && in->count == 0;
+      for (i = 0; i < n->nkids && ok; i++)
+        ok = in->sat[i];
+      break;
+
+    case Q_CAPTURE:
+      ok = in->ok;
+      if (ok) {
+        if (in->build != NULL) {
+          s = _sel(r, in->build->root);
+          if (s != NULL) {
+            in->build->root = NULL;
+            _free_build(r, in->build);
+            in->build = NULL;
+          }
+        } else {
+          s = _sel(r, in->sx);
+        }
+        if (s == NULL)
+          return -1;
+        s->next = in->sel;
+        in->sel = s;
+        if (in->last == NULL)
+          in->last = s;
+      }
+      break;
+
+    default:
+      ok = in->ok;
+      break;
+    }
+
+    if (ok) {
+      _report(r, in->parent, in->slot, 1, in->sel, in->last);
+      in->sel = in->last = NULL;
+    } else {
+      _report(r, in->parent, in->slot, 0, NULL, NULL);
+    }
+
+    r->frames[r->depth-1] = next;
+    _put_inst(r, in);
+  }
+
+  r->depth--;
+
+  return 0;
+}
+
+static int
+_run_init (qrun_t * r, const sexp_query_t * q, sexp_query_visitor_t visit,
+           void *data, int stream)
+{
+  memset(r, 0, sizeof(qrun_t));
+  r->q = q;
+  r->visit = visit;
+  r->data = data;
+  r->stream = stream;
+  r->instsize = sizeof(qinst_t) + q->maxkids;
+
+  return 0;
+}
+
+/**
+ * Drop whatever a stopped or failed match left behind.
+ */
+static void
+_run_free (qrun_t * r)
+{
+  qinst_t *in, *next;
+
+  while (r->depth > 0) {
+    for (in = r->frames[r->depth-1]; in != NULL; in = next) {
+      next = in->next;
+      _put_inst(r, in);
+    }
+    r->depth--;
+  }
+
+  for (in = r->free; in != NULL; in = next) {
+    next = in->next;
+    sexp_free(in, r->instsize);
+  }
+  r->free = NULL;
+
+  if (r->frames != NULL)
+    sexp_free(r->frames, r->cap * sizeof(qinst_t *));
+  r->frames = NULL;
+  r->cap = 0;
+}
+
+static sexp_walk_t
+_run_pre (sexp_t * sx, unsigned int depth, void *data)
+{
+  qrun_t *r = (qrun_t *) data;
+  char nbuf[SEXP_NUMBER_MAX];
+  const char *t;
+  size_t len;
+
+  if (sx->ty == SEXP_LIST)
+    _start(r, sx, 1, NULL, 0, SEXP_BASIC);
+  else if (sx->aty == SEXP_BINARY)
+    _start(r, sx, 0, sx->bindata, sx->binlength, SEXP_BINARY);
+  else {
+    t = sexp_atom_text(sx, nbuf, &len);
+    _start(r, sx, 0, t, len, sx->aty);
+  }
+
+  return (r->failed || r->stopped) ? SEXP_WALK_STOP : SEXP_WALK_CONTINUE;
+}
+
+static sexp_walk_t
+_run_post (sexp_t * sx, unsigned int depth, void *data)
+{
+  qrun_t *r = (qrun_t *) data;
+
+  if (sx->ty == SEXP_LIST)
+    _end(r, 1);
+
+  return (r->failed || r->stopped) ? SEXP_WALK_STOP : SEXP_WALK_CONTINUE;
+}
+
+int
+sexp_query_run (const sexp_query_t * q, sexp_t * sx,
+                sexp_query_visitor_t visit, void *data)
+{
+  qrun_t r;
+  sexp_errcode_t olderr;
+  sexp_t *stop;
+
+  if (q == NULL || visit == NULL) {
+    sexp_errno = SEXP_ERR_BAD_PARAM;
+    return -1;
+  }
+
+  _run_init(&r, q, visit, data, 0);
+
+  olderr = sexp_errno;
+  sexp_errno = SEXP_ERR_OK;
+
+  stop = sexp_walk(sx, _run_pre, _run_post, &r);
+  if (stop == NULL && sexp_errno != SEXP_ERR_OK)
+    r.failed = 1;
+
+  _run_free(&r);
+
+  if (r.failed)
+    return -1;
+
+  sexp_errno = olderr;
+
+  return r.count;
+}
+
+/*========================*/
+/* streams                */
+/*========================*/
+
+struct sexp_query_stream {
+  qrun_t run;
+  sexp_event_sink_t sink;
+};
+
+static void
+_ev_start (void *data)
+{
+  _start(&((sexp_query_stream_t *) data)->run, NULL, 1, NULL, 0,
+         SEXP_BASIC);
+}
+
+static void
+_ev_end (void *data)
+{
+  _end(&((sexp_query_stream_t *) data)->run, 1);
+}
+
+static void
+_ev_characters (void *data, const char *val, size_t len, atom_t aty)
+{
+  _start(&((sexp_query_stream_t *) data)->run, NULL, 0, val, len, aty);
+}
+
+static void
+_ev_binary (void *data, const char *bin, size_t len)
+{
+  _start(&((sexp_query_stream_t *) data)->run, NULL, 0, bin, len,
+         SEXP_BINARY);
+}
+
+sexp_query_stream_t *
+new_sexp_query_stream (const sexp_query_t * q, sexp_query_visitor_t visit,
+                       void *data)
+{
+  sexp_query_stream_t *qs;
+
+  if (q == NULL || visit == NULL) {
+    sexp_errno = SEXP_ERR_BAD_PARAM;
+    return NULL;
+  }
+
+#ifdef __cplusplus
+  qs = (sexp_query_stream_t *)sexp_malloc(sizeof(sexp_query_stream_t));
+#else
+  qs = sexp_malloc(sizeof(sexp_query_stream_t));
+#endif
+  if (qs == NULL) {
+    sexp_errno = SEXP_ERR_MEMORY;
+    return NULL;
+  }
+
+  _run_init(&qs->run, q, visit, data, 1);
+
+  qs->sink.start_sexpr = _ev_start;
+  qs->sink.end_sexpr = _ev_end;
+  qs->sink.characters = _ev_characters;
+  qs->sink.binary = _ev_binary;
+  qs->sink.data = qs;
+
+  return qs;
+}
+
+void
+destroy_sexp_query_stream (sexp_query_stream_t * qs)
+{
+  if (qs == NULL) return;
+
+  _run_free(&qs->run);
+  sexp_free(qs, sizeof(sexp_query_stream_t));
+}
+
+void
+sexp_query_attach (sexp_query_stream_t * qs, pcont_t * cc)
+{
+  if (qs == NULL || cc == NULL) {
+    sexp_errno = SEXP_ERR_BAD_PARAM;
+    return;
+  }
+
+  cc->mode = PARSER_EVENTS_ONLY;
+  cc->event_sink = &qs->sink;
+}
+
+int
+sexp_query_stream_count (const sexp_query_stream_t * qs)
+{
+  if (qs == NULL || qs->run.failed)
+    return -1;
+
+  return qs->run.count;
+}
@@ -0,0 +1,151 @@
+/**
+   @cond IGNORE
+
+   ======================================================
+   SFSEXP: Small, Fast S-Expression Library
+   Written by Matthew Sottile (mjsottile@gmail.com)
+   ======================================================
+
+   Copyright (2003-2006). The Regents of the University of California. This
+   material was produced under U.S. Government contract W-7405-ENG-36 for Los
+   Alamos National Laboratory, which is operated by the University of
+   California for the U.S. Department of Energy. The U.S. Government has rights
+   to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+   THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+   LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+   derivative works, such modified software should be clearly marked, so as not
+   to confuse it with the version available from LANL.
+
+   Additionally, this library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of the
+   License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+   LA-CC-04-094
+
+   @endcond
+**/
+#ifndef __SEXP_QUERY_H__
+#define __SEXP_QUERY_H__
+
+/**
+ * \file sexp_query.h
+ *
+ * \brief Path queries: patterns that select parts of s-expressions.
+ *
+ * A query is itself an s-expression, compiled once and then matched
+ * against any number of expressions, either trees or the event stream of
+ * the events-only parser.  In a query:
+ *
+ * - an atom matches an atom with the same text (quotes are ignored);
+ * - <tt>*</tt> matches any one element;
+ * - <tt>?</tt> matches any one element and selects it;
+ * - <tt>(? p)</tt> selects an element matching the pattern p;
+ * - <tt>(// p)</tt> matches an element if it, or any element nested inside
+ *   it, matches p (the descendant axis);
+ * - <tt>(h p1 ... pn)</tt> matches a list whose first element matches h
+ *   and which has, for each pi, some later element matching pi;
+ * - <tt>(@ n p)</tt>, as one of the pi of a list pattern, requires that
+ *   element number n of the list, counting the head as 0, match p;
+ * - <tt>()</tt> matches the empty list.
+ *
+ * The special atoms are only special when unquoted: <tt>"*"</tt> matches
+ * an atom <tt>*</tt>.  A match selects every element matched by a
+ * selecting pattern, in document order; a query without <tt>?</tt>
+ * selects the top level elements it matches.  For example,
+ * <tt>(config (server * (port ?)))</tt> selects the port numbers of the
+ * servers of a config, and <tt>(// (port ?))</tt> every port number
+ * anywhere.
+ */
+
+#include "sexp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /**
+   * A compiled query.  The contents are private to sexp_query.c.
+   */
+  typedef struct sexp_query sexp_query_t;
+
+  /**
+   * A query being matched against the events-only parser.  The contents
+   * are private to sexp_query.c.
+   */
+  typedef struct sexp_query_stream sexp_query_stream_t;
+
+  /**
+   * Called for each element a query selects.  Return SEXP_WALK_STOP to end
+   * the search, anything else to go on.
+   */
+  typedef sexp_walk_t (*sexp_query_visitor_t)(sexp_t *sx, void *data);
+
+  /**
+   * Compile the query in the string \a query.  Returns NULL and sets
+   * sexp_errno on failure: SEXP_ERR_BAD_PARAM if the string is not a
+   * valid query.
+   */
+  sexp_query_t *new_sexp_query(const char *query);
+
+  /**
+   * Destroy a compiled query.
+   */
+  void destroy_sexp_query(sexp_query_t *q);
+
+  /**
+   * Match \a q against \a sx and each element on its next chain, passing
+   * each selected element (a pointer into sx) to \a visit.  A query is only
+   * read while matching, so it may be used by several threads at once.
+   *
+   * \return The number of elements selected, or -1 with sexp_errno set if
+   *         memory ran out.
+   */
+  int sexp_query_run(const sexp_query_t *q, sexp_t *sx,
+                     sexp_query_visitor_t visit, void *data);
+
+  /**
+   * Create a stream matching \a q against the expressions parsed by a
+   * continuation (see sexp_query_attach), without building them.  Only
+   * the elements the query selects are built, and then only once the
+   * expression around them is known to match; each is passed to
+   * \a visit and destroyed when visit returns, so visit must copy
+   * anything it wants to keep.  Returns NULL and sets sexp_errno on
+   * failure.
+   */
+  sexp_query_stream_t *new_sexp_query_stream(const sexp_query_t *q,
+                                             sexp_query_visitor_t visit,
+                                             void *data);
+
+  /**
+   * Destroy a query stream.  Detach it from its continuation first.
+   */
+  void destroy_sexp_query_stream(sexp_query_stream_t *qs);
+
+  /**
+   * Switch the continuation \a cc to the events-only parser, feeding its
+   * events to \a qs.  cparse_sexp then returns with last_sexp set to NULL
+   * after each expression, as usual in that mode.
+   */
+  void sexp_query_attach(sexp_query_stream_t *qs, pcont_t *cc);
+
+  /**
+   * The number of elements \a qs has selected so far, or -1 if it ran out
+   * of memory, in which case it ignores further events.
+   */
+  int sexp_query_stream_count(const sexp_query_stream_t *qs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SEXP_QUERY_H__ */
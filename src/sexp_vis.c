@@ -37,67 +37,73 @@
 #include "faststack.h"
 #include "sexp.h"
 
-static void _sexp_to_dotfile(const sexp_t *sx, FILE *fp) {
-  const sexp_t *tmp;
-
-  tmp = sx;
-
-  while (tmp != NULL) {
-    fprintf(fp,"  sx%lu [shape=record,label=\"",(unsigned long)tmp);
-    if (tmp->ty == SEXP_VALUE) {
-      fprintf(fp,"{ <type> SEXP_VALUE | ");
-      switch (tmp->aty) {
-      case SEXP_BASIC:
-        fprintf(fp,"SEXP_BASIC }");
-        break;
-      case SEXP_SQUOTE:
-        fprintf(fp,"SEXP_SQUOTE }");
-        break;
-      case SEXP_DQUOTE:
-        fprintf(fp,"SEXP_DQUOTE }");
-        break;
-      case SEXP_BINARY:
-        fprintf(fp,"SEXP_BINARY }");
-        break;
-      default:
-        fprintf(fp,"ATY Unknown }");
-        break;
-      }
-    } else
-      fprintf(fp,"<type> SEXP_LIST");
-
-    if (tmp->ty == SEXP_LIST) {
-      fprintf(fp,"| <list> list | <next> next\"];\n");
-
-      if (tmp->list != NULL) {
-        fprintf(fp,"  sx%lu:list -> sx%lu:type;\n",
-                (unsigned long)tmp,
-                (unsigned long)tmp->list);
-        _sexp_to_dotfile(tmp->list,fp);
-      }
-      if (tmp->next != NULL)
-        fprintf(fp,"  sx%lu:next -> sx%lu:type;\n",
-                (unsigned long)tmp,
-                (unsigned long)tmp->next);
-      tmp = tmp->next;
-    } else {
-      if (tmp->aty == SEXP_BINARY)
-        fprintf(fp,"| binlength=%lu | <next> next\"];\n",
-                (unsigned long)tmp->binlength);
-      else
-        fprintf(fp,"| { va=%lu | vu=%lu } | val=%s | <next> next\"];\n",
-                (unsigned long)tmp->val_allocated,
-                (unsigned long)tmp->val_used,
-                tmp->val);
-
-      if (tmp->next != NULL)
-        fprintf(fp,"  sx%lu:next -> sx%lu:type;\n",
-                (unsigned long)tmp,
-                (unsigned long)tmp->next);
-      tmp = tmp->next;
-
+/*
+ * The record for an element and its list edge are written before the
+ * contents of the list, and the next edge after them, which is the order
+ * the old recursive writer produced.
+ */
+static sexp_walk_t _dot_pre(sexp_t *tmp, unsigned int depth, void *data) {
+  FILE *fp = (FILE *)data;
+  char nbuf[SEXP_NUMBER_MAX];
+
+  fprintf(fp,"  sx%lu [shape=record,label=\"",(unsigned long)tmp);
+  if (tmp->ty == SEXP_VALUE) {
+    fprintf(fp,"{ <type> SEXP_VALUE | ");
+    switch (tmp->aty) {
+    case SEXP_BASIC:
+      fprintf(fp,"SEXP_BASIC }");
+      break;
+    case SEXP_SQUOTE:
+      fprintf(fp,"SEXP_SQUOTE }");
+      break;
+    case SEXP_DQUOTE:
+      fprintf(fp,"SEXP_DQUOTE }");
+      break;
+    case SEXP_BINARY:
+      fprintf(fp,"SEXP_BINARY }");
+      break;
+    default:
+      fprintf(fp,"ATY Unknown }");
+      break;
     }
+  } else
+    fprintf(fp,"<type> SEXP_LIST");
+
+  if (tmp->ty == SEXP_LIST) {
+    fprintf(fp,"| <list> list | <next> next\"];\n");
+
+    if (tmp->list != NULL)
+      fprintf(fp,"  sx%lu:list -> sx%lu:type;\n",
+              (unsigned long)tmp,
+              (unsigned long)tmp->list);
+  } else {
+    if (tmp->aty == SEXP_BINARY)
+      fprintf(fp,"| binlength=%lu | <next> next\"];\n",
+              (unsigned long)tmp->binlength);
+    else
+      fprintf(fp,"| { va=%lu | vu=%lu } | val=%s | <next> next\"];\n",
+              (unsigned long)tmp->val_allocated,
+              (unsigned long)tmp->val_used,
+              sexp_atom_text(tmp, nbuf, NULL));
   }
+
+  return SEXP_WALK_CONTINUE;
+}
+
+static sexp_walk_t _dot_post(sexp_t *tmp, unsigned int depth, void *data) {
+  FILE *fp = (FILE *)data;
+
+  if (tmp->next != NULL)
+    fprintf(fp,"  sx%lu:next -> sx%lu:type;\n",
+            (unsigned long)tmp,
+            (unsigned long)tmp->next);
+
+  return SEXP_WALK_CONTINUE;
+}
+
+static void _sexp_to_dotfile(const sexp_t *sx, FILE *fp) {
+  /* the walk only reads sx; the cast is for the visitor signature. */
+  sexp_walk((sexp_t *)sx, _dot_pre, _dot_post, fp);
 }
 
 sexp_errcode_t sexp_to_dotfile(const sexp_t *sx, const char *fname) {
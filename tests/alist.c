@@ -0,0 +1,181 @@
+/**
+
+SFSEXP: Small, Fast S-Expression Library version 1.0
+Written by Matthew Sottile (mjsottile@gmail.com)
+
+Copyright (2003-2006). The Regents of the University of California. This
+material was produced under U.S. Government contract W-7405-ENG-36 for Los
+Alamos National Laboratory, which is operated by the University of
+California for the U.S. Department of Energy. The U.S. Government has rights
+to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+derivative works, such modified software should be clearly marked, so as not
+to confuse it with the version available from LANL.
+
+Additionally, this library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation; either version 2.1 of the
+License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation,
+Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+LA-CC-04-094
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sexp.h"
+#include "test_util.h"
+
+/**
+ * look up association lists through an index, and check the answers
+ * against a scan of the list before and after changing it.
+ */
+
+/* the first entry with key, by scanning */
+static sexp_t *scan(sexp_t *sx, const char *key) {
+  sexp_t *t;
+
+  for (t = sx->list; t != NULL; t = t->next)
+    if (t->ty == SEXP_LIST && t->list != NULL &&
+        t->list->ty == SEXP_VALUE && strcmp(t->list->val, key) == 0)
+      return t;
+  return NULL;
+}
+
+static char text[] =
+  "((port 80) (host \"example.org\") atom () ((nested) x) "
+  "(port 8080) (\"quoted key\" yes) (empty))";
+
+static const char *keys[] = {
+  "port", "host", "atom", "nested", "quoted key", "empty", "missing", "",
+  NULL
+};
+
+static void check_all(sexp_alist_t *idx, sexp_t *sx, const char *what) {
+  int i;
+
+  for (i = 0; keys[i] != NULL; i++)
+    check(sexp_alist_get(idx, keys[i]) == scan(sx, keys[i]), what);
+}
+
+int main(int argc, char **argv) {
+  char name[32];
+  sexp_t *sx, *t, *last;
+  sexp_alist_t *idx;
+  sexp_cursor_t *cur;
+  sexp_intern_t *tab;
+  pcont_t *cc;
+  int i;
+
+  sx = parse_sexp(text, strlen(text));
+  check(sx != NULL, "parse");
+  idx = sexp_alist_index(sx);
+  check(idx != NULL, "index");
+  check_all(idx, sx, "lookup");
+  check(strcmp(sexp_alist_get(idx, "port")->list->next->val, "80") == 0,
+        "first entry wins");
+  check(sexp_alist_get(idx, "atom") == NULL, "atoms are not entries");
+  check(sexp_alist_get(idx, "nested") == NULL, "list keys are ignored");
+
+  /* add many entries, then look them all up */
+  for (last = sx->list; last->next != NULL; last = last->next)
+    ;
+  for (i = 0; i < 1000; i++) {
+    sprintf(name, "key%d", i);
+    t = new_sexp_list(new_sexp_atom(name, strlen(name), SEXP_BASIC));
+    t->list->next = new_sexp_atom("v", 1, SEXP_BASIC);
+    last->next = t;
+    last = t;
+  }
+  check(sexp_alist_get(idx, "key10") == NULL, "not seen before invalidate");
+  sexp_alist_invalidate(idx);
+  for (i = 0; i < 1000; i++) {
+    sprintf(name, "key%d", i);
+    check(sexp_alist_get(idx, name) == scan(sx, name) &&
+          sexp_alist_get(idx, name) != NULL, "added entry");
+  }
+  check_all(idx, sx, "after adding");
+
+  /* remove the first port; the second one is found */
+  t = sx->list;
+  sx->list = t->next;
+  t->next = NULL;
+  destroy_sexp(t);
+  sexp_alist_invalidate(idx);
+  check(strcmp(sexp_alist_get(idx, "port")->list->next->val, "8080") == 0,
+        "second entry after removing the first");
+  check_all(idx, sx, "after removing");
+
+  /* edits through a cursor move the generation of the list on, and the
+     index sees them without being invalidated: rename an entry */
+  cur = new_sexp_cursor(sx);
+  check(cur != NULL && sexp_cursor_down(cur) == 1 &&
+        sexp_cursor_down(cur) == 1, "cursor");
+  t = sexp_cursor_replace(cur, new_sexp_atom("server", 6, SEXP_BASIC));
+  check(t != NULL && strcmp(t->val, "host") == 0, "cursor replace");
+  destroy_sexp(t);
+  check(sexp_alist_get(idx, "server") == scan(sx, "server") &&
+        sexp_alist_get(idx, "server") != NULL, "renamed through a cursor");
+  check(sexp_alist_get(idx, "host") == NULL, "old name gone");
+
+  /* and add one in front of the others */
+  check(sexp_cursor_up(cur) == 1, "cursor up");
+  t = new_sexp_list(new_sexp_atom("user", 4, SEXP_BASIC));
+  check(sexp_cursor_insert(cur, t) == 0, "cursor insert");
+  check(sexp_alist_get(idx, "user") == t, "added through a cursor");
+  destroy_sexp_cursor(cur);
+
+  destroy_sexp_alist(idx);
+  destroy_sexp(sx);
+
+  /* errors */
+  sx = new_sexp_atom("a", 1, SEXP_BASIC);
+  check(sexp_alist_index(sx) == NULL && sexp_errno == SEXP_ERR_BAD_PARAM,
+        "atom");
+  check(sexp_alist_index(NULL) == NULL && sexp_errno == SEXP_ERR_BAD_PARAM,
+        "NULL");
+  destroy_sexp(sx);
+
+  /* interned keys */
+  tab = new_sexp_intern(0);
+  check(tab != NULL, "intern table");
+  cc = init_continuation(NULL);
+  check(cc != NULL, "continuation");
+  cc->intern = tab;
+  sx = iparse_sexp(text, strlen(text), cc);
+  check(sx != NULL, "interned parse");
+  idx = sexp_alist_index(sx);
+  check(idx != NULL, "interned index");
+  check_all(idx, sx, "interned lookup");
+  destroy_sexp_alist(idx);
+  destroy_sexp(sx);
+  destroy_continuation(cc);
+  destroy_sexp_intern(tab);
+
+  /* a lazy list and its lazy entries are built */
+  sx = parse_sexp_lazy(text, strlen(text));
+  check(sx != NULL, "lazy parse");
+  idx = sexp_alist_index(sx);
+  check(idx != NULL, "lazy index");
+  check(!(sx->flags & SEXP_FLAG_LAZY), "lazy list built");
+  check_all(idx, sx, "lazy lookup");
+  destroy_sexp_alist(idx);
+  destroy_sexp(sx);
+
+  sexp_cleanup();
+
+  printf("association list tests passed\n");
+
+  return 0;
+}
@@ -0,0 +1,136 @@
+/**
+
+SFSEXP: Small, Fast S-Expression Library version 1.0
+Written by Matthew Sottile (mjsottile@gmail.com)
+
+Copyright (2003-2006). The Regents of the University of California. This
+material was produced under U.S. Government contract W-7405-ENG-36 for Los
+Alamos National Laboratory, which is operated by the University of
+California for the U.S. Department of Energy. The U.S. Government has rights
+to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+derivative works, such modified software should be clearly marked, so as not
+to confuse it with the version available from LANL.
+
+Additionally, this library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation; either version 2.1 of the
+License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation,
+Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+LA-CC-04-094
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sexp.h"
+#include "test_util.h"
+
+/**
+ * copy expressions into arenas, with and without sharing atom buffers, and
+ * check that the copies print like the original and stay valid after the
+ * original (and other copies) are gone.
+ */
+
+static const char *input =
+  "(request (id 42) (path \"/a b/c\") 'quoted (nested (x y (z))) () "
+  "(a-rather-long-atom-that-fills-its-buffer-well-past-the-initial-size-"
+  "of-the-parser-value-buffer-so-that-sharing-has-to-grow-it-aaaaaaaaaaaaaa"
+  "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+  "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa))";
+
+int main(int argc, char **argv) {
+  sexp_arena_t *a1, *a2;
+  sexp_t *sx, *bin, *c1, *c2, *c3, *c4;
+  CSTRING *orig = NULL;
+  char *expect, *blob;
+  char buf[32];
+  int i;
+
+  sx = parse_sexp((char *)input, strlen(input));
+  check(sx != NULL, "parse");
+
+  /* the atom owns the blob, so it is freed through sexp_free. */
+  blob = sexp_malloc(4);
+  memcpy(blob, "b in", 4);
+  bin = new_sexp_binary_atom(blob, 4);
+  bin->next = sx->list->next;
+  sx->list->next = bin;
+
+  print_sexp_cstr(&orig, sx, 256);
+  expect = toCharPtr(orig);
+
+  /* small blocks so copies spill over into new ones. */
+  a1 = new_sexp_arena(64);
+  a2 = new_sexp_arena(0);
+  check(a1 != NULL && a2 != NULL, "new_sexp_arena");
+
+  c1 = copy_sexp_into(a1, sx);
+  check(c1 != NULL && (c1->flags & SEXP_FLAG_ARENA), "copy_sexp_into");
+  prints(c1, expect, "copy_sexp_into output");
+
+  c2 = share_sexp_into(a1, sx);
+  check(c2 != NULL, "share_sexp_into");
+  prints(c2, expect, "share_sexp_into output");
+  check(c2->list->val == sx->list->val, "atom buffer shared");
+  check(c2->list->next->bindata != bin->bindata, "binary atom copied");
+
+  /* copies of copies: c3 shares with sx and c2; c4 copies c1's arena text. */
+  c3 = share_sexp_into(a2, c2);
+  c4 = share_sexp_into(a2, c1);
+  check(c3 != NULL && c4 != NULL, "share_sexp_into from arena");
+  check(c3->list->val == sx->list->val, "shared buffer shared again");
+  check(c4->list->val != c1->list->val, "arena text copied");
+
+  /* destroy_sexp leaves arena elements alone. */
+  destroy_sexp(c1);
+
+  /* originals can go away before the copies. */
+  destroy_sexp(sx);
+  prints(c2, expect, "shared copy after source destroyed");
+
+  destroy_sexp_arena(a1);
+  prints(c3, expect, "shared copy after first arena destroyed");
+  prints(c4, expect, "copy of arena copy");
+
+  /* many small copies through one arena. */
+  for (i = 0; i < 1000; i++) {
+    sprintf(buf, "(n %d (m))", i);
+    sx = parse_sexp(buf, strlen(buf));
+    c1 = share_sexp_into(a2, sx);
+    destroy_sexp(sx);
+    prints(c1, buf, "small shared copy");
+  }
+
+  /* constructor atoms have no spare room for the count. */
+  sx = new_sexp_atom("abc", 3, SEXP_BASIC);
+  c1 = share_sexp_into(a2, sx);
+  check(c1 != NULL && c1->val == sx->val && strcmp(c1->val, "abc") == 0,
+        "shared constructor atom");
+  destroy_sexp(sx);
+  check(strcmp(c1->val, "abc") == 0, "constructor atom after destroy");
+
+  check(copy_sexp_into(NULL, c3) == NULL && sexp_errno == SEXP_ERR_BAD_PARAM,
+        "NULL arena");
+  check(copy_sexp_into(a2, NULL) == NULL, "NULL expression");
+
+  destroy_sexp_arena(a2);
+  destroy_sexp_arena(NULL);
+  sdestroy(orig);
+  sexp_cleanup();
+
+  printf("arena tests passed.\n");
+
+  exit(EXIT_SUCCESS);
+}
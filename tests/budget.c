@@ -0,0 +1,217 @@
+/**
+
+SFSEXP: Small, Fast S-Expression Library version 1.0
+Written by Matthew Sottile (mjsottile@gmail.com)
+
+Copyright (2003-2006). The Regents of the University of California. This
+material was produced under U.S. Government contract W-7405-ENG-36 for Los
+Alamos National Laboratory, which is operated by the University of
+California for the U.S. Department of Energy. The U.S. Government has rights
+to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+derivative works, such modified software should be clearly marked, so as not
+to confuse it with the version available from LANL.
+
+Additionally, this library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation; either version 2.1 of the
+License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation,
+Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+LA-CC-04-094
+
+**/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef WIN32
+# include <unistd.h>
+#endif
+#include "sexp.h"
+#include "test_util.h"
+
+/**
+ * parse with a work budget on the continuation, and check that no call
+ * looks at more input than the budget allows and that the results are
+ * those of parsing without one.
+ */
+
+static const char *input =
+  "(a (b \"c \\\" d\" 'e) #b#3#xyz) ; f (\n g hij \"k l\" '(m (n)) (o) ";
+
+static int starts, ends, chars;
+
+static void start(void) { starts++; }
+static void end(void) { ends++; }
+static void characters(const char *s, size_t n, atom_t aty) { chars++; }
+
+/* parse input in pieces of chunk bytes, printing the expressions into
+   out; returns the number of calls made */
+static int run(parsermode_t mode, size_t budget, size_t chunk,
+               char *out, size_t outlen) {
+  parser_event_handlers_t handlers;
+  pcont_t *cc = init_continuation(NULL);
+  static char buf[4096];
+  size_t off, n, used = 0;
+  const char *from;
+  sexp_t *sx;
+  int calls = 0;
+
+  check(cc != NULL, "continuation");
+  memset(&handlers, 0, sizeof(handlers));
+  handlers.start_sexpr = start;
+  handlers.end_sexpr = end;
+  handlers.characters = characters;
+  cc->mode = mode;
+  if (mode == PARSER_EVENTS_ONLY)
+    cc->event_handlers = &handlers;
+  cc->work_budget = budget;
+  starts = ends = chars = 0;
+  out[0] = '\0';
+
+  for (off = 0; input[off] != '\0'; off += n) {
+    n = strlen(input + off);
+    if (n > chunk) n = chunk;
+    memcpy(buf, input + off, n);
+    buf[n] = '\0';
+
+    do {
+      from = (cc->lastPos != NULL) ? cc->lastPos : buf;
+      sx = iparse_sexp(buf, n, cc);
+      calls++;
+      check(cc->error == SEXP_ERR_OK || cc->error == SEXP_ERR_INCOMPLETE,
+            "error");
+      if (budget != 0 && cc->lastPos != NULL)
+        check((size_t) (cc->lastPos - from) <= budget, "over budget");
+      if (sx != NULL) {
+        used += strlen(out + used);
+        check(print_sexp(out + used, outlen - used, sx) >= 0, "print");
+        used += strlen(out + used);
+        out[used++] = '|';
+        out[used] = '\0';
+        destroy_sexp(sx);
+      }
+    } while (cc->lastPos != NULL);
+  }
+
+  destroy_continuation(cc);
+  return calls;
+}
+
+static void expect(parsermode_t mode) {
+  static const size_t budgets[] = { 1, 2, 3, 7, 100 };
+  static const size_t chunks[] = { 4096, 1, 5 };
+  char want[1024], got[1024];
+  int s, e, c, calls;
+  size_t i, j;
+
+  run(mode, 0, 4096, want, sizeof(want));
+  s = starts; e = ends; c = chars;
+
+  for (i = 0; i < sizeof(budgets) / sizeof(budgets[0]); i++)
+    for (j = 0; j < sizeof(chunks) / sizeof(chunks[0]); j++) {
+      calls = run(mode, budgets[i], chunks[j], got, sizeof(got));
+      check(strcmp(got, want) == 0, "expressions");
+      check(starts == s && ends == e && chars == c, "events");
+      if (chunks[j] == 4096)
+        check((size_t) calls >= strlen(input) / budgets[i], "calls");
+    }
+}
+
+#ifndef WIN32
+/* read s through an io wrapper whose continuation has a depth limit and
+   a budget: (a b) comes out, then err, again on the next call */
+static void bad_read(const char *s, unsigned int depth, size_t budget,
+                     sexp_errcode_t err) {
+  sexp_iowrap_t *iow;
+  sexp_t *sx;
+  int fds[2], tries, i;
+
+  check(pipe(fds) == 0, "pipe");
+  check(write(fds[1], s, strlen(s)) == (ssize_t) strlen(s), "write");
+  close(fds[1]);
+  iow = init_iowrap(fds[0]);
+  check(iow != NULL, "io wrapper");
+  iow->cc->max_depth = depth;
+  iow->cc->work_budget = budget;
+
+  for (tries = 0; (sx = read_one_sexp(iow)) == NULL; tries++)
+    check(sexp_errno == SEXP_ERR_INCOMPLETE && tries < 20, "good read");
+  check(strcmp(sx->list->next->val, "b") == 0, "good expression");
+  destroy_sexp(sx);
+
+  for (i = 0; i < 2; i++) {
+    for (tries = 0; (sx = read_one_sexp(iow)) == NULL &&
+           sexp_errno == SEXP_ERR_INCOMPLETE; tries++)
+      check(tries < 20, "bad read");
+    check(sx == NULL && sexp_errno == err, s);
+  }
+
+  destroy_iowrap(iow);
+  close(fds[0]);
+}
+#endif
+
+int main(int argc, char **argv) {
+  char out[1024];
+
+  expect(PARSER_NORMAL);
+  expect(PARSER_INLINE_BINARY);
+  expect(PARSER_EVENTS_ONLY);
+
+  run(PARSER_NORMAL, 0, 4096, out, sizeof(out));
+  check(strcmp(out, "(a (b \"c \\\" d\" 'e) #b#3#xyz)|g|hij|\"k l\"|'(m (n))|(o)|")
+        == 0, "normal");
+  run(PARSER_EVENTS_ONLY, 0, 4096, out, sizeof(out));
+  check(starts == 3 && ends == 3, "event counts");
+
+#ifndef WIN32
+  {
+    sexp_iowrap_t *iow;
+    sexp_t *sx;
+    int fds[2], tries;
+
+    /* a budget stops read_one_sexp short as well, and it picks up where
+       it stopped when called again */
+    check(pipe(fds) == 0, "pipe");
+    strcpy(out, "(abc def) (g)\n");
+    check(write(fds[1], out, strlen(out)) == (ssize_t) strlen(out), "write");
+    close(fds[1]);
+    iow = init_iowrap(fds[0]);
+    check(iow != NULL, "io wrapper");
+    iow->cc->work_budget = 2;
+    for (tries = 0; (sx = read_one_sexp(iow)) == NULL; tries++)
+      check(sexp_errno == SEXP_ERR_INCOMPLETE && tries < 10, "first read");
+    check(tries > 0 && strcmp(sx->list->next->val, "def") == 0, "first");
+    destroy_sexp(sx);
+    for (tries = 0; (sx = read_one_sexp(iow)) == NULL; tries++)
+      check(sexp_errno == SEXP_ERR_INCOMPLETE && tries < 10, "second read");
+    check(strcmp(sx->list->val, "g") == 0, "second");
+    destroy_sexp(sx);
+    destroy_iowrap(iow);
+    close(fds[0]);
+  }
+
+  /* an error stops read_one_sexp every time it is called, with or
+     without a budget, rather than being parsed again forever */
+  bad_read("(a b)) (c d) ", 0, 0, SEXP_ERR_BADFORM);
+  bad_read("(a b)) (c d) ", 0, 2, SEXP_ERR_BADFORM);
+  bad_read("(a b) ((c)) (d) ", 1, 0, SEXP_ERR_LIMIT_DEPTH);
+  bad_read("(a b) ((c)) (d) ", 1, 3, SEXP_ERR_LIMIT_DEPTH);
+#endif
+
+  sexp_cleanup();
+
+  exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,218 @@
+/**
+
+SFSEXP: Small, Fast S-Expression Library version 1.0
+Written by Matthew Sottile (mjsottile@gmail.com)
+
+Copyright (2003-2006). The Regents of the University of California. This
+material was produced under U.S. Government contract W-7405-ENG-36 for Los
+Alamos National Laboratory, which is operated by the University of
+California for the U.S. Department of Energy. The U.S. Government has rights
+to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+derivative works, such modified software should be clearly marked, so as not
+to confuse it with the version available from LANL.
+
+Additionally, this library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation; either version 2.1 of the
+License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation,
+Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+LA-CC-04-094
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sexp.h"
+#include "test_util.h"
+
+/**
+ * build the same expressions as trees, in an arena and as text, and
+ * check them against each other and against what the parser makes of
+ * the text.
+ */
+
+typedef struct out {
+  char buf[65536];
+  size_t used;
+  int calls;
+  int fail;
+} out_t;
+
+static int collect(void *data, const char *buf, size_t len) {
+  out_t *o = (out_t *)data;
+
+  if (o->fail)
+    return -1;
+  check(o->used + len < sizeof(o->buf), "output fits");
+  memcpy(o->buf + o->used, buf, len);
+  o->used += len;
+  o->calls++;
+  return 0;
+}
+
+static char big[6000];
+
+/* (msg "a \"quoted\" \\ string" 'sym (42 -7 0.5 1e+100 0.1) () big)
+   followed by (n i) for i below count */
+static int build(sexp_builder_t *b, int count) {
+  int i;
+
+  sexp_build_begin(b);
+  sexp_build_atom(b, "msg", 3, SEXP_BASIC);
+  sexp_build_atom(b, "a \"quoted\" \\ string", 19, SEXP_DQUOTE);
+  sexp_build_atom(b, "sym", 3, SEXP_SQUOTE);
+  sexp_build_begin(b);
+  sexp_build_int(b, 42);
+  sexp_build_int(b, -7);
+  sexp_build_double(b, 0.5);
+  sexp_build_double(b, 1e100);
+  sexp_build_double(b, 0.1);
+  sexp_build_end(b);
+  sexp_build_begin(b);
+  sexp_build_end(b);
+  sexp_build_atom(b, big, strlen(big), SEXP_BASIC);
+  sexp_build_end(b);
+
+  for (i = 0; i < count; i++) {
+    sexp_build_begin(b);
+    sexp_build_atom(b, "n", 1, SEXP_BASIC);
+    sexp_build_int(b, i);
+    if (sexp_build_end(b) != 0)
+      return -1;
+  }
+
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  static out_t out;
+  static char text[65536];
+  sexp_builder_t *b;
+  sexp_arena_t *arena;
+  sexp_t *sx, *ax, *px, *t, *u;
+  char nbuf[SEXP_NUMBER_MAX];
+  char *line, *end;
+  size_t n;
+  int i;
+
+  memset(big, 'x', sizeof(big) - 1);
+
+  /* a tree */
+  b = new_sexp_builder(NULL);
+  check(b != NULL, "builder");
+  check(build(b, 100) == 0, "build");
+  sx = sexp_build_finish(b);
+  check(sx != NULL, "finish");
+  check(sexp_build_finish(b) == NULL && sexp_errno == SEXP_ERR_OK,
+        "nothing more");
+  check(sexp_list_length(sx) == 6, "elements");
+  check(strcmp(sx->list->next->val, "a \"quoted\" \\ string") == 0 &&
+        sx->list->next->aty == SEXP_DQUOTE, "dquote atom");
+  check(sx->list->next->next->aty == SEXP_SQUOTE, "squote atom");
+  t = sx->list->next->next->next->list;
+  check(t->val == NULL && (t->flags & SEXP_FLAG_INT64) && sexp_int64_value(t) == 42,
+        "numbers keep their value");
+  check(strcmp(sexp_atom_text(t, nbuf, NULL), "42") == 0 &&
+        strcmp(sexp_atom_text(t->next, nbuf, NULL), "-7") == 0 &&
+        strcmp(sexp_atom_text(t->next->next, nbuf, NULL), "0.5") == 0 &&
+        strcmp(sexp_atom_text(t->next->next->next, nbuf, NULL),
+               "1e+100") == 0 &&
+        strcmp(sexp_atom_text(t->next->next->next->next, nbuf, NULL),
+               "0.1") == 0, "numbers");
+  for (t = sx->next, i = 0; t != NULL; t = t->next, i++)
+    check(sexp_int64_value(t->list->next) == i, "chain");
+  check(i == 100, "chain length");
+
+  /* the same in an arena */
+  arena = new_sexp_arena(0);
+  check(arena != NULL, "arena");
+  check(sexp_build_begin(b) == 0 &&
+        sexp_build_finish(b) == NULL && sexp_errno == SEXP_ERR_INCOMPLETE,
+        "open list");
+  destroy_sexp_builder(b);
+  b = new_sexp_builder(arena);
+  check(b != NULL && build(b, 100) == 0, "arena build");
+  ax = sexp_build_finish(b);
+  check(ax != NULL && (ax->flags & SEXP_FLAG_ARENA), "arena elements");
+  for (t = sx, u = ax; t != NULL && u != NULL; t = t->next, u = u->next)
+    check(sexp_equal(t, u) == 1, "arena equal");
+  check(t == NULL && u == NULL, "arena chain");
+  destroy_sexp_builder(b);
+
+  /* as text: the expressions print_sexp gives, one per line */
+  b = new_sexp_builder_writer(collect, &out);
+  check(b != NULL && build(b, 100) == 0 && sexp_build_flush(b) == 0,
+        "write");
+  check(out.calls > 1, "written in pieces");
+  out.buf[out.used] = '\0';
+  for (t = sx, n = 0; t != NULL; t = t->next) {
+    u = t->next;
+    t->next = NULL;
+    i = print_sexp(text + n, sizeof(text) - n, t);
+    t->next = u;
+    check(i > 0, "print");
+    n += i;
+    if (u != NULL)
+      text[n++] = '\n';
+  }
+  text[n] = '\0';
+  check(strcmp(out.buf, text) == 0, "writer matches print_sexp");
+  destroy_sexp_builder(b);
+
+  /* and it parses back */
+  for (t = sx, line = out.buf; t != NULL; t = t->next, line = end + 1) {
+    end = strchr(line, '\n');
+    if (end == NULL)
+      end = line + strlen(line);
+    px = parse_sexp(line, end - line);
+    check(px != NULL && sexp_equal(px, t) == 1, "parse back");
+    destroy_sexp(px);
+  }
+  destroy_sexp(sx);
+  destroy_sexp_arena(arena);
+
+  /* errors stick */
+  b = new_sexp_builder(NULL);
+  check(b != NULL, "builder");
+  check(sexp_build_end(b) == -1 && sexp_errno == SEXP_ERR_BADFORM,
+        "end without begin");
+  sexp_errno = SEXP_ERR_OK;
+  check(sexp_build_begin(b) == -1 && sexp_errno == SEXP_ERR_BADFORM,
+        "error sticks");
+  check(sexp_build_finish(b) == NULL && sexp_errno == SEXP_ERR_BADFORM,
+        "finish after an error");
+  destroy_sexp_builder(b);
+
+  b = new_sexp_builder(NULL);
+  check(sexp_build_atom(b, "x", 1, SEXP_BINARY) == -1 &&
+        sexp_errno == SEXP_ERR_BAD_CONSTRUCTOR, "binary");
+  destroy_sexp_builder(b);
+
+  /* a write that fails */
+  out.used = 0;
+  out.fail = 1;
+  b = new_sexp_builder_writer(collect, &out);
+  check(b != NULL && build(b, 1) == -1 && sexp_errno == SEXP_ERR_IO,
+        "write error");
+  check(sexp_build_finish(b) == NULL && sexp_errno == SEXP_ERR_BAD_PARAM,
+        "writers do not finish");
+  destroy_sexp_builder(b);
+
+  sexp_cleanup();
+
+  printf("builder tests passed\n");
+
+  return 0;
+}
@@ -19,6 +19,7 @@ function test {
     return $status
 }
 
+test ./builder
 test ./ctest
 
 ## note: need to keep iteration count for ctorture low here
@@ -27,7 +28,30 @@ perl ./randsexp.pl 200 40000 0.4 > /tmp/SEXP.SKINNY
 test ./ctorture -i 10 -f /tmp/SEXP.SKINNY
 rm -f /tmp/SEXP.SKINNY
 
+test ./alist
+test ./arena
+test ./budget
+test ./cursor
+test ./destroy
 test ./error_codes
+test ./events
+test ./hash
+test ./hashcons
+test ./index
+test ./intern
+test ./lazy
+test ./limits
+test ./match
+test ./number
+test ./parallel
 test ./partial
+test ./persist
+test ./project
+test ./query
+test ./recover
 test ./read_and_dump
 test ./readtests
+test ./scatter
+test ./source
+test ./validate
+test ./walk
@@ -67,10 +67,11 @@ enum { FIXBUF, CSTR };
  ** usage()
  **/
 void usage(char *av0) {
-  printf("\nusage: %s [-t] [-c] [-i iters] [-f fname] [-h]\n\n",av0);
+  printf("\nusage: %s [-t] [-c] [-p] [-i iters] [-f fname] [-h]\n\n",av0);
   printf("  -i iters : specify number of iterations (default: %d)\n", DEFITERS);
   printf("  -f fname : read expression from file fname (default: STDIN)\n");
   printf("  -c       : toggle CSTRING-based print_sexp (default: fixed buffer ~8MB)\n");
+  printf("  -p       : time only the parser, not print_sexp\n");
   printf("  -t       : execute original test from torture.c (see * below)\n");
   printf("  -h       : usage\n\n");
   printf("* please note that ctorture.c subsumes and replaces torture.c from now on.\n\n");
@@ -91,11 +92,12 @@ int main(int argc, char **argv) {
   int              print_type = FIXBUF;
   CSTRING          *cs1, *cs2;
   int              do_old_torture = 0;
+  int              parse_only = 0;
 
   maxiters = DEFITERS; /* default */
   fd = STDIN_FILENO;   /* default */
 
-  while ((ch = getopt(argc,argv,"i:f:cht")) != -1) {
+  while ((ch = getopt(argc,argv,"i:f:chpt")) != -1) {
     switch ((char)ch) {
     case 'i':
       maxiters = atoi(optarg);
@@ -118,6 +120,9 @@ int main(int argc, char **argv) {
     case 'h':
       usage(argv[0]);
       break;
+    case 'p':
+      parse_only = 1;
+      break;
     case 't':
       do_old_torture = 1;
       break;
@@ -177,12 +182,14 @@ int main(int argc, char **argv) {
       cc = cparse_sexp(buf,MAXSIZE,cc);
     sx = cc->last_sexp;
     cc->lastPos = NULL;
-    if (print_type == CSTR)
-      print_sexp_cstr(&cs2,sx,(cs1->curlen)+1);
-    else
-      print_sexp(pstr,MAXSIZE,sx);
+    if (parse_only == 0) {
+      if (print_type == CSTR)
+        print_sexp_cstr(&cs2,sx,(cs1->curlen)+1);
+      else
+        print_sexp(pstr,MAXSIZE,sx);
+    }
     destroy_sexp(sx);
-    if (print_type == CSTR) {
+    if (print_type == CSTR && parse_only == 0) {
       sempty(cs2);
     }
   }
@@ -0,0 +1,195 @@
+/**
+
+SFSEXP: Small, Fast S-Expression Library version 1.0
+Written by Matthew Sottile (mjsottile@gmail.com)
+
+Copyright (2003-2006). The Regents of the University of California. This
+material was produced under U.S. Government contract W-7405-ENG-36 for Los
+Alamos National Laboratory, which is operated by the University of
+California for the U.S. Department of Energy. The U.S. Government has rights
+to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+derivative works, such modified software should be clearly marked, so as not
+to confuse it with the version available from LANL.
+
+Additionally, this library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation; either version 2.1 of the
+License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation,
+Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+LA-CC-04-094
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sexp.h"
+#include "test_util.h"
+
+/**
+ * move a cursor around expressions and edit them through it, checking
+ * the printed result after each change.
+ */
+
+static sexp_t *atom(const char *s) {
+  return new_sexp_atom(s, strlen(s), SEXP_BASIC);
+}
+
+int main(int argc, char **argv) {
+  char text[] = "(a (b c) d)";
+  char name[16];
+  sexp_t *sx, *t;
+  sexp_cursor_t *c;
+  pcont_t *cc;
+  size_t hash;
+  int i;
+
+  sx = parse_sexp(text, strlen(text));
+  check(sx != NULL, "parse");
+  c = new_sexp_cursor(sx);
+  check(c != NULL, "cursor");
+
+  /* navigation */
+  check(sexp_cursor_focus(c) == sx && sexp_cursor_depth(c) == 0, "start");
+  check(sexp_cursor_up(c) == 0 && sexp_cursor_left(c) == 0, "top");
+  check(sexp_cursor_down(c) == 1 && sexp_cursor_depth(c) == 1, "down");
+  check(strcmp(sexp_cursor_focus(c)->val, "a") == 0, "first");
+  check(sexp_cursor_down(c) == 0, "atoms have no inside");
+  check(sexp_cursor_right(c) == 1 && sexp_cursor_down(c) == 1 &&
+        strcmp(sexp_cursor_focus(c)->val, "b") == 0, "(b c)");
+  check(sexp_cursor_right(c) == 1 && sexp_cursor_right(c) == 1 &&
+        sexp_cursor_focus(c) == NULL && sexp_cursor_right(c) == 0, "end");
+  check(sexp_cursor_left(c) == 1 &&
+        strcmp(sexp_cursor_focus(c)->val, "c") == 0, "left from the end");
+  check(sexp_cursor_up(c) == 1 && sexp_cursor_focus(c) == sx->list->next,
+        "up");
+  check(sexp_cursor_left(c) == 1 &&
+        strcmp(sexp_cursor_focus(c)->val, "a") == 0 &&
+        sexp_cursor_left(c) == 0, "left keeps the path");
+
+  /* edits */
+  check(sexp_cursor_insert(c, atom("z")) == 0, "insert first");
+  prints(sx, "(z a (b c) d)", "after insert");
+  check(sexp_cursor_right(c) == 1 && sexp_cursor_right(c) == 1 &&
+        sexp_cursor_down(c) == 1 && sexp_cursor_right(c) == 1, "to c");
+  t = sexp_cursor_replace(c, atom("y"));
+  check(t != NULL && strcmp(t->val, "c") == 0 && t->next == NULL,
+        "replace");
+  destroy_sexp(t);
+  prints(sx, "(z a (b y) d)", "after replace");
+  check(sexp_cursor_left(c) == 1, "to b");
+  t = sexp_cursor_remove(c);
+  check(t != NULL && strcmp(t->val, "b") == 0, "remove");
+  destroy_sexp(t);
+  prints(sx, "(z a (y) d)", "after remove");
+  t = sexp_cursor_remove(c);
+  destroy_sexp(t);
+  check(sexp_cursor_focus(c) == NULL && sexp_cursor_remove(c) == NULL &&
+        sexp_errno == SEXP_ERR_BAD_PARAM, "remove at the end");
+  prints(sx, "(z a () d)", "after removing the last");
+
+  /* append to an empty list: insert at the end and step past */
+  for (i = 0; i < 1000; i++) {
+    sprintf(name, "e%d", i);
+    check(sexp_cursor_insert(c, atom(name)) == 0 &&
+          sexp_cursor_right(c) == 1, "append");
+  }
+  check(sexp_list_length(sx->list->next->next) == 1000, "appended");
+  check(strcmp(sexp_nth(sx->list->next->next, 999)->val, "e999") == 0,
+        "last appended");
+  for (i = 0; i < 1000; i++)
+    check(sexp_cursor_left(c) == 1, "back over the appended");
+  check(sexp_cursor_left(c) == 0, "start of the list");
+  while (sexp_cursor_focus(c) != NULL)
+    destroy_sexp(sexp_cursor_remove(c));
+  prints(sx, "(z a () d)", "after removing the appended");
+
+  /* splice a chain in */
+  t = atom("p");
+  t->next = atom("q");
+  check(sexp_cursor_splice(c, t) == 0 && sexp_cursor_focus(c) == t,
+        "splice");
+  prints(sx, "(z a (p q) d)", "after splice");
+  check(sexp_cursor_insert(c, NULL) == -1 &&
+        sexp_errno == SEXP_ERR_BAD_PARAM, "insert NULL");
+
+  /* the top level is the next chain; inserting before the root */
+  check(sexp_cursor_up(c) == 1 && sexp_cursor_up(c) == 1, "to the top");
+  check(sexp_cursor_insert(c, atom("before")) == 0 &&
+        sexp_cursor_root(c) != sx, "new root");
+  sx = sexp_cursor_root(c);
+  prints(sx, "before", "new root");
+  prints(sx->next, "(z a (p q) d)", "old root after new root");
+  destroy_sexp_cursor(c);
+  t = sx->next;
+  sx->next = NULL;
+  destroy_sexp(sx);
+  destroy_sexp(t);
+
+  /* build from nothing */
+  c = new_sexp_cursor(NULL);
+  check(c != NULL && sexp_cursor_focus(c) == NULL, "empty cursor");
+  check(sexp_cursor_insert(c, new_sexp_list(NULL)) == 0 &&
+        sexp_cursor_down(c) == 1 &&
+        sexp_cursor_insert(c, atom("x")) == 0, "build");
+  prints(sexp_cursor_root(c), "(x)", "built from nothing");
+  destroy_sexp(sexp_cursor_root(c));
+  destroy_sexp_cursor(c);
+
+  /* edits drop cached hashes, source ranges and indexes on the path */
+  cc = init_continuation(NULL);
+  check(cc != NULL, "continuation");
+  cc->track_source = 1;
+  cc->index_lists = 1;
+  sx = iparse_sexp(text, strlen(text), cc);
+  check(sx != NULL, "tracked parse");
+  hash = sexp_hash_cache(sx);
+  c = new_sexp_cursor(sx);
+  check(c != NULL && sexp_cursor_down(c) == 1 && sexp_cursor_right(c) == 1 &&
+        sexp_cursor_down(c) == 1 && sexp_cursor_right(c) == 1, "to c");
+  destroy_sexp(sexp_cursor_replace(c, atom("y")));
+  check(!(sx->flags & (SEXP_FLAG_HASHED | SEXP_FLAG_SOURCE)) &&
+        !(sx->list->next->flags & (SEXP_FLAG_HASHED | SEXP_FLAG_SOURCE |
+                                   SEXP_FLAG_INDEXED)), "flags cleared");
+  check(sexp_hash(sx) != hash, "hash changed");
+  check(sexp_nth(sx->list->next, 1) == sexp_cursor_focus(c), "no index");
+  destroy_sexp_cursor(c);
+  destroy_sexp(sx);
+  destroy_continuation(cc);
+
+  /* persistent lists cannot be edited */
+  sx = sexp_freeze(parse_sexp(text, strlen(text)));
+  check(sx != NULL, "freeze");
+  c = new_sexp_cursor(sx);
+  check(c != NULL && sexp_cursor_down(c) == 1, "down persistent");
+  check(sexp_cursor_remove(c) == NULL && sexp_errno == SEXP_ERR_BAD_PARAM,
+        "persistent remove");
+  destroy_sexp_cursor(c);
+  destroy_sexp(sx);
+
+  /* lazy lists are built on the way down */
+  sx = parse_sexp_lazy(text, strlen(text));
+  c = new_sexp_cursor(sx);
+  check(c != NULL && sexp_cursor_down(c) == 1 && sexp_cursor_right(c) == 1 &&
+        sexp_cursor_down(c) == 1 &&
+        strcmp(sexp_cursor_focus(c)->val, "b") == 0, "lazy");
+  destroy_sexp_cursor(c);
+  destroy_sexp(sx);
+
+  sexp_cleanup();
+
+  printf("cursor tests passed\n");
+
+  return 0;
+}
@@ -0,0 +1,132 @@
+/**
+
+SFSEXP: Small, Fast S-Expression Library version 1.0
+Written by Matthew Sottile (mjsottile@gmail.com)
+
+Copyright (2003-2006). The Regents of the University of California. This
+material was produced under U.S. Government contract W-7405-ENG-36 for Los
+Alamos National Laboratory, which is operated by the University of
+California for the U.S. Department of Energy. The U.S. Government has rights
+to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+derivative works, such modified software should be clearly marked, so as not
+to confuse it with the version available from LANL.
+
+Additionally, this library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation; either version 2.1 of the
+License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation,
+Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+LA-CC-04-094
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sexp.h"
+
+/**
+ * destroy expressions that are far too long or deep for a recursive
+ * destroy_sexp on a default sized stack, synchronously and through the
+ * background reclaimer.
+ */
+
+#define WIDE 1000000
+#define DEEP 200000
+
+static sexp_t *wide(void) {
+  char *buf = malloc(WIDE*2+3);
+  size_t i, n = 0;
+  sexp_t *sx;
+
+  buf[n++] = '(';
+  for (i = 0; i < WIDE; i++) {
+    buf[n++] = 'a';
+    buf[n++] = ' ';
+  }
+  buf[n++] = ')';
+  buf[n] = '\0';
+
+  sx = parse_sexp(buf, n);
+  free(buf);
+
+  return sx;
+}
+
+static sexp_t *deep(void) {
+  char *buf = malloc(DEEP*4+1);
+  size_t i, n = 0;
+  sexp_t *sx;
+
+  /* each level has a trailing atom so entering the nested list has to
+     remember where to continue. */
+  for (i = 0; i < DEEP; i++)
+    buf[n++] = '(';
+  for (i = 0; i < DEEP; i++) {
+    buf[n++] = ' ';
+    buf[n++] = 'x';
+    buf[n++] = ')';
+  }
+  buf[n] = '\0';
+
+  sx = parse_sexp(buf, n);
+  free(buf);
+
+  return sx;
+}
+
+int main(int argc, char **argv) {
+  sexp_t *sx;
+  int round;
+
+#ifdef _SEXP_LIMIT_MEMORY_
+  /* these expressions need far more than the default limit. */
+  set_sexp_max_memory(1024*1024*1024);
+#endif
+
+  for (round = 0; round < 2; round++) {
+    sx = wide();
+    if (sx == NULL || sexp_list_length(sx) != WIDE) {
+      printf("failed to build wide expression.\n");
+      exit(EXIT_FAILURE);
+    }
+    if (round == 0)
+      destroy_sexp(sx);
+    else
+      destroy_sexp_async(sx);
+
+    sx = deep();
+    if (sx == NULL) {
+      printf("failed to build deep expression.\n");
+      exit(EXIT_FAILURE);
+    }
+    if (round == 0)
+      destroy_sexp(sx);
+    else
+      destroy_sexp_async(sx);
+  }
+
+  sexp_reclaimer_drain();
+
+  /* sexp_cleanup frees whatever is still queued before stopping. */
+  destroy_sexp_async(wide());
+  sexp_cleanup();
+
+  destroy_sexp_async(NULL);
+  destroy_sexp(NULL);
+
+  printf("wide and deep expressions destroyed.\n");
+
+  exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,232 @@
+/**
+
+SFSEXP: Small, Fast S-Expression Library version 1.0
+Written by Matthew Sottile (mjsottile@gmail.com)
+
+Copyright (2003-2006). The Regents of the University of California. This
+material was produced under U.S. Government contract W-7405-ENG-36 for Los
+Alamos National Laboratory, which is operated by the University of
+California for the U.S. Department of Energy. The U.S. Government has rights
+to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+derivative works, such modified software should be clearly marked, so as not
+to confuse it with the version available from LANL.
+
+Additionally, this library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation; either version 2.1 of the
+License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation,
+Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+LA-CC-04-094
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sexp.h"
+#include "test_util.h"
+
+/**
+ * the parser is specialized for trees, trees with inline binary data,
+ * events and validation only.  feed the same input to each, whole and
+ * in pieces, and check that they agree.
+ */
+
+static const char *input =
+  "(a (b \"c d\") ; note\n 'e '(f \"g)\" h)) x \"y\" ";
+
+static const char *expect =
+  "[B:a [B:b D:c d ] S:e S:(f \"g)\" h) ] B:x D:y ";
+
+static char events[512];
+
+static void note(const char *text, size_t len) {
+  size_t n = strlen(events);
+
+  check(n + len < sizeof(events), "event log");
+  memcpy(events + n, text, len);
+  events[n + len] = '\0';
+}
+
+static void note_atom(const char *val, size_t len, atom_t aty) {
+  note(aty == SEXP_SQUOTE ? "S:" : aty == SEXP_DQUOTE ? "D:" : "B:", 2);
+  note(val, len);
+  note(" ", 1);
+}
+
+static void on_start(void) { note("[", 1); }
+static void on_end(void) { note("] ", 2); }
+
+/* the handlers are given nul terminated text */
+static void on_chars(const char *val, size_t len, atom_t aty) {
+  note_atom(val, strlen(val), aty);
+}
+
+static void on_binary(const char *bin, size_t len) {
+  note("#:", 2);
+  note(bin, len);
+  note(" ", 1);
+}
+
+static void sink_start(void *data) { (*(int *)data)++; note("[", 1); }
+static void sink_end(void *data) { note("] ", 2); }
+
+/* the sink is given the length without it */
+static void sink_chars(void *data, const char *val, size_t len,
+                       atom_t aty) {
+  note_atom(val, len, aty);
+}
+
+/* parse input in pieces of at most chunk bytes with cc, returning the
+   number of expressions; trees are destroyed */
+static int run(const char *in, size_t chunk, pcont_t *cc) {
+  char buf[256];
+  size_t off, n;
+  int count = 0;
+
+  for (off = 0; in[off] != '\0'; off += n) {
+    n = strlen(in + off);
+    if (n > chunk)
+      n = chunk;
+    memcpy(buf, in + off, n);
+    buf[n] = '\0';
+    cc->lastPos = NULL;
+    do {
+      cparse_sexp(buf, n, cc);
+      check(cc->error == SEXP_ERR_OK || cc->error == SEXP_ERR_INCOMPLETE,
+            "parse");
+      if (cc->error == SEXP_ERR_OK && cc->lastPos != NULL)
+        count++;
+      if (cc->last_sexp != NULL) {
+        destroy_sexp(cc->last_sexp);
+        cc->last_sexp = NULL;
+      }
+    } while (cc->lastPos != NULL);
+  }
+
+  return count;
+}
+
+static const size_t chunks[] = { 1, 2, 3, 5, 1000 };
+
+int main(int argc, char **argv) {
+  parser_event_handlers_t peh;
+  sexp_event_sink_t sink;
+  parsermode_t modes[2];
+  char buf[64];
+  sexp_t *sx;
+  pcont_t *cc;
+  size_t c, m;
+  int lists;
+
+  peh.start_sexpr = on_start;
+  peh.end_sexpr = on_end;
+  peh.characters = on_chars;
+  peh.binary = on_binary;
+
+  /* trees and events report the same events in every split */
+  modes[0] = PARSER_NORMAL;
+  modes[1] = PARSER_EVENTS_ONLY;
+  for (m = 0; m < 2; m++) {
+    for (c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++) {
+      cc = init_continuation(NULL);
+      check(cc != NULL, "continuation");
+      cc->mode = modes[m];
+      cc->event_handlers = &peh;
+      events[0] = '\0';
+      check(run(input, chunks[c], cc) == 3, "three expressions");
+      check(strcmp(events, expect) == 0, events);
+      destroy_continuation(cc);
+    }
+  }
+
+  /* the sink sees them too, but only when the mode is events only */
+  sink.start_sexpr = sink_start;
+  sink.end_sexpr = sink_end;
+  sink.characters = sink_chars;
+  sink.binary = NULL;
+  sink.data = &lists;
+  for (c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++) {
+    cc = init_continuation(NULL);
+    cc->mode = PARSER_EVENTS_ONLY;
+    cc->event_sink = &sink;
+    lists = 0;
+    events[0] = '\0';
+    check(run(input, chunks[c], cc) == 3, "sink expressions");
+    check(strcmp(events, expect) == 0, events);
+    check(lists == 2, "sink data");
+    destroy_continuation(cc);
+  }
+
+  cc = init_continuation(NULL);
+  cc->event_sink = &sink;
+  events[0] = '\0';
+  check(run(input, 1000, cc) == 3 && events[0] == '\0', "no sink in trees");
+  destroy_continuation(cc);
+
+  /* with nobody listening, events only just checks the input */
+  cc = init_continuation(NULL);
+  cc->mode = PARSER_EVENTS_ONLY;
+  check(run(input, 1000, cc) == 3, "validate");
+  strcpy(buf, "(a b))");
+  cc->lastPos = NULL;
+  cparse_sexp(buf, strlen(buf), cc);
+  check(cc->error == SEXP_ERR_OK && cc->last_sexp == NULL, "valid");
+  cparse_sexp(buf, strlen(buf), cc);
+  check(cc->error == SEXP_ERR_BADFORM, "unopened paren");
+  destroy_continuation(cc);
+
+  cc = init_continuation(NULL);
+  cc->mode = PARSER_EVENTS_ONLY;
+  strcpy(buf, "(a (b");
+  cparse_sexp(buf, strlen(buf), cc);
+  check(cc->error == SEXP_ERR_INCOMPLETE, "incomplete");
+  strcpy(buf, "))");
+  cparse_sexp(buf, strlen(buf), cc);
+  check(cc->error == SEXP_ERR_OK, "completed");
+  destroy_continuation(cc);
+
+  /* inline binary data may hold any byte, parens included */
+  for (c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++) {
+    cc = init_continuation(NULL);
+    cc->mode = PARSER_INLINE_BINARY;
+    cc->event_handlers = &peh;
+    events[0] = '\0';
+    check(run("(x #b#3#a)b #y) ", chunks[c], cc) == 1, "binary parse");
+    check(strcmp(events, "[B:x #:a)b B:#y ] ") == 0, events);
+    destroy_continuation(cc);
+  }
+
+  strcpy(buf, "(x #b#3#a)b y)");
+  cc = init_continuation(NULL);
+  cc->mode = PARSER_INLINE_BINARY;
+  sx = iparse_sexp(buf, strlen(buf), cc);
+  check(sx != NULL && sexp_list_length(sx) == 3, "binary tree");
+  check(sx->list->next->aty == SEXP_BINARY &&
+        sx->list->next->binlength == 3 &&
+        memcmp(sx->list->next->bindata, "a)b", 3) == 0, "binary atom");
+  destroy_sexp(sx);
+  destroy_continuation(cc);
+
+  /* outside binary mode the same text is plain atoms */
+  strcpy(buf, "(x #b#3#ab y)");
+  sx = parse_sexp(buf, strlen(buf));
+  check(sx != NULL && sexp_list_length(sx) == 3 &&
+        strcmp(sx->list->next->val, "#b#3#ab") == 0, "no binary");
+  destroy_sexp(sx);
+
+  sexp_cleanup();
+
+  exit(EXIT_SUCCESS);
+}
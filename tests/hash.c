@@ -0,0 +1,173 @@
+/**
+
+SFSEXP: Small, Fast S-Expression Library version 1.0
+Written by Matthew Sottile (mjsottile@gmail.com)
+
+Copyright (2003-2006). The Regents of the University of California. This
+material was produced under U.S. Government contract W-7405-ENG-36 for Los
+Alamos National Laboratory, which is operated by the University of
+California for the U.S. Department of Energy. The U.S. Government has rights
+to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+derivative works, such modified software should be clearly marked, so as not
+to confuse it with the version available from LANL.
+
+Additionally, this library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation; either version 2.1 of the
+License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation,
+Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+LA-CC-04-094
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sexp.h"
+#include "test_util.h"
+
+/**
+ * structural hashing and equality: equal expressions from separate parses,
+ * differences in atom type, bytes and shape, cached hashes, hash-consed
+ * expressions, and lists nested too deep for recursion.
+ */
+
+#define DEEP 100000
+
+static sexp_t *parse(const char *str) {
+  sexp_t *sx = parse_sexp((char *)str, strlen(str));
+
+  check(sx != NULL, str);
+
+  return sx;
+}
+
+/* compare str with each of the others, which all differ from it. */
+static void differ(const char *str, const char **others) {
+  sexp_t *a = parse(str);
+  sexp_t *b;
+
+  for (; *others != NULL; others++) {
+    b = parse(*others);
+    if (sexp_equal(a, b) != 0 || sexp_hash(a) == sexp_hash(b)) {
+      printf("%s vs %s\n", str, *others);
+      check(0, "different expressions");
+    }
+    destroy_sexp(b);
+  }
+
+  destroy_sexp(a);
+}
+
+static char *nested(int n, const char *atom) {
+  char *buf = malloc(2 * n + strlen(atom) + 1);
+  int i;
+
+  for (i = 0; i < n; i++)
+    buf[i] = '(';
+  strcpy(buf + n, atom);
+  for (i = 0; i < n; i++)
+    buf[n + strlen(atom) + i] = ')';
+  buf[2 * n + strlen(atom)] = '\0';
+
+  return buf;
+}
+
+int main(int argc, char **argv) {
+  static const char *input =
+    "(order (id 42) (items (item \"a b\" 2) (item 'c 1)) () (note x))";
+  static const char *others[] = {
+    "(order (id 42) (items (item \"a b\" 2) (item c 1)) () (note x))",
+    "(order (id 42) (items (item a 2) (item 'c 1)) () (note x))",
+    "(order (id 42) (items (item \"a b\" 2) (item 'c 1)) (note x))",
+    "(order (id 42) (items (item \"a b\" 2) (item 'c 1) ()) (note x))",
+    "(order (id 42) (items (item \"a b\" 2 (item 'c 1))) () (note x))",
+    "(order (id 42) (items (item \"a b\" 2) (item 'c 1)) () (note y))",
+    "(order (id 42) (items (item \"a b\" 2) (item 'c 1)) () (note x) z)",
+    "order",
+    NULL
+  };
+  sexp_t *a, *b, *c, *hx;
+  char *deep;
+  size_t h;
+
+#ifdef _SEXP_LIMIT_MEMORY_
+  /* the deeply nested lists need more than the default limit. */
+  set_sexp_max_memory(1024*1024*1024);
+#endif
+
+  a = parse(input);
+  b = parse(input);
+
+  check(sexp_equal(a, b) == 1, "separate parses equal");
+  check(sexp_equal(a, a) == 1, "equal to itself");
+  check(sexp_hash(a) == sexp_hash(b), "separate parses hash alike");
+  check(sexp_equal(a->list->next, b->list->next) == 1, "sub-expressions");
+  check(sexp_equal(a->list->next, b->list->next->next) == 0,
+        "following elements are not compared");
+  check(sexp_equal(a, NULL) == 0 && sexp_equal(NULL, NULL) == 1, "NULL");
+  differ(input, others);
+
+  /* a sub-expression hashes like the same text parsed on its own. */
+  c = parse("(note x)");
+  check(sexp_hash(c) == sexp_hash(a->list->next->next->next->next),
+        "hash ignores position");
+  destroy_sexp(c);
+
+  /* cached hashes are the same hashes, and are used for early exits. */
+  h = sexp_hash(a);
+  check(sexp_hash_cache(a) == h, "cached hash");
+  check((a->flags & SEXP_FLAG_HASHED) && a->val_allocated == h,
+        "root cached");
+  check(a->list->next->flags & SEXP_FLAG_HASHED, "contents cached");
+  check(!(a->list->flags & SEXP_FLAG_HASHED), "atoms hashed again");
+  check(sexp_hash(a) == h, "hash from cache");
+  check(sexp_equal(a, b) == 1, "equal with one side cached");
+  sexp_hash_cache(b);
+  check(sexp_equal(a, b) == 1, "equal with both sides cached");
+  b->val_allocated++;
+  check(sexp_equal(a, b) == 0, "cached hash mismatch");
+  sexp_hash_uncache(b);
+  check(!(b->flags & SEXP_FLAG_HASHED) &&
+        !(b->list->next->flags & SEXP_FLAG_HASHED), "uncached");
+  check(sexp_equal(a, b) == 1, "equal again once uncached");
+  destroy_sexp(b);
+
+  /* a hash-consed DAG equals the tree it came from. */
+  hx = sexp_hashcons(parse(input));
+  check(hx != NULL, "sexp_hashcons");
+  check(sexp_equal(hx, a) == 1 && sexp_hash(hx) == h, "hash-consed");
+  sexp_release(hx);
+  destroy_sexp(a);
+
+  /* deep nesting. */
+  deep = nested(DEEP, "x");
+  a = parse(deep);
+  b = parse(deep);
+  free(deep);
+  deep = nested(DEEP, "y");
+  c = parse(deep);
+  free(deep);
+  check(sexp_equal(a, b) == 1, "deep equal");
+  check(sexp_equal(a, c) == 0, "deep differ");
+  check(sexp_hash(a) == sexp_hash(b) && sexp_hash(a) != sexp_hash(c),
+        "deep hashes");
+  destroy_sexp(a);
+  destroy_sexp(b);
+  destroy_sexp(c);
+
+  sexp_cleanup();
+
+  return 0;
+}
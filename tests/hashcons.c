@@ -0,0 +1,163 @@
+/**
+
+SFSEXP: Small, Fast S-Expression Library version 1.0
+Written by Matthew Sottile (mjsottile@gmail.com)
+
+Copyright (2003-2006). The Regents of the University of California. This
+material was produced under U.S. Government contract W-7405-ENG-36 for Los
+Alamos National Laboratory, which is operated by the University of
+California for the U.S. Department of Energy. The U.S. Government has rights
+to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+derivative works, such modified software should be clearly marked, so as not
+to confuse it with the version available from LANL.
+
+Additionally, this library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation; either version 2.1 of the
+License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation,
+Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+LA-CC-04-094
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sexp.h"
+#include "test_util.h"
+
+/**
+ * hash-cons expressions with repeated sub-expressions, check that equal
+ * parts end up as the same elements and that printing and copying expand
+ * them again, then parse a stream of messages with a continuation that
+ * hash-conses them all against one table.
+ */
+
+static const char *input =
+  "(msg (hdr (v 1) (type tick)) (body (px 10 20) (px 10 20) (px 10 21)) "
+  "(hdr (v 1) (type tick)) \"quoted\" \"quoted\")";
+
+int main(int argc, char **argv) {
+  sexp_hashcons_t *t;
+  sexp_t *sx, *hx, *cp, *hdr1, *hdr2, *a, *b, *c;
+  sexp_t *m[4];
+  pcont_t *cc;
+  char buf[64];
+  size_t n;
+  int i;
+
+  sx = parse_sexp((char *)input, strlen(input));
+  check(sx != NULL, "parse");
+
+  hx = sexp_hashcons(sx);
+  check(hx != NULL, "sexp_hashcons");
+  prints(hx, input, "hash-consed expression prints like the original");
+  check((hx->flags & SEXP_FLAG_PERSISTENT) != 0, "result is persistent");
+
+  /* equal lists share their contents; the elements holding them differ
+     only because what follows them differs. */
+  hdr1 = hx->list->next;
+  hdr2 = hdr1->next->next;
+  check(hdr1 != hdr2 && hdr1->list == hdr2->list, "equal headers shared");
+  a = hdr1->next->list->next;
+  b = a->next;
+  c = b->next;
+  check(a->list == b->list, "equal px lists shared");
+  check(a->list != c->list, "different px lists not shared");
+  check(sexp_list_length(a) == 3 && sexp_list_length(c) == 3, "lengths");
+
+  /* a copy is an ordinary tree again. */
+  cp = copy_sexp(hx);
+  check(cp != NULL, "copy_sexp");
+  prints(cp, input, "copy prints like the original");
+  check((cp->flags & SEXP_FLAG_PERSISTENT) == 0, "copy is not persistent");
+  check(cp->list->next->list != cp->list->next->next->next->list,
+        "copy does not share");
+  destroy_sexp(cp);
+  sexp_release(hx);
+
+  /* equal tails of different lists are shared too. */
+  sx = parse_sexp((char *)"((a x y) (b x y))", 17);
+  check(sx != NULL, "parse tails");
+  sx = sexp_hashcons(sx);
+  check(sx != NULL, "sexp_hashcons tails");
+  check(sx->list->list->next == sx->list->next->list->next, "tails shared");
+  sexp_release(sx);
+
+  /* a continuation hash-consing every message against one table: equal
+     messages come back as the same expression, and whatever the table
+     still refers to outlives the messages. */
+  t = new_sexp_hashcons(0);
+  check(t != NULL, "new_sexp_hashcons");
+
+  sprintf(buf, "(msg)");
+  cc = init_continuation(buf);
+  check(cc != NULL, "init_continuation");
+  cc->hashcons = t;
+
+  for (i = 0; i < 4; i++) {
+    sprintf(buf, "(tick (v %d) (src \"feed\"))", i / 2);
+    reset_pcont(cc);
+    cc = cparse_sexp(buf, strlen(buf), cc);
+    check(cc->last_sexp != NULL, "parse with hashcons");
+    m[i] = cc->last_sexp;
+  }
+
+  check(m[0] == m[1] && m[2] == m[3], "equal messages shared");
+  check(m[0] != m[2], "different messages not shared");
+  check(m[0]->list->next->next == m[2]->list->next->next,
+        "common part of different messages shared");
+  prints(m[2], "(tick (v 1) (src \"feed\"))", "message prints");
+
+  n = sexp_hashcons_count(t);
+  hx = sexp_hashcons_with(t, parse_sexp((char *)"(tick (v 0) (src \"feed\"))", 26));
+  check(hx == m[0], "sexp_hashcons_with finds parsed message");
+  check(sexp_hashcons_count(t) == n, "no new elements");
+
+  for (i = 0; i < 4; i++)
+    sexp_release(m[i]);
+  destroy_continuation(cc);
+
+  prints(hx, "(tick (v 0) (src \"feed\"))", "message outlives the others");
+  destroy_sexp_hashcons(t);
+  prints(hx, "(tick (v 0) (src \"feed\"))", "message outlives the table");
+  sexp_release(hx);
+
+  /* a long stream of different messages: what the table alone still
+     refers to is dropped instead of growing it, and what is still in
+     use keeps being shared. */
+  t = new_sexp_hashcons(16);
+  check(t != NULL, "new_sexp_hashcons stream");
+  hx = sexp_hashcons_with(t, parse_sexp((char *)"(v 0)", 5));
+  check(hx != NULL, "hashcons kept message");
+  for (i = 0; i < 5000; i++) {
+    sprintf(buf, "(tick (v %d) (n %d))", i, i);
+    sx = sexp_hashcons_with(t, parse_sexp(buf, strlen(buf)));
+    check(sx != NULL, "hashcons stream message");
+    sexp_release(sx);
+  }
+  check(sexp_hashcons_count(t) <= 24, "unused elements dropped");
+  sx = sexp_hashcons_with(t, parse_sexp((char *)"(v 0)", 5));
+  check(sx == hx, "element in use still shared");
+  sexp_release(sx);
+  sexp_release(hx);
+  destroy_sexp_hashcons(t);
+
+  check(sexp_hashcons_with(NULL, NULL) == NULL &&
+        sexp_errno == SEXP_ERR_BAD_PARAM, "bad parameters");
+
+  sexp_cleanup();
+
+  return 0;
+}
@@ -0,0 +1,153 @@
+/**
+
+SFSEXP: Small, Fast S-Expression Library version 1.0
+Written by Matthew Sottile (mjsottile@gmail.com)
+
+Copyright (2003-2006). The Regents of the University of California. This
+material was produced under U.S. Government contract W-7405-ENG-36 for Los
+Alamos National Laboratory, which is operated by the University of
+California for the U.S. Department of Energy. The U.S. Government has rights
+to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+derivative works, such modified software should be clearly marked, so as not
+to confuse it with the version available from LANL.
+
+Additionally, this library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation; either version 2.1 of the
+License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation,
+Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+LA-CC-04-094
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sexp.h"
+#include "test_util.h"
+
+/**
+ * index lists by hand and from the parser, and check that sexp_nth and
+ * sexp_length agree with walking the list.
+ */
+
+/* element n by walking, to compare against */
+static sexp_t *walk_nth(const sexp_t *sx, size_t n) {
+  sexp_t *t = sx->list;
+
+  while (t != NULL && n-- > 0)
+    t = t->next;
+  return t;
+}
+
+static void check_list(const sexp_t *sx, const char *what) {
+  size_t i, len = 0;
+  sexp_t *t;
+
+  for (t = sx->list; t != NULL; t = t->next)
+    len++;
+  check(sexp_length(sx) == len, what);
+  check(sexp_list_length(sx) == (int)len, what);
+  for (i = 0; i <= len; i++)
+    check(sexp_nth(sx, i) == walk_nth(sx, i), what);
+}
+
+static char text[] =
+  "(a b (c d e) () (f (g h i j k) l) \"m n\" 'o p)";
+
+int main(int argc, char **argv) {
+  sexp_t *sx, *sub;
+  pcont_t *cc;
+  char buf[256];
+
+  /* by hand */
+  sx = parse_sexp(text, strlen(text));
+  check(sx != NULL, "parse");
+  check(!(sx->flags & SEXP_FLAG_INDEXED), "not indexed by default");
+  check_list(sx, "unindexed");
+
+  check(sexp_index(sx) == 0 && (sx->flags & SEXP_FLAG_INDEXED), "index");
+  check(sexp_length(sx) == 8, "length");
+  check(strcmp(sexp_nth(sx, 0)->val, "a") == 0, "head");
+  check(strcmp(sexp_nth(sx, 7)->val, "p") == 0, "last");
+  check(sexp_nth(sx, 8) == NULL, "past the end");
+  check_list(sx, "indexed");
+
+  sub = sexp_nth(sx, 3);
+  check(sexp_index(sub) == 0 && sexp_length(sub) == 0 &&
+        sexp_nth(sub, 0) == NULL, "empty list");
+
+  /* after a change, indexing again catches up */
+  sub = sexp_nth(sx, 2);
+  check(sexp_index(sub) == 0, "index sublist");
+  destroy_sexp(sub->list->next->next);
+  sub->list->next->next = NULL;
+  check(sexp_index(sub) == 0 && sexp_length(sub) == 2, "reindex");
+  check_list(sub, "reindexed");
+  sexp_unindex(sub);
+  check(!(sub->flags & SEXP_FLAG_INDEXED), "unindex");
+  check_list(sub, "unindexed again");
+
+  /* atoms */
+  check(sexp_index(sexp_nth(sx, 0)) == -1 &&
+        sexp_errno == SEXP_ERR_BAD_PARAM, "atom not indexed");
+  check(sexp_length(sexp_nth(sx, 0)) == 1 && sexp_nth(sexp_nth(sx, 0), 0) ==
+        NULL, "atom length");
+  check(sexp_length(NULL) == 0 && sexp_nth(NULL, 0) == NULL, "NULL");
+
+  /* printing and copying are not affected */
+  check(print_sexp(buf, sizeof(buf), sx) > 0, "print");
+  sub = copy_sexp(sx);
+  check(sub != NULL && sexp_equal(sub, sx) == 1 &&
+        !(sub->flags & SEXP_FLAG_INDEXED), "copy");
+  destroy_sexp(sub);
+  destroy_sexp(sx);
+
+  /* from the parser: lists of three or more elements */
+  cc = init_continuation(NULL);
+  check(cc != NULL, "continuation");
+  cc->index_lists = 3;
+  sx = iparse_sexp(text, strlen(text), cc);
+  check(sx != NULL, "parse indexed");
+  check(sx->flags & SEXP_FLAG_INDEXED, "top indexed");
+  check(sexp_nth(sx, 2)->flags & SEXP_FLAG_INDEXED, "(c d e) indexed");
+  check(!(sexp_nth(sx, 3)->flags & SEXP_FLAG_INDEXED), "() not indexed");
+  sub = sexp_nth(sx, 4);
+  check(sub->flags & SEXP_FLAG_INDEXED, "(f ...) indexed");
+  check(sexp_nth(sub, 1)->flags & SEXP_FLAG_INDEXED, "(g ...) indexed");
+  check_list(sx, "parsed");
+  check_list(sub, "parsed sublist");
+  check_list(sexp_nth(sub, 1), "parsed inner");
+
+  /* hash-consing drops the indexes */
+  sx = sexp_hashcons(sx);
+  check(sx != NULL && !(sx->flags & SEXP_FLAG_INDEXED), "hashcons");
+  check_list(sx, "hashconsed");
+  destroy_sexp(sx);
+  destroy_continuation(cc);
+
+  /* a lazy list is built when indexed */
+  sx = parse_sexp_lazy(text, strlen(text));
+  check(sx != NULL && (sx->flags & SEXP_FLAG_LAZY), "lazy");
+  check(sexp_index(sx) == 0 && !(sx->flags & SEXP_FLAG_LAZY) &&
+        sexp_length(sx) == 8, "lazy indexed");
+  check(strcmp(sexp_nth(sx, 5)->val, "m n") == 0, "lazy element");
+  destroy_sexp(sx);
+
+  sexp_cleanup();
+
+  printf("indexed list tests passed\n");
+
+  return 0;
+}
@@ -0,0 +1,185 @@
+/**
+
+SFSEXP: Small, Fast S-Expression Library version 1.0
+Written by Matthew Sottile (mjsottile@gmail.com)
+
+Copyright (2003-2006). The Regents of the University of California. This
+material was produced under U.S. Government contract W-7405-ENG-36 for Los
+Alamos National Laboratory, which is operated by the University of
+California for the U.S. Department of Energy. The U.S. Government has rights
+to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+derivative works, such modified software should be clearly marked, so as not
+to confuse it with the version available from LANL.
+
+Additionally, this library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation; either version 2.1 of the
+License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation,
+Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+LA-CC-04-094
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sexp.h"
+#include "test_util.h"
+#ifdef _SEXP_THREADS_
+# include <pthread.h>
+#endif
+
+/**
+ * parse with an intern table attached to the continuation: repeated basic
+ * atoms share one string, quoted atoms do not, find_sexp works on both,
+ * and the strings outlive the table.
+ */
+
+#define NMSG 1000
+
+/* parse NMSG messages through one continuation using table t. */
+static sexp_t **parse_all(sexp_intern_t *t) {
+  sexp_t **msgs = malloc(NMSG * sizeof(sexp_t *));
+  char buf[128];
+  pcont_t *cc;
+  int i;
+
+  sprintf(buf, "(msg)");
+  cc = init_continuation(buf);
+  check(cc != NULL, "init_continuation");
+  cc->intern = t;
+
+  for (i = 0; i < NMSG; i++) {
+    sprintf(buf, "(msg (port %d) (name \"svc %d\") 'timestamp (x%d y))",
+            i % 10, i, i);
+    reset_pcont(cc);
+    cc = cparse_sexp(buf, strlen(buf), cc);
+    check(cc->last_sexp != NULL, "parse");
+    msgs[i] = cc->last_sexp;
+  }
+
+  destroy_continuation(cc);
+
+  return msgs;
+}
+
+/* the threads share the table; they are left out when the library
+   keeps its global, thread-unsafe caches of sexp_t and stack nodes */
+#if defined(_SEXP_THREADS_) && defined(_NO_MEMORY_MANAGEMENT_)
+static void *parse_thread(void *arg) {
+  sexp_t **msgs = parse_all((sexp_intern_t *)arg);
+  int i;
+
+  for (i = 0; i < NMSG; i++)
+    destroy_sexp(msgs[i]);
+  free(msgs);
+
+  return NULL;
+}
+#endif
+
+int main(int argc, char **argv) {
+  sexp_intern_t *t;
+  sexp_t **msgs, *a, *b, *sx;
+  const char *port;
+  size_t n;
+  int i;
+
+  t = new_sexp_intern(0);
+  check(t != NULL, "new_sexp_intern");
+
+  msgs = parse_all(t);
+
+  a = msgs[0]->list->next->list;        /* port */
+  b = msgs[NMSG-1]->list->next->list;
+  check(a->val == b->val, "basic atoms share one string");
+  check((a->flags & SEXP_FLAG_INTERNED) && (a->flags & SEXP_FLAG_SHARED_VAL),
+        "interned flags");
+  check(a->val_used == 5 && strcmp(a->val, "port") == 0, "interned text");
+  check(sexp_interned_hash(a) == sexp_hash_bytes("port", 4), "stored hash");
+
+  a = msgs[0]->list->next->next->list->next;    /* "svc 0" */
+  check(!(a->flags & SEXP_FLAG_INTERNED), "dquote atoms not interned");
+  a = msgs[0]->list->next->next->next;          /* 'timestamp */
+  check(a->aty == SEXP_SQUOTE && !(a->flags & SEXP_FLAG_INTERNED),
+        "squote atoms not interned");
+
+  /* msg port name x0..x999 y and the ten port numbers. */
+  n = sexp_intern_count(t);
+  check(n == 3 + NMSG + 1 + 10, "distinct strings counted once");
+
+  /* find by interned pointer, by plain string, and a miss. */
+  port = sexp_intern(t, "port", 4);
+  check(port == msgs[5]->list->next->list->val, "sexp_intern lookup");
+  check(sexp_intern_count(t) == n, "lookup adds nothing");
+  check(find_sexp(port, msgs[5]) == msgs[5]->list->next->list,
+        "find_sexp by pointer");
+  sx = find_sexp("x5", msgs[5]);
+  check(sx != NULL && strcmp(sx->val, "x5") == 0, "find_sexp by string");
+  check(find_sexp("x6", msgs[5]) == NULL, "find_sexp miss");
+  sx = bfs_find_sexp("y", msgs[5]);
+  check(sx != NULL && strcmp(sx->val, "y") == 0, "bfs_find_sexp");
+  check(find_sexp("svc 5", msgs[5]) != NULL, "find_sexp of quoted atom");
+
+  sx = new_sexp_interned_atom(t, "port", 4);
+  check(sx != NULL && sx->val == port, "new_sexp_interned_atom");
+  destroy_sexp(sx);
+
+  /* strings no atom uses are dropped instead of growing the table, but
+     ones handed out by sexp_intern stay. */
+  {
+    sexp_intern_t *u = new_sexp_intern(16);
+    const char *keep = sexp_intern(u, "keep", 4);
+    char buf[32];
+
+    for (i = 0; i < 10000; i++) {
+      sprintf(buf, "z%d", i);
+      sx = new_sexp_interned_atom(u, buf, strlen(buf));
+      check(sx != NULL, "churn atom");
+      destroy_sexp(sx);
+    }
+    check(sexp_intern_count(u) <= 24, "unused strings reclaimed");
+    check(sexp_intern(u, "keep", 4) == keep && strcmp(keep, "keep") == 0,
+          "sexp_intern string pinned");
+    destroy_sexp_intern(u);
+  }
+
+#if defined(_SEXP_THREADS_) && defined(_NO_MEMORY_MANAGEMENT_)
+  {
+    pthread_t th[4];
+
+    for (i = 0; i < 4; i++)
+      check(pthread_create(&th[i], NULL, parse_thread, t) == 0,
+            "pthread_create");
+    for (i = 0; i < 4; i++)
+      pthread_join(th[i], NULL);
+    check(sexp_intern_count(t) == n, "threads added no new strings");
+  }
+#endif
+
+  /* atoms keep their strings after the table is gone. */
+  destroy_sexp_intern(t);
+  check(strcmp(msgs[NMSG-1]->list->next->list->val, "port") == 0,
+        "string outlives table");
+
+  for (i = 0; i < NMSG; i++)
+    destroy_sexp(msgs[i]);
+  free(msgs);
+
+  sexp_cleanup();
+
+  printf("intern tests passed.\n");
+
+  exit(EXIT_SUCCESS);
+}
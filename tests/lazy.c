@@ -0,0 +1,185 @@
+/**
+
+SFSEXP: Small, Fast S-Expression Library version 1.0
+Written by Matthew Sottile (mjsottile@gmail.com)
+
+Copyright (2003-2006). The Regents of the University of California. This
+material was produced under U.S. Government contract W-7405-ENG-36 for Los
+Alamos National Laboratory, which is operated by the University of
+California for the U.S. Department of Energy. The U.S. Government has rights
+to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+derivative works, such modified software should be clearly marked, so as not
+to confuse it with the version available from LANL.
+
+Additionally, this library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation; either version 2.1 of the
+License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation,
+Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+LA-CC-04-094
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sexp.h"
+#include "test_util.h"
+
+/**
+ * parse lazily, build the lists step by step and all at once, and check
+ * that the result is what parse_sexp builds.
+ */
+
+static const char *docs[] = {
+  "(msg (hdr a b) (body \"x)(\" 'q '(p ; (r)) c\\) ; comment )\n (z)) tail)",
+  "  ; leading comment\n (a)",
+  "(a ((b) ()) \"\" '\"s)\" 'x)",
+  "(x \001 y)",
+  "(a (b) c) (d)",
+  "atom",
+  NULL
+};
+
+static void same(sexp_t *a, sexp_t *b, const char *what) {
+  char bufa[1024], bufb[1024];
+
+  check(print_sexp(bufa, sizeof(bufa), a) >= 0, "print");
+  check(print_sexp(bufb, sizeof(bufb), b) >= 0, "print");
+  if (strcmp(bufa, bufb) != 0) {
+    printf("%s: '%s' vs '%s'\n", what, bufa, bufb);
+    check(0, what);
+  }
+}
+
+int main(int argc, char **argv) {
+  char buf[256];
+  sexp_t *full, *lazy, *hd, *sx;
+  int i;
+
+  for (i = 0; docs[i] != NULL; i++) {
+    full = parse_sexp((char *)docs[i], strlen(docs[i]));
+    check(full != NULL, docs[i]);
+
+    /* the text is copied: scribble over it once it is parsed. */
+    strcpy(buf, docs[i]);
+    lazy = parse_sexp_lazy(buf, strlen(buf));
+    check(lazy != NULL, "lazy parse");
+    memset(buf, ')', strlen(buf));
+
+    if (full->ty == SEXP_LIST) {
+      check((lazy->flags & SEXP_FLAG_LAZY) != 0, "root is lazy");
+      check(lazy->val_used > 0 && lazy->val[0] == '(', "source range");
+
+      /* one level: atoms are built, lists stay lazy */
+      hd = sexp_lazy_list(lazy);
+      check((lazy->flags & SEXP_FLAG_LAZY) == 0, "root built");
+      check(sexp_lazy_list(lazy) == hd, "built once");
+      for (sx = hd; sx != NULL; sx = sx->next)
+        check(sx->ty == SEXP_VALUE || (sx->flags & SEXP_FLAG_LAZY) ||
+              sx->list != NULL, "lists inside stay lazy");
+    }
+
+    check(sexp_materialize(lazy) == 0, "materialize");
+    same(full, lazy, docs[i]);
+
+    destroy_sexp(full);
+    destroy_sexp(lazy);
+  }
+
+  /* look at the head only and throw the rest away unbuilt. */
+  lazy = parse_sexp_lazy("(route (big (deep (er))) \"x\")", 29);
+  check(lazy != NULL, "route");
+  hd = sexp_lazy_list(lazy);
+  check(hd != NULL && strcmp(hd->val, "route") == 0, "head");
+  check(hd->next->flags & SEXP_FLAG_LAZY, "body lazy");
+  check(strncmp(hd->next->val, "(big (deep (er)))", hd->next->val_used) == 0,
+        "body text");
+  sx = sexp_lazy_list(hd->next);
+  check(sx != NULL && strcmp(sx->val, "big") == 0, "body head");
+  destroy_sexp(lazy);
+
+  check(sexp_lazy_list(NULL) == NULL && sexp_errno == SEXP_ERR_BAD_PARAM,
+        "null list");
+
+  /* a lazy list is never taken for an empty one: the gateway prints the
+     message it only looked the head of, and other functions build the
+     lists they look into */
+  {
+    const char *msg = "(msg (hdr a b) (body (x y) z))";
+    CSTRING *cs = NULL;
+    sexp_t *cp;
+
+    full = parse_sexp((char *) msg, strlen(msg));
+    lazy = parse_sexp_lazy(msg, strlen(msg));
+    check(print_sexp(buf, sizeof(buf), lazy) >= 0 &&
+          strcmp(buf, msg) == 0, "print unbuilt");
+    hd = sexp_lazy_list(lazy);
+    check(print_sexp(buf, sizeof(buf), lazy) >= 0 &&
+          strcmp(buf, msg) == 0, "print head built");
+    check(print_sexp(buf, 10, lazy) == -1 &&
+          sexp_errno == SEXP_ERR_BUFFER_FULL, "print short");
+    check(print_sexp_cstr(&cs, lazy, 8) >= 0 &&
+          strcmp(cs->base, msg) == 0, "print cstring");
+    sdestroy(cs);
+
+    check(hd->next->flags & SEXP_FLAG_LAZY, "hdr lazy");
+    check(sexp_list_length(hd->next) == 3, "length");
+    check(sexp_nth(hd->next->next, 1) != NULL &&
+          sexp_nth(hd->next->next, 1)->ty == SEXP_LIST, "nth");
+    destroy_sexp(lazy);
+
+    lazy = parse_sexp_lazy(msg, strlen(msg));
+    cp = copy_sexp(lazy);
+    same(cp, full, "copy");
+    check(sexp_equal(cp, full) == 1, "copy equal");
+    destroy_sexp(cp);
+    destroy_sexp(lazy);
+
+    lazy = parse_sexp_lazy(msg, strlen(msg));
+    check(sexp_equal(lazy, full) == 1, "equal");
+    destroy_sexp(lazy);
+
+    lazy = parse_sexp_lazy(msg, strlen(msg));
+    check(sexp_hash(lazy) == sexp_hash(full), "hash");
+    destroy_sexp(lazy);
+
+    lazy = parse_sexp_lazy(msg, strlen(msg));
+    sx = find_sexp("z", lazy);
+    check(sx != NULL && sx->ty == SEXP_VALUE, "find");
+    destroy_sexp(lazy);
+
+    lazy = parse_sexp_lazy(msg, strlen(msg));
+    check(bfs_find_sexp("y", lazy) != NULL, "bfs find");
+    destroy_sexp(lazy);
+
+    destroy_sexp(full);
+  }
+
+  /* incomplete and malformed text */
+  check(parse_sexp_lazy("(a (b)", 6) == NULL &&
+        sexp_errno == SEXP_ERR_INCOMPLETE, "incomplete");
+  check(parse_sexp_lazy("(a \"b)", 6) == NULL &&
+        sexp_errno == SEXP_ERR_INCOMPLETE, "open string");
+  check(parse_sexp_lazy(" ) (a)", 6) == NULL &&
+        sexp_errno == SEXP_ERR_BADFORM, "close paren");
+  check(parse_sexp_lazy("  ", 2) == NULL &&
+        sexp_errno == SEXP_ERR_INCOMPLETE, "blank");
+
+  sexp_cleanup();
+
+  printf("lazy parsing tests passed\n");
+
+  return 0;
+}
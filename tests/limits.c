@@ -0,0 +1,171 @@
+/**
+
+SFSEXP: Small, Fast S-Expression Library version 1.0
+Written by Matthew Sottile (mjsottile@gmail.com)
+
+Copyright (2003-2006). The Regents of the University of California. This
+material was produced under U.S. Government contract W-7405-ENG-36 for Los
+Alamos National Laboratory, which is operated by the University of
+California for the U.S. Department of Energy. The U.S. Government has rights
+to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+derivative works, such modified software should be clearly marked, so as not
+to confuse it with the version available from LANL.
+
+Additionally, this library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation; either version 2.1 of the
+License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation,
+Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+LA-CC-04-094
+
+**/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sexp.h"
+#include "test_util.h"
+
+/**
+ * parse with the limits of the continuation set, and check that input
+ * within them parses and input past them stops with the right error,
+ * without reading or allocating the rest.
+ */
+
+static pcont_t *limited(parsermode_t mode, unsigned int depth, size_t atom,
+                        size_t nodes, size_t bytes) {
+  pcont_t *cc = init_continuation(NULL);
+
+  check(cc != NULL, "continuation");
+  cc->mode = mode;
+  cc->max_depth = depth;
+  cc->max_atom_bytes = atom;
+  cc->max_nodes = nodes;
+  cc->max_bytes = bytes;
+  return cc;
+}
+
+/* parse all of s; running out of input is all that goes wrong for input
+   within the limits */
+static sexp_errcode_t parse(pcont_t *cc, const char *s) {
+  static char buf[4096];
+  sexp_t *sx;
+
+  strcpy(buf, s);
+  do {
+    sx = iparse_sexp(buf, strlen(buf), cc);
+    destroy_sexp(sx);
+  } while (cc->error == SEXP_ERR_OK && cc->lastPos != NULL);
+  return cc->error;
+}
+
+/* a new continuation with the limits parses s with the result err */
+static void expect(parsermode_t mode, unsigned int depth, size_t atom,
+                   size_t nodes, size_t bytes, const char *s,
+                   sexp_errcode_t err) {
+  pcont_t *cc = limited(mode, depth, atom, nodes, bytes);
+
+  check(parse(cc, s) == err, s);
+  check(err == SEXP_ERR_INCOMPLETE || sexp_errno == err, "sexp_errno");
+  destroy_continuation(cc);
+}
+
+static void start(void) { }
+
+int main(int argc, char **argv) {
+  parser_event_handlers_t handlers;
+  char big[2048];
+  pcont_t *cc;
+
+  /* depth */
+  expect(PARSER_NORMAL, 3, 0, 0, 0, "(((a))) (b)", SEXP_ERR_INCOMPLETE);
+  expect(PARSER_NORMAL, 3, 0, 0, 0, "(a ((b ((c)))))", SEXP_ERR_LIMIT_DEPTH);
+  expect(PARSER_NORMAL, 3, 0, 0, 0, "(a '((((b)))))", SEXP_ERR_INCOMPLETE);
+
+  /* atoms */
+  expect(PARSER_NORMAL, 0, 4, 0, 0, "(abcd \"efgh\" 'ijkl) ",
+         SEXP_ERR_INCOMPLETE);
+  expect(PARSER_NORMAL, 0, 4, 0, 0, "(abcd abcde)", SEXP_ERR_LIMIT_ATOM);
+  expect(PARSER_NORMAL, 0, 4, 0, 0, "(\"abcde\")", SEXP_ERR_LIMIT_ATOM);
+  expect(PARSER_NORMAL, 0, 4, 0, 0, "'(a b c)", SEXP_ERR_LIMIT_ATOM);
+  expect(PARSER_NORMAL, 0, 4, 0, 0, "abcde ", SEXP_ERR_LIMIT_ATOM);
+
+  /* a long atom is stopped long before its end */
+  cc = limited(PARSER_NORMAL, 0, 100, 0, 0);
+  memset(big, 'x', sizeof(big) - 1);
+  big[0] = '(';
+  big[sizeof(big) - 1] = '\0';
+  check(parse(cc, big) == SEXP_ERR_LIMIT_ATOM, "long atom");
+  check(cc->val_allocated < 1024, "long atom stopped");
+  destroy_continuation(cc);
+
+  /* binary atoms are refused on their size */
+  expect(PARSER_INLINE_BINARY, 0, 4, 0, 0, "(#b#4#abcd)", SEXP_ERR_INCOMPLETE);
+  expect(PARSER_INLINE_BINARY, 0, 4, 0, 0, "(#b#1000000000#",
+         SEXP_ERR_LIMIT_ATOM);
+  expect(PARSER_INLINE_BINARY, 0, 0, 0, 6, "(#b#4#abcd #b#3#abc)",
+         SEXP_ERR_LIMIT_BYTES);
+
+  /* elements of one expression */
+  expect(PARSER_NORMAL, 0, 0, 3, 0, "(a b) (c d) ((e))", SEXP_ERR_INCOMPLETE);
+  expect(PARSER_NORMAL, 0, 0, 3, 0, "(a b c)", SEXP_ERR_LIMIT_NODES);
+  expect(PARSER_NORMAL, 0, 0, 3, 0, "(a (b))", SEXP_ERR_LIMIT_NODES);
+
+  /* bytes of one expression */
+  expect(PARSER_NORMAL, 0, 0, 0, 5, "(ab cde) (fghij)", SEXP_ERR_INCOMPLETE);
+  expect(PARSER_NORMAL, 0, 0, 0, 5, "(abc def)", SEXP_ERR_LIMIT_BYTES);
+
+  /* the counts carry over from one buffer to the next */
+  cc = limited(PARSER_NORMAL, 0, 0, 3, 0);
+  check(parse(cc, "(a ") == SEXP_ERR_INCOMPLETE, "first piece");
+  check(parse(cc, "b c)") == SEXP_ERR_LIMIT_NODES, "second piece");
+  destroy_continuation(cc);
+
+  cc = limited(PARSER_NORMAL, 0, 8, 0, 0);
+  check(parse(cc, "(abcd") == SEXP_ERR_INCOMPLETE, "first atom piece");
+  check(parse(cc, "efghi)") == SEXP_ERR_LIMIT_ATOM, "second atom piece");
+  destroy_continuation(cc);
+
+  /* events are limited as trees are, and so is validation, which is
+     what events become without handlers or a sink */
+  memset(&handlers, 0, sizeof(handlers));
+  handlers.start_sexpr = start;
+  cc = limited(PARSER_EVENTS_ONLY, 2, 0, 0, 0);
+  cc->event_handlers = &handlers;
+  check(parse(cc, "(a (b (c)))") == SEXP_ERR_LIMIT_DEPTH, "events");
+  destroy_continuation(cc);
+  expect(PARSER_EVENTS_ONLY, 2, 0, 0, 0, "(a (b (c)))", SEXP_ERR_LIMIT_DEPTH);
+  expect(PARSER_EVENTS_ONLY, 0, 4, 0, 0, "(abcd \"efgh\" 'ijkl) ",
+         SEXP_ERR_INCOMPLETE);
+  expect(PARSER_EVENTS_ONLY, 0, 4, 0, 0, "(abcd abcde)", SEXP_ERR_LIMIT_ATOM);
+  expect(PARSER_EVENTS_ONLY, 0, 4, 0, 0, "(\"ab\\\"cd\")",
+         SEXP_ERR_LIMIT_ATOM);
+  expect(PARSER_EVENTS_ONLY, 0, 4, 0, 0, "'(a b c)", SEXP_ERR_LIMIT_ATOM);
+  expect(PARSER_EVENTS_ONLY, 0, 0, 3, 0, "(a b) (c d) ((e))",
+         SEXP_ERR_INCOMPLETE);
+  expect(PARSER_EVENTS_ONLY, 0, 0, 3, 0, "(a (b))", SEXP_ERR_LIMIT_NODES);
+  expect(PARSER_EVENTS_ONLY, 0, 0, 0, 5, "(ab cde) (fghij)",
+         SEXP_ERR_INCOMPLETE);
+  expect(PARSER_EVENTS_ONLY, 0, 0, 0, 5, "(abc def)", SEXP_ERR_LIMIT_BYTES);
+
+  cc = limited(PARSER_EVENTS_ONLY, 0, 8, 0, 0);
+  check(parse(cc, "(abcd") == SEXP_ERR_INCOMPLETE, "first validated piece");
+  check(parse(cc, "efghi)") == SEXP_ERR_LIMIT_ATOM, "second validated piece");
+  destroy_continuation(cc);
+
+  sexp_cleanup();
+
+  exit(EXIT_SUCCESS);
+}
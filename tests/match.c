@@ -0,0 +1,186 @@
+/**
+
+SFSEXP: Small, Fast S-Expression Library version 1.0
+Written by Matthew Sottile (mjsottile@gmail.com)
+
+Copyright (2003-2006). The Regents of the University of California. This
+material was produced under U.S. Government contract W-7405-ENG-36 for Los
+Alamos National Laboratory, which is operated by the University of
+California for the U.S. Department of Energy. The U.S. Government has rights
+to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+derivative works, such modified software should be clearly marked, so as not
+to confuse it with the version available from LANL.
+
+Additionally, this library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation; either version 2.1 of the
+License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation,
+Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+LA-CC-04-094
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sexp.h"
+#include "test_util.h"
+
+/**
+ * search an expression for several names at once with each match mode,
+ * checking the names found and the paths reported against the obvious
+ * one-name-at-a-time search.
+ */
+
+static const char *input =
+  "(route (to \"svc.orders\") (keys order orders reorder) "
+  "(meta (trace abc-order-7) (tags urgent order)) 'order)";
+
+static const char *names[] = { "order", "orders", "urgent", "ord", "zz", "" };
+
+#define NNAMES (sizeof(names) / sizeof(names[0]))
+
+#define MAXHITS 64
+
+typedef struct hit {
+  sexp_t *sx;
+  size_t name;
+  unsigned int depth;
+  sexp_t *parent;
+} hit_t;
+
+typedef struct hits {
+  hit_t h[MAXHITS];
+  int n;
+  int stop_after;
+} hits_t;
+
+static sexp_walk_t record(sexp_t *sx, size_t name, sexp_t **path,
+                          unsigned int depth, void *data) {
+  hits_t *hs = (hits_t *)data;
+
+  check(hs->n < MAXHITS, "too many hits");
+  check(depth > 0 && path[depth-1]->ty == SEXP_LIST, "path");
+  hs->h[hs->n].sx = sx;
+  hs->h[hs->n].name = name;
+  hs->h[hs->n].depth = depth;
+  hs->h[hs->n].parent = path[depth-1];
+  hs->n++;
+
+  return (hs->n == hs->stop_after) ? SEXP_WALK_STOP : SEXP_WALK_CONTINUE;
+}
+
+static int matches(const char *val, const char *name, sexp_match_mode_t mode) {
+  size_t vl = strlen(val), nl = strlen(name);
+
+  switch (mode) {
+  case SEXP_MATCH_EXACT:  return strcmp(val, name) == 0;
+  case SEXP_MATCH_PREFIX: return strncmp(val, name, nl) == 0;
+  case SEXP_MATCH_SUFFIX: return vl >= nl && strcmp(val + vl - nl, name) == 0;
+  default:                return strstr(val, name) != NULL;
+  }
+}
+
+/* is (sx, name) among the hits, and does its parent contain sx? */
+static int found(hits_t *hs, sexp_t *sx, size_t name) {
+  sexp_t *e;
+  int i;
+
+  for (i = 0; i < hs->n; i++) {
+    if (hs->h[i].sx != sx || hs->h[i].name != name)
+      continue;
+    for (e = hs->h[i].parent->list; e != NULL && e != sx; e = e->next)
+      ;
+    check(e == sx, "parent in path holds the atom");
+    return 1;
+  }
+
+  return 0;
+}
+
+static void try_mode(sexp_t *sx, sexp_match_mode_t mode) {
+  sexp_matcher_t *m;
+  hits_t hs;
+  sexp_t *stack[64], *e;
+  int sp = 0, expect = 0;
+  size_t i;
+
+  m = new_sexp_matcher(names, NNAMES, mode);
+  check(m != NULL, "new_sexp_matcher");
+
+  hs.n = 0;
+  hs.stop_after = 0;
+  check(sexp_match_multi(m, sx, record, &hs) == hs.n, "count");
+
+  /* every atom against every name, the slow way. */
+  stack[sp++] = sx;
+  while (sp > 0) {
+    for (e = stack[--sp]; e != NULL; e = e->next) {
+      if (e->ty == SEXP_LIST) {
+        stack[sp++] = e->list;
+        continue;
+      }
+      for (i = 0; i < NNAMES; i++) {
+        if (matches(e->val, names[i], mode)) {
+          expect++;
+          if (!found(&hs, e, i)) {
+            printf("mode %d: %s / %s\n", mode, e->val, names[i]);
+            check(0, "match missing");
+          }
+        }
+      }
+    }
+  }
+  check(expect == hs.n, "no extra matches");
+
+  /* stopping early. */
+  hs.n = 0;
+  hs.stop_after = 2;
+  check(sexp_match_multi(m, sx, record, &hs) == 2, "stop");
+
+  destroy_sexp_matcher(m);
+}
+
+int main(int argc, char **argv) {
+  sexp_t *sx;
+  hits_t hs;
+  const char *two[] = { "keys", "tags" };
+
+  sx = parse_sexp((char *)input, strlen(input));
+  check(sx != NULL, "parse");
+
+  try_mode(sx, SEXP_MATCH_EXACT);
+  try_mode(sx, SEXP_MATCH_PREFIX);
+  try_mode(sx, SEXP_MATCH_SUFFIX);
+  try_mode(sx, SEXP_MATCH_SUBSTRING);
+
+  /* the one-shot exact search, with the paths it reports. */
+  hs.n = 0;
+  hs.stop_after = 0;
+  check(find_sexp_multi(two, 2, sx, record, &hs) == 2, "find_sexp_multi");
+  check(hs.h[0].sx == find_sexp("keys", sx) && hs.h[0].name == 0 &&
+        hs.h[0].depth == 2, "keys");
+  check(hs.h[1].sx == find_sexp("tags", sx) && hs.h[1].name == 1 &&
+        hs.h[1].depth == 3 &&
+        hs.h[1].parent == sx->list->next->next->next->list->next->next, "tags");
+
+  check(find_sexp_multi(two, 2, NULL, record, &hs) == 0, "NULL expression");
+  check(sexp_match_multi(NULL, sx, record, &hs) == -1 &&
+        sexp_errno == SEXP_ERR_BAD_PARAM, "bad parameters");
+
+  destroy_sexp(sx);
+  sexp_cleanup();
+
+  return 0;
+}
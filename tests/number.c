@@ -0,0 +1,200 @@
+/**
+
+SFSEXP: Small, Fast S-Expression Library version 1.0
+Written by Matthew Sottile (mjsottile@gmail.com)
+
+Copyright (2003-2006). The Regents of the University of California. This
+material was produced under U.S. Government contract W-7405-ENG-36 for Los
+Alamos National Laboratory, which is operated by the University of
+California for the U.S. Department of Energy. The U.S. Government has rights
+to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+derivative works, such modified software should be clearly marked, so as not
+to confuse it with the version available from LANL.
+
+Additionally, this library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation; either version 2.1 of the
+License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation,
+Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+LA-CC-04-094
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <limits.h>
+#include "sexp.h"
+#include "test_util.h"
+
+/**
+ * numeric atoms: formatting, printing, and the operations that look at
+ * the text of atoms.
+ */
+
+/* integers that need all the bits of sexp_int64_t */
+static const sexp_int64_t wide[] = {
+  -1, 81985529216486895LL, -9223372036854775807LL - 1
+};
+
+static void check_int(sexp_int64_t v, const char *expect) {
+  char buf[SEXP_NUMBER_MAX];
+
+  check(sexp_format_int64(buf, v) == strlen(expect) &&
+        strcmp(buf, expect) == 0, expect);
+}
+
+static void check_double(double v, const char *expect) {
+  char buf[SEXP_NUMBER_MAX];
+
+  check(sexp_format_double(buf, v) == strlen(expect) &&
+        strcmp(buf, expect) == 0, expect);
+}
+
+static const double round_trip[] = {
+  0.1, 0.2, 0.3, 1.0 / 3, 2.0 / 3, 3.141592653589793, 1e-300, 1e300,
+  DBL_MAX, DBL_MIN, 5e-324, 123456.789, 9007199254740993.0, -2.5e-7
+};
+
+int main(int argc, char **argv) {
+  char buf[256], text[SEXP_NUMBER_MAX];
+  char nbuf[SEXP_NUMBER_MAX];
+  sexp_t *sx, *parsed, *cp, *t;
+  sexp_arena_t *arena;
+  CSTRING *s = NULL;
+  size_t i, len;
+
+  /* formatting */
+  check_int(0, "0");
+  check_int(7, "7");
+  check_int(-7, "-7");
+  check_int(10, "10");
+  check_int(99, "99");
+  check_int(100, "100");
+  check_int(1234567890123LL, "1234567890123");
+  check_int(-9223372036854775807LL - 1, "-9223372036854775808");
+  check_int(9223372036854775807LL, "9223372036854775807");
+
+  check_double(0.0, "0");
+  check_double(-0.0, "-0");
+  check_double(4.0, "4");
+  check_double(-12345.0, "-12345");
+  check_double(0.5, "0.5");
+  check_double(0.1, "0.1");
+  check_double(1e100, "1e+100");
+  check_double(1e15, "1e+15");
+  check_double(0.0001, "0.0001");
+  check_double(1e-5, "1e-05");
+  check_double(-2.5e-7, "-2.5e-07");
+  check_double(123456.789, "123456.789");
+  check_double(1.5e300, "1.5e+300");
+  check_double(5e-324, "5e-324");
+  check_double(0.3, "0.3");
+  check_double(2.0 / 3, "0.6666666666666666");
+  for (i = 0; i < sizeof(round_trip) / sizeof(round_trip[0]); i++) {
+    sexp_format_double(text, round_trip[i]);
+    check(strtod(text, NULL) == round_trip[i], "round trip");
+  }
+
+  /* all 64 bits of the value are kept */
+  for (i = 0; i < sizeof(wide) / sizeof(wide[0]); i++) {
+    t = new_sexp_int64(wide[i]);
+    check(t != NULL && sexp_int64_value(t) == wide[i], "wide integer");
+    sexp_set_double(t, -1.0 / 3);
+    check(sexp_double_value(t) == -1.0 / 3 &&
+          (t->flags & (SEXP_FLAG_INT64 | SEXP_FLAG_DOUBLE)) ==
+          SEXP_FLAG_DOUBLE, "sexp_set_double");
+    destroy_sexp(t);
+  }
+
+  /* printing */
+  sx = new_sexp_list(new_sexp_atom("vals", 4, SEXP_BASIC));
+  sx->list->next = new_sexp_int64(-42);
+  sx->list->next->next = new_sexp_double(0.25);
+  sx->list->next->next->next = new_sexp_int64(1000000);
+  check(sx->list->next->val == NULL &&
+        (sx->list->next->flags & SEXP_FLAG_INT64) &&
+        (sx->list->next->next->flags & SEXP_FLAG_DOUBLE), "numeric atoms");
+  check(print_sexp(buf, sizeof(buf), sx) > 0 &&
+        strcmp(buf, "(vals -42 0.25 1000000)") == 0, "print_sexp");
+  check(print_sexp_cstr(&s, sx, 8) > 0 &&
+        strcmp(s->base, "(vals -42 0.25 1000000)") == 0, "print_sexp_cstr");
+  sdestroy(s);
+
+  /* a buffer too small cuts the number short */
+  for (i = 1; i < 24; i++) {
+    memset(buf, 'X', sizeof(buf));
+    check(print_sexp(buf, i, sx) == -1 && sexp_errno == SEXP_ERR_BUFFER_FULL,
+          "short buffer");
+    check(strlen(buf) == i - 1 &&
+          strncmp(buf, "(vals -42 0.25 1000000)", i - 1) == 0 &&
+          buf[i] == 'X', "short buffer contents");
+  }
+  t = new_sexp_int64(123456);
+  check(print_sexp(buf, 4, t) == -1 && strcmp(buf, "123") == 0,
+        "lone number cut short");
+  check(print_sexp(buf, sizeof(buf), t) == 6 && strcmp(buf, "123456") == 0,
+        "lone number");
+  destroy_sexp(t);
+
+  /* the text is what parsing the printed expression gives */
+  check(print_sexp(buf, sizeof(buf), sx) > 0, "print");
+  parsed = parse_sexp(buf, strlen(buf));
+  check(parsed != NULL && sexp_equal(parsed, sx) == 1 &&
+        sexp_equal(sx, parsed) == 1, "equal to the parsed text");
+  check(sexp_hash(parsed) == sexp_hash(sx), "same hash as the text");
+  check(find_sexp("0.25", sx) == sx->list->next->next, "find_sexp");
+  check(strcmp(sexp_atom_text(sx->list->next, nbuf, &len), "-42") == 0 &&
+        len == 3, "sexp_atom_text");
+  check(sexp_atom_text(parsed->list, nbuf, &len) == parsed->list->val &&
+        len == 4, "text of a text atom");
+  check(sexp_atom_text(sx, nbuf, NULL) == NULL, "lists have no text");
+  destroy_sexp(parsed);
+
+  /* copies keep the value */
+  cp = copy_sexp(sx);
+  check(cp != NULL && cp->list->next->val == NULL &&
+        sexp_int64_value(cp->list->next) == -42 && sexp_equal(cp, sx) == 1,
+        "copy");
+  destroy_sexp(cp);
+  arena = new_sexp_arena(0);
+  check(arena != NULL, "arena");
+  cp = copy_sexp_into(arena, sx);
+  check(cp != NULL && (cp->list->next->next->flags & SEXP_FLAG_DOUBLE) &&
+        sexp_double_value(cp->list->next->next) == 0.25 &&
+        sexp_equal(cp, sx) == 1, "arena copy");
+  destroy_sexp_arena(arena);
+
+  /* different numbers differ */
+  t = new_sexp_int64(-43);
+  check(sexp_equal(t, sx->list->next) == 0, "unequal ints");
+  destroy_sexp(t);
+  t = new_sexp_atom("-42", 3, SEXP_BASIC);
+  check(sexp_equal(t, sx->list->next) == 1, "int equals its text");
+  destroy_sexp(t);
+
+  /* persistent versions keep it too */
+  cp = sexp_hashcons(copy_sexp(sx));
+  check(cp != NULL && sexp_equal(cp, sx) == 1, "hashcons");
+  destroy_sexp(cp);
+
+  destroy_sexp(sx);
+
+  sexp_cleanup();
+
+  printf("numeric atom tests passed\n");
+
+  return 0;
+}
@@ -0,0 +1,177 @@
+/**
+
+SFSEXP: Small, Fast S-Expression Library version 1.0
+Written by Matthew Sottile (mjsottile@gmail.com)
+
+Copyright (2003-2006). The Regents of the University of California. This
+material was produced under U.S. Government contract W-7405-ENG-36 for Los
+Alamos National Laboratory, which is operated by the University of
+California for the U.S. Department of Energy. The U.S. Government has rights
+to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+derivative works, such modified software should be clearly marked, so as not
+to confuse it with the version available from LANL.
+
+Additionally, this library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation; either version 2.1 of the
+License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation,
+Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+LA-CC-04-094
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sexp.h"
+
+/**
+ * check that print_sexp_parallel and write_sexp_parallel produce exactly
+ * what print_sexp_cstr produces, for a range of thread counts.
+ */
+
+#define NCHILDREN 5000
+
+static const char *pieces[] = {
+  "atom", "\"dquoted atom\"", "'squoted", "(nested (list \"with\" 'quotes))",
+  "()", "\"esc\\\"aped\"", "'(quoted list)", "12345"
+};
+
+int main(int argc, char **argv) {
+  CSTRING *in = NULL, *serial = NULL, *par = NULL;
+  sexp_t *sx, *bin, *bad;
+  unsigned int threads[] = { 0, 1, 2, 3, 8, 64 };
+  unsigned int t, i;
+  FILE *fp;
+  char *rbuf;
+  size_t rlen;
+  sexp_errcode_t err;
+  char *blob;
+
+  in = snew(1024);
+  in = sadd(in, "(top");
+  for (i = 0; i < NCHILDREN; i++) {
+    in = saddch(in, ' ');
+    in = sadd(in, (char *)pieces[i % (sizeof(pieces)/sizeof(char *))]);
+  }
+  in = saddch(in, ')');
+
+  sx = parse_sexp(in->base, in->curlen);
+  if (sx == NULL) {
+    printf("parse failed, err=%d\n", sexp_errno);
+    exit(EXIT_FAILURE);
+  }
+
+  /* binary atoms print with a trailing space of their own; make sure the
+     chunk boundaries don't disturb that.  the atom owns the blob, so it
+     comes from sexp_malloc. */
+  blob = sexp_malloc(3);
+  memcpy(blob, "a b", 3);
+  bin = new_sexp_binary_atom(blob, 3);
+  bin->next = sx->list->next;
+  sx->list->next = bin;
+
+  print_sexp_cstr(&serial, sx, 1024);
+
+  for (t = 0; t < sizeof(threads)/sizeof(unsigned int); t++) {
+    err = print_sexp_parallel(&par, sx, 1024, threads[t]);
+    if (err != SEXP_ERR_OK) {
+      printf("print_sexp_parallel(%u) failed, err=%d\n", threads[t], err);
+      exit(EXIT_FAILURE);
+    }
+
+    if (par->curlen != serial->curlen ||
+        memcmp(par->base, serial->base, serial->curlen) != 0) {
+      printf("print_sexp_parallel(%u) output differs from print_sexp_cstr\n",
+             threads[t]);
+      exit(EXIT_FAILURE);
+    }
+    sdestroy(par);
+    par = NULL;
+
+    fp = tmpfile();
+    if (fp == NULL) {
+      printf("could not open temporary file\n");
+      exit(EXIT_FAILURE);
+    }
+
+    err = write_sexp_parallel(fileno(fp), sx, threads[t]);
+    if (err != SEXP_ERR_OK) {
+      printf("write_sexp_parallel(%u) failed, err=%d\n", threads[t], err);
+      exit(EXIT_FAILURE);
+    }
+
+    rlen = (size_t)ftell(fp);
+    rewind(fp);
+    rbuf = malloc(rlen+1);
+    if (rlen != serial->curlen || fread(rbuf, 1, rlen, fp) != rlen ||
+        memcmp(rbuf, serial->base, rlen) != 0) {
+      printf("write_sexp_parallel(%u) output differs from print_sexp_cstr\n",
+             threads[t]);
+      exit(EXIT_FAILURE);
+    }
+    free(rbuf);
+    fclose(fp);
+  }
+
+  /* an atom has nothing to split and takes the serial path. */
+  err = print_sexp_parallel(&par, sx->list, 16, 4);
+  if (err != SEXP_ERR_OK || strcmp(par->base, "top") != 0) {
+    printf("print_sexp_parallel mishandled an atom: %s\n",
+           (par == NULL) ? "(null)" : par->base);
+    exit(EXIT_FAILURE);
+  }
+
+  /* elements of unknown type fail the chunks they are in, and the error
+     is reported once the workers are done */
+  for (bad = sx->list, i = 0; bad != NULL; bad = bad->next, i++)
+    if (i % 100 == 3 && bad->ty == SEXP_VALUE)
+      bad->ty = (elt_t) 99;
+  for (t = 0; t < sizeof(threads)/sizeof(unsigned int); t++) {
+    sexp_errno = SEXP_ERR_OK;
+    err = print_sexp_parallel(&par, sx, 1024, threads[t]);
+    if (err != SEXP_ERR_BADCONTENT || sexp_errno != SEXP_ERR_BADCONTENT) {
+      printf("print_sexp_parallel(%u) missed a bad element, err=%d\n",
+             threads[t], err);
+      exit(EXIT_FAILURE);
+    }
+    if (par != NULL) {
+      sdestroy(par);
+      par = NULL;
+    }
+
+    sexp_errno = SEXP_ERR_OK;
+    fp = tmpfile();
+    err = write_sexp_parallel(fileno(fp), sx, threads[t]);
+    if (err != SEXP_ERR_BADCONTENT || sexp_errno != SEXP_ERR_BADCONTENT) {
+      printf("write_sexp_parallel(%u) missed a bad element, err=%d\n",
+             threads[t], err);
+      exit(EXIT_FAILURE);
+    }
+    fclose(fp);
+  }
+  for (bad = sx->list; bad != NULL; bad = bad->next)
+    if (bad->ty == (elt_t) 99)
+      bad->ty = SEXP_VALUE;
+
+  printf("parallel printing matches serial printing.\n");
+
+  sdestroy(par);
+  sdestroy(serial);
+  sdestroy(in);
+  destroy_sexp(sx);
+  sexp_cleanup();
+
+  exit(EXIT_SUCCESS);
+}
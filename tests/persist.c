@@ -0,0 +1,128 @@
+/**
+
+SFSEXP: Small, Fast S-Expression Library version 1.0
+Written by Matthew Sottile (mjsottile@gmail.com)
+
+Copyright (2003-2006). The Regents of the University of California. This
+material was produced under U.S. Government contract W-7405-ENG-36 for Los
+Alamos National Laboratory, which is operated by the University of
+California for the U.S. Department of Energy. The U.S. Government has rights
+to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+derivative works, such modified software should be clearly marked, so as not
+to confuse it with the version available from LANL.
+
+Additionally, this library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation; either version 2.1 of the
+License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation,
+Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+LA-CC-04-094
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sexp.h"
+#include "test_util.h"
+
+/**
+ * build versions of a persistent expression with sexp_set_nth,
+ * sexp_replace and sexp_append, check that old versions are unchanged and
+ * that untouched parts are shared, and drop the versions in an order
+ * different from the one they were made in.
+ */
+
+static const char *input =
+  "(config (server (host \"example.org\") (port 80)) "
+  "(limits (cpu 4) (mem 1024)) (users alice bob))";
+
+static sexp_t *frozen(const char *str) {
+  sexp_t *sx = parse_sexp((char *)str, strlen(str));
+
+  check(sx != NULL, "parse");
+  check(sexp_freeze(sx) == sx, "sexp_freeze");
+
+  return sx;
+}
+
+int main(int argc, char **argv) {
+  sexp_t *v0, *v1, *v2, *v3, *v4, *port, *p443, *lim, *carol, *tmp;
+  CSTRING *orig = NULL;
+
+  v0 = frozen(input);
+  print_sexp_cstr(&orig, v0, 256);
+
+  /* replace a nested element: only (config ...) and (server ...) and the
+     elements in front of the changed ones are new. */
+  port = v0->list->next->list->next->next;
+  p443 = frozen("(port 443)");
+  v1 = sexp_replace(v0, port, p443);
+  check(v1 != NULL, "sexp_replace");
+  prints(v1, "(config (server (host \"example.org\") (port 443)) "
+         "(limits (cpu 4) (mem 1024)) (users alice bob))", "replaced");
+  prints(v0, toCharPtr(orig), "old version after replace");
+  check(v1->list->next->next == v0->list->next->next, "limits shared");
+  check(v1->list->next->list->next->list ==
+        v0->list->next->list->next->list, "host contents shared");
+  check(v1->list->val == v0->list->val, "atom text shared");
+
+  /* set the third element of the top list. */
+  lim = frozen("(limits)");
+  v2 = sexp_set_nth(v1, 2, lim);
+  check(v2 != NULL, "sexp_set_nth");
+  prints(v2, "(config (server (host \"example.org\") (port 443)) "
+         "(limits) (users alice bob))", "set_nth");
+  check(v2->list->next->next->next == v1->list->next->next->next,
+        "users shared");
+  sexp_release(lim);
+
+  /* append to the users list. */
+  carol = frozen("carol");
+  tmp = v2->list->next->next->next;
+  v3 = sexp_append(tmp, carol);
+  check(v3 != NULL, "sexp_append");
+  prints(v3, "(users alice bob carol)", "append");
+  v4 = sexp_replace(v2, tmp, v3);
+  check(v4 != NULL, "sexp_replace with appended list");
+  prints(v4, "(config (server (host \"example.org\") (port 443)) "
+         "(limits) (users alice bob carol))", "replace with appended");
+
+  /* error cases. */
+  check(sexp_set_nth(v0, 10, carol) == NULL &&
+        sexp_errno == SEXP_ERR_BAD_PARAM, "set_nth out of range");
+  check(sexp_replace(v0, v4->list->next, carol) == NULL &&
+        sexp_errno == SEXP_ERR_BAD_PARAM, "replace of element not in root");
+
+  /* drop versions out of order; each remaining one stays intact. */
+  sexp_release(p443);
+  sexp_release(carol);
+  destroy_sexp(v1);
+  prints(v0, toCharPtr(orig), "v0 after v1 released");
+  prints(v4, "(config (server (host \"example.org\") (port 443)) "
+         "(limits) (users alice bob carol))", "v4 after v1 released");
+  sexp_release(v0);
+  sexp_release(v3);
+  prints(v4, "(config (server (host \"example.org\") (port 443)) "
+         "(limits) (users alice bob carol))", "v4 after v0 released");
+  sexp_release(v2);
+  sexp_release(v4);
+
+  sdestroy(orig);
+  sexp_cleanup();
+
+  printf("persistent tests passed.\n");
+
+  exit(EXIT_SUCCESS);
+}
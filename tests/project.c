@@ -0,0 +1,182 @@
+/**
+
+SFSEXP: Small, Fast S-Expression Library version 1.0
+Written by Matthew Sottile (mjsottile@gmail.com)
+
+Copyright (2003-2006). The Regents of the University of California. This
+material was produced under U.S. Government contract W-7405-ENG-36 for Los
+Alamos National Laboratory, which is operated by the University of
+California for the U.S. Department of Energy. The U.S. Government has rights
+to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+derivative works, such modified software should be clearly marked, so as not
+to confuse it with the version available from LANL.
+
+Additionally, this library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation; either version 2.1 of the
+License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation,
+Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+LA-CC-04-094
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sexp.h"
+#include "test_util.h"
+
+/**
+ * parse with projections attached, whole and in pieces, and check that
+ * exactly the projected lists are built.
+ */
+
+typedef struct test {
+  const char *spec;
+  const char *input;
+  const char *expect;   /* expressions returned, separated by " | " */
+} test_t;
+
+static test_t tests[] = {
+  { "(config (server (port)) (log))",
+    "(config (server web (port 80) (host a)) (user b) (log x))",
+    "(config (server (port 80)) (log x))" },
+  /* top level expressions that are not kept are not returned */
+  { "(a)", "(a 1) (b 2) x \"s\" 'q '(a 5) (a 3) ()",
+    "(a 1) | (a 3)" },
+  /* strings, escapes, comments and quoted lists in dropped parts */
+  { "(r (keep))",
+    "(r (drop \"a)(\\\"\" a\\) ; ) (\n '(x ; y) (z)) \"b)\" (keep 1 \"(\") "
+    "'\"c)\" 'd ; (\n (keep (2)))",
+    "(r (keep 1 \"(\") (keep (2)))" },
+  { "(r (k))", "(r ((h) 1) () (k 2) (k))", "(r (k 2) (k))" },
+  { "(r (k))", "(r (x \001 y) (k 1) \001 z)", "(r (k 1))" },
+  { "(r (*))", "(r ((h) 1) () (k 2) x)", "(r ((h) 1) () (k 2))" },
+  { "(* (x))", "((h) (x) y) (a (x))", "((h) (x)) | (a (x))" },
+  /* a literal head is preferred to *, and patterns are merged */
+  { "(r (* (x)) (a)) (r (b (y)))",
+    "(r (a 1 (x 2)) (b (x 1) (y 2) (z 3)) (c (x 4) (y 5)))",
+    "(r (a 1 (x 2)) (b (y 2)) (c (x 4)))" },
+  { "(r (a)) (r (a (x)))", "(r (a 1 (x 2) (y 3)))", "(r (a 1 (x 2) (y 3)))" },
+  { "(\"*\")", "(* 1) (x 2) (\"*\" 3)", "(* 1) | (\"*\" 3)" },
+  { "(a (b (c)))", "(a (b (c 1) (d 2)) (b 3) (c 4)) (a (a (b (c))))",
+    "(a (b (c 1)) (b)) | (a)" },
+  { NULL, NULL, NULL }
+};
+
+static const char *bad[] = {
+  "", "x", "(a", "((a) b)", "(a b)", "(a (b) c)", NULL
+};
+
+static void collect(char *buf, sexp_t *sx) {
+  CSTRING *s = NULL;
+
+  print_sexp_cstr(&s, sx, 256);
+  check(s != NULL, "print");
+  if (buf[0] != '\0')
+    strcat(buf, " | ");
+  strcat(buf, toCharPtr(s));
+  sdestroy(s);
+}
+
+/* parse str with projection p in pieces of at most chunk bytes. */
+static void run(sexp_projection_t *p, const char *str, size_t chunk,
+                char *out) {
+  char buf[256];
+  size_t off, n;
+  pcont_t *cc;
+
+  cc = init_continuation(NULL);
+  check(cc != NULL, "continuation");
+  cc->projection = p;
+  out[0] = '\0';
+
+  for (off = 0; str[off] != '\0'; off += n) {
+    n = strlen(str + off);
+    if (n > chunk)
+      n = chunk;
+    memcpy(buf, str + off, n);
+    buf[n] = '\0';
+    cc->lastPos = NULL;
+    do {
+      cparse_sexp(buf, n, cc);
+      check(cc->error == SEXP_ERR_OK || cc->error == SEXP_ERR_INCOMPLETE,
+            "parse");
+      if (cc->last_sexp != NULL) {
+        collect(out, cc->last_sexp);
+        destroy_sexp(cc->last_sexp);
+        cc->last_sexp = NULL;
+      }
+    } while (cc->lastPos != NULL);
+  }
+
+  check(cc->depth == 0 && cc->stack->height == 0, "nothing left open");
+  destroy_continuation(cc);
+}
+
+int main(int argc, char **argv) {
+  sexp_projection_t *p;
+  char whole[1024], split[1024];
+  size_t chunk;
+  pcont_t *cc;
+  sexp_t *sx;
+  int i;
+
+  for (i = 0; tests[i].spec != NULL; i++) {
+    p = new_sexp_projection(tests[i].spec);
+    check(p != NULL, tests[i].spec);
+
+    run(p, tests[i].input, 1000, whole);
+    if (strcmp(whole, tests[i].expect) != 0) {
+      printf("%s: got '%s'\n", tests[i].spec, whole);
+      check(0, "projected parse");
+    }
+
+    for (chunk = 1; chunk < 8; chunk++) {
+      run(p, tests[i].input, chunk, split);
+      if (strcmp(whole, split) != 0) {
+        printf("%s: chunk %u got '%s'\n", tests[i].spec,
+               (unsigned) chunk, split);
+        check(0, "split projected parse");
+      }
+    }
+
+    destroy_sexp_projection(p);
+  }
+
+  for (i = 0; bad[i] != NULL; i++) {
+    check(new_sexp_projection(bad[i]) == NULL, bad[i]);
+    check(sexp_errno == SEXP_ERR_BAD_PARAM, "bad spec error");
+  }
+
+  /* inline binary mode ignores projections */
+  p = new_sexp_projection("(a)");
+  check(p != NULL, "binary projection");
+  cc = init_continuation(NULL);
+  check(cc != NULL, "binary continuation");
+  cc->mode = PARSER_INLINE_BINARY;
+  cc->projection = p;
+  sx = iparse_sexp("(b #b#1#) c)", 12, cc);
+  check(sx != NULL && sx->list->next->aty == SEXP_BINARY &&
+        sx->list->next->next != NULL, "binary parse");
+  destroy_sexp(sx);
+  destroy_continuation(cc);
+  destroy_sexp_projection(p);
+
+  sexp_cleanup();
+
+  printf("projection tests passed\n");
+
+  return 0;
+}
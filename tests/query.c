@@ -0,0 +1,193 @@
+/**
+
+SFSEXP: Small, Fast S-Expression Library version 1.0
+Written by Matthew Sottile (mjsottile@gmail.com)
+
+Copyright (2003-2006). The Regents of the University of California. This
+material was produced under U.S. Government contract W-7405-ENG-36 for Los
+Alamos National Laboratory, which is operated by the University of
+California for the U.S. Department of Energy. The U.S. Government has rights
+to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+derivative works, such modified software should be clearly marked, so as not
+to confuse it with the version available from LANL.
+
+Additionally, this library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation; either version 2.1 of the
+License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation,
+Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+LA-CC-04-094
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sexp.h"
+#include "test_util.h"
+
+/**
+ * run path queries over parsed trees and over the events-only parser,
+ * checking that both select the same elements.
+ */
+
+static const char *doc =
+  "(config (server (host a) (port 80)) (server (host \"b\") (port 8080)) "
+  "(client (port 1)))";
+
+static const char *doc2 = "(config (server (host c) (port 443)))";
+
+typedef struct test {
+  const char *query;
+  const char *expect;   /* selections from doc, separated by " | " */
+} test_t;
+
+static test_t tests[] = {
+  { "(config (server * (port ?)))", "80 | 8080" },
+  { "(// (port ?))", "80 | 8080 | 1" },
+  { "(config (@ 2 (server (host ?))))", "\"b\"" },
+  { "(config (? (server (host b))))", "(server (host \"b\") (port 8080))" },
+  { "(config (server (host a) ?))", "(host a) | (port 80)" },
+  { "(config (client))",
+    "(config (server (host a) (port 80)) (server (host \"b\") (port 8080)) "
+    "(client (port 1)))" },
+  { "(config (server (host \"a\") (port ?)))", "80" },
+  { "(config (nothing ?))", "" },
+  { "(config (client ()))", "" },
+  { "(* (// (? (port *))))", "(port 80) | (port 8080) | (port 1)" },
+  { NULL, NULL }
+};
+
+typedef struct result {
+  char buf[1024];
+  int n;
+  int stop_after;
+} result_t;
+
+static sexp_walk_t collect(sexp_t *sx, void *data) {
+  result_t *r = (result_t *)data;
+  CSTRING *s = NULL;
+
+  print_sexp_cstr(&s, sx, 256);
+  check(s != NULL, "print");
+  if (r->n++ > 0)
+    strcat(r->buf, " | ");
+  strcat(r->buf, toCharPtr(s));
+  sdestroy(s);
+
+  return (r->n == r->stop_after) ? SEXP_WALK_STOP : SEXP_WALK_CONTINUE;
+}
+
+/* feed str to the query stream in pieces of at most chunk bytes. */
+static void feed(pcont_t *cc, const char *str, size_t chunk) {
+  char buf[256];
+  size_t off, n;
+
+  for (off = 0; str[off] != '\0'; off += n) {
+    n = strlen(str + off);
+    if (n > chunk)
+      n = chunk;
+    memcpy(buf, str + off, n);
+    buf[n] = '\0';
+    cc->lastPos = NULL;
+    do {
+      cparse_sexp(buf, n, cc);
+      check(cc->error == SEXP_ERR_OK || cc->error == SEXP_ERR_INCOMPLETE,
+            "events parse");
+    } while (cc->lastPos != NULL);
+  }
+}
+
+static void run_stream(sexp_query_t *q, result_t *r, size_t chunk) {
+  sexp_query_stream_t *qs;
+  pcont_t *cc;
+
+  qs = new_sexp_query_stream(q, collect, r);
+  check(qs != NULL, "new_sexp_query_stream");
+  cc = init_continuation(NULL);
+  check(cc != NULL, "init_continuation");
+  sexp_query_attach(qs, cc);
+
+  feed(cc, doc, chunk);
+  feed(cc, doc2, chunk);
+
+  check(sexp_query_stream_count(qs) == r->n, "stream count");
+  destroy_continuation(cc);
+  destroy_sexp_query_stream(qs);
+}
+
+int main(int argc, char **argv) {
+  sexp_query_t *q;
+  sexp_t *sx, *sx2;
+  result_t tree, stream;
+  int i;
+
+  sx = parse_sexp((char *)doc, strlen(doc));
+  sx2 = parse_sexp((char *)doc2, strlen(doc2));
+  check(sx != NULL && sx2 != NULL, "parse");
+
+  for (i = 0; tests[i].query != NULL; i++) {
+    q = new_sexp_query(tests[i].query);
+    check(q != NULL, tests[i].query);
+
+    memset(&tree, 0, sizeof(tree));
+    check(sexp_query_run(q, sx, collect, &tree) == tree.n, "count");
+    if (strcmp(tree.buf, tests[i].expect) != 0) {
+      printf("%s: got '%s'\n", tests[i].query, tree.buf);
+      check(0, "tree selections");
+    }
+
+    /* the stream sees doc2 after doc, with whole and split input. */
+    check(sexp_query_run(q, sx2, collect, &tree) >= 0, "second tree");
+
+    memset(&stream, 0, sizeof(stream));
+    run_stream(q, &stream, 1000);
+    if (strcmp(tree.buf, stream.buf) != 0) {
+      printf("%s: tree '%s', stream '%s'\n", tests[i].query, tree.buf,
+             stream.buf);
+      check(0, "stream selections");
+    }
+
+    memset(&stream, 0, sizeof(stream));
+    run_stream(q, &stream, 7);
+    check(strcmp(tree.buf, stream.buf) == 0, "split stream selections");
+
+    destroy_sexp_query(q);
+  }
+
+  /* stopping early, in both modes. */
+  q = new_sexp_query("(// (port ?))");
+  check(q != NULL, "port query");
+  memset(&tree, 0, sizeof(tree));
+  tree.stop_after = 2;
+  check(sexp_query_run(q, sx, collect, &tree) == 2, "tree stop");
+  memset(&stream, 0, sizeof(stream));
+  stream.stop_after = 1;
+  run_stream(q, &stream, 1000);
+  check(strcmp(stream.buf, "80") == 0, "stream stop");
+  destroy_sexp_query(q);
+
+  /* malformed queries. */
+  check(new_sexp_query("(config (@ x p))") == NULL &&
+        sexp_errno == SEXP_ERR_BAD_PARAM, "bad position");
+  check(new_sexp_query("(@ 1 a)") == NULL, "position outside a list");
+  check(new_sexp_query("(config (? a b))") == NULL, "selection arity");
+  check(new_sexp_query("(config") == NULL, "incomplete query");
+
+  destroy_sexp(sx);
+  destroy_sexp(sx2);
+  sexp_cleanup();
+
+  return 0;
+}
@@ -0,0 +1,246 @@
+/**
+
+SFSEXP: Small, Fast S-Expression Library version 1.0
+Written by Matthew Sottile (mjsottile@gmail.com)
+
+Copyright (2003-2006). The Regents of the University of California. This
+material was produced under U.S. Government contract W-7405-ENG-36 for Los
+Alamos National Laboratory, which is operated by the University of
+California for the U.S. Department of Energy. The U.S. Government has rights
+to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+derivative works, such modified software should be clearly marked, so as not
+to confuse it with the version available from LANL.
+
+Additionally, this library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation; either version 2.1 of the
+License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation,
+Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+LA-CC-04-094
+
+**/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef WIN32
+# include <unistd.h>
+#endif
+#include "sexp.h"
+#include "sexp_query.h"
+#include "test_util.h"
+
+/**
+ * parse bad input with recovery on, whole and in pieces, and check that
+ * the expressions after each error come out and the bytes skipped over
+ * are counted.
+ */
+
+/* parse s in pieces of at most chunk bytes, printing the expressions
+   that come out into out, each followed by a space */
+static void run(pcont_t *cc, const char *s, size_t chunk, char *out) {
+  static char buf[4096];
+  size_t off, n;
+  sexp_t *sx;
+
+  out[0] = '\0';
+  cc->recover = 1;
+  for (off = 0; s[off] != '\0'; off += n) {
+    n = strlen(s + off);
+    if (n > chunk)
+      n = chunk;
+    memcpy(buf, s + off, n);
+    buf[n] = '\0';
+    do {
+      sx = iparse_sexp(buf, n, cc);
+      check(cc->error == SEXP_ERR_OK || cc->error == SEXP_ERR_INCOMPLETE,
+            "recovered");
+      if (sx != NULL) {
+        print_sexp(out + strlen(out), 256, sx);
+        strcat(out, " ");
+        destroy_sexp(sx);
+      }
+    } while (cc->lastPos != NULL);
+  }
+}
+
+/* s comes out as expect whole and in pieces, skipping the same bytes
+   each time; returns how many */
+static size_t expect(parsermode_t mode, unsigned int depth, size_t atom,
+                     size_t nodes, const char *s, const char *expect) {
+  static const size_t chunks[] = { 4096, 1, 2, 3, 5, 7 };
+  char out[1024];
+  size_t i, skipped = 0;
+  pcont_t *cc;
+
+  for (i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++) {
+    cc = init_continuation(NULL);
+    check(cc != NULL, "continuation");
+    cc->mode = mode;
+    cc->max_depth = depth;
+    cc->max_atom_bytes = atom;
+    cc->max_nodes = nodes;
+    run(cc, s, chunks[i], out);
+    check(strcmp(out, expect) == 0, out);
+    check(cc->depth == 0 && cc->resync == 0, "resynchronized");
+    if (i == 0)
+      skipped = cc->skipped;
+    check(cc->skipped == skipped, "skipped");
+    destroy_continuation(cc);
+  }
+  return skipped;
+}
+
+static int starts;
+
+static void start(void) {
+  starts++;
+}
+
+/* append what a query stream selects to the buffer in data */
+static sexp_walk_t selected(sexp_t *sx, void *data) {
+  char *out = (char *) data;
+
+  print_sexp(out + strlen(out), 256, sx);
+  strcat(out, " ");
+  return SEXP_WALK_CONTINUE;
+}
+
+int main(int argc, char **argv) {
+  char big[1024], out[256];
+  parser_event_handlers_t handlers;
+  pcont_t *cc;
+  sexp_t *sx;
+  int i;
+
+  /* a stray close paren is passed over */
+  check(expect(PARSER_NORMAL, 0, 0, 0, "(a) ) (b) ", "(a) (b) ") == 1,
+        "stray paren");
+
+  /* the rest of an expression over a limit is skipped */
+  check(expect(PARSER_NORMAL, 0, 0, 3, "(a b c d (e f)) (g) x ",
+               "(g) x ") == 9, "nodes");
+  expect(PARSER_NORMAL, 2, 0, 0,
+         "(a (b (c \")\" d ; )\n e) 'f)) (g) ", "(g) ");
+  check(expect(PARSER_NORMAL, 0, 4, 0, "abcdefg (g) ", "(g) ") == 0,
+        "too long where it ends");
+  expect(PARSER_NORMAL, 0, 4, 0, "(a \"b(c)de\" f) (g) ", "(g) ");
+  expect(PARSER_NORMAL, 0, 4, 0, "(a '(b (c \")\") d) e) (g) ", "(g) ");
+
+  /* long atoms are stopped before their end */
+  strcpy(big, "(a \"");
+  for (i = 0; i < 100; i++)
+    strcat(big, "x)(\\\"");
+  strcat(big, "\" b) (g) ");
+  expect(PARSER_NORMAL, 0, 100, 0, big, "(g) ");
+
+  strcpy(big, "(a '(");
+  for (i = 0; i < 30; i++)
+    strcat(big, "(y \")\" ");
+  for (i = 0; i < 30; i++)
+    strcat(big, ")");
+  strcat(big, ") b) (g) ");
+  expect(PARSER_NORMAL, 0, 100, 0, big, "(g) ");
+
+  /* binary data is skipped by its size */
+  expect(PARSER_INLINE_BINARY, 0, 4, 0, "(a #b#6#)))))) b) (g) ", "(g) ");
+  expect(PARSER_INLINE_BINARY, 0, 0, 2, "(a b #b#3#))) c) (g) ", "(g) ");
+  expect(PARSER_INLINE_BINARY, 0, 0, 2, "(a b #c#3#) (g) ", "(g) ");
+
+  /* a binary size that is not all digits drops its expression */
+  check(expect(PARSER_INLINE_BINARY, 0, 0, 0, "(a #b#-1#x) (g) ",
+               "(g) ") == 5, "negative size");
+  expect(PARSER_INLINE_BINARY, 0, 0, 0, "(a #b#1x#(c)) (g) ", "(g) ");
+
+  /* without recovery, the error stops the parse */
+  cc = init_continuation(NULL);
+  cc->max_nodes = 3;
+  strcpy(big, "(a b c d) (g) ");
+  sx = iparse_sexp(big, strlen(big), cc);
+  check(sx == NULL && cc->error == SEXP_ERR_LIMIT_NODES, "no recovery");
+  destroy_continuation(cc);
+
+  /* events */
+  memset(&handlers, 0, sizeof(handlers));
+  handlers.start_sexpr = start;
+  cc = init_continuation(NULL);
+  cc->mode = PARSER_EVENTS_ONLY;
+  cc->event_handlers = &handlers;
+  cc->max_depth = 1;
+  run(cc, "((a)) ) (b) ", 4096, out);
+  check(starts == 3 && cc->skipped == 4, "events");
+  destroy_continuation(cc);
+
+  /* a query stream sees the lists of a dropped expression ended, and
+     goes on matching what follows it */
+  {
+    static const size_t chunks[] = { 4096, 1, 3 };
+    sexp_query_t *q;
+    sexp_query_stream_t *qs;
+    char sel[256];
+    size_t j;
+
+    q = new_sexp_query("(port ?)");
+    check(q != NULL, "query");
+    for (j = 0; j < sizeof(chunks) / sizeof(chunks[0]); j++) {
+      sel[0] = '\0';
+      qs = new_sexp_query_stream(q, selected, sel);
+      check(qs != NULL, "query stream");
+      cc = init_continuation(NULL);
+      sexp_query_attach(qs, cc);
+      cc->max_depth = 2;
+      run(cc, "(port 0)(a (b (c (d))))(port 1)(port 2)", chunks[j], out);
+      check(strcmp(sel, "0 1 2 ") == 0, sel);
+      check(sexp_query_stream_count(qs) == 3, "query stream count");
+      destroy_continuation(cc);
+      destroy_sexp_query_stream(qs);
+    }
+    destroy_sexp_query(q);
+  }
+
+  /* validation, which is what events become without handlers */
+  check(expect(PARSER_EVENTS_ONLY, 0, 0, 3, "(a b c d (e f)) (g) x ", "")
+        == 9, "validated nodes");
+  expect(PARSER_EVENTS_ONLY, 2, 0, 0,
+         "(a (b (c \")\" d ; )\n e) 'f)) (g) ", "");
+
+#ifndef WIN32
+  {
+    sexp_iowrap_t *iow;
+    int fds[2];
+
+    /* the continuation of an io wrapper can recover before reading */
+    check(pipe(fds) == 0, "pipe");
+    strcpy(big, "(a) ) (b)\n");
+    check(write(fds[1], big, strlen(big)) == (ssize_t) strlen(big), "write");
+    close(fds[1]);
+    iow = init_iowrap(fds[0]);
+    check(iow != NULL && iow->cc != NULL, "io wrapper");
+    iow->cc->recover = 1;
+    sx = read_one_sexp(iow);
+    check(sx != NULL && strcmp(sx->list->val, "a") == 0, "first read");
+    destroy_sexp(sx);
+    sx = read_one_sexp(iow);
+    check(sx != NULL && strcmp(sx->list->val, "b") == 0, "second read");
+    destroy_sexp(sx);
+    destroy_iowrap(iow);
+    close(fds[0]);
+  }
+#endif
+
+  sexp_cleanup();
+
+  exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,181 @@
+/**
+
+SFSEXP: Small, Fast S-Expression Library version 1.0
+Written by Matthew Sottile (mjsottile@gmail.com)
+
+Copyright (2003-2006). The Regents of the University of California. This
+material was produced under U.S. Government contract W-7405-ENG-36 for Los
+Alamos National Laboratory, which is operated by the University of
+California for the U.S. Department of Energy. The U.S. Government has rights
+to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+derivative works, such modified software should be clearly marked, so as not
+to confuse it with the version available from LANL.
+
+Additionally, this library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation; either version 2.1 of the
+License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation,
+Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+LA-CC-04-094
+
+**/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sexp.h"
+#include "test_util.h"
+
+/**
+ * parse input given as segments, split at every place and in pieces of
+ * every size, and check that the expressions that come out are those of
+ * parsing it from one buffer.
+ */
+
+#ifndef WIN32
+static const char *input =
+  "(a (b \"c \\\" d\" 'e) #b#5#x(y)z) ; f (\n ghi \"k l\" '(m (n)) (o) ";
+
+/* parse the segments with cc until they have all been looked at,
+   printing the expressions, and where they came from in the input,
+   into out after what is there */
+static void run(pcont_t *cc, const struct iovec *iov, int iovcnt,
+                char *out, size_t outlen) {
+  size_t used, off, len;
+
+  do {
+    cc = cparse_sexpv(iov, iovcnt, cc);
+    check(cc->error == SEXP_ERR_OK || cc->error == SEXP_ERR_INCOMPLETE,
+          "error");
+    if (cc->last_sexp != NULL) {
+      used = strlen(out);
+      check(print_sexp(out + used, outlen - used, cc->last_sexp) >= 0,
+            "print");
+      used = strlen(out);
+      if (sexp_source_range(cc->last_sexp, &off, &len) == 0)
+        sprintf(out + used, "@%lu+%lu", (unsigned long) off,
+                (unsigned long) len);
+      strcat(out, "|");
+      destroy_sexp(cc->last_sexp);
+      cc->last_sexp = NULL;
+    }
+  } while (cc->lastPos != NULL);
+}
+
+static pcont_t *continuation(parsermode_t mode, size_t budget) {
+  pcont_t *cc = init_continuation(NULL);
+
+  check(cc != NULL, "continuation");
+  cc->mode = mode;
+  cc->work_budget = budget;
+  cc->track_source = 1;
+  return cc;
+}
+
+static void expect(parsermode_t mode, size_t budget) {
+  static char buf[4096];
+  char want[1024], got[1024];
+  struct iovec iov[256];
+  size_t len = strlen(input), i, j, piece;
+  pcont_t *cc;
+
+  strcpy(buf, input);
+
+  cc = continuation(mode, 0);
+  want[0] = '\0';
+  iov[0].iov_base = buf;
+  iov[0].iov_len = len;
+  run(cc, iov, 1, want, sizeof(want));
+  destroy_continuation(cc);
+  check(want[0] != '\0', "whole");
+
+  /* two segments, split at each place, with an empty one between */
+  for (i = 0; i <= len; i++) {
+    cc = continuation(mode, budget);
+    got[0] = '\0';
+    iov[0].iov_base = buf;
+    iov[0].iov_len = i;
+    iov[1].iov_base = buf + i;
+    iov[1].iov_len = 0;
+    iov[2].iov_base = buf + i;
+    iov[2].iov_len = len - i;
+    run(cc, iov, 3, got, sizeof(got));
+    check(strcmp(got, want) == 0, "split");
+    check(cc->src_base == len, "offset");
+    destroy_continuation(cc);
+  }
+
+  /* pieces of every size */
+  for (piece = 1; piece < 8; piece++) {
+    cc = continuation(mode, budget);
+    got[0] = '\0';
+    for (i = j = 0; i < len; i += piece, j++) {
+      iov[j].iov_base = buf + i;
+      iov[j].iov_len = (len - i < piece) ? len - i : piece;
+    }
+    run(cc, iov, (int) j, got, sizeof(got));
+    check(strcmp(got, want) == 0, "pieces");
+    destroy_continuation(cc);
+  }
+}
+
+int main(int argc, char **argv) {
+  char out[1024];
+  struct iovec iov[2];
+  char a[] = "(ab", b[] = "c d) e";
+  pcont_t *cc;
+
+  expect(PARSER_NORMAL, 0);
+  expect(PARSER_NORMAL, 3);
+  expect(PARSER_INLINE_BINARY, 0);
+  expect(PARSER_INLINE_BINARY, 2);
+
+  /* the atom split between segments comes out whole, and what is left
+     at the end goes on into the next call */
+  cc = continuation(PARSER_NORMAL, 0);
+  out[0] = '\0';
+  iov[0].iov_base = a;
+  iov[0].iov_len = strlen(a);
+  iov[1].iov_base = b;
+  iov[1].iov_len = strlen(b);
+  run(cc, iov, 2, out, sizeof(out));
+  check(strcmp(out, "(abc d)@0+7|") == 0, "joined");
+  iov[0].iov_base = b + 5;
+  iov[0].iov_len = 1;
+  run(cc, iov, 1, out, sizeof(out));
+  check(strcmp(out, "(abc d)@0+7|") == 0, "atom at the end");
+  iov[0].iov_base = b + 4;
+  iov[0].iov_len = 1;
+  run(cc, iov, 1, out, sizeof(out));
+  check(strcmp(out, "(abc d)@0+7|ee@8+2|") == 0, "atom continued");
+  destroy_continuation(cc);
+
+  /* no segments is no input */
+  cc = continuation(PARSER_NORMAL, 0);
+  check(cparse_sexpv(NULL, 1, cc) == cc &&
+        cc->error == SEXP_ERR_NULLSTRING, "null");
+  check(cparse_sexpv(iov, 0, cc) == cc &&
+        cc->error == SEXP_ERR_NULLSTRING, "empty");
+  destroy_continuation(cc);
+
+  sexp_cleanup();
+
+  exit(EXIT_SUCCESS);
+}
+#else
+int main(int argc, char **argv) {
+  return 0;
+}
+#endif
@@ -0,0 +1,201 @@
+/**
+
+SFSEXP: Small, Fast S-Expression Library version 1.0
+Written by Matthew Sottile (mjsottile@gmail.com)
+
+Copyright (2003-2006). The Regents of the University of California. This
+material was produced under U.S. Government contract W-7405-ENG-36 for Los
+Alamos National Laboratory, which is operated by the University of
+California for the U.S. Department of Energy. The U.S. Government has rights
+to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+derivative works, such modified software should be clearly marked, so as not
+to confuse it with the version available from LANL.
+
+Additionally, this library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation; either version 2.1 of the
+License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation,
+Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+LA-CC-04-094
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sexp.h"
+#include "test_util.h"
+
+/**
+ * parse with source tracking, whole and in pieces, check that the range
+ * of every element holds its text, and copy expressions out raw.
+ */
+
+static const char *input =
+  "(config ; the servers\n"
+  "  (server \"web\" (port 80) 'x '(a \"b)\" c))\n"
+  "  (server \"db\"  (port 5432)))\n"
+  "atom \"str\" (tail (x)) 'q\n";
+
+/* the text at an element's source range parses back to the element. */
+static sexp_walk_t check_range(sexp_t *sx, unsigned int depth, void *data) {
+  char text[512];
+  size_t off, len;
+  sexp_t *back;
+
+  check(sexp_source_range(sx, &off, &len) == 0, "range recorded");
+  check(off + len <= strlen(input), "range inside");
+  memcpy(text, input + off, len);
+  text[len] = ' ';
+  text[len + 1] = '\0';
+
+  back = parse_sexp(text, len + 1);
+  check(back != NULL && sexp_equal(back, sx) == 1, text);
+  destroy_sexp(back);
+
+  return SEXP_WALK_CONTINUE;
+}
+
+/* parse input in pieces of at most chunk bytes; returns the expressions */
+static int run(size_t chunk, sexp_t **out) {
+  char buf[256];
+  size_t off, n;
+  pcont_t *cc;
+  int count = 0;
+
+  cc = init_continuation(NULL);
+  check(cc != NULL, "continuation");
+  cc->track_source = 1;
+
+  for (off = 0; input[off] != '\0'; off += n) {
+    n = strlen(input + off);
+    if (n > chunk)
+      n = chunk;
+    memcpy(buf, input + off, n);
+    buf[n] = '\0';
+    cc->lastPos = NULL;
+    do {
+      cparse_sexp(buf, n, cc);
+      check(cc->error == SEXP_ERR_OK || cc->error == SEXP_ERR_INCOMPLETE,
+            "parse");
+      if (cc->last_sexp != NULL) {
+        out[count++] = cc->last_sexp;
+        cc->last_sexp = NULL;
+      }
+    } while (cc->lastPos != NULL);
+  }
+
+  destroy_continuation(cc);
+  return count;
+}
+
+static const size_t chunks[] = { 1, 2, 3, 4, 5, 6, 7, 1000 };
+
+int main(int argc, char **argv) {
+  char buf[512], expect[512], *big;
+  sexp_t *sx[8], *port;
+  size_t c, chunk, len;
+  pcont_t *cc;
+  int i, n;
+
+  /* split into pieces of 1 to 7 bytes, then whole */
+  for (c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++) {
+    chunk = chunks[c];
+    n = run(chunk, sx);
+    check(n == 5, "five expressions");
+    for (i = 0; i < n; i++) {
+      check(sexp_walk(sx[i], check_range, NULL, NULL) == NULL, "walk");
+      /* keep the first expression of the last run */
+      if (chunk != 1000 || i > 0)
+        destroy_sexp(sx[i]);
+    }
+  }
+
+  /* untouched, the whole text of the first expression is copied back */
+  n = sexp_emit_raw(buf, sizeof(buf), sx[0], input, strlen(input));
+  check(sexp_source_range(sx[0], NULL, &len) == 0 && n == (int)len &&
+        strncmp(buf, input, n) == 0, "raw copy");
+
+  /* change one port; the rest keeps its comments and layout */
+  port = sx[0]->list->next->list->next->next->list->next;
+  check(strcmp(port->val, "80") == 0, "port atom");
+  sexp_release_val(port);
+  port->val = (char *)sexp_malloc(5);
+  check(port->val != NULL, "new port");
+  memcpy(port->val, "8080", 5);
+  port->val_used = port->val_allocated = 5;
+  port->flags &= ~SEXP_FLAG_SOURCE;
+  sx[0]->flags &= ~SEXP_FLAG_SOURCE;
+  sx[0]->list->next->flags &= ~SEXP_FLAG_SOURCE;
+  sx[0]->list->next->list->next->next->flags &= ~SEXP_FLAG_SOURCE;
+
+  n = sexp_emit_raw(buf, sizeof(buf), sx[0], input, strlen(input));
+  strcpy(expect, "(config (server \"web\" (port 8080) 'x '(a \"b)\" c)) "
+         "(server \"db\"  (port 5432)))");
+  if (n < 0 || strcmp(buf, expect) != 0) {
+    printf("got '%s'\n", buf);
+    check(0, "raw copy with a change");
+  }
+
+  /* errors: short buffer, and source that does not cover the ranges */
+  check(sexp_emit_raw(buf, 10, sx[0], input, strlen(input)) == -1 &&
+        sexp_errno == SEXP_ERR_BUFFER_FULL, "buffer full");
+  check(sexp_emit_raw(buf, sizeof(buf), sx[0], input, 20) == -1 &&
+        sexp_errno == SEXP_ERR_BAD_PARAM, "short source");
+  destroy_sexp(sx[0]);
+
+  /* without tracking, nothing is recorded and everything is printed */
+  cc = init_continuation(NULL);
+  check(cc != NULL, "continuation");
+  sx[0] = iparse_sexp((char *)input, strlen(input), cc);
+  check(sx[0] != NULL && !(sx[0]->flags & SEXP_FLAG_SOURCE), "untracked");
+  n = sexp_emit_raw(buf, sizeof(buf), sx[0], input, strlen(input));
+  check(n > 0 && print_sexp(expect, sizeof(expect), sx[0]) == n &&
+        strcmp(buf, expect) == 0, "untracked emit");
+  destroy_sexp(sx[0]);
+  destroy_continuation(cc);
+
+  /* many ranges at once, some of them dropped as their elements go */
+  big = (char *)malloc(3 * 2000 + 1);
+  check(big != NULL, "big input");
+  big[0] = '\0';
+  for (i = 0; i < 3; i++) {
+    strcat(big, "(");
+    for (n = 0; n < 300; n++)
+      sprintf(big + strlen(big), "a%d ", n);
+    strcat(big, ")");
+  }
+  cc = init_continuation(NULL);
+  check(cc != NULL, "continuation");
+  cc->track_source = 1;
+  for (i = 0; i < 3; i++)
+    sx[i] = iparse_sexp(big, strlen(big), cc);
+  destroy_continuation(cc);
+  destroy_sexp(sx[1]);
+  for (i = 0; i < 3; i += 2) {
+    for (port = sx[i]->list; port != NULL; port = port->next) {
+      check(sexp_source_range(port, &c, &len) == 0 &&
+            len == port->val_used - 1 &&
+            strncmp(big + c, port->val, len) == 0, "many ranges");
+    }
+    destroy_sexp(sx[i]);
+  }
+  free(big);
+
+  sexp_cleanup();
+
+  printf("source range tests passed\n");
+
+  return 0;
+}
@@ -0,0 +1,72 @@
+/**
+
+SFSEXP: Small, Fast S-Expression Library version 1.0
+Written by Matthew Sottile (mjsottile@gmail.com)
+
+Copyright (2003-2006). The Regents of the University of California. This
+material was produced under U.S. Government contract W-7405-ENG-36 for Los
+Alamos National Laboratory, which is operated by the University of
+California for the U.S. Department of Energy. The U.S. Government has rights
+to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+derivative works, such modified software should be clearly marked, so as not
+to confuse it with the version available from LANL.
+
+Additionally, this library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation; either version 2.1 of the
+License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation,
+Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+LA-CC-04-094
+
+**/
+
+#ifndef __TEST_UTIL_H__
+#define __TEST_UTIL_H__
+
+/**
+ * helpers shared by the test programs.  Include after sexp.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __GNUC__
+#define TEST_UNUSED __attribute__((unused))
+#else
+#define TEST_UNUSED
+#endif
+
+/* stop the test with a message naming the failed check. */
+static TEST_UNUSED void check(int cond, const char *what) {
+  if (!cond) {
+    printf("FAILED: %s\n", what);
+    exit(EXIT_FAILURE);
+  }
+}
+
+/* check that sx prints as expect, showing what it printed if not. */
+static TEST_UNUSED void prints(const sexp_t *sx, const char *expect,
+                               const char *what) {
+  CSTRING *s = NULL;
+
+  print_sexp_cstr(&s, sx, 256);
+  if (s == NULL || strcmp(toCharPtr(s), expect) != 0) {
+    printf("got: %s\n", (s == NULL) ? "(null)" : toCharPtr(s));
+    check(0, what);
+  }
+  sdestroy(s);
+}
+
+#endif /* __TEST_UTIL_H__ */
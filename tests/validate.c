@@ -0,0 +1,174 @@
+/**
+
+SFSEXP: Small, Fast S-Expression Library version 1.0
+Written by Matthew Sottile (mjsottile@gmail.com)
+
+Copyright (2003-2006). The Regents of the University of California. This
+material was produced under U.S. Government contract W-7405-ENG-36 for Los
+Alamos National Laboratory, which is operated by the University of
+California for the U.S. Department of Energy. The U.S. Government has rights
+to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+derivative works, such modified software should be clearly marked, so as not
+to confuse it with the version available from LANL.
+
+Additionally, this library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation; either version 2.1 of the
+License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation,
+Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+LA-CC-04-094
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sexp.h"
+#include "test_util.h"
+
+/**
+ * check input with sexp_validate, and with a continuation fed in pieces,
+ * against what the parser makes of it.
+ */
+
+static const char *input =
+  "(a (b \"c)\" 'd '(e \"f)\" g))) x \"y\" ; (unclosed comment";
+
+/* binary sizes with something other than digits in them */
+static const char *sizes[] = { "(a #b#-1#x)", "(a #b#+1#x)", "(a #b#1x#x)" };
+
+static sexp_errcode_t validate(const char *s, parsermode_t mode,
+                               sexp_validate_info_t *info) {
+  memset(info, 0, sizeof(sexp_validate_info_t));
+  info->mode = mode;
+  return sexp_validate(s, strlen(s), info);
+}
+
+int main(int argc, char **argv) {
+  sexp_validate_info_t info;
+  char buf[64], *deep;
+  size_t i, n, off;
+  pcont_t *cc;
+  sexp_t *sx;
+
+  check(validate(input, PARSER_NORMAL, &info) == SEXP_ERR_OK, "valid");
+  check(info.exprs == 3, "expressions");
+  check(info.atoms == 7, "atoms");
+  check(info.max_depth == 2, "depth");
+  check(info.offset == strlen(input), "offset");
+  check(sexp_validate(input, strlen(input), NULL) == SEXP_ERR_OK, "no info");
+  check(validate("", PARSER_NORMAL, &info) == SEXP_ERR_OK &&
+        info.exprs == 0, "empty");
+
+  /* the parser agrees */
+  strcpy(buf, "(a b))");
+  check(validate(buf, PARSER_NORMAL, &info) == SEXP_ERR_BADFORM, "badform");
+  check(info.exprs == 1 && info.offset == 5, "badform offset");
+  cc = init_continuation(buf);
+  sx = iparse_sexp(buf, strlen(buf), cc);
+  destroy_sexp(sx);
+  sx = iparse_sexp(buf, strlen(buf), cc);
+  check(sx == NULL && cc->error == SEXP_ERR_BADFORM, "parser badform");
+  destroy_continuation(cc);
+
+  check(validate("(a (b", PARSER_NORMAL, &info) == SEXP_ERR_INCOMPLETE,
+        "open list");
+  check(validate("(a \"b)", PARSER_NORMAL, &info) == SEXP_ERR_INCOMPLETE,
+        "open string");
+  check(validate("'(a b", PARSER_NORMAL, &info) == SEXP_ERR_INCOMPLETE,
+        "open quoted list");
+  check(validate("(a b\\)", PARSER_NORMAL, &info) == SEXP_ERR_INCOMPLETE,
+        "escaped paren");
+  check(validate("(a) b", PARSER_NORMAL, &info) == SEXP_ERR_INCOMPLETE &&
+        info.exprs == 1, "atom at the end may go on");
+
+  /* binary atoms only in inline binary mode */
+  check(validate("(x #b#3#a)b y)", PARSER_INLINE_BINARY, &info) ==
+        SEXP_ERR_OK, "binary");
+  check(info.exprs == 1 && info.atoms == 3, "binary counts");
+  check(validate("(x #b#3#a)b y)", PARSER_NORMAL, &info) ==
+        SEXP_ERR_BADFORM, "no binary");
+  check(validate("(x #b#5#ab", PARSER_INLINE_BINARY, &info) ==
+        SEXP_ERR_INCOMPLETE, "short binary");
+  /* a binary size is digits only, for the parser as for validation */
+  for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    check(validate(sizes[i], PARSER_INLINE_BINARY, &info) ==
+          SEXP_ERR_BADFORM &&
+          info.offset == 6 + strspn(sizes[i] + 6, "0123456789"), sizes[i]);
+    cc = init_continuation(NULL);
+    cc->mode = PARSER_INLINE_BINARY;
+    strcpy(buf, sizes[i]);
+    sx = iparse_sexp(buf, strlen(buf), cc);
+    check(sx == NULL && cc->error == SEXP_ERR_BADFORM, sizes[i]);
+    destroy_continuation(cc);
+  }
+
+  memcpy(buf, "(#b#2#\0\0)", 9);
+  info.mode = PARSER_INLINE_BINARY;
+  check(sexp_validate(buf, 9, &info) == SEXP_ERR_OK &&
+        info.atoms == 1, "nul bytes in binary");
+
+  /* a nul byte anywhere else would end the parse early */
+  memcpy(buf, "(a)\0)))", 7);
+  info.mode = PARSER_NORMAL;
+  check(sexp_validate(buf, 7, &info) == SEXP_ERR_BADCONTENT &&
+        info.offset == 3 && info.exprs == 1, "nul after an expression");
+  memcpy(buf, "\0(((", 4);
+  check(sexp_validate(buf, 4, &info) == SEXP_ERR_BADCONTENT &&
+        info.offset == 0 && info.exprs == 0, "nul first");
+  memcpy(buf, "(a \0b)", 6);
+  check(sexp_validate(buf, 6, &info) == SEXP_ERR_BADCONTENT &&
+        info.offset == 3, "nul in a list");
+
+  /* nesting costs nothing */
+  n = 10000;
+  deep = (char *) malloc(2 * n + 1);
+  check(deep != NULL, "deep buffer");
+  memset(deep, '(', n);
+  memset(deep + n, ')', n);
+  deep[2 * n] = '\0';
+  check(validate(deep, PARSER_NORMAL, &info) == SEXP_ERR_OK &&
+        info.max_depth == n && info.exprs == 1, "deep");
+  free(deep);
+
+  /* a continuation validates input that comes in pieces */
+  for (n = 1; n < 8; n++) {
+    cc = init_continuation(NULL);
+    cc->mode = PARSER_EVENTS_ONLY;
+    memset(&info, 0, sizeof(info));
+    cc->validate_info = &info;
+    for (off = 0; input[off] != '\0'; off += i) {
+      i = strlen(input + off);
+      if (i > n)
+        i = n;
+      memcpy(buf, input + off, i);
+      buf[i] = '\0';
+      cc->lastPos = NULL;
+      do {
+        cparse_sexp(buf, i, cc);
+        check(cc->error == SEXP_ERR_OK ||
+              cc->error == SEXP_ERR_INCOMPLETE, "pieces");
+      } while (cc->lastPos != NULL);
+    }
+    check(info.exprs == 3 && info.atoms == 7 && info.max_depth == 2,
+          "pieces counts");
+    destroy_continuation(cc);
+  }
+
+  check(sexp_validate(NULL, 0, &info) == SEXP_ERR_NULLSTRING, "null");
+
+  sexp_cleanup();
+
+  exit(EXIT_SUCCESS);
+}
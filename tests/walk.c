@@ -0,0 +1,133 @@
+/**
+
+SFSEXP: Small, Fast S-Expression Library version 1.0
+Written by Matthew Sottile (mjsottile@gmail.com)
+
+Copyright (2003-2006). The Regents of the University of California. This
+material was produced under U.S. Government contract W-7405-ENG-36 for Los
+Alamos National Laboratory, which is operated by the University of
+California for the U.S. Department of Energy. The U.S. Government has rights
+to use, reproduce, and distribute this software. NEITHER THE GOVERNMENT NOR
+THE UNIVERSITY MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+LIABILITY FOR THE USE OF THIS SOFTWARE. If software is modified to produce
+derivative works, such modified software should be clearly marked, so as not
+to confuse it with the version available from LANL.
+
+Additionally, this library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation; either version 2.1 of the
+License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation,
+Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, U SA
+
+LA-CC-04-094
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sexp.h"
+#include "test_util.h"
+
+/**
+ * exercise sexp_walk directly, and the traversals built on it (find_sexp,
+ * copy_sexp) on an expression nested far deeper than a recursive walk
+ * could handle on a default sized stack.
+ */
+
+#define DEEP 200000
+
+static char order[256];
+static size_t olen = 0;
+
+static sexp_walk_t pre(sexp_t *sx, unsigned int depth, void *data) {
+  order[olen++] = (sx->ty == SEXP_LIST) ? '(' : sx->val[0];
+  order[olen++] = '0' + depth;
+  if (sx->ty == SEXP_VALUE && strcmp(sx->val, (char *)data) == 0)
+    return SEXP_WALK_STOP;
+  if (sx->ty == SEXP_LIST && sx->list != NULL &&
+      strcmp(sx->list->val, "skip") == 0)
+    return SEXP_WALK_SKIP;
+  return SEXP_WALK_CONTINUE;
+}
+
+static sexp_walk_t post(sexp_t *sx, unsigned int depth, void *data) {
+  order[olen++] = (sx->ty == SEXP_LIST) ? ')' : '.';
+  return SEXP_WALK_CONTINUE;
+}
+
+int main(int argc, char **argv) {
+  char *buf, *a, *b;
+  size_t i, n = 0;
+  sexp_t *sx, *cp, *found;
+  CSTRING *s1 = NULL, *s2 = NULL;
+
+#ifdef _SEXP_LIMIT_MEMORY_
+  /* these expressions need far more than the default limit. */
+  set_sexp_max_memory(1024*1024*1024);
+#endif
+
+  sx = parse_sexp("(a (b c) (skip d) () e)", 23);
+  check(sx != NULL, "parse");
+
+  check(sexp_walk(sx, pre, post, "none") == NULL, "walk to completion");
+  order[olen] = '\0';
+  check(strcmp(order, "(0a1.(1b2.c2.)(1)(1)e1.)") == 0, "walk order");
+
+  olen = 0;
+  found = sexp_walk(sx, pre, post, "c");
+  order[olen] = '\0';
+  check(found != NULL && strcmp(found->val, "c") == 0, "walk stop");
+  check(strcmp(order, "(0a1.(1b2.c2") == 0, "walk order with stop");
+
+  check(sexp_walk(NULL, pre, post, "c") == NULL, "walk of NULL");
+  destroy_sexp(sx);
+
+  /* deeply nested expression with a trailing atom at each level. */
+  buf = malloc(DEEP*4+8);
+  for (i = 0; i < DEEP; i++)
+    buf[n++] = '(';
+  memcpy(buf+n, "leaf", 4);
+  n += 4;
+  for (i = 0; i < DEEP; i++) {
+    buf[n++] = ' ';
+    buf[n++] = 'x';
+    buf[n++] = ')';
+  }
+  buf[n] = '\0';
+
+  sx = parse_sexp(buf, n);
+  check(sx != NULL, "parse deep");
+  free(buf);
+
+  found = find_sexp("leaf", sx);
+  check(found != NULL && strcmp(found->val, "leaf") == 0, "find_sexp deep");
+  check(find_sexp("missing", sx) == NULL, "find_sexp missing");
+
+  cp = copy_sexp(sx);
+  check(cp != NULL, "copy_sexp deep");
+
+  print_sexp_cstr(&s1, sx, 1024);
+  print_sexp_cstr(&s2, cp, 1024);
+  a = toCharPtr(s1);
+  b = toCharPtr(s2);
+  check(a != NULL && b != NULL && strcmp(a, b) == 0, "copy matches");
+
+  sdestroy(s1);
+  sdestroy(s2);
+  destroy_sexp(sx);
+  destroy_sexp(cp);
+  sexp_cleanup();
+
+  printf("walk tests passed.\n");
+
+  exit(EXIT_SUCCESS);
+}